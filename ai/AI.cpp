@@ -75,7 +75,7 @@ void AI::randomize_aim_inaccuracy() {
 void AI::update(const GameLogic& logic, uint64_t diff) {
 	set_logic(&logic);
 
-	m_pathfinder.set_physics(logic.get_world());
+	m_pathfinder.set_physics(logic.get_world(), logic.get_static_geometry());
 
 	// Deal with MapGrapher if necessary:
 	// If we don't know anything about the map, start learning about it.
@@ -85,11 +85,12 @@ void AI::update(const GameLogic& logic, uint64_t diff) {
 
 	// If the MapGrapher is not done, continue it:
 	if (!m_grapher.is_done_mapping()) {
-		m_grapher.do_mapping(1);
+		m_grapher.do_mapping(false);
 
 		// We're done now, let's output the results
 		if (m_grapher.is_done_mapping()) {
-			m_grapher.write_map(logic.get_map()->get_name());
+			m_grapher.write_map(logic.get_map());
+			m_pathfinder.update_graph();
 		}
 	}
 	
@@ -166,7 +167,7 @@ float AI::time_to_impact(const Player* player) const {
 		return 0;
 	}
 
-	RayCast cast(world);
+	RayCast cast(world, m_logic->get_static_geometry());
 	float found_distance = cast.cast_in_vel_dir(player);
 	
 	return to_game(found_distance) / player->get_velocity().get_magnitude();
@@ -179,7 +180,7 @@ float AI::can_see_player(const Player* player, const Player* other_player, float
 		return 0;
 	}
 
-	RayCast cast(world);
+	RayCast cast(world, m_logic->get_static_geometry());
 	b2Vec2 start_pos = b2Vec2(to_physics(player->get_x()), to_physics(player->get_y()));
 	float dist = cast.cast_at_player(start_pos, other_player, max_radius);
 	return dist;
@@ -194,7 +195,7 @@ float AI::can_see_gate(const Player* player, const Gate* gate, float max_radius)
 		return 0;
 	}
 	
-	RayCast cast(world);
+	RayCast cast(world, m_logic->get_static_geometry());
 	float dist = cast.cast_at_obstacle(ray_start, gate, max_radius, true);
 	
 	return dist;
@@ -226,8 +227,9 @@ void AI::initialize_map_grapher() {
 	m_grapher.load_map(m_logic, world);
 	
 	m_pathfinder.set_graph(get_map_graph());
-	m_pathfinder.set_physics(world);
+	m_pathfinder.set_physics(world, m_logic->get_static_geometry());
 	m_pathfinder.set_timeout(500);
+	m_pathfinder.set_incremental(true);
 }
 
 Pathfinder* AI::get_pathfinder() {
@@ -50,7 +50,7 @@ AggressiveState::~AggressiveState() {
 
 void AggressiveState::load_rules() {
 	// Load the rules.
-	m_rule_dangerous =
+	m_rule_dangerous.compile(
 		new FuzzyLogic::Not(
 			new FuzzyLogic::Or(
 				new FuzzyLogic::And(
@@ -59,9 +59,10 @@ void AggressiveState::load_rules() {
 				),
 				m_fuzzy->make_terminal("other_energy_percent","frozen")
 			)
-		);
+		)
+	);
 	
-	m_rule_can_target =
+	m_rule_can_target.compile(
 		new FuzzyLogic::And(
 			new FuzzyLogic::And(
 				new FuzzyLogic::Not(
@@ -88,9 +89,10 @@ void AggressiveState::load_rules() {
 				m_fuzzy->make_terminal("gun_cooldown", "ready"),
 				m_fuzzy->make_terminal("gun_cooldown", "almost_ready")
 			)
-		);
+		)
+	);
 	
-	m_rule_firing_importance =
+	m_rule_firing_importance.compile(
 		new FuzzyLogic::And(
 			new FuzzyLogic::And(
 				// Are we in danger of dying soon?
@@ -155,9 +157,10 @@ void AggressiveState::load_rules() {
 					)
 				)
 			)
-		);
+		)
+	);
 	
-	m_rule_run_away = 
+	m_rule_run_away.compile(
 		new FuzzyLogic::And(
 			// Can we jump soon?
 			new FuzzyLogic::Or(
@@ -185,9 +188,10 @@ void AggressiveState::load_rules() {
 				// Are they capturing our gate?
 				m_fuzzy->make_terminal("other_holding_gate", "not_holding")
 			)
-		);
+		)
+	);
 	
-	m_rule_jump_at_gate = 
+	m_rule_jump_at_gate.compile(
 		new FuzzyLogic::And(
 			// Can we jump soon?
 			new FuzzyLogic::Or(
@@ -210,9 +214,10 @@ void AggressiveState::load_rules() {
 					m_fuzzy->make_terminal("holding_gate", "not_holding")
 				)
 			)
-		);
+		)
+	);
 	
-	m_rule_dont_jump = 
+	m_rule_dont_jump.compile(
 		new FuzzyLogic::Or(
 			new FuzzyLogic::And(
 				// Is our cooldown nearly ready for firing?
@@ -235,9 +240,10 @@ void AggressiveState::load_rules() {
 					m_fuzzy->make_terminal("holding_gate", "not_holding")
 				)
 			)
-		);
+		)
+	);
 	
-	m_rule_weapon_fitness = 
+	m_rule_weapon_fitness.compile(
 		new FuzzyLogic::Or(
 			new FuzzyLogic::And(
 				m_fuzzy->make_terminal("weap_damage_at_player", "freeze"),
@@ -254,9 +260,10 @@ void AggressiveState::load_rules() {
 					m_fuzzy->make_terminal("weap_freeze_time", "none")
 				)
 			)
-		);
+		)
+	);
 		
-	m_rule_holding_gate = 
+	m_rule_holding_gate.compile(
 		new FuzzyLogic::And(
 			new FuzzyLogic::Not(
 				m_fuzzy->make_terminal("other_holding_gate", "not_holding")
@@ -270,7 +277,8 @@ void AggressiveState::load_rules() {
 					)
 				)
 			)
-		);
+		)
+	);
 }
 
 const string& AggressiveState::get_name() const {
@@ -296,14 +304,17 @@ int AggressiveState::get_curr_weapon() const {
 void AggressiveState::decide(FuzzyLogicAI* ai, FuzzyEnvironment* env, const GameLogic& logic) {
 	const Player* my_player = ai->get_own_player();
 
-	ConstIterator<std::pair<uint32_t, Player*> > other_players = logic.list_players();
+	const std::vector<Player*>& other_players = logic.get_players();
 	Player* best_target = NULL;
 	float best_target_val = 0.0f;
+
+	// Apply the rules to every entity at once
+	m_rule_dangerous.apply(*env, &m_dangerous_scores);
+	m_rule_can_target.apply(*env, &m_can_target_scores);
+
 	// Determine danger for each enemy player.
-	while (other_players.has_more()) {
-		std::pair<uint32_t, Player*> next_iter = other_players.next();
-		
-		Player* other_player = next_iter.second;
+	for (std::vector<Player*>::const_iterator next_iter(other_players.begin()); next_iter != other_players.end(); ++next_iter) {
+		Player* other_player = *next_iter;
 		if (other_player == my_player) {
 			continue;
 		}
@@ -313,9 +324,9 @@ void AggressiveState::decide(FuzzyLogicAI* ai, FuzzyEnvironment* env, const Game
 			continue;
 		}
 		
-		float dangerous = m_rule_dangerous->apply(*env, (long)other_player);
+		float dangerous = get_score(m_dangerous_scores, env, (long)other_player);
 		
-		float can_target = m_rule_can_target->apply(*env, (long)other_player);
+		float can_target = get_score(m_can_target_scores, env, (long)other_player);
 		
 		float target_val = dangerous * can_target;
 		
@@ -355,10 +366,13 @@ bool AggressiveState::check_switch_weapons(FuzzyLogicAI* ai, const GameLogic& lo
 		
 		ConstIterator<Weapon*> weapons = logic.list_weapons();
 
+		// Apply the rules to every entity at once
+		m_rule_weapon_fitness.apply(*env, &m_weapon_fitness_scores);
+
 		while (weapons.has_more()) {
 			Weapon* weapon = weapons.next();
 		
-			float weapon_fitness = m_rule_weapon_fitness->apply(*env, get_combo_id(m_target, weapon));
+			float weapon_fitness = get_score(m_weapon_fitness_scores, env, get_combo_id(m_target, weapon));
 		
 			// Favor the current weapon.
 			if (weapon->get_id() == ai->get_curr_weapon() && weapon_fitness >= 0.95f) {
@@ -402,20 +416,20 @@ void AggressiveState::update_wanted_aim(FuzzyLogicAI* ai, const GameLogic& logic
 	
 	if (m_target != NULL) {
 		// Determine importance of aiming at target.
-		float dangerous = m_rule_dangerous->apply(*env, (long)m_target);
+		float dangerous = m_rule_dangerous.apply(*env, (long)m_target);
 		
-		float can_target = m_rule_can_target->apply(*env, (long)m_target);
+		float can_target = m_rule_can_target.apply(*env, (long)m_target);
 		
-		float firing_importance = m_rule_firing_importance->apply(*env, (long)m_target);
+		float firing_importance = m_rule_firing_importance.apply(*env, (long)m_target);
 		
 		aim_at_target = (int)(dangerous * can_target * firing_importance * 100.0f);
 		
 		// Determine if we should jump at the gate.
-		aim_at_gate = m_rule_jump_at_gate->apply(*env, (long)m_target) * 100;
+		aim_at_gate = m_rule_jump_at_gate.apply(*env, (long)m_target) * 100;
 	
 		// Determine if we should run away.
-		float run_away = m_rule_run_away->apply(*env, (long)m_target);
-		float dont_jump = m_rule_dont_jump->apply(*env, (long)m_target);
+		float run_away = m_rule_run_away.apply(*env, (long)m_target);
+		float dont_jump = m_rule_dont_jump.apply(*env, (long)m_target);
 		aim_to_jump = (run_away - dont_jump) * 100 - aim_at_target/2.0f;
 		if (aim_to_jump < 0) {
 			aim_to_jump = 0;
@@ -545,19 +559,20 @@ void AggressiveState::check_transitions(FuzzyLogicAI* ai, const GameLogic& logic
 	const Gate* my_gate = logic.get_map()->get_gate(my_player->get_team());
 	float map_size = sqrt(logic.get_map()->get_width() * logic.get_map()->get_width() + logic.get_map()->get_height() * logic.get_map()->get_height());
 	
-	ConstIterator<std::pair<uint32_t, Player*> > other_players = logic.list_players();
+	const std::vector<Player*>& other_players = logic.get_players();
 
 	bool found_enemy = false;
 	bool found_gate_hold = false;
 	int num_enemies_attacking = 0;
 	int num_allies_defending = 0;
 
+	// Apply the rules to every entity at once
+	m_rule_holding_gate.apply(*env, &m_holding_gate_scores);
+
 	// Check if anyone is holding the gate.
 	// Also check if anyone is on your side of the field.
-	while (other_players.has_more()) {
-		std::pair<uint32_t, Player*> next_iter = other_players.next();
-		
-		Player* other_player = next_iter.second;
+	for (std::vector<Player*>::const_iterator next_iter(other_players.begin()); next_iter != other_players.end(); ++next_iter) {
+		Player* other_player = *next_iter;
 		if (other_player == my_player) {
 			continue;
 		}
@@ -575,7 +590,7 @@ void AggressiveState::check_transitions(FuzzyLogicAI* ai, const GameLogic& logic
 			}
 			continue;
 		} else {
-			float holding_gate = m_rule_holding_gate->apply(*env, (long)other_player);
+			float holding_gate = get_score(m_holding_gate_scores, env, (long)other_player);
 		
 			if (holding_gate > .5) {
 				found_gate_hold = true;
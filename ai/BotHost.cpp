@@ -0,0 +1,127 @@
+/*
+ * ai/BotHost.cpp
+ *
+ * This file is part of Leges Motus, a networked, 2D shooter set in zero gravity.
+ * 
+ * Copyright 2009-2011 Andrew Ayer, Nathan Partlan, Jeffrey Pfau
+ * 
+ * Leges Motus is free and open source software.  You may redistribute it and/or
+ * modify it under the terms of version 2, or (at your option) version 3, of the
+ * GNU General Public License (GPL), as published by the Free Software Foundation.
+ * 
+ * Leges Motus is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.  See the full text of the GNU General Public License for
+ * further detail.
+ * 
+ * For a full copy of the GNU General Public License, please see the COPYING file
+ * in the root of the source code tree.  You may also retrieve a copy from
+ * <http://www.gnu.org/licenses/gpl-2.0.txt>, or request a copy by writing to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ * 02111-1307  USA
+ * 
+ */
+
+#include "BotHost.hpp"
+#include "common/Map.hpp"
+#include "common/file.hpp"
+#include "common/timer.hpp"
+#include <fstream>
+#include <sstream>
+#include <iterator>
+
+using namespace LM;
+using namespace std;
+
+BotHost::Bot::Bot(BotHost* host, Configuration* config, const string& name) : m_ai(config), m_controller(&m_ai) {
+	m_host = host;
+	diff = 0;
+
+	set_config(config);
+	set_controller(&m_controller);
+	set_name(name);
+}
+
+bool BotHost::Bot::read_map(Map* map, const string& map_name) {
+	return m_host->read_map(map, map_name);
+}
+
+BotHost::BotHost(Configuration* config, size_t nbr_threads) : m_pool(nbr_threads) {
+	m_config = config;
+
+	// These are set up the first time they're used, so do it before there are other threads
+	user_dir();
+	resource_dir();
+}
+
+BotHost::~BotHost() {
+	for (size_t i = 0; i < m_bots.size(); ++i) {
+		m_bots[i]->disconnect();
+		delete m_bots[i];
+	}
+}
+
+void BotHost::add_bot(const string& name) {
+	m_bots.push_back(new Bot(this, m_config, name));
+}
+
+void BotHost::connect(const IPAddress& server_address) {
+	for (size_t i = 0; i < m_bots.size(); ++i) {
+		m_bots[i]->connect(server_address);
+	}
+}
+
+bool BotHost::read_map(Map* map, const string& map_name) {
+	MapFiles::iterator it(m_map_files.find(map_name));
+	if (it == m_map_files.end()) {
+		ifstream file;
+		open_resource(&file, (string("maps") + PATH_SEP + map_name + ".map").c_str());
+		if (!file) {
+			return false;
+		}
+		string contents((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+		it = m_map_files.insert(make_pair(map_name, contents)).first;
+	}
+
+	istringstream file(it->second);
+	return map->load(file);
+}
+
+void BotHost::update_bot(void* bot) {
+	Bot* b = static_cast<Bot*>(bot);
+	b->update_controller(b->diff);
+}
+
+void BotHost::step(uint64_t diff) {
+	m_active_bots.clear();
+	for (size_t i = 0; i < m_bots.size(); ++i) {
+		Bot* bot = m_bots[i];
+		bot->diff = diff;
+		if (bot->begin_step()) {
+			m_active_bots.push_back(bot);
+		}
+	}
+
+	if (!m_active_bots.empty()) {
+		m_pool.run_all(update_bot, &m_active_bots[0], m_active_bots.size());
+	}
+
+	for (size_t i = 0; i < m_active_bots.size(); ++i) {
+		Bot* bot = static_cast<Bot*>(m_active_bots[i]);
+		bot->finish_step();
+	}
+}
+
+void BotHost::run() {
+	uint64_t last_time = get_ticks();
+	while (true) {
+		uint64_t current_time = get_ticks();
+		step(current_time - last_time);
+
+		if ((get_ticks() - current_time) < 17) {
+			msleep(17 - (get_ticks() - current_time));
+		}
+
+		last_time = current_time;
+	}
+}
@@ -0,0 +1,107 @@
+/*
+ * ai/BotHost.hpp
+ *
+ * This file is part of Leges Motus, a networked, 2D shooter set in zero gravity.
+ * 
+ * Copyright 2009-2011 Andrew Ayer, Nathan Partlan, Jeffrey Pfau
+ * 
+ * Leges Motus is free and open source software.  You may redistribute it and/or
+ * modify it under the terms of version 2, or (at your option) version 3, of the
+ * GNU General Public License (GPL), as published by the Free Software Foundation.
+ * 
+ * Leges Motus is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.  See the full text of the GNU General Public License for
+ * further detail.
+ * 
+ * For a full copy of the GNU General Public License, please see the COPYING file
+ * in the root of the source code tree.  You may also retrieve a copy from
+ * <http://www.gnu.org/licenses/gpl-2.0.txt>, or request a copy by writing to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ * 02111-1307  USA
+ * 
+ */
+
+#ifndef LM_AI_BOTHOST_HPP
+#define LM_AI_BOTHOST_HPP
+
+#include "client/Client.hpp"
+#include "common/ThreadPool.hpp"
+#include "AIController.hpp"
+#include "FuzzyLogicAI.hpp"
+#include <map>
+#include <string>
+#include <vector>
+
+namespace LM {
+	class Configuration;
+	class IPAddress;
+	class Map;
+
+	/*
+	 * Runs a number of AI clients in one process.
+	 *
+	 * Each bot is a Client with its own connection to the server, its own view of the game,
+	 * and its own weapons (which keep track of their cooldowns), but the bots share what they'd
+	 * otherwise each load: the configuration, the map files, and the graph of each map (see
+	 * PathGraph::acquire_shared()).
+	 *
+	 * Networking and the game logic run on the thread which calls step(), and then the bots' AIs
+	 * decide what to do in parallel on a ThreadPool.
+	 */
+	class BotHost {
+	private:
+		class Bot : public Client {
+		private:
+			BotHost* m_host;
+			FuzzyLogicAI m_ai;
+			AIController m_controller;
+
+		protected:
+			virtual bool read_map(Map* map, const std::string& map_name);
+
+		public:
+			uint64_t diff;		// The time to step the controller by
+
+			Bot(BotHost* host, Configuration* config, const std::string& name);
+
+			using Client::begin_step;
+			using Client::update_controller;
+			using Client::finish_step;
+		};
+		friend class Bot;
+
+		typedef std::map<std::string, std::string> MapFiles; // The contents of each map file, by map name
+
+		Configuration* m_config;
+		std::vector<Bot*> m_bots;
+		std::vector<void*> m_active_bots; // The bots whose controllers are updated this step
+		MapFiles m_map_files;
+		ThreadPool m_pool;
+
+		static void update_bot(void* bot);
+		bool read_map(Map* map, const std::string& map_name);
+
+		// Not copyable
+		BotHost(const BotHost&);
+		BotHost& operator=(const BotHost&);
+
+	public:
+		// Use the given number of threads for the AIs, or one per processor if 0
+		explicit BotHost(Configuration* config, size_t nbr_threads = 0);
+		~BotHost();
+
+		void add_bot(const std::string& name);
+		void connect(const IPAddress& server_address);
+
+		// Step every bot by diff milliseconds
+		void step(uint64_t diff);
+		// Step the bots forever, at (up to) 60 steps per second
+		void run();
+
+		size_t get_nbr_bots() const { return m_bots.size(); }
+		size_t get_nbr_threads() const { return m_pool.get_nbr_threads(); }
+	};
+}
+
+#endif
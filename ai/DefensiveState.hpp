@@ -45,14 +45,20 @@ namespace LM {
 		AI::AimReason m_aim_reason;
 		
 		// Fuzzy Logic Rules
-		FuzzyLogic::Rule* m_rule_dangerous;
-		FuzzyLogic::Rule* m_rule_can_target;
-		FuzzyLogic::Rule* m_rule_firing_importance;
-		FuzzyLogic::Rule* m_rule_run_away;
-		FuzzyLogic::Rule* m_rule_jump_own_gate;
-		FuzzyLogic::Rule* m_rule_dont_jump;
-		FuzzyLogic::Rule* m_rule_weapon_fitness;
-		FuzzyLogic::Rule* m_rule_holding_gate;
+		FuzzyLogic::Program m_rule_dangerous;
+		FuzzyLogic::Program m_rule_can_target;
+		FuzzyLogic::Program m_rule_firing_importance;
+		FuzzyLogic::Program m_rule_run_away;
+		FuzzyLogic::Program m_rule_jump_own_gate;
+		FuzzyLogic::Program m_rule_dont_jump;
+		FuzzyLogic::Program m_rule_weapon_fitness;
+		FuzzyLogic::Program m_rule_holding_gate;
+		
+		// The scores of every entity, from the last time each rule was applied to them all
+		std::vector<float> m_dangerous_scores;
+		std::vector<float> m_can_target_scores;
+		std::vector<float> m_weapon_fitness_scores;
+		std::vector<float> m_holding_gate_scores;
 		
 		void load_rules();
 		bool check_switch_weapons(FuzzyLogicAI* ai, const GameLogic& logic, FuzzyEnvironment* env);
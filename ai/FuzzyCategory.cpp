@@ -63,6 +63,7 @@ void FuzzyCategory::apply(FuzzyEnvironment::Subenv results) const {
 	while (input.has_more()) {
 		int bid = 0;
 		pair<long, float> in_pair = input.next();
+		int entity = results.add_entity(in_pair.first);
 		for (vector<Bin>::const_iterator iter = m_bins.begin(); iter != m_bins.end(); ++iter, ++bid) {
 			float value = in_pair.second;
 			float result = 0.0f;
@@ -76,7 +77,7 @@ void FuzzyCategory::apply(FuzzyEnvironment::Subenv results) const {
 			} else if (value >= b.start - b.grade_width) {
 				result = (value - b.start + b.grade_width)/b.grade_width;
 			}
-			results.set(in_pair.first, bid, result);
+			results.set_value(entity, bid, result);
 		}
 	}
 }
@@ -23,6 +23,7 @@
  */
 
 #include "FuzzyEnvironment.hpp"
+#include <algorithm>
 
 using namespace LM;
 using namespace std;
@@ -36,10 +37,18 @@ void FuzzyEnvironment::Subenv::set(long id, int bin, float value) {
 	m_e->set(m_cat, id, bin, value);
 }
 
+void FuzzyEnvironment::Subenv::set_value(int entity, int bin, float value) {
+	m_e->set_value(m_cat, entity, bin, value);
+}
+
 float FuzzyEnvironment::Subenv::get(long id, int bin) const {
 	return m_e->get(m_cat, id, bin);
 }
 
+int FuzzyEnvironment::Subenv::add_entity(long id) {
+	return m_e->add_entity(id);
+}
+
 ConstIterator<pair<long, float> > FuzzyEnvironment::Subenv::get_input() const {
 	return m_e->get_input(m_cat);
 }
@@ -48,67 +57,155 @@ void FuzzyEnvironment::Subenv::clear() {
 	m_e->clear(m_cat);
 }
 
+FuzzyEnvironment::FuzzyEnvironment() {
+	m_stride = 0;
+}
+
+FuzzyEnvironment::Category& FuzzyEnvironment::get_category(int cat) {
+	if (m_cats.size() <= (size_t) cat) {
+		Category empty;
+		empty.nbins = 0;
+		m_cats.resize(cat + 1, empty);
+	}
+	return m_cats[cat];
+}
+
+const FuzzyEnvironment::Category* FuzzyEnvironment::find_category(int cat) const {
+	if (m_cats.size() <= (size_t) cat) {
+		return NULL;
+	}
+	return &m_cats[cat];
+}
+
+void FuzzyEnvironment::reserve_entities(size_t nbr_entities) {
+	if (nbr_entities <= m_stride) {
+		return;
+	}
+
+	size_t stride = max<size_t>(max<size_t>(16, m_stride * 2), nbr_entities);
+	for (vector<Category>::iterator iter = m_cats.begin(); iter != m_cats.end(); ++iter) {
+		vector<float> values(iter->nbins * stride, 0.0f);
+		for (int bin = 0; bin < iter->nbins; ++bin) {
+			copy(iter->values.begin() + bin * m_stride, iter->values.begin() + (bin + 1) * m_stride, values.begin() + bin * stride);
+		}
+		iter->values.swap(values);
+	}
+	m_stride = stride;
+}
+
+int FuzzyEnvironment::add_entity(long id) {
+	map<long, int>::iterator iter = m_entities.lower_bound(id);
+	if (iter != m_entities.end() && iter->first == id) {
+		return iter->second;
+	}
+
+	int entity = m_ids.size();
+	reserve_entities(entity + 1);
+	m_ids.push_back(id);
+	m_entities.insert(iter, make_pair(id, entity));
+	return entity;
+}
+
+int FuzzyEnvironment::find_entity(long id) const {
+	map<long, int>::const_iterator iter = m_entities.find(id);
+	if (iter == m_entities.end()) {
+		return -1;
+	}
+	return iter->second;
+}
+
 void FuzzyEnvironment::set(int cat, int bin, float value) {
 	set(cat, 0L, bin, value);
 }
 
 void FuzzyEnvironment::set(int cat, long id, int bin, float value) {
-	m_env[cat][id][bin] = value;
+	set_value(cat, add_entity(id), bin, value);
 }
 
 void FuzzyEnvironment::set(int cat, void* id, int bin, float value) {
 	set(cat, (long) id, bin, value);
 }
 
+void FuzzyEnvironment::set_value(int cat, int entity, int bin, float value) {
+	Category& category = get_category(cat);
+	if (category.nbins <= bin) {
+		category.nbins = bin + 1;
+		category.values.resize(category.nbins * m_stride, 0.0f);
+	}
+	category.values[bin * m_stride + entity] = value;
+}
+
 float FuzzyEnvironment::get(int cat, int bin) const {
 	return get(cat, 0L, bin);
 }
 
 float FuzzyEnvironment::get(int cat, long id, int bin) const {
-	return m_env.find(cat)->second.find(id)->second.find(bin)->second;
+	int entity = find_entity(id);
+	const float* values = get_bin(cat, bin);
+	if (entity < 0 || values == NULL) {
+		return 0.0f;
+	}
+	return values[entity];
 }
 
 float FuzzyEnvironment::get(int cat, void* id, int bin) const {
 	return get(cat, (long) id, bin);
 }
 
+const float* FuzzyEnvironment::get_bin(int cat, int bin) const {
+	const Category* category = find_category(cat);
+	if (category == NULL || category->nbins <= bin) {
+		return NULL;
+	}
+	return &category->values[bin * m_stride];
+}
+
 void FuzzyEnvironment::set_input(int cat, float value) {
-	m_input[cat].clear();
-	m_input[cat][0L] = value;
+	map<long, float>& input = get_category(cat).input;
+	input.clear();
+	input[0L] = value;
 }
 
 void FuzzyEnvironment::set_input(int cat, const map<long, float>& input) {
-	m_input[cat] = input;
+	get_category(cat).input = input;
 }
 
 void FuzzyEnvironment::add_input(int cat, long id, float value) {
-	m_input[cat][id] = value;
+	get_category(cat).input[id] = value;
 }
 
 void FuzzyEnvironment::add_input(int cat, void* id, float value) {
-	m_input[cat][(long) id] = value;
+	add_input(cat, (long) id, value);
 }
 
 ConstIterator<pair<long, float> > FuzzyEnvironment::get_input(int cat) const {
-	if (m_input.find(cat) == m_input.end()) {
+	const Category* category = find_category(cat);
+	if (category == NULL) {
 		return ConstIterator<pair<long, float> >(new ConstIterator<pair<long, float> >::Null);
 	} else {
-		return ConstIterator<pair<long, float> >(new ConstStdMapIterator<long, float>(&m_input.find(cat)->second));
+		return ConstIterator<pair<long, float> >(new ConstStdMapIterator<long, float>(&category->input));
 	}
 }
 
 void FuzzyEnvironment::clear() {
-	m_env.clear();
-	m_input.clear();
+	// Keep the storage, so that it doesn't need to be reallocated next time
+	m_ids.clear();
+	m_entities.clear();
+	for (vector<Category>::iterator iter = m_cats.begin(); iter != m_cats.end(); ++iter) {
+		iter->nbins = 0;
+		iter->values.clear();
+		iter->input.clear();
+	}
 }
 
 void FuzzyEnvironment::clear(int cat) {
-	if (m_env.find(cat) != m_env.end()) {
-		m_env[cat].clear();
-	}
-	if (m_input.find(cat) != m_input.end()) {
-		m_input[cat].clear();
+	if (m_cats.size() <= (size_t) cat) {
+		return;
 	}
+	Category& category = m_cats[cat];
+	category.nbins = 0;
+	category.values.clear();
+	category.input.clear();
 }
 
 FuzzyEnvironment::Subenv FuzzyEnvironment::subset(int cat) {
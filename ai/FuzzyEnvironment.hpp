@@ -26,9 +26,19 @@
 #define LM_AI_FUZZYENVIRONMENT_HPP
 
 #include <map>
+#include <vector>
+#include <stddef.h>
 #include "common/Iterator.hpp"
 
 namespace LM {
+	/*
+	 * The inputs to a FuzzyLogic, and how much each of them falls in each bin of its category.
+	 *
+	 * Inputs are given for entities (players, gates, ...), identified by a long.  Each entity is
+	 * numbered in the order it's first seen, and the values are stored densely, bin by bin:
+	 * get_bin() returns one value for every entity, so a rule can be evaluated for every entity
+	 * in one go (see FuzzyLogic::Program).  An entity which has no value in a bin has 0.
+	 */
 	class FuzzyEnvironment {
 	public:
 		class Subenv {
@@ -40,7 +50,9 @@ namespace LM {
 			Subenv(FuzzyEnvironment* parent, int category);
 
 			void set(long id, int bin, float value);
+			void set_value(int entity, int bin, float value);
 			float get(long id, int bin) const;
+			int add_entity(long id);
 
 			ConstIterator<std::pair<long, float> > get_input() const;
 
@@ -48,17 +60,43 @@ namespace LM {
 		};
 
 	private:
-		std::map<int, std::map<long, std::map<int, float> > > m_env;
-		std::map<int, std::map<long, float> > m_input;
+		struct Category {
+			int nbins;
+			std::vector<float> values;	// Entity e's value in bin b is at values[b * m_stride + e]
+			std::map<long, float> input;
+		};
+
+		std::vector<long> m_ids;		// The id of each entity
+		std::map<long, int> m_entities;		// The entity with each id
+		size_t m_stride;			// How many entities there's room for in each bin
+		std::vector<Category> m_cats;
+
+		Category& get_category(int cat);
+		const Category* find_category(int cat) const;
+		void reserve_entities(size_t nbr_entities);
 
 	public:
+		FuzzyEnvironment();
+
 		void set(int cat, int bin, float value);
 		void set(int cat, long id, int bin, float value);
 		void set(int cat, void* id, int bin, float value);
+		void set_value(int cat, int entity, int bin, float value);
 		float get(int cat, int bin) const;
 		float get(int cat, long id, int bin) const;
 		float get(int cat, void* id, int bin) const;
 
+		// The number of the entity with the given id, adding it if necessary
+		int add_entity(long id);
+		// The number of the entity with the given id, or -1 if there isn't one
+		int find_entity(long id) const;
+		size_t get_nbr_entities() const { return m_ids.size(); }
+		long get_entity_id(int entity) const { return m_ids[entity]; }
+
+		// The value of every entity in the given bin (get_nbr_entities() of them), or NULL if
+		// no entity has a value in it
+		const float* get_bin(int cat, int bin) const;
+
 		void set_input(int cat, float value);
 		void set_input(int cat, const std::map<long, float>& input);
 		void add_input(int cat, long id, float value);
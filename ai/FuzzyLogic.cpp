@@ -27,18 +27,13 @@
 #include "common/Exception.hpp"
 
 #include <sstream>
+#include <algorithm>
 
 using namespace LM;
 using namespace std;
 
-float FuzzyLogic::Rule::apply(const FuzzyEnvironment& values, long id) const {
-	throw Exception("Null Rule invoked");
-}
-
-void FuzzyLogic::Rule::apply(const FuzzyEnvironment& values, map<long, float>* output) const {
-	for (map<long, float>::iterator iter = output->begin(); iter != output->end(); ++iter) {
-		iter->second = apply(values, iter->first);
-	}
+int FuzzyLogic::Rule::compile(vector<Instruction>* code) const {
+	throw Exception("Null Rule compiled");
 }
 
 FuzzyLogic::Terminal::Terminal(int cat, int bin) {
@@ -46,8 +41,10 @@ FuzzyLogic::Terminal::Terminal(int cat, int bin) {
 	m_bin = bin;
 }
 
-float FuzzyLogic::Terminal::apply(const FuzzyEnvironment& values, long id) const {
-	return values.get(m_cat, id, m_bin);
+int FuzzyLogic::Terminal::compile(vector<Instruction>* code) const {
+	Instruction load = { Instruction::LOAD, m_cat, m_bin };
+	code->push_back(load);
+	return 1;
 }
 
 FuzzyLogic::And::And(const Rule* lhs, const Rule* rhs) {
@@ -60,8 +57,12 @@ FuzzyLogic::And::~And() {
 	delete m_rhs;
 }
 
-float FuzzyLogic::And::apply(const FuzzyEnvironment& values, long id) const {
-	return min<float>(m_lhs->apply(values, id), m_rhs->apply(values, id));
+int FuzzyLogic::And::compile(vector<Instruction>* code) const {
+	int lhs_depth = m_lhs->compile(code);
+	int rhs_depth = m_rhs->compile(code);
+	Instruction op = { Instruction::AND, 0, 0 };
+	code->push_back(op);
+	return max(lhs_depth, rhs_depth + 1);
 }
 
 FuzzyLogic::Or::Or(const Rule* lhs, const Rule* rhs) {
@@ -74,8 +75,12 @@ FuzzyLogic::Or::~Or() {
 	delete m_rhs;
 }
 
-float FuzzyLogic::Or::apply(const FuzzyEnvironment& values, long id) const {
-	return max<float>(m_lhs->apply(values, id), m_rhs->apply(values, id));
+int FuzzyLogic::Or::compile(vector<Instruction>* code) const {
+	int lhs_depth = m_lhs->compile(code);
+	int rhs_depth = m_rhs->compile(code);
+	Instruction op = { Instruction::OR, 0, 0 };
+	code->push_back(op);
+	return max(lhs_depth, rhs_depth + 1);
 }
 
 FuzzyLogic::Not::Not(const Rule* op) {
@@ -86,8 +91,100 @@ FuzzyLogic::Not::~Not() {
 	delete m_op;
 }
 
-float FuzzyLogic::Not::apply(const FuzzyEnvironment& values, long id) const {
-	return 1.0f - m_op->apply(values, id);
+int FuzzyLogic::Not::compile(vector<Instruction>* code) const {
+	int depth = m_op->compile(code);
+	Instruction op = { Instruction::NOT, 0, 0 };
+	code->push_back(op);
+	return depth;
+}
+
+FuzzyLogic::Program::Program() {
+	m_depth = 0;
+}
+
+void FuzzyLogic::Program::compile(Rule* rule) {
+	m_code.clear();
+	m_depth = rule->compile(&m_code);
+	delete rule;
+}
+
+float FuzzyLogic::Program::apply(const FuzzyEnvironment& values, long id) const {
+	if (m_code.empty()) {
+		return 0.0f;
+	}
+
+	int entity = values.find_entity(id);
+	m_stack.resize(m_depth);
+	float* stack = &m_stack[0];
+	int top = -1;
+	for (vector<Instruction>::const_iterator iter = m_code.begin(); iter != m_code.end(); ++iter) {
+		switch (iter->op) {
+		case Instruction::LOAD: {
+			const float* bin = values.get_bin(iter->cat, iter->bin);
+			stack[++top] = (bin != NULL && entity >= 0) ? bin[entity] : 0.0f;
+			break;
+		}
+		case Instruction::AND:
+			--top;
+			stack[top] = min<float>(stack[top], stack[top + 1]);
+			break;
+		case Instruction::OR:
+			--top;
+			stack[top] = max<float>(stack[top], stack[top + 1]);
+			break;
+		case Instruction::NOT:
+			stack[top] = 1.0f - stack[top];
+			break;
+		}
+	}
+	return stack[0];
+}
+
+void FuzzyLogic::Program::apply(const FuzzyEnvironment& values, vector<float>* results) const {
+	size_t n = values.get_nbr_entities();
+	results->assign(n, 0.0f);
+	if (m_code.empty() || n == 0) {
+		return;
+	}
+
+	m_stack.resize(m_depth * n);
+	float* top = NULL;
+	for (vector<Instruction>::const_iterator iter = m_code.begin(); iter != m_code.end(); ++iter) {
+		switch (iter->op) {
+		case Instruction::LOAD: {
+			top = top == NULL ? &m_stack[0] : top + n;
+			const float* bin = values.get_bin(iter->cat, iter->bin);
+			if (bin != NULL) {
+				copy(bin, bin + n, top);
+			} else {
+				fill(top, top + n, 0.0f);
+			}
+			break;
+		}
+		case Instruction::AND: {
+			const float* rhs = top;
+			top -= n;
+			for (size_t i = 0; i < n; ++i) {
+				top[i] = rhs[i] < top[i] ? rhs[i] : top[i];
+			}
+			break;
+		}
+		case Instruction::OR: {
+			const float* rhs = top;
+			top -= n;
+			for (size_t i = 0; i < n; ++i) {
+				top[i] = rhs[i] > top[i] ? rhs[i] : top[i];
+			}
+			break;
+		}
+		case Instruction::NOT:
+			for (size_t i = 0; i < n; ++i) {
+				top[i] = 1.0f - top[i];
+			}
+			break;
+		}
+	}
+	copy(top, top + n, results->begin());
 }
 
 FuzzyLogic::FuzzyLogic(const string& section) : m_section(section) {
@@ -95,9 +192,7 @@ FuzzyLogic::FuzzyLogic(const string& section) : m_section(section) {
 }
 
 FuzzyLogic::~FuzzyLogic() {
-	for (vector<Rule*>::iterator iter = m_rules.begin(); iter != m_rules.end(); ++iter) {
-		delete *iter;
-	}
+	// Nothing to do
 }
 
 int FuzzyLogic::add_category(const string& name) {
@@ -184,7 +279,8 @@ bool FuzzyLogic::load_category(const Configuration* config, const string& catego
 int FuzzyLogic::add_rule(const string& name, Rule* rule) {
 	int id = m_rules.size();
 	m_rule_ids[name] = id;
-	m_rules.push_back(rule);
+	m_rules.push_back(Program());
+	m_rules.back().compile(rule);
 	return id;
 }
 
@@ -207,7 +303,7 @@ float FuzzyLogic::decide(int rule, const FuzzyEnvironment& env) const {
 
 float FuzzyLogic::decide(int rule, long id, const FuzzyEnvironment& env) const {
 	ASSERT((size_t) rule < m_rules.size());
-	return m_rules[rule]->apply(env, id);	
+	return m_rules[rule].apply(env, id);	
 }
 
 float FuzzyLogic::decide(int rule, void* id, const FuzzyEnvironment& env) const {
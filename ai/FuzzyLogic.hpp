@@ -34,11 +34,25 @@
 namespace LM {
 	class FuzzyLogic {
 	public:
+		struct Instruction {
+			enum Opcode {
+				LOAD,	// Push the values in a bin
+				AND,	// Pop two values, and push the lesser
+				OR,	// Pop two values, and push the greater
+				NOT	// Replace the top value v with 1 - v
+			};
+
+			Opcode op;
+			int cat;
+			int bin;
+		};
+
+		// Rules are built as trees of these, and then compiled into a Program
 		class Rule {
 		public:
 			virtual ~Rule() {}
-			virtual float apply(const FuzzyEnvironment& values, long id) const;
-			virtual void apply(const FuzzyEnvironment& values, std::map<long, float>* output) const;
+			// Append the instructions which evaluate this rule, and return how many values they push
+			virtual int compile(std::vector<Instruction>* code) const;
 		};
 
 		class Terminal : public Rule {
@@ -48,7 +62,7 @@ namespace LM {
 
 		public:
 			Terminal(int cat, int bin);
-			virtual float apply(const FuzzyEnvironment& values, long id) const;
+			virtual int compile(std::vector<Instruction>* code) const;
 		};
 
 		class And : public Rule {
@@ -59,7 +73,7 @@ namespace LM {
 		public:
 			And(const Rule* lhs, const Rule* rhs);
 			virtual ~And();
-			virtual float apply(const FuzzyEnvironment& values, long id) const;
+			virtual int compile(std::vector<Instruction>* code) const;
 		};
 
 		class Or : public Rule {
@@ -70,7 +84,7 @@ namespace LM {
 		public:
 			Or(const Rule* lhs, const Rule* rhs);
 			virtual ~Or();
-			virtual float apply(const FuzzyEnvironment& values, long id) const;
+			virtual int compile(std::vector<Instruction>* code) const;
 		};
 
 		class Not : public Rule {
@@ -80,14 +94,38 @@ namespace LM {
 		public:
 			Not(const Rule* op);
 			virtual ~Not();
-			virtual float apply(const FuzzyEnvironment& values, long id) const;
+			virtual int compile(std::vector<Instruction>* code) const;
+		};
+
+		/*
+		 * A rule compiled into a flat list of instructions for a stack machine.
+		 *
+		 * Each value on the stack is a row with one value for every entity in the environment
+		 * (see FuzzyEnvironment::get_bin()), so the rule is evaluated for all of them at once,
+		 * in loops over contiguous floats which the compiler can vectorize.
+		 */
+		class Program {
+		private:
+			std::vector<Instruction> m_code;
+			int m_depth; // The most values on the stack at once
+			mutable std::vector<float> m_stack;
+
+		public:
+			Program();
+
+			// Replace the program with the given rule, which is deleted once it's been compiled
+			void compile(Rule* rule);
+
+			float apply(const FuzzyEnvironment& values, long id) const;
+			// Set results[e] to the rule's value for every entity e in the environment
+			void apply(const FuzzyEnvironment& values, std::vector<float>* results) const;
 		};
 
 	private:
 		std::vector<FuzzyCategory> m_cats;
 		std::map<std::string, int> m_cat_ids;
 
-		std::vector<Rule*> m_rules;
+		std::vector<Program> m_rules;
 		std::map<std::string, int> m_rule_ids;
 
 		std::string m_section;
@@ -103,6 +141,7 @@ namespace LM {
 
 		bool load_category(const Configuration* config, const std::string& category);
 
+		// The rule is compiled, and deleted
 		int add_rule(const std::string& name, Rule* rule);
 		int get_rule_id(const std::string& name) const;
 
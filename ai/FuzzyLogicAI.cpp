@@ -194,12 +194,10 @@ void FuzzyLogicAI::populate_environment() {
 	const Gate* allied_gate = logic->get_map()->get_gate(my_player->get_team());
 	
 	// Populate each category for each of the other players.
-	ConstIterator<std::pair<uint32_t, Player*> > other_players = logic->list_players();
+	const std::vector<Player*>& other_players = logic->get_players();
 	
-	while (other_players.has_more()) {
-		std::pair<uint32_t, Player*> next_iter = other_players.next();
-		
-		Player* other_player = next_iter.second;
+	for (std::vector<Player*>::const_iterator next_iter(other_players.begin()); next_iter != other_players.end(); ++next_iter) {
+		Player* other_player = *next_iter;
 		if (other_player == my_player) {
 			continue;
 		}
@@ -24,6 +24,7 @@
 
 #include "FuzzyLogicState.hpp"
 #include "common/Weapon.hpp"
+#include "FuzzyEnvironment.hpp"
 
 using namespace LM;
 using namespace std;
@@ -31,3 +32,11 @@ using namespace std;
 long FuzzyLogicState::get_combo_id(const Player* player, const Weapon* weapon) {
 	return (weapon->get_id() | (player->get_id() << 16));
 }
+
+float FuzzyLogicState::get_score(const vector<float>& scores, const FuzzyEnvironment* env, long id) const {
+	int entity = env->find_entity(id);
+	if (entity < 0 || (size_t) entity >= scores.size()) {
+		return 0.0f;
+	}
+	return scores[entity];
+}
@@ -26,6 +26,7 @@
 #define LM_AI_FUZZYLOGICSTATE_HPP
 
 #include "AI.hpp"
+#include <vector>
 
 namespace LM {
 	class FuzzyEnvironment;
@@ -48,6 +49,8 @@ namespace LM {
 
 		virtual void decide(FuzzyLogicAI* ai, FuzzyEnvironment* env, const GameLogic& logic) = 0;
 		long get_combo_id(const Player* player, const Weapon* weapon);
+		// The score of the entity with the given id, from a rule applied to every entity
+		float get_score(const std::vector<float>& scores, const FuzzyEnvironment* env, long id) const;
 	};
 }
 
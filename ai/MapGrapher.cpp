@@ -30,7 +30,19 @@
 #include "common/MapObject.hpp"
 #include "common/GameLogic.hpp"
 #include "common/Player.hpp"
+#include "common/file.hpp"
+#include "common/Exception.hpp"
 #include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+
+#ifdef __WIN32
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
 
 using namespace LM;
 using namespace std;
@@ -41,17 +53,28 @@ const int MapGrapher::BUFFER_ANGLE = 30;
 const float MapGrapher::MULTI_CAST_WIDTH = .9f;
 const bool MapGrapher::MULTI_CAST = true;
 
+namespace {
+	// Bots in the same process share the temporary graph file
+	Mutex graph_file_mutex;
+}
+
 MapGrapher::MapGrapher() {
 	m_physics = NULL;
 	m_graph = NULL;
+	m_snapshot = NULL;
+	m_next_segment = 0;
+	m_cancelled = false;
 	
 	objects_mapped = 0;
 	sides_mapped = 0;
 	entries_mapped = 0;
 	entries_skipped = 0;
+	mapping_time = 0;
+	nbr_workers = 0;
 }
 
 MapGrapher::~MapGrapher() {
+	stop_workers();
 	delete m_graph;
 }
 
@@ -66,8 +89,6 @@ void MapGrapher::map_object(b2Body* body) {
 	
 	b2Fixture* fixture = body->GetFixtureList();
 	
-	b2Vec2 body_pos = body->GetPosition();
-	
 	// For each fixture:
 	while (fixture != NULL) {
 		if (fixture->IsSensor()) {
@@ -86,20 +107,21 @@ void MapGrapher::map_object(b2Body* body) {
 		int index = 0;
 		
 		// Compute the world point, and put it in the set of lines.
-		b2Vec2 last_vertex;
+		Segment segment;
 		while (index < polyshape->GetVertexCount()) {
 			b2Vec2 world_vertex = body->GetWorldPoint(polyshape->GetVertex(index));
 			
 			if (index > 0) {
-				map_segment(last_vertex, world_vertex, obj);
+				segment.end = world_vertex;
+				m_segments.push_back(segment);
 			}
 			
-			last_vertex.x = world_vertex.x;
-			last_vertex.y = world_vertex.y;
+			segment.start = world_vertex;
 			index++;
 		}
 		// Map the last vertex back to the first.
-		map_segment(last_vertex, body->GetWorldPoint(polyshape->GetVertex(0)), obj);
+		segment.end = body->GetWorldPoint(polyshape->GetVertex(0));
+		m_segments.push_back(segment);
 		
 		fixture = fixture->GetNext();
 	}
@@ -107,11 +129,57 @@ void MapGrapher::map_object(b2Body* body) {
 	objects_mapped++;
 }
 
-void MapGrapher::map_segment(b2Vec2 start, b2Vec2 end, PhysicsObject* obj) {
-	start.x = to_game(start.x);
-	start.y = to_game(start.y);
-	end.x = to_game(end.x);
-	end.y = to_game(end.y);
+void MapGrapher::add_snapshot_body(const b2Body* body) {
+	const PhysicsObject* obj = static_cast<const PhysicsObject*>(body->GetUserData());
+	if (obj->get_type() == PhysicsObject::MAP_OBJECT && !static_cast<const MapObject*>(obj)->is_collidable()) {
+		// Rays go through it anyways
+		return;
+	}
+
+	b2BodyDef body_def;
+	body_def.position = body->GetPosition();
+	body_def.angle = body->GetAngle();
+	b2Body* copy = m_snapshot->CreateBody(&body_def);
+	copy->SetUserData(&m_snapshot_object);
+
+	for (const b2Fixture* fixture = body->GetFixtureList(); fixture != NULL; fixture = fixture->GetNext()) {
+		if (!fixture->IsSensor()) {
+			copy->CreateFixture(fixture->GetShape(), 0.0f);
+		}
+	}
+}
+
+void MapGrapher::Worker::run(void* arg) {
+	Worker* worker = static_cast<Worker*>(arg);
+	MapGrapher* grapher = worker->grapher;
+	size_t nbr_workers = grapher->m_workers.size();
+
+	// Each worker takes every nbr_workers'th segment
+	for (size_t i = worker->index; i < grapher->m_segments.size(); i += nbr_workers) {
+		{
+			Mutex::Lock lock(grapher->m_mutex);
+			if (grapher->m_cancelled) {
+				return;
+			}
+		}
+
+		worker->map_segment(grapher->m_segments[i], grapher->m_results[i]);
+
+		Mutex::Lock lock(grapher->m_mutex);
+		++worker->nbr_done;
+	}
+}
+
+void MapGrapher::Worker::map_segment(const Segment& segment, SegmentResult& result) {
+	const float dist_change = grapher->dist_change;
+	const float theta_change = grapher->theta_change;
+
+	result.mapped = false;
+	result.entries_mapped = 0;
+	result.entries_skipped = 0;
+
+	b2Vec2 start(to_game(segment.start.x), to_game(segment.start.y));
+	b2Vec2 end(to_game(segment.end.x), to_game(segment.end.y));
 	b2Vec2 temp_vec(start.x, start.y);
 	temp_vec -= end;
 	float length = temp_vec.Length();
@@ -120,15 +188,13 @@ void MapGrapher::map_segment(b2Vec2 start, b2Vec2 end, PhysicsObject* obj) {
 	
 	SparseIntersectMap::Intersect isect;
 	
-	int entries_checked = 0;
-	
 	// Ignore sides that are outside the map and oriented outwards.
 	float dirnorm = get_normalized_angle(dir-90);
 	if (start.x < 0 && dirnorm > 90 && dirnorm < 270) {
 		return;
 	}
 
-	if (start.x > m_width && (dirnorm < 90 || dirnorm > 270)) {
+	if (start.x > grapher->m_width && (dirnorm < 90 || dirnorm > 270)) {
 		return;
 	}
 	
@@ -136,9 +202,11 @@ void MapGrapher::map_segment(b2Vec2 start, b2Vec2 end, PhysicsObject* obj) {
 		return;
 	}
 	
-	if (start.y > m_height && dirnorm < 180 && dirnorm >= 1) {
+	if (start.y > grapher->m_height && dirnorm < 180 && dirnorm >= 1) {
 		return;
 	}
+
+	result.mapped = true;
 	
 	// Go a little ways into the shape, so we don't accidentally start inside another shape as well,
 	// which would cause Box2D to ignore the other shape when raycasting, and give us incorrect results.
@@ -153,97 +221,208 @@ void MapGrapher::map_segment(b2Vec2 start, b2Vec2 end, PhysicsObject* obj) {
 			
 			float normalized_angle = to_radians(get_normalized_angle(angle));
 			
-			// Check if we already have a match for this angle:
-			if (m_graph->get(temp_vec.x, temp_vec.y, to_degrees(normalized_angle), &isect)) {
-				entries_skipped++;
+			// Check if we already have a match for this angle.  (The graph itself is checked when
+			// the results are merged - this just avoids ray-casting the same entry over and over.)
+			if (visited->get(temp_vec.x, temp_vec.y, to_degrees(normalized_angle), &isect)) {
+				result.entries_skipped++;
 				continue;
 			}
 			
-			entries_checked++;
-			
 			// Cast a ray where the player's head would be.
-			m_ray_cast.do_ray_cast(b2Vec2(to_physics(temp_vec.x), to_physics(temp_vec.y)), normalized_angle, -1, obj);
-			
-			RayCast::RayCastResult& result = m_ray_cast.get_result();
+			RayCast::Ray rays[3];
+			RayCast::RayCastResult results[3];
+			rays[0].start = b2Vec2(to_physics(temp_vec.x), to_physics(temp_vec.y));
+			rays[0].direction = normalized_angle;
+			rays[0].distance = -1;
+			rays[0].start_object = NULL;
+			rays[0].ignore_collidable = false;
 			
 			if (MULTI_CAST) {
 				// Cast a second ray where the player's feet would be.
 				temp_vec2.x = temp_vec.x + to_physics(Player::PLAYER_HEIGHT*MULTI_CAST_WIDTH) * cos(to_radians(dir));
 				temp_vec2.y = temp_vec.y + to_physics(Player::PLAYER_HEIGHT*MULTI_CAST_WIDTH) * sin(to_radians(dir));
-			
-				m_ray_cast2.do_ray_cast(b2Vec2(to_physics(temp_vec2.x), to_physics(temp_vec2.y)), normalized_angle, -1, obj);
-			
-				RayCast::RayCastResult& result2 = m_ray_cast2.get_result();
+				rays[1] = rays[0];
+				rays[1].start = b2Vec2(to_physics(temp_vec2.x), to_physics(temp_vec2.y));
 				
 				// Cast a third ray where the player's feet would be on the other side.
 				temp_vec3.x = temp_vec.x + to_physics(Player::PLAYER_HEIGHT*MULTI_CAST_WIDTH) * cos(to_radians(dir-180));
 				temp_vec3.y = temp_vec.y + to_physics(Player::PLAYER_HEIGHT*MULTI_CAST_WIDTH) * sin(to_radians(dir-180));
+				rays[2] = rays[0];
+				rays[2].start = b2Vec2(to_physics(temp_vec3.x), to_physics(temp_vec3.y));
+			}
+			
+			ray_cast.cast_rays(rays, MULTI_CAST ? 3 : 1, results);
 			
-				m_ray_cast3.do_ray_cast(b2Vec2(to_physics(temp_vec3.x), to_physics(temp_vec3.y)), normalized_angle, -1, obj);
+			RayCast::RayCastResult cast_result = results[0];
 			
-				RayCast::RayCastResult& result3 = m_ray_cast3.get_result();
+			if (MULTI_CAST) {
+				const RayCast::RayCastResult& result2 = results[1];
+				const RayCast::RayCastResult& result3 = results[2];
 			
-				if (result.shortest_dist == -1 && result2.shortest_dist == -1 && result3.shortest_dist == -1) {
+				if (cast_result.shortest_dist == -1 && result2.shortest_dist == -1 && result3.shortest_dist == -1) {
 					continue;
 				}
 			
-				if (result.shortest_dist == -1 || (result.shortest_dist > result2.shortest_dist && result2.shortest_dist != -1)) {
-					result = result2;
+				if (cast_result.shortest_dist == -1 || (cast_result.shortest_dist > result2.shortest_dist && result2.shortest_dist != -1)) {
+					cast_result = result2;
 				}
 				
-				if (result.shortest_dist == -1 || (result.shortest_dist > result3.shortest_dist && result3.shortest_dist != -1)) {
-					result = result3;
+				if (cast_result.shortest_dist == -1 || (cast_result.shortest_dist > result3.shortest_dist && result3.shortest_dist != -1)) {
+					cast_result = result3;
 				}
 			} else {
-				if (result.shortest_dist == -1) {
+				if (cast_result.shortest_dist == -1) {
 					continue;
 				}
 			}
 			
-			entries_mapped++;
-			
-			isect.x = to_game(result.hit_point.x);
-			isect.y = to_game(result.hit_point.y);
-			isect.dist = to_game(result.shortest_dist);
-			
-			if (isect.dist <= 50) {
-				entries_skipped++;
+			if (to_game(cast_result.shortest_dist) <= 50) {
+				result.entries_mapped++;
+				result.entries_skipped++;
 				// Don't store the result if you will travel a very short distance.
 				continue;
 			}
 			
-			//DEBUG("Started at: " << temp_vec.x << ", " << temp_vec.y << ", " << to_degrees(normalized_angle) << ", HIT: " << to_game(result.hit_point.x) << ", " << to_game(result.hit_point.y));
-			
-			// Set the forward direction in the graph.
-			m_graph->set(temp_vec.x, temp_vec.y, to_degrees(normalized_angle), isect);
-			
-			// Set the reverse direction in the graph.
-			if (m_graph->get(to_game(result.hit_point.x), to_game(result.hit_point.y), get_normalized_angle(angle-180), &isect)) {
-				entries_skipped++;
-				//DEBUG("Reverse entry at " << to_game(result.hit_point.x) << ", " << to_game(result.hit_point.y) << ", " << get_normalized_angle(angle-180) << " already set.");
-				continue;
-			}
-			
-			isect.x = temp_vec.x;
-			isect.y = temp_vec.y;
-			isect.dist = to_game(result.shortest_dist);
-			
-			entries_mapped++;
-			
-			//DEBUG("Setting: " << to_game(result.hit_point.x) << ", " << to_game(result.hit_point.y) << ", " << get_normalized_angle(angle-180));
-			
-			m_graph->set(to_game(result.hit_point.x), to_game(result.hit_point.y), get_normalized_angle(angle-180), isect);
+			Sample sample;
+			sample.x = temp_vec.x;
+			sample.y = temp_vec.y;
+			sample.theta = to_degrees(normalized_angle);
+			sample.reverse_theta = get_normalized_angle(angle-180);
+			sample.hit_x = to_game(cast_result.hit_point.x);
+			sample.hit_y = to_game(cast_result.hit_point.y);
+			sample.dist = to_game(cast_result.shortest_dist);
+			result.samples.push_back(sample);
+
+			isect.x = sample.hit_x;
+			isect.y = sample.hit_y;
+			isect.dist = sample.dist;
+			visited->set(sample.x, sample.y, sample.theta, isect);
 		}
 		temp_vec.x += dist_change * cos(to_radians(dir));
 		temp_vec.y += dist_change * sin(to_radians(dir));
 	}
-	
-	//DEBUG("Entries checked: " << entries_checked);
+}
+
+void MapGrapher::merge_segment(SegmentResult& result) {
+	if (!result.mapped) {
+		return;
+	}
+
+	entries_mapped += result.entries_mapped;
+	entries_skipped += result.entries_skipped;
+
+	SparseIntersectMap::Intersect isect;
+	for (size_t i = 0; i < result.samples.size(); ++i) {
+		const Sample& sample = result.samples[i];
+
+		// Check if we already have a match for this angle:
+		if (m_graph->get(sample.x, sample.y, sample.theta, &isect)) {
+			entries_skipped++;
+			continue;
+		}
+		
+		entries_mapped++;
+		
+		// Set the forward direction in the graph.
+		isect.x = sample.hit_x;
+		isect.y = sample.hit_y;
+		isect.dist = sample.dist;
+		m_graph->set(sample.x, sample.y, sample.theta, isect);
+		
+		// Set the reverse direction in the graph.
+		if (m_graph->get(sample.hit_x, sample.hit_y, sample.reverse_theta, &isect)) {
+			entries_skipped++;
+			continue;
+		}
+		
+		isect.x = sample.x;
+		isect.y = sample.y;
+		isect.dist = sample.dist;
+		
+		entries_mapped++;
+		
+		m_graph->set(sample.hit_x, sample.hit_y, sample.reverse_theta, isect);
+	}
+
+	// Free the results now they're in the graph
+	std::vector<Sample>().swap(result.samples);
 	
 	sides_mapped++;
 }
 
-void MapGrapher::load_map(const GameLogic* logic, b2World* world) {
+void MapGrapher::start_workers() {
+	m_results.assign(m_segments.size(), SegmentResult());
+	m_next_segment = 0;
+	m_cancelled = false;
+
+	nbr_workers = std::max<size_t>(1, std::min<size_t>(Thread::get_nbr_processors(), m_segments.size()));
+	for (size_t i = 0; i < nbr_workers; ++i) {
+		Worker* worker = new Worker;
+		worker->grapher = this;
+		worker->index = i;
+		worker->ray_cast.set_physics(m_snapshot, &m_snapshot_geometry);
+		worker->visited = new SparseIntersectMap(GRANULARITY, MAX_SIZE / nbr_workers);
+		worker->nbr_done = 0;
+		m_workers.push_back(worker);
+	}
+
+	// (All the workers must exist before any of them start.)
+	for (size_t i = 0; i < m_workers.size(); ++i) {
+		if (!m_workers[i]->thread.start(Worker::run, m_workers[i])) {
+			// Do this worker's share right here instead
+			Worker::run(m_workers[i]);
+		}
+	}
+}
+
+void MapGrapher::stop_workers() {
+	{
+		Mutex::Lock lock(m_mutex);
+		m_cancelled = true;
+	}
+
+	for (size_t i = 0; i < m_workers.size(); ++i) {
+		m_workers[i]->thread.join();
+		delete m_workers[i]->visited;
+		delete m_workers[i];
+	}
+	m_workers.clear();
+	m_segments.clear();
+	m_results.clear();
+	m_next_segment = 0;
+
+	m_snapshot_geometry.clear();
+	delete m_snapshot;
+	m_snapshot = NULL;
+}
+
+bool MapGrapher::is_segment_done(size_t segment) {
+	const Worker* worker = m_workers[segment % m_workers.size()];
+	Mutex::Lock lock(m_mutex);
+	return worker->nbr_done > segment / m_workers.size();
+}
+
+SparseIntersectMap* MapGrapher::load_graph(const Map* map) {
+	if (!m_graph_file.open_resource(get_graph_filename(map->get_name()).c_str())) {
+		return NULL;
+	}
+
+	try {
+		SparseIntersectMap* graph = new SparseIntersectMap(m_graph_file.get_data(), m_graph_file.get_length());
+		if (strcmp(graph->get_map_name(), map->get_name()) == 0 && graph->get_map_revision() == map->get_revision()) {
+			return graph;
+		}
+		WARN("Map graph is for revision " << graph->get_map_revision() << " of " << graph->get_map_name() << ", not revision " << map->get_revision() << " of " << map->get_name());
+		delete graph;
+	} catch (const Exception& e) {
+		WARN("Could not load map graph: " << e.what());
+	}
+
+	m_graph_file.close();
+	return NULL;
+}
+
+void MapGrapher::load_map(const GameLogic* logic, b2World* world, bool use_graph_file) {
 	start_time = get_ticks();
 	
 	const Map* map = logic->get_map();
@@ -257,84 +436,121 @@ void MapGrapher::load_map(const GameLogic* logic, b2World* world) {
 	
 	m_physics = world;
 	
-	m_ray_cast.set_physics(world);
-	m_ray_cast2.set_physics(world);
-	
 	// Clear our current map:
+	stop_workers();
 	delete m_graph;
+	m_graph = NULL;
+	m_graph_file.close();
 
-	ifstream graph_file;
-	open_resource(&graph_file, (string("maps") + PATH_SEP + map->get_name() + ".mgf").c_str(), true);
-	bool res_used = false;
+	if (use_graph_file) {
+		m_graph = load_graph(map);
+	}
+	bool res_used = m_graph != NULL;
 
-	if (graph_file.fail()) {
+	if (!res_used) {
 		m_graph = new SparseIntersectMap(GRANULARITY, MAX_SIZE);
-	} else {
-		res_used = true;
-		m_graph = new SparseIntersectMap(&graph_file);
 	}
-	graph_file.close();
 	
 	theta_change = m_graph->get_granularity_theta();
 	
 	// Note: We test more distances than necessary, in order to get the edges of bins we might otherwise have missed.
 	dist_change = sqrt(m_graph->get_granularity_x() * m_graph->get_granularity_x() + m_graph->get_granularity_y() * m_graph->get_granularity_y())*0.7f;
-	
-	// Initialize our list of objects to be done.
-	m_objects.clear();
 
-	if (!res_used) {
-		b2Body* body = m_physics->GetBodyList();
-		while (body != NULL) {
-			PhysicsObject* obj = static_cast<PhysicsObject*>(body->GetUserData());
-			if (obj->get_type() == PhysicsObject::MAP_EDGE || obj->get_type() == PhysicsObject::MAP_OBJECT) {
-				m_objects.push_back(body);
-			}
-			body = body->GetNext();
+	objects_mapped = 0;
+	sides_mapped = 0;
+	entries_mapped = 0;
+	entries_skipped = 0;
+	mapping_time = 0;
+	nbr_workers = 0;
+
+	if (res_used) {
+		return;
+	}
+
+	// Copy the map's static geometry, and divide the sides of its objects amongst the workers.
+	std::vector<b2Body*> objects;
+	b2Body* body = m_physics->GetBodyList();
+	while (body != NULL) {
+		PhysicsObject* obj = static_cast<PhysicsObject*>(body->GetUserData());
+		if (obj->get_type() == PhysicsObject::MAP_EDGE || obj->get_type() == PhysicsObject::MAP_OBJECT) {
+			objects.push_back(body);
 		}
+		body = body->GetNext();
+	}
+
+	m_snapshot = new b2World(b2Vec2(0.0f, 0.0f));
+	for (std::vector<b2Body*>::reverse_iterator it(objects.rbegin()); it != objects.rend(); ++it) {
+		add_snapshot_body(*it);
+		map_object(*it);
 	}
+	m_snapshot_geometry.build(m_snapshot);
+
+	start_workers();
 }
 
-void MapGrapher::do_mapping(int num_objects) {
-	if (m_physics == NULL) {
+void MapGrapher::do_mapping(bool wait) {
+	if (m_workers.empty()) {
 		return;
 	}
-	
-	if (num_objects == -1) {
-		num_objects = m_objects.size();
-	}
-	
-	for (int i = 0; i < num_objects; i++) {
-		if (m_objects.empty()) {
-			return;
+
+	if (wait) {
+		for (size_t i = 0; i < m_workers.size(); ++i) {
+			m_workers[i]->thread.join();
 		}
-	
-		b2Body* next_obj = m_objects.back();
-	
-		// Map the next object.
-		map_object(next_obj);
-	
-		// We are now done with the next object.
-		m_objects.pop_back();
+	}
+
+	// Merge the finished segments, in order
+	while (m_next_segment < m_segments.size() && is_segment_done(m_next_segment)) {
+		merge_segment(m_results[m_next_segment]);
+		++m_next_segment;
 	}
 	
 	if (is_done_mapping()) {
+		mapping_time = get_ticks() - start_time;
+		stop_workers();
+
 		DEBUG("Objects: " << objects_mapped << " Sides: " << sides_mapped << " Entries: " << entries_mapped << " Skipped: " << entries_skipped << " (" << (((float)entries_skipped/(entries_skipped+entries_mapped)) * 100) << "%)");
-		DEBUG("Mapping completed in " << ((get_ticks() - start_time)/1000.0f) << " seconds.");
+		DEBUG("Mapping completed in " << (mapping_time/1000.0f) << " seconds with " << nbr_workers << " threads (" << (entries_mapped * 1000.0f / std::max<uint64_t>(mapping_time, 1)) << " entries/second).");
 	}
 }
 
 bool MapGrapher::is_done_mapping() const {
-	return m_objects.empty();
+	return m_next_segment >= m_segments.size();
 }
 
-bool MapGrapher::write_map(const char* map_name) const {
+bool MapGrapher::write_map(const Map* map) const {
+	// Other bots may have the current file mapped, so write a new file and rename it over the old one
+	string filename(get_graph_filename(map->get_name()));
+	string path(string(user_dir()) + filename);
+	// The mutex only covers this process's threads, so the temporary file is named after the process too
+	ostringstream temp_filename;
+	temp_filename << filename << '.' << getpid() << ".tmp";
+
+	Mutex::Lock lock(graph_file_mutex);
 	ofstream output;
-	open_for_writing(&output, (string("maps") + PATH_SEP + map_name + ".mgf").c_str(), true);
-	m_graph->write(&output);
-	bool failed = !output.bad();
+	open_for_writing(&output, temp_filename.str().c_str(), true);
+	if (output.fail()) {
+		return false;
+	}
+	m_graph->write(&output, map->get_name(), map->get_revision());
+	// Closing flushes the last of the data, which can fail too (e.g. when the disk is full)
 	output.close();
-	return failed;
+	bool succeeded = !output.fail();
+
+	string temp_path(string(user_dir()) + temp_filename.str());
+	if (!succeeded) {
+		remove(temp_path.c_str());
+		return false;
+	}
+#ifdef __WIN32
+	// rename() won't replace an existing file here
+	remove(path.c_str());
+#endif
+	return rename(temp_path.c_str(), path.c_str()) == 0;
+}
+
+string MapGrapher::get_graph_filename(const char* map_name) {
+	return string("maps") + PATH_SEP + map_name + ".mgf";
 }
 
 SparseIntersectMap* MapGrapher::get_graph() {
@@ -27,7 +27,12 @@
 
 #include <list>
 #include <string>
+#include <vector>
 #include "common/RayCast.hpp"
+#include "common/StaticGeometry.hpp"
+#include "common/MappedFile.hpp"
+#include "common/PhysicsObject.hpp"
+#include "common/Thread.hpp"
 
 class b2World;
 class b2Body;
@@ -39,6 +44,15 @@ namespace LM {
 	class PhysicsObject;
 	class GameLogic;
 
+	/*
+	 * Builds the graph of where a player can jump to on a map, by ray-casting from points along
+	 * the sides of every obstacle.
+	 *
+	 * The sides are divided up between a pool of worker threads, which ray-cast against their own
+	 * copy of the map's static geometry (so the game can carry on using its world meanwhile).
+	 * Their results are merged into the graph in the same order as if the sides had been mapped
+	 * one after the other, so the graph doesn't depend on the number of threads or their timing.
+	 */
 	class MapGrapher {
 
 	private:
@@ -48,6 +62,44 @@ namespace LM {
 		const static float MULTI_CAST_WIDTH;
 		
 		const static bool MULTI_CAST;
+
+		// A side of an obstacle, in physics coordinates
+		struct Segment {
+			b2Vec2 start;
+			b2Vec2 end;
+		};
+
+		// A ray cast from a side which hit something
+		struct Sample {
+			float x;		// Where the ray started (game coordinates)
+			float y;
+			float theta;		// The direction of the ray (degrees)
+			float reverse_theta;	// The opposite direction
+			float hit_x;		// Where the ray hit
+			float hit_y;
+			float dist;
+		};
+
+		struct SegmentResult {
+			bool mapped;		// False if the side faces out of the map, and was skipped
+			std::vector<Sample> samples;
+			long int entries_mapped;
+			long int entries_skipped;
+		};
+
+		class Worker {
+		public:
+			MapGrapher* grapher;
+			size_t index;
+			RayCast ray_cast;
+			SparseIntersectMap* visited;	// The (forward) entries this worker has produced
+			Thread thread;
+			size_t nbr_done;		// Segments completed (guarded by the grapher's m_mutex)
+
+			static void run(void* worker);
+			void map_segment(const Segment& segment, SegmentResult& result);
+		};
+		friend class Worker;
 		
 		float dist_change;
 		float theta_change;
@@ -58,34 +110,66 @@ namespace LM {
 		long int entries_skipped;
 		
 		uint64_t start_time;
+		uint64_t mapping_time;	// Wall time (in milliseconds) it took to map
+		size_t nbr_workers;
 	
 		SparseIntersectMap* m_graph;
+		MappedFile m_graph_file; // Backs m_graph, if it was loaded from a file
 		b2World* m_physics;
-		std::list<b2Body*> m_objects;
-		RayCast m_ray_cast;
-		RayCast m_ray_cast2;
-		RayCast m_ray_cast3;
+
+		// The static geometry of the map, which the workers ray-cast against
+		b2World* m_snapshot;
+		PhysicsObject m_snapshot_object; // The user data of every body in m_snapshot
+		StaticGeometry m_snapshot_geometry; // Everything in m_snapshot, so the workers skip Box2D's world query
+
+		std::vector<Segment> m_segments;
+		std::vector<SegmentResult> m_results;
+		size_t m_next_segment; // The next segment to merge into the graph
+		std::vector<Worker*> m_workers;
+		Mutex m_mutex;
+		bool m_cancelled; // Guarded by m_mutex
 		
 		int m_width;
 		int m_height;
 		
 		void map_object(b2Body* object);
-		void map_segment(b2Vec2 start, b2Vec2 end, PhysicsObject* obj = NULL);
+		void add_snapshot_body(const b2Body* body);
+
+		void start_workers();
+		void stop_workers();
+		bool is_segment_done(size_t segment);
+		void merge_segment(SegmentResult& result);
+
+		// Returns NULL if there's no graph file for this revision of the map
+		SparseIntersectMap* load_graph(const Map* map);
 
 	public:
 		MapGrapher();
 		~MapGrapher();
 		
-		void load_map(const GameLogic* logic, b2World* world);
+		// The graph is loaded from the map's graph file if there is one (and use_graph_file is true),
+		// otherwise the map is mapped in the background, and do_mapping() adds the results to the graph.
+		void load_map(const GameLogic* logic, b2World* world, bool use_graph_file = true);
 		
-		// If a number n of objects is passed, will only map the next n bodies.
-		void do_mapping(int num_objects = -1);
+		// Add the sides which have been mapped so far to the graph.
+		// If wait is true, wait until the whole map has been mapped.
+		void do_mapping(bool wait = true);
 		
 		bool is_done_mapping() const;
 		
-		bool write_map(const char* map_name) const;
+		// Write the graph to the map's graph file, replacing any existing one.
+		// (Bots which have the old file loaded keep using it.)
+		bool write_map(const Map* map) const;
+
+		static std::string get_graph_filename(const char* map_name);
 		
 		SparseIntersectMap* get_graph();
+
+		// Statistics about the last mapping
+		size_t get_nbr_workers() const { return nbr_workers; }
+		long int get_entries_mapped() const { return entries_mapped; }
+		long int get_entries_skipped() const { return entries_skipped; }
+		uint64_t get_mapping_time() const { return mapping_time; }
 	};
 }
 
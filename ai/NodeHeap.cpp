@@ -0,0 +1,111 @@
+/*
+ * ai/NodeHeap.cpp
+ *
+ * This file is part of Leges Motus, a networked, 2D shooter set in zero gravity.
+ * 
+ * Copyright 2009-2011 Andrew Ayer, Nathan Partlan, Jeffrey Pfau
+ * 
+ * Leges Motus is free and open source software.  You may redistribute it and/or
+ * modify it under the terms of version 2, or (at your option) version 3, of the
+ * GNU General Public License (GPL), as published by the Free Software Foundation.
+ * 
+ * Leges Motus is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.  See the full text of the GNU General Public License for
+ * further detail.
+ * 
+ * For a full copy of the GNU General Public License, please see the COPYING file
+ * in the root of the source code tree.  You may also retrieve a copy from
+ * <http://www.gnu.org/licenses/gpl-2.0.txt>, or request a copy by writing to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ * 02111-1307  USA
+ * 
+ */
+
+#include "NodeHeap.hpp"
+
+using namespace LM;
+using namespace std;
+
+void NodeHeap::resize(size_t nbr_nodes) {
+	m_entries.clear();
+	m_positions.assign(nbr_nodes, -1);
+}
+
+void NodeHeap::clear() {
+	for (size_t i = 0; i < m_entries.size(); ++i) {
+		m_positions[m_entries[i].node] = -1;
+	}
+	m_entries.clear();
+}
+
+void NodeHeap::place(int index, const Entry& entry) {
+	m_entries[index] = entry;
+	m_positions[entry.node] = index;
+}
+
+void NodeHeap::sift_up(int index) {
+	Entry entry = m_entries[index];
+	while (index > 0) {
+		int parent = (index - 1) / 2;
+		if (!(entry.key < m_entries[parent].key)) {
+			break;
+		}
+		place(index, m_entries[parent]);
+		index = parent;
+	}
+	place(index, entry);
+}
+
+void NodeHeap::sift_down(int index) {
+	Entry entry = m_entries[index];
+	int size = int(m_entries.size());
+	while (2 * index + 1 < size) {
+		int child = 2 * index + 1;
+		if (child + 1 < size && m_entries[child + 1].key < m_entries[child].key) {
+			++child;
+		}
+		if (!(m_entries[child].key < entry.key)) {
+			break;
+		}
+		place(index, m_entries[child]);
+		index = child;
+	}
+	place(index, entry);
+}
+
+void NodeHeap::push(PathGraph::NodeId node, float key) {
+	int index = m_positions[node];
+	if (index == -1) {
+		Entry entry;
+		entry.key = key;
+		entry.node = node;
+		m_entries.push_back(entry);
+		sift_up(int(m_entries.size()) - 1);
+	} else if (key < m_entries[index].key) {
+		m_entries[index].key = key;
+		sift_up(index);
+	} else {
+		m_entries[index].key = key;
+		sift_down(index);
+	}
+}
+
+PathGraph::NodeId NodeHeap::pop() {
+	PathGraph::NodeId node = m_entries[0].node;
+	remove(node);
+	return node;
+}
+
+void NodeHeap::remove(PathGraph::NodeId node) {
+	int index = m_positions[node];
+	m_positions[node] = -1;
+	Entry last = m_entries.back();
+	m_entries.pop_back();
+	if (index == int(m_entries.size())) {
+		return;
+	}
+	place(index, last);
+	sift_up(index);
+	sift_down(m_positions[last.node]);
+}
@@ -0,0 +1,70 @@
+/*
+ * ai/NodeHeap.hpp
+ *
+ * This file is part of Leges Motus, a networked, 2D shooter set in zero gravity.
+ * 
+ * Copyright 2009-2011 Andrew Ayer, Nathan Partlan, Jeffrey Pfau
+ * 
+ * Leges Motus is free and open source software.  You may redistribute it and/or
+ * modify it under the terms of version 2, or (at your option) version 3, of the
+ * GNU General Public License (GPL), as published by the Free Software Foundation.
+ * 
+ * Leges Motus is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.  See the full text of the GNU General Public License for
+ * further detail.
+ * 
+ * For a full copy of the GNU General Public License, please see the COPYING file
+ * in the root of the source code tree.  You may also retrieve a copy from
+ * <http://www.gnu.org/licenses/gpl-2.0.txt>, or request a copy by writing to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ * 02111-1307  USA
+ * 
+ */
+
+#ifndef LM_AI_NODEHEAP_HPP
+#define LM_AI_NODEHEAP_HPP
+
+#include "PathGraph.hpp"
+#include <vector>
+
+namespace LM {
+	/*
+	 * A binary min-heap of the nodes of a PathGraph, ordered by a key which can be changed while
+	 * the node is in the heap.  The heap knows where each node is, so changing a key or removing
+	 * a node doesn't need a search.
+	 */
+	class NodeHeap {
+	private:
+		struct Entry {
+			float key;
+			PathGraph::NodeId node;
+		};
+
+		std::vector<Entry> m_entries;
+		std::vector<int> m_positions; // Index in m_entries of each node, or -1
+
+		void place(int index, const Entry& entry);
+		void sift_up(int index);
+		void sift_down(int index);
+
+	public:
+		// Make room for nodes 0 up to nbr_nodes - 1, and empty the heap
+		void resize(size_t nbr_nodes);
+		void clear();
+
+		bool empty() const { return m_entries.empty(); }
+		size_t size() const { return m_entries.size(); }
+		bool contains(PathGraph::NodeId node) const { return m_positions[node] != -1; }
+
+		PathGraph::NodeId top() const { return m_entries[0].node; }
+		float top_key() const { return m_entries[0].key; }
+
+		// Add a node, or change its key if it's already in the heap
+		void push(PathGraph::NodeId node, float key);
+		PathGraph::NodeId pop();
+		void remove(PathGraph::NodeId node);
+	};
+}
+
+#endif
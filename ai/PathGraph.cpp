@@ -0,0 +1,213 @@
+/*
+ * ai/PathGraph.cpp
+ *
+ * This file is part of Leges Motus, a networked, 2D shooter set in zero gravity.
+ * 
+ * Copyright 2009-2011 Andrew Ayer, Nathan Partlan, Jeffrey Pfau
+ * 
+ * Leges Motus is free and open source software.  You may redistribute it and/or
+ * modify it under the terms of version 2, or (at your option) version 3, of the
+ * GNU General Public License (GPL), as published by the Free Software Foundation.
+ * 
+ * Leges Motus is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.  See the full text of the GNU General Public License for
+ * further detail.
+ * 
+ * For a full copy of the GNU General Public License, please see the COPYING file
+ * in the root of the source code tree.  You may also retrieve a copy from
+ * <http://www.gnu.org/licenses/gpl-2.0.txt>, or request a copy by writing to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ * 02111-1307  USA
+ * 
+ */
+
+#include "PathGraph.hpp"
+#include "common/Thread.hpp"
+#include <algorithm>
+
+using namespace LM;
+using namespace std;
+
+const PathGraph::NodeId PathGraph::NO_NODE = 0xFFFFFFFF;
+
+namespace {
+	struct Entry {
+		uint64_t cell;
+		int theta;
+		const SparseIntersectMap::Intersect* isect;
+
+		// By the node they leave, then by direction
+		bool operator<(const Entry& other) const {
+			return cell < other.cell || (cell == other.cell && theta < other.theta);
+		}
+	};
+
+	// A PathGraph shared by the Pathfinders using the same graph file
+	struct SharedGraph {
+		std::string map_name;
+		int map_revision;
+		int count;
+		PathGraph* path_graph;
+		int nbr_users;
+	};
+
+	Mutex shared_graphs_mutex;
+	vector<SharedGraph> shared_graphs; // Guarded by shared_graphs_mutex
+}
+
+PathGraph::PathGraph() {
+	m_source = NULL;
+	m_source_count = 0;
+	m_grain = 0;
+	m_first_edges.push_back(0);
+	m_first_in_edges.push_back(0);
+}
+
+uint64_t PathGraph::make_cell(int gx, int gy) {
+	return (uint64_t(uint32_t(gx)) << 32) | uint32_t(gy);
+}
+
+PathGraph::NodeId PathGraph::find_cell(uint64_t cell) const {
+	vector<uint64_t>::const_iterator it(lower_bound(m_cells.begin(), m_cells.end(), cell));
+	if (it == m_cells.end() || *it != cell) {
+		return NO_NODE;
+	}
+	return NodeId(it - m_cells.begin());
+}
+
+void PathGraph::clear() {
+	m_cells.clear();
+	m_first_edges.assign(1, 0);
+	m_edges.clear();
+	m_edge_sources.clear();
+	m_first_in_edges.assign(1, 0);
+	m_in_edges.clear();
+	m_source = NULL;
+	m_source_count = 0;
+	m_grain = 0;
+}
+
+const PathGraph* PathGraph::acquire_shared(const SparseIntersectMap* graph) {
+	Mutex::Lock lock(shared_graphs_mutex);
+	for (size_t i = 0; i < shared_graphs.size(); ++i) {
+		SharedGraph& shared = shared_graphs[i];
+		if (shared.map_name == graph->get_map_name() && shared.map_revision == graph->get_map_revision() && shared.count == graph->count()) {
+			++shared.nbr_users;
+			return shared.path_graph;
+		}
+	}
+
+	SharedGraph shared;
+	shared.map_name = graph->get_map_name();
+	shared.map_revision = graph->get_map_revision();
+	shared.count = graph->count();
+	shared.path_graph = new PathGraph;
+	shared.path_graph->build(graph);
+	// It outlives the map graph it was built from
+	shared.path_graph->m_source = NULL;
+	shared.nbr_users = 1;
+	shared_graphs.push_back(shared);
+	return shared.path_graph;
+}
+
+void PathGraph::release_shared(const PathGraph* path_graph) {
+	Mutex::Lock lock(shared_graphs_mutex);
+	for (size_t i = 0; i < shared_graphs.size(); ++i) {
+		if (shared_graphs[i].path_graph == path_graph) {
+			if (--shared_graphs[i].nbr_users == 0) {
+				delete shared_graphs[i].path_graph;
+				shared_graphs.erase(shared_graphs.begin() + i);
+			}
+			return;
+		}
+	}
+}
+
+bool PathGraph::is_stale(const SparseIntersectMap* graph) const {
+	return graph != m_source || (graph != NULL && graph->count() != m_source_count);
+}
+
+void PathGraph::build(const SparseIntersectMap* graph) {
+	clear();
+	if (graph == NULL) {
+		return;
+	}
+	m_source = graph;
+	m_source_count = graph->count();
+	m_grain = graph->m_grain;
+
+	// Gather the entries, along with the cells they leave from
+	vector<Entry> entries;
+	entries.reserve(m_source_count);
+	m_cells.reserve(m_source_count * 2);
+	for (int i = 0; i < graph->m_nbuckets; ++i) {
+		const SparseIntersectMap::Element* elts;
+		int size;
+		graph->get_bucket(i, &elts, &size);
+		for (int j = 0; j < size; ++j) {
+			Entry entry;
+			entry.cell = make_cell(elts[j].x, elts[j].y);
+			entry.theta = elts[j].t;
+			entry.isect = &elts[j].i;
+			entries.push_back(entry);
+			m_cells.push_back(entry.cell);
+			m_cells.push_back(get_cell(elts[j].i.x, elts[j].i.y));
+		}
+	}
+
+	// Every cell that's jumped from or to is a node
+	sort(m_cells.begin(), m_cells.end());
+	m_cells.erase(unique(m_cells.begin(), m_cells.end()), m_cells.end());
+	vector<uint64_t>(m_cells).swap(m_cells);
+
+	sort(entries.begin(), entries.end());
+
+	m_first_edges.assign(m_cells.size() + 1, 0);
+	m_first_in_edges.assign(m_cells.size() + 1, 0);
+	m_edges.resize(entries.size());
+	m_edge_sources.resize(entries.size());
+	for (size_t i = 0; i < entries.size(); ++i) {
+		const SparseIntersectMap::Intersect& isect = *entries[i].isect;
+		m_edge_sources[i] = find_cell(entries[i].cell);
+		m_edges[i].target = find_cell(get_cell(isect.x, isect.y));
+		m_edges[i].isect = isect;
+		++m_first_edges[m_edge_sources[i] + 1];
+		++m_first_in_edges[m_edges[i].target + 1];
+	}
+	for (size_t i = 1; i < m_first_edges.size(); ++i) {
+		m_first_edges[i] += m_first_edges[i - 1];
+		m_first_in_edges[i] += m_first_in_edges[i - 1];
+	}
+
+	// List the edges arriving at each node, in order
+	m_in_edges.resize(m_edges.size());
+	vector<uint32_t> next_in_edges(m_first_in_edges.begin(), m_first_in_edges.end() - 1);
+	for (size_t i = 0; i < m_edges.size(); ++i) {
+		m_in_edges[next_in_edges[m_edges[i].target]++] = uint32_t(i);
+	}
+}
+
+uint64_t PathGraph::get_cell(float x, float y) const {
+	return make_cell(int(x) >> m_grain, int(y) >> m_grain);
+}
+
+PathGraph::NodeId PathGraph::find_node(float x, float y) const {
+	return find_cell(get_cell(x, y));
+}
+
+void PathGraph::find_nodes_near(float x, float y, float radius, vector<NodeId>& nodes) const {
+	if (m_cells.empty()) {
+		return;
+	}
+	int max_gx = int(x + radius) >> m_grain;
+	int max_gy = int(y + radius) >> m_grain;
+	for (int gx = int(x - radius) >> m_grain; gx <= max_gx; ++gx) {
+		for (int gy = int(y - radius) >> m_grain; gy <= max_gy; ++gy) {
+			NodeId node = find_cell(make_cell(gx, gy));
+			if (node != NO_NODE) {
+				nodes.push_back(node);
+			}
+		}
+	}
+}
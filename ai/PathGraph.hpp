@@ -0,0 +1,107 @@
+/*
+ * ai/PathGraph.hpp
+ *
+ * This file is part of Leges Motus, a networked, 2D shooter set in zero gravity.
+ * 
+ * Copyright 2009-2011 Andrew Ayer, Nathan Partlan, Jeffrey Pfau
+ * 
+ * Leges Motus is free and open source software.  You may redistribute it and/or
+ * modify it under the terms of version 2, or (at your option) version 3, of the
+ * GNU General Public License (GPL), as published by the Free Software Foundation.
+ * 
+ * Leges Motus is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.  See the full text of the GNU General Public License for
+ * further detail.
+ * 
+ * For a full copy of the GNU General Public License, please see the COPYING file
+ * in the root of the source code tree.  You may also retrieve a copy from
+ * <http://www.gnu.org/licenses/gpl-2.0.txt>, or request a copy by writing to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ * 02111-1307  USA
+ * 
+ */
+
+#ifndef LM_AI_PATHGRAPH_HPP
+#define LM_AI_PATHGRAPH_HPP
+
+#include "SparseIntersectMap.hpp"
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+namespace LM {
+	/*
+	 * A map graph (see SparseIntersectMap), compacted for the Pathfinder to search.
+	 *
+	 * The nodes are the cells of the map graph (every direction at one position falls in the
+	 * same cell), numbered 0 to get_nbr_nodes() - 1.  The edges leaving a node are the jumps
+	 * from its cell, stored contiguously with the node they land in.  The edges arriving at each
+	 * node are also listed, for searching backwards from a goal.
+	 *
+	 * A PathGraph of a map graph loaded from a file is shared by every Pathfinder in the process
+	 * using the same file (see acquire_shared()), and isn't changed once it's been built, so any
+	 * number of threads can search it at once.
+	 */
+	class PathGraph {
+	public:
+		typedef uint32_t NodeId;
+		static const NodeId NO_NODE;
+
+		struct Edge {
+			NodeId target;
+			SparseIntersectMap::Intersect isect;
+		};
+
+	private:
+		std::vector<uint64_t> m_cells;		// Sorted cell of each node
+		std::vector<uint32_t> m_first_edges;	// Edges of node n are m_first_edges[n] up to m_first_edges[n + 1]
+		std::vector<Edge> m_edges;
+		std::vector<NodeId> m_edge_sources;
+		std::vector<uint32_t> m_first_in_edges;	// Like m_first_edges, for m_in_edges
+		std::vector<uint32_t> m_in_edges;	// Indices of the edges arriving at each node
+		const SparseIntersectMap* m_source;
+		int m_source_count;
+		int m_grain;
+
+		static uint64_t make_cell(int gx, int gy);
+		NodeId find_cell(uint64_t cell) const;
+
+	public:
+		PathGraph();
+
+		// The PathGraph of a read-only map graph, built if no other Pathfinder is using one of the
+		// same map graph already.  Every call must be matched by a call to release_shared().
+		static const PathGraph* acquire_shared(const SparseIntersectMap* graph);
+		static void release_shared(const PathGraph* path_graph);
+
+		// Rebuild from the given map graph (which may be NULL)
+		void build(const SparseIntersectMap* graph);
+		void clear();
+
+		// Whether the map graph has changed since the last build
+		bool is_stale(const SparseIntersectMap* graph) const;
+
+		// The cell containing the given position
+		uint64_t get_cell(float x, float y) const;
+		// The node of the cell containing the given position, or NO_NODE if nothing leaves or lands in it
+		NodeId find_node(float x, float y) const;
+		// Add the nodes whose cells might be within radius of the given position
+		void find_nodes_near(float x, float y, float radius, std::vector<NodeId>& nodes) const;
+
+		size_t get_nbr_nodes() const { return m_cells.size(); }
+		size_t get_nbr_edges() const { return m_edges.size(); }
+
+		const Edge* begin_edges(NodeId node) const { return &m_edges[0] + m_first_edges[node]; }
+		const Edge* end_edges(NodeId node) const { return &m_edges[0] + m_first_edges[node + 1]; }
+		const Edge& get_edge(size_t index) const { return m_edges[index]; }
+		size_t get_edge_index(const Edge* edge) const { return edge - &m_edges[0]; }
+		NodeId get_edge_source(size_t index) const { return m_edge_sources[index]; }
+
+		const uint32_t* begin_in_edges(NodeId node) const { return &m_in_edges[0] + m_first_in_edges[node]; }
+		const uint32_t* end_in_edges(NodeId node) const { return &m_in_edges[0] + m_first_in_edges[node + 1]; }
+	};
+}
+
+#endif
@@ -26,50 +26,116 @@
 #include "SparseIntersectMap.hpp"
 #include "common/Player.hpp"
 #include "common/physics.hpp"
-#include <queue>
-#include <set>
-#include <map>
 #include "common/misc.hpp"
+#include <algorithm>
+#include <limits>
 
 using namespace LM;
 using namespace std;
 
-std::map<SparseIntersectMap::Intersect, float, Pathfinder::IntersectComparator> Pathfinder::f_scores;
-std::map<SparseIntersectMap::Intersect, float, Pathfinder::IntersectComparator> Pathfinder::g_scores;
-std::map<SparseIntersectMap::Intersect, float, Pathfinder::IntersectComparator> Pathfinder::h_scores;
+namespace {
+	const float UNREACHABLE = numeric_limits<float>::infinity();
+}
+
+bool Pathfinder::AvoidArea::operator==(const AvoidArea& other) const {
+	return x == other.x && y == other.y && area == other.area && weight == other.weight;
+}
 
 Pathfinder::Pathfinder() {
+	m_search = 0;
+	m_nbr_expanded = 0;
+	m_path_cache_size = PATH_CACHE_SIZE;
+	m_cache_clock = 0;
+	m_nbr_cache_hits = 0;
+	m_incremental = false;
+	m_has_goal = false;
+	m_path_graph = &m_own_path_graph;
 	set_graph(NULL);
 	m_timeout = -1;
 }
 
 Pathfinder::Pathfinder(SparseIntersectMap* graph) {
+	m_search = 0;
+	m_nbr_expanded = 0;
+	m_path_cache_size = PATH_CACHE_SIZE;
+	m_cache_clock = 0;
+	m_nbr_cache_hits = 0;
+	m_incremental = false;
+	m_has_goal = false;
+	m_path_graph = &m_own_path_graph;
 	set_graph(graph);
 	m_timeout = -1;
 }
 
 Pathfinder::~Pathfinder() {
 	clear_avoid_areas();
+	release_path_graph();
+}
+
+void Pathfinder::reset() {
+	m_path_cache.clear();
+	m_has_goal = false;
+}
+
+void Pathfinder::release_path_graph() {
+	if (m_path_graph != &m_own_path_graph) {
+		PathGraph::release_shared(m_path_graph);
+		m_path_graph = &m_own_path_graph;
+	}
 }
 
 void Pathfinder::set_graph(SparseIntersectMap* graph) {
+	release_path_graph();
 	m_graph = graph;
+	if (graph != NULL && graph->is_read_only()) {
+		m_own_path_graph.clear();
+		m_path_graph = PathGraph::acquire_shared(graph);
+	} else {
+		m_own_path_graph.build(graph);
+	}
+	reset();
 }
 
-void Pathfinder::set_physics(const b2World* world) {
-	m_ray_cast.set_physics(world);
+void Pathfinder::update_graph() {
+	// A read-only graph never changes
+	if (m_path_graph == &m_own_path_graph && m_own_path_graph.is_stale(m_graph)) {
+		m_own_path_graph.build(m_graph);
+		reset();
+	}
+}
+
+const PathGraph* Pathfinder::get_path_graph() const {
+	return m_path_graph;
+}
+
+size_t Pathfinder::get_nbr_expanded() const {
+	return m_nbr_expanded;
+}
+
+size_t Pathfinder::get_nbr_cache_hits() const {
+	return m_nbr_cache_hits;
+}
+
+void Pathfinder::set_physics(const b2World* world, const StaticGeometry* static_geometry) {
+	m_ray_cast.set_physics(world, static_geometry);
 }
 
 void Pathfinder::set_timeout(long timeout) {
 	m_timeout = timeout;
 }
 
+void Pathfinder::set_incremental(bool incremental) {
+	m_incremental = incremental;
+	m_has_goal = false;
+}
+
+void Pathfinder::set_path_cache_size(size_t size) {
+	m_path_cache_size = size;
+	m_path_cache.clear();
+}
+
 bool Pathfinder::find_path(float start_x, float start_y, float goal_x, float goal_y, float tolerance, vector<SparseIntersectMap::Intersect>& path, PathFoundFunc check_found) {
-	f_scores.clear();
-	g_scores.clear();
-	h_scores.clear();
-	
-	uint64_t start_time = get_ticks();
+	m_nbr_expanded = 0;
 	
 	// Check if we're already there.
 	b2Vec2 curr_dist = b2Vec2(goal_x - start_x, goal_y - start_y);
@@ -77,70 +143,332 @@ bool Pathfinder::find_path(float start_x, float start_y, float goal_x, float goa
 		return true;
 	}
 	
-	set<SparseIntersectMap::Intersect, IntersectComparator> closed_set; // Stores nodes already visited.
-	map<SparseIntersectMap::Intersect, SparseIntersectMap::Intersect, IntersectComparator> came_from; // Stores where we came from to get to each node.
-	priority_queue<SparseIntersectMap::Intersect, vector<SparseIntersectMap::Intersect>, GraphNodeComparator> open_set; // The nodes we have yet to check.
-	
-	// Set up the initial node to check.
 	SparseIntersectMap::Intersect start;
 	start.x = start_x;
 	start.y = start_y;
 	start.dist = 0;
-	g_scores[start] = 0;
-	h_scores[start] = estimate_h_score(start, goal_x, goal_y);
-	f_scores[start] = h_scores[start];
 	
-	open_set.push(start);
+	PathGraph::NodeId start_node = m_path_graph->find_node(start_x, start_y);
+	if (start_node == PathGraph::NO_NODE) {
+		// Nowhere to go from here
+		if ((*this.*check_found)(start, goal_x, goal_y, tolerance)) {
+			path.push_back(start);
+			return true;
+		}
+		return false;
+	}
+
+	// See if we've been here before.
+	if (CachedPath* cached = find_cached_path(start_node, goal_x, goal_y, tolerance, check_found)) {
+		if (!cached->found) {
+			++m_nbr_cache_hits;
+			return false;
+		}
+
+		// The cached path starts where that search started, and ends near where that goal was.
+		const SparseIntersectMap::Intersect& end = cached->path.size() > 1 ? cached->path.back() : start;
+		if ((*this.*check_found)(end, goal_x, goal_y, tolerance)) {
+			++m_nbr_cache_hits;
+			path.push_back(start);
+			path.insert(path.end(), cached->path.begin() + 1, cached->path.end());
+			return true;
+		}
+	}
+
+	size_t first = path.size();
+	bool found;
+	if (m_incremental && check_found == &Pathfinder::is_within_dist) {
+		set_goal(goal_x, goal_y, tolerance);
+		update_avoid_areas();
+		if (!search_from_goal(start_node, get_ticks())) {
+			return false;
+		}
+		path.push_back(start);
+		found = follow_path(start_node, path);
+		if (!found) {
+			path.resize(first);
+		}
+	} else {
+		bool timed_out = false;
+		found = search(start, start_node, goal_x, goal_y, tolerance, path, check_found, &timed_out);
+		if (timed_out) {
+			return false;
+		}
+	}
+
+	cache_path(start_node, goal_x, goal_y, tolerance, check_found, found, path, first);
+	return found;
+}
+
+bool Pathfinder::search(const SparseIntersectMap::Intersect& start, PathGraph::NodeId start_node, float goal_x, float goal_y, float tolerance, vector<SparseIntersectMap::Intersect>& path, PathFoundFunc check_found, bool* timed_out) {
+	uint64_t start_time = get_ticks();
+
+	// Start a new search, forgetting everything from the last one.
+	if (m_nodes.size() != m_path_graph->get_nbr_nodes()) {
+		NodeState unvisited;
+		unvisited.search = 0;
+		m_nodes.assign(m_path_graph->get_nbr_nodes(), unvisited);
+		m_open_set.resize(m_path_graph->get_nbr_nodes());
+		m_search = 0;
+	} else {
+		m_open_set.clear();
+	}
+	if (++m_search == 0) {
+		// Wrapped around; the old search numbers could come back
+		for (size_t i = 0; i < m_nodes.size(); ++i) {
+			m_nodes[i].search = 0;
+		}
+		m_search = 1;
+	}
 	
-	float theta_change = m_graph->get_granularity_theta();
+	// Set up the initial node to check.
+	NodeState& start_state = visit(start_node);
+	start_state.g_score = 0;
+	start_state.isect = start;
+	m_open_set.push(start_node, estimate_h_score(start, goal_x, goal_y));
 	
-	while (!open_set.empty()) {
-		SparseIntersectMap::Intersect current = open_set.top();
-		//DEBUG("Current: " << current.x << ", " << current.y);
-		if ((*this.*check_found)(current, goal_x, goal_y, tolerance)) {
+	while (!m_open_set.empty()) {
+		PathGraph::NodeId current = m_open_set.pop();
+		++m_nbr_expanded;
+		NodeState& current_state = m_nodes[current];
+		current_state.closed = true;
+		//DEBUG("Current: " << current_state.isect.x << ", " << current_state.isect.y);
+		if ((*this.*check_found)(current_state.isect, goal_x, goal_y, tolerance)) {
 			// We're done.
-			reconstruct_path(came_from, current, path);
-			//DEBUG("Found a path! Distance: " << g_scores[current] << " Hops: " << path.size());
+			reconstruct_path(current, path);
+			//DEBUG("Found a path! Distance: " << current_state.g_score << " Hops: " << path.size());
 			return true;
 		}
-		open_set.pop();
-		
-		closed_set.insert(current);
 		
-		// XXX: We need a better way to iterate through the neighbors, without having to check _every_ angle
-		for (float theta = 0; theta < 360; theta += theta_change) {
-			SparseIntersectMap::Intersect neighbor;
-			
-			// If this neighbor doesn't exist, or we've already checked it, skip it:
-			if (!m_graph->get(current.x, current.y, theta, &neighbor)) {
-				continue;
-			}
-			
-			if (closed_set.find(neighbor) != closed_set.end()) {
+		float current_g_score = current_state.g_score;
+		for (const PathGraph::Edge* edge = m_path_graph->begin_edges(current); edge != m_path_graph->end_edges(current); ++edge) {
+			NodeState& neighbor = visit(edge->target);
+
+			// If we've already checked it, skip it:
+			if (neighbor.closed) {
 				continue;
 			}
 			
-			float tentative_g_score = g_scores[current] + calculate_g_score(neighbor);
+			float tentative_g_score = current_g_score + calculate_g_score(edge->isect);
 			
-			if (g_scores.find(neighbor) == g_scores.end() || g_scores[neighbor] > tentative_g_score) {
-				g_scores[neighbor] = tentative_g_score;
-				h_scores[neighbor] = estimate_h_score(neighbor, goal_x, goal_y);
-				f_scores[neighbor] = g_scores[neighbor] + h_scores[neighbor];
-				
-				// XXX: We need a better way to update things that are already in the open_set, other than pushing them again.
-				open_set.push(neighbor);
-				came_from[neighbor] = current;
+			if (neighbor.g_score < 0 || neighbor.g_score > tentative_g_score) {
+				neighbor.g_score = tentative_g_score;
+				neighbor.came_from = current;
+				neighbor.isect = edge->isect;
+				m_open_set.push(edge->target, tentative_g_score + estimate_h_score(edge->isect, goal_x, goal_y));
 			}
+		}
 		
-			if (m_timeout != -1 && get_ticks() > start_time + m_timeout) {
-				return false;
-			}
+		if (m_timeout != -1 && get_ticks() > start_time + m_timeout) {
+			*timed_out = true;
+			return false;
 		}
 	}
 	
 	return false;
 }
 
+Pathfinder::NodeState& Pathfinder::visit(PathGraph::NodeId node) {
+	NodeState& state = m_nodes[node];
+	if (state.search != m_search) {
+		state.search = m_search;
+		state.closed = false;
+		state.came_from = PathGraph::NO_NODE;
+		state.g_score = -1;
+	}
+	return state;
+}
+
+bool Pathfinder::avoid_areas_match(const vector<AvoidArea>& avoid_areas) const {
+	if (avoid_areas.size() != m_avoid_areas.size()) {
+		return false;
+	}
+	for (size_t i = 0; i < avoid_areas.size(); ++i) {
+		if (!(avoid_areas[i] == *m_avoid_areas[i])) {
+			return false;
+		}
+	}
+	return true;
+}
+
+Pathfinder::CachedPath* Pathfinder::find_cached_path(PathGraph::NodeId start_node, float goal_x, float goal_y, float tolerance, PathFoundFunc check_found) {
+	uint64_t goal = m_path_graph->get_cell(goal_x, goal_y);
+	for (size_t i = 0; i < m_path_cache.size(); ++i) {
+		CachedPath& cached = m_path_cache[i];
+		if (cached.start == start_node && cached.goal == goal && cached.tolerance == tolerance && cached.check_found == check_found && avoid_areas_match(cached.avoid_areas)) {
+			cached.last_used = ++m_cache_clock;
+			return &cached;
+		}
+	}
+	return NULL;
+}
+
+void Pathfinder::cache_path(PathGraph::NodeId start_node, float goal_x, float goal_y, float tolerance, PathFoundFunc check_found, bool found, const vector<SparseIntersectMap::Intersect>& path, size_t first) {
+	if (m_path_cache_size == 0) {
+		return;
+	}
+
+	// Replace the least recently used path, once the cache is full
+	CachedPath* cached;
+	if (m_path_cache.size() < m_path_cache_size) {
+		m_path_cache.push_back(CachedPath());
+		cached = &m_path_cache.back();
+	} else {
+		cached = &m_path_cache[0];
+		for (size_t i = 1; i < m_path_cache.size(); ++i) {
+			if (m_path_cache[i].last_used < cached->last_used) {
+				cached = &m_path_cache[i];
+			}
+		}
+	}
+
+	cached->start = start_node;
+	cached->goal = m_path_graph->get_cell(goal_x, goal_y);
+	cached->tolerance = tolerance;
+	cached->check_found = check_found;
+	cached->avoid_areas.clear();
+	for (size_t i = 0; i < m_avoid_areas.size(); ++i) {
+		cached->avoid_areas.push_back(*m_avoid_areas[i]);
+	}
+	cached->found = found;
+	cached->path.assign(path.begin() + first, path.end());
+	cached->last_used = ++m_cache_clock;
+}
+
+void Pathfinder::set_goal(float goal_x, float goal_y, float tolerance) {
+	if (m_has_goal && m_goal_x == goal_x && m_goal_y == goal_y && m_goal_tolerance == tolerance) {
+		return;
+	}
+
+	m_has_goal = true;
+	m_goal_x = goal_x;
+	m_goal_y = goal_y;
+	m_goal_tolerance = tolerance;
+	m_goal_avoid_areas.clear();
+	for (size_t i = 0; i < m_avoid_areas.size(); ++i) {
+		m_goal_avoid_areas.push_back(*m_avoid_areas[i]);
+	}
+
+	GoalState unreached;
+	unreached.dist = UNREACHABLE;
+	unreached.lookahead = UNREACHABLE;
+	m_goal_states.assign(m_path_graph->get_nbr_nodes(), unreached);
+	m_goal_queue.resize(m_path_graph->get_nbr_nodes());
+
+	// Start from the nodes which can jump to the goal
+	update_near(goal_x, goal_y, tolerance);
+}
+
+void Pathfinder::update_avoid_areas() {
+	if (avoid_areas_match(m_goal_avoid_areas)) {
+		return;
+	}
+
+	// The jumps landing near the old and new avoid areas cost something different now
+	vector<AvoidArea> old_avoid_areas;
+	old_avoid_areas.swap(m_goal_avoid_areas);
+	for (size_t i = 0; i < m_avoid_areas.size(); ++i) {
+		m_goal_avoid_areas.push_back(*m_avoid_areas[i]);
+	}
+	for (size_t i = 0; i < old_avoid_areas.size(); ++i) {
+		update_near(old_avoid_areas[i].x, old_avoid_areas[i].y, old_avoid_areas[i].area);
+	}
+	for (size_t i = 0; i < m_goal_avoid_areas.size(); ++i) {
+		update_near(m_goal_avoid_areas[i].x, m_goal_avoid_areas[i].y, m_goal_avoid_areas[i].area);
+	}
+}
+
+void Pathfinder::update_near(float x, float y, float radius) {
+	vector<PathGraph::NodeId> nodes;
+	m_path_graph->find_nodes_near(x, y, radius, nodes);
+	for (size_t i = 0; i < nodes.size(); ++i) {
+		for (const uint32_t* in_edge = m_path_graph->begin_in_edges(nodes[i]); in_edge != m_path_graph->end_in_edges(nodes[i]); ++in_edge) {
+			if (is_within_dist(m_path_graph->get_edge(*in_edge).isect, x, y, radius)) {
+				update_goal_state(m_path_graph->get_edge_source(*in_edge));
+			}
+		}
+	}
+}
+
+float Pathfinder::get_goal_dist(const PathGraph::Edge& edge) {
+	float g_score = calculate_g_score(edge.isect);
+	if (is_within_dist(edge.isect, m_goal_x, m_goal_y, m_goal_tolerance)) {
+		return g_score;
+	}
+	return g_score + m_goal_states[edge.target].dist;
+}
+
+void Pathfinder::update_goal_state(PathGraph::NodeId node) {
+	GoalState& state = m_goal_states[node];
+	state.lookahead = UNREACHABLE;
+	for (const PathGraph::Edge* edge = m_path_graph->begin_edges(node); edge != m_path_graph->end_edges(node); ++edge) {
+		state.lookahead = min(state.lookahead, get_goal_dist(*edge));
+	}
+
+	if (state.dist != state.lookahead) {
+		m_goal_queue.push(node, min(state.dist, state.lookahead));
+	} else if (m_goal_queue.contains(node)) {
+		m_goal_queue.remove(node);
+	}
+}
+
+bool Pathfinder::search_from_goal(PathGraph::NodeId start_node, uint64_t start_time) {
+	const GoalState& start = m_goal_states[start_node];
+	while (!m_goal_queue.empty() && (m_goal_queue.top_key() < min(start.dist, start.lookahead) || start.dist != start.lookahead)) {
+		PathGraph::NodeId current = m_goal_queue.pop();
+		++m_nbr_expanded;
+
+		GoalState& state = m_goal_states[current];
+		if (state.dist > state.lookahead) {
+			state.dist = state.lookahead;
+		} else {
+			state.dist = UNREACHABLE;
+			update_goal_state(current);
+		}
+
+		for (const uint32_t* in_edge = m_path_graph->begin_in_edges(current); in_edge != m_path_graph->end_in_edges(current); ++in_edge) {
+			update_goal_state(m_path_graph->get_edge_source(*in_edge));
+		}
+
+		if (m_timeout != -1 && get_ticks() > start_time + m_timeout) {
+			// Carry on from here next time
+			return false;
+		}
+	}
+	return true;
+}
+
+bool Pathfinder::follow_path(PathGraph::NodeId start_node, vector<SparseIntersectMap::Intersect>& path) {
+	PathGraph::NodeId current = start_node;
+	for (size_t hops = 0; hops < m_path_graph->get_nbr_nodes(); ++hops) {
+		// Take the jump which leaves us closest to the goal.  (Jumps which land back where we
+		// are can't help, but might look just as good if they're short enough.)
+		const PathGraph::Edge* best_edge = NULL;
+		float best_dist = UNREACHABLE;
+		for (const PathGraph::Edge* edge = m_path_graph->begin_edges(current); edge != m_path_graph->end_edges(current); ++edge) {
+			if (edge->target == current) {
+				continue;
+			}
+			float dist = get_goal_dist(*edge);
+			if (dist < best_dist) {
+				best_dist = dist;
+				best_edge = edge;
+			}
+		}
+
+		if (best_edge == NULL) {
+			return false;
+		}
+
+		path.push_back(best_edge->isect);
+		if (is_within_dist(best_edge->isect, m_goal_x, m_goal_y, m_goal_tolerance)) {
+			return true;
+		}
+		current = best_edge->target;
+	}
+	return false;
+}
+
 bool Pathfinder::find_path(float start_x, float start_y, float goal_x, float goal_y, float tolerance, vector<SparseIntersectMap::Intersect>& path) {
 	return find_path(start_x, start_y, goal_x, goal_y, tolerance, path, &Pathfinder::is_within_dist);
 }
@@ -149,11 +477,12 @@ bool Pathfinder::find_path_to_visibility(float start_x, float start_y, float goa
 	return find_path(start_x, start_y, goal_x, goal_y, tolerance, path, &Pathfinder::is_visible);
 }
 
-void Pathfinder::reconstruct_path(std::map<SparseIntersectMap::Intersect, SparseIntersectMap::Intersect, IntersectComparator>& came_from, SparseIntersectMap::Intersect current, std::vector<SparseIntersectMap::Intersect>& path) {
-	if (came_from.find(current) != came_from.end()) {
-		reconstruct_path(came_from, came_from[current], path);
+void Pathfinder::reconstruct_path(PathGraph::NodeId current, std::vector<SparseIntersectMap::Intersect>& path) {
+	size_t first = path.size();
+	for (PathGraph::NodeId node = current; node != PathGraph::NO_NODE; node = m_nodes[node].came_from) {
+		path.push_back(m_nodes[node].isect);
 	}
-	path.push_back(current);
+	reverse(path.begin() + first, path.end());
 }
 
 float Pathfinder::get_dist(SparseIntersectMap::Intersect node, float goal_x, float goal_y) {
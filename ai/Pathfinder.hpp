@@ -26,54 +26,107 @@
 #define LM_AI_PATHFINDER_HPP
 
 #include "SparseIntersectMap.hpp"
+#include "PathGraph.hpp"
+#include "NodeHeap.hpp"
 #include "common/RayCast.hpp"
-#include <queue>
 #include <vector>
-#include <map>
 
 class b2World;
 
 namespace LM {
 	class Player;
 
+	/*
+	 * A* search over the map graph.
+	 *
+	 * The map graph is compacted into a PathGraph when it changes (Pathfinders using the same
+	 * graph file share one PathGraph), and each search keeps its scores in a per-node array which
+	 * is reused from search to search (so Pathfinders only share the read-only graph, and a search
+	 * doesn't allocate once the arrays are big enough).  The open set is a binary heap which knows
+	 * where each node is, so a node's score is lowered in place
+	 * instead of pushing it again.
+	 *
+	 * Recent results are cached, by the cell the search starts in and the cell of the goal, for
+	 * as long as the avoid areas stay the same.
+	 *
+	 * In incremental mode, find_path() instead searches back from the goal (D* Lite, without a
+	 * heuristic), and keeps the distance to the goal of the nodes it's searched.  When the goal
+	 * stays put, a search from a new start only has to search as far as the new start is from the
+	 * goal, and a change in the avoid areas only updates the nodes which are near them.  If a search
+	 * times out, the next one picks up where it left off.
+	 */
 	class Pathfinder {
 
 	typedef bool (Pathfinder::*PathFoundFunc)(SparseIntersectMap::Intersect node, float goal_x, float goal_y, float tolerance);
 	
-	private:
-	
-		class IntersectComparator {
-		public:
-			bool operator()(const SparseIntersectMap::Intersect& n1, const SparseIntersectMap::Intersect& n2) {
-				return (n1.dist > n2.dist);
-			}
-		};
-		
 	public:
 		struct AvoidArea {
 			float x;
 			float y;
 			float area;
 			float weight;
+
+			bool operator==(const AvoidArea& other) const;
 		};
-		
-		static std::map<SparseIntersectMap::Intersect, float, IntersectComparator> f_scores;
-		static std::map<SparseIntersectMap::Intersect, float, IntersectComparator> g_scores;
-		static std::map<SparseIntersectMap::Intersect, float, IntersectComparator> h_scores;
+
+		enum { PATH_CACHE_SIZE = 16 };
 	
 	private:
-	
-		class GraphNodeComparator {
-		public:
-			bool operator()(SparseIntersectMap::Intersect& n1, SparseIntersectMap::Intersect& n2) {
-				return (Pathfinder::f_scores[n1] > Pathfinder::f_scores[n2]);
-			}
+		// What a search knows about a node.  Only valid if search == m_search.
+		struct NodeState {
+			uint32_t search;
+			bool closed;
+			PathGraph::NodeId came_from;
+			float g_score;
+			SparseIntersectMap::Intersect isect; // Where we land in this node
+		};
+
+		// What the incremental search knows about a node
+		struct GoalState {
+			float dist;		// Distance to the goal
+			float lookahead;	// Distance to the goal through the best neighbor
+		};
+
+		struct CachedPath {
+			PathGraph::NodeId start;
+			uint64_t goal;
+			float tolerance;
+			PathFoundFunc check_found;
+			std::vector<AvoidArea> avoid_areas;
+			bool found;
+			std::vector<SparseIntersectMap::Intersect> path;
+			uint64_t last_used;
 		};
 		
 		SparseIntersectMap* m_graph;
+		const PathGraph* m_path_graph; // Either m_own_path_graph, or shared with other Pathfinders
+		PathGraph m_own_path_graph;
+		std::vector<NodeState> m_nodes;
+		NodeHeap m_open_set;
+		uint32_t m_search;
+		size_t m_nbr_expanded;
+
+		std::vector<CachedPath> m_path_cache;
+		size_t m_path_cache_size;
+		uint64_t m_cache_clock;
+		size_t m_nbr_cache_hits;
+
+		bool m_incremental;
+		bool m_has_goal;
+		float m_goal_x;
+		float m_goal_y;
+		float m_goal_tolerance;
+		std::vector<AvoidArea> m_goal_avoid_areas; // The avoid areas the distances were computed with
+		std::vector<GoalState> m_goal_states;
+		NodeHeap m_goal_queue;
+
 		std::vector<AvoidArea*> m_avoid_areas;
 		RayCast m_ray_cast;
 		long m_timeout;
+
+		void reset();
+		void release_path_graph();
+		NodeState& visit(PathGraph::NodeId node);
 	
 		float estimate_h_score(SparseIntersectMap::Intersect intersect, float goal_x, float goal_y);
 	
@@ -82,11 +135,26 @@ namespace LM {
 		bool is_within_dist(SparseIntersectMap::Intersect node, float goal_x, float goal_y, float tolerance);
 		bool is_visible(SparseIntersectMap::Intersect node, float goal_x, float goal_y, float tolerance);
 		
-		void reconstruct_path(std::map<SparseIntersectMap::Intersect, SparseIntersectMap::Intersect, IntersectComparator>& came_from, SparseIntersectMap::Intersect current, std::vector<SparseIntersectMap::Intersect>& path);
+		void reconstruct_path(PathGraph::NodeId current, std::vector<SparseIntersectMap::Intersect>& path);
 	
 		float calculate_g_score(SparseIntersectMap::Intersect node);
 		
 		bool find_path(float start_x, float start_y, float goal_x, float goal_y, float tolerance, std::vector<SparseIntersectMap::Intersect>& path, PathFoundFunc check_found);
+		bool search(const SparseIntersectMap::Intersect& start, PathGraph::NodeId start_node, float goal_x, float goal_y, float tolerance, std::vector<SparseIntersectMap::Intersect>& path, PathFoundFunc check_found, bool* timed_out);
+
+		// Path cache
+		bool avoid_areas_match(const std::vector<AvoidArea>& avoid_areas) const;
+		CachedPath* find_cached_path(PathGraph::NodeId start_node, float goal_x, float goal_y, float tolerance, PathFoundFunc check_found);
+		void cache_path(PathGraph::NodeId start_node, float goal_x, float goal_y, float tolerance, PathFoundFunc check_found, bool found, const std::vector<SparseIntersectMap::Intersect>& path, size_t first);
+
+		// Incremental search
+		void set_goal(float goal_x, float goal_y, float tolerance);
+		void update_avoid_areas();
+		void update_near(float x, float y, float radius);
+		void update_goal_state(PathGraph::NodeId node);
+		float get_goal_dist(const PathGraph::Edge& edge);
+		bool search_from_goal(PathGraph::NodeId start_node, uint64_t start_time);
+		bool follow_path(PathGraph::NodeId start_node, std::vector<SparseIntersectMap::Intersect>& path);
 
 	public:
 		Pathfinder();
@@ -94,8 +162,11 @@ namespace LM {
 		~Pathfinder();
 	
 		void set_graph(SparseIntersectMap* graph);
-		void set_physics(const b2World* world);
+		void set_physics(const b2World* world, const StaticGeometry* static_geometry = NULL);
 		void set_timeout(long timeout);
+		void set_incremental(bool incremental);
+		// How many searches to remember the results of (0 to not cache them)
+		void set_path_cache_size(size_t size);
 		
 		void add_avoid_area(AvoidArea* a);
 		
@@ -104,6 +175,14 @@ namespace LM {
 		// Fills the "path" with the path to the goal. Returns false if it cannot find one.
 		bool find_path(float start_x, float start_y, float goal_x, float goal_y, float tolerance, std::vector<SparseIntersectMap::Intersect>& path);
 		bool find_path_to_visibility(float start_x, float start_y, float goal_x, float goal_y, float tolerance, std::vector<SparseIntersectMap::Intersect>& path);
+
+		// Rebuild the PathGraph if the map graph has changed since it was built
+		void update_graph();
+		const PathGraph* get_path_graph() const;
+
+		// How many nodes the last search took from the open set
+		size_t get_nbr_expanded() const;
+		size_t get_nbr_cache_hits() const;
 	};
 }
 
@@ -28,10 +28,17 @@
 #include <ctime>
 #include "common/team.hpp"
 #include "common/RayCast.hpp"
+#include <algorithm>
 
 using namespace LM;
 using namespace std;
 
+namespace {
+	bool	compare_ids(const Player* a, const Player* b) {
+		return a->get_id() < b->get_id();
+	}
+}
+
 const float ReactiveAIController::MAX_AIM_VEL = .04f;
 const unsigned int ReactiveAIController::AIM_TOLERANCE = .01f;
 const float ReactiveAIController::BASE_AIM_UNCERTAINTY = .2f;
@@ -59,16 +66,20 @@ void ReactiveAIController::find_desired_aim(const GameLogic& state, uint32_t pla
 		return;
 	}
 	
+	m_ray_cast.set_physics(state.get_world(), state.get_static_geometry());
+	
 	// Find the nearest enemy.
-	ConstIterator<std::pair<uint32_t, Player*> > it=state.list_players();
-	while(it.has_more()) {
-		std::pair<uint32_t, Player*> next = it.next();
-		if (next.first == player_id) {
+	// Only players within our vision radius can be seen, so don't bother casting rays at the rest.
+	// They're checked in order of ID, as they would be if we went through every player.
+	m_nearby_players.clear();
+	state.find_players_near(my_player->get_position(), VISION_RADIUS, m_nearby_players);
+	sort(m_nearby_players.begin(), m_nearby_players.end(), compare_ids);
+	for (size_t i = 0; i < m_nearby_players.size(); ++i) {
+		Player* currplayer = m_nearby_players[i];
+		if (currplayer->get_id() == player_id) {
 			continue;
 		}
 		
-		Player* currplayer = next.second;
-		
 		if (currplayer->get_team() == my_player->get_team()) {
 			continue;
 		}
@@ -77,7 +88,7 @@ void ReactiveAIController::find_desired_aim(const GameLogic& state, uint32_t pla
 			continue;
 		}
 		
-		float dist = check_player_visible(state.get_world(), my_player, currplayer);
+		float dist = check_player_visible(my_player, currplayer);
 		if (dist > -1) {
 			closestenemy = currplayer;
 			closestdist = dist;
@@ -89,7 +100,7 @@ void ReactiveAIController::find_desired_aim(const GameLogic& state, uint32_t pla
 	
 	float dist = -1;
 	if (m_enemy_gate != NULL) {
-		dist = check_gate_visible(state.get_world(), my_player, m_enemy_gate);
+		dist = check_gate_visible(my_player, m_enemy_gate);
 	}
 	
 	if (dist > -1 && dist < VISION_RADIUS && 
@@ -152,13 +163,12 @@ float ReactiveAIController::update_gun() {
 	return fabs(m_curr_aim - m_wanted_aim);
 }
 
-float ReactiveAIController::check_gate_visible(const b2World* physics, const Player* start_player, const Gate* gate) {
+float ReactiveAIController::check_gate_visible(const Player* start_player, const Gate* gate) {
 	b2Vec2 ray_start = b2Vec2(to_physics(start_player->get_x()), to_physics(start_player->get_y()));
 	
-	RayCast cast(physics);
-	cast.cast_at_obstacle(ray_start, gate, VISION_RADIUS, true);
+	m_ray_cast.cast_at_obstacle(ray_start, gate, VISION_RADIUS, true);
 	
-	RayCast::RayCastResult& result = cast.get_result();
+	RayCast::RayCastResult& result = m_ray_cast.get_result();
 	
 	PhysicsObject* hitobj = result.closest_object;
 	if (hitobj == NULL) {
@@ -173,12 +183,11 @@ float ReactiveAIController::check_gate_visible(const b2World* physics, const Pla
 }
 
 
-float ReactiveAIController::check_player_visible(const b2World* physics, const Player* start_player, const Player* other_player) {
-	RayCast cast(physics);
+float ReactiveAIController::check_player_visible(const Player* start_player, const Player* other_player) {
 	b2Vec2 start_pos = b2Vec2(to_physics(start_player->get_x()), to_physics(start_player->get_y()));
-	cast.cast_at_player(start_pos, other_player, VISION_RADIUS);
+	m_ray_cast.cast_at_player(start_pos, other_player, VISION_RADIUS);
 	
-	RayCast::RayCastResult& result = cast.get_result();
+	RayCast::RayCastResult& result = m_ray_cast.get_result();
 	
 	PhysicsObject* hitobj = result.closest_object;
 	if (hitobj == NULL) {
@@ -27,7 +27,9 @@
 
 #include "client/Controller.hpp"
 #include <string>
+#include <vector>
 #include "common/physics.hpp"
+#include "common/RayCast.hpp"
 
 namespace LM {
 	class ReactiveAIController : public Controller {
@@ -57,11 +59,13 @@ namespace LM {
 		
 		float update_gun(); // Returns the absolute value of the difference between desired and actual angle.
 		
-		float check_player_visible(const b2World* world, const Player* start_player, const Player* other_player); // Returns the distance to the player, or -1 if not visible.
-		float check_gate_visible(const b2World* physics, const Player* start_player, const Gate* gate); // Returns the distance to the gate, or -1 if not visible.
+		float check_player_visible(const Player* start_player, const Player* other_player); // Returns the distance to the player, or -1 if not visible.
+		float check_gate_visible(const Player* start_player, const Gate* gate); // Returns the distance to the gate, or -1 if not visible.
 		
 		// For ray casts:
+		RayCast			m_ray_cast;		// Set up for the current GameLogic by find_desired_aim().
 		const Gate*		m_enemy_gate;		// The other team's gate.
+		std::vector<Player*>	m_nearby_players;	// Players close enough to be seen, re-used for every update.
 
 	public:
 		ReactiveAIController();
@@ -51,18 +51,20 @@ SeekingState::~SeekingState() {
 
 void SeekingState::load_rules() {
 	// Load the rules.
-	m_rule_good_target =
+	m_rule_good_target.compile(
 		new FuzzyLogic::Not(
 			m_fuzzy->make_terminal("other_energy_percent","frozen")
-		);
+		)
+	);
 		
-	m_rule_easy_target = 
+	m_rule_easy_target.compile(
 		new FuzzyLogic::Or(
 			m_fuzzy->make_terminal("other_energy_percent", "almost_frozen"),
 			m_fuzzy->make_terminal("other_energy_percent", "damaged")
-		);
+		)
+	);
 		
-	m_rule_dangerous = 
+	m_rule_dangerous.compile(
 		new FuzzyLogic::Or(
 			new FuzzyLogic::Not(
 				m_fuzzy->make_terminal("other_can_see_enemy_gate", "far_away")
@@ -70,9 +72,10 @@ void SeekingState::load_rules() {
 			new FuzzyLogic::Not(
 				m_fuzzy->make_terminal("other_holding_gate", "not_holding")
 			)
-		);
+		)
+	);
 	
-	m_rule_can_target =
+	m_rule_can_target.compile(
 		new FuzzyLogic::And(
 			new FuzzyLogic::And(
 				new FuzzyLogic::Not(
@@ -99,9 +102,10 @@ void SeekingState::load_rules() {
 				m_fuzzy->make_terminal("gun_cooldown", "ready"),
 				m_fuzzy->make_terminal("gun_cooldown", "almost_ready")
 			)
-		);
+		)
+	);
 	
-	m_rule_firing_importance =
+	m_rule_firing_importance.compile(
 		new FuzzyLogic::And(
 			new FuzzyLogic::And(
 				// Are we in danger of dying soon?
@@ -166,9 +170,10 @@ void SeekingState::load_rules() {
 					)
 				)
 			)
-		);
+		)
+	);
 	
-	m_rule_jump_at_enemy = 
+	m_rule_jump_at_enemy.compile(
 		new FuzzyLogic::And(
 			new FuzzyLogic::And(
 				// Can we jump soon?
@@ -181,9 +186,10 @@ void SeekingState::load_rules() {
 			),
 			// Can we see the enemy?
 			m_fuzzy->make_terminal("can_see_player", "cant_see")
-		);
+		)
+	);
 	
-	m_rule_weapon_fitness = 
+	m_rule_weapon_fitness.compile(
 		new FuzzyLogic::Or(
 			new FuzzyLogic::And(
 				m_fuzzy->make_terminal("weap_damage_at_player", "freeze"),
@@ -200,7 +206,8 @@ void SeekingState::load_rules() {
 					m_fuzzy->make_terminal("weap_freeze_time", "none")
 				)
 			)
-		);
+		)
+	);
 }
 
 const string& SeekingState::get_name() const {
@@ -240,15 +247,18 @@ void SeekingState::decide(FuzzyLogicAI* ai, FuzzyEnvironment* env, const GameLog
 void SeekingState::switch_target(FuzzyLogicAI* ai, const GameLogic& logic, FuzzyEnvironment* env) {
 	const Player* my_player = ai->get_own_player();
 
-	ConstIterator<std::pair<uint32_t, Player*> > other_players = logic.list_players();
+	const std::vector<Player*>& other_players = logic.get_players();
 	Player* best_target = NULL;
 	float best_target_val = 0.0f;
 
+	// Apply the rules to every entity at once
+	m_rule_good_target.apply(*env, &m_good_target_scores);
+	m_rule_easy_target.apply(*env, &m_easy_target_scores);
+	m_rule_dangerous.apply(*env, &m_dangerous_scores);
+
 	// Determine danger for each enemy player.
-	while (other_players.has_more()) {
-		std::pair<uint32_t, Player*> next_iter = other_players.next();
-		
-		Player* other_player = next_iter.second;
+	for (std::vector<Player*>::const_iterator next_iter(other_players.begin()); next_iter != other_players.end(); ++next_iter) {
+		Player* other_player = *next_iter;
 		if (other_player == my_player) {
 			continue;
 		}
@@ -258,11 +268,11 @@ void SeekingState::switch_target(FuzzyLogicAI* ai, const GameLogic& logic, Fuzzy
 			continue;
 		}
 		
-		float good_target = m_rule_good_target->apply(*env, (long)other_player);
+		float good_target = get_score(m_good_target_scores, env, (long)other_player);
 		
-		float easy_target = m_rule_easy_target->apply(*env, (long)other_player);
+		float easy_target = get_score(m_easy_target_scores, env, (long)other_player);
 		
-		float dangerous = m_rule_dangerous->apply(*env, (long)other_player);
+		float dangerous = get_score(m_dangerous_scores, env, (long)other_player);
 		
 		if (m_target == other_player) {
 			good_target *= 10;
@@ -300,10 +310,13 @@ bool SeekingState::check_switch_weapons(FuzzyLogicAI* ai, const GameLogic& logic
 		
 		ConstIterator<Weapon*> weapons = logic.list_weapons();
 
+		// Apply the rules to every entity at once
+		m_rule_weapon_fitness.apply(*env, &m_weapon_fitness_scores);
+
 		while (weapons.has_more()) {
 			Weapon* weapon = weapons.next();
 			
-			float weapon_fitness = m_rule_weapon_fitness->apply(*env, get_combo_id(m_target, weapon));
+			float weapon_fitness = get_score(m_weapon_fitness_scores, env, get_combo_id(m_target, weapon));
 			
 			// Favor the current weapon.
 			if (weapon->get_id() == ai->get_curr_weapon() && weapon_fitness >= 0.95f) {
@@ -344,16 +357,16 @@ void SeekingState::update_wanted_aim(FuzzyLogicAI* ai, const GameLogic& logic, F
 	
 	if (m_target != NULL) {
 		// Determine importance of aiming at target.
-		float good_target = m_rule_good_target->apply(*env, (long)m_target);
+		float good_target = m_rule_good_target.apply(*env, (long)m_target);
 		
-		float can_target = m_rule_can_target->apply(*env, (long)m_target);
+		float can_target = m_rule_can_target.apply(*env, (long)m_target);
 		
-		float firing_importance = m_rule_firing_importance->apply(*env, (long)m_target);
+		float firing_importance = m_rule_firing_importance.apply(*env, (long)m_target);
 		
 		aim_at_target = (int)(good_target * can_target * firing_importance * 100.0f);
 		
 		// Determine if we should jump at the enemy.
-		jump_at_enemy = m_rule_jump_at_enemy->apply(*env, (long)m_target) * 100;
+		jump_at_enemy = m_rule_jump_at_enemy.apply(*env, (long)m_target) * 100;
 	}
 	
 	Pathfinder* pathfinder = ai->get_pathfinder();
@@ -442,13 +455,14 @@ void SeekingState::update_wanted_aim(FuzzyLogicAI* ai, const GameLogic& logic, F
 void SeekingState::check_transitions(FuzzyLogicAI* ai, const GameLogic& logic, FuzzyEnvironment* env) {
 	const Player* my_player = ai->get_own_player();
 	
-	ConstIterator<std::pair<uint32_t, Player*> > other_players = logic.list_players();
+	const std::vector<Player*>& other_players = logic.get_players();
+
+	// Apply the rules to every entity at once
+	m_rule_good_target.apply(*env, &m_good_target_scores);
 
 	// Determine danger for each enemy player.
-	while (other_players.has_more()) {
-		std::pair<uint32_t, Player*> next_iter = other_players.next();
-		
-		Player* other_player = next_iter.second;
+	for (std::vector<Player*>::const_iterator next_iter(other_players.begin()); next_iter != other_players.end(); ++next_iter) {
+		Player* other_player = *next_iter;
 		if (other_player == my_player) {
 			continue;
 		}
@@ -458,7 +472,7 @@ void SeekingState::check_transitions(FuzzyLogicAI* ai, const GameLogic& logic, F
 			continue;
 		}
 		
-		float good_target = m_rule_good_target->apply(*env, (long)other_player);
+		float good_target = get_score(m_good_target_scores, env, (long)other_player);
 		
 		if (good_target != 0) {
 			m_next_state = "seeking";
@@ -44,13 +44,19 @@ namespace LM {
 		AI::AimReason m_aim_reason;
 		
 		// Fuzzy Logic Rules
-		FuzzyLogic::Rule* m_rule_good_target;
-		FuzzyLogic::Rule* m_rule_easy_target;
-		FuzzyLogic::Rule* m_rule_dangerous;
-		FuzzyLogic::Rule* m_rule_can_target;
-		FuzzyLogic::Rule* m_rule_firing_importance;
-		FuzzyLogic::Rule* m_rule_jump_at_enemy;
-		FuzzyLogic::Rule* m_rule_weapon_fitness;
+		FuzzyLogic::Program m_rule_good_target;
+		FuzzyLogic::Program m_rule_easy_target;
+		FuzzyLogic::Program m_rule_dangerous;
+		FuzzyLogic::Program m_rule_can_target;
+		FuzzyLogic::Program m_rule_firing_importance;
+		FuzzyLogic::Program m_rule_jump_at_enemy;
+		FuzzyLogic::Program m_rule_weapon_fitness;
+		
+		// The scores of every entity, from the last time each rule was applied to them all
+		std::vector<float> m_good_target_scores;
+		std::vector<float> m_easy_target_scores;
+		std::vector<float> m_dangerous_scores;
+		std::vector<float> m_weapon_fitness_scores;
 		
 		void load_rules();
 		void switch_target(FuzzyLogicAI* ai, const GameLogic& logic, FuzzyEnvironment* env);
@@ -25,12 +25,27 @@
 #include "SparseIntersectMap.hpp"
 #include "common/misc.hpp"
 #include "common/file.hpp"
+#include "common/Exception.hpp"
 
 #include <cstring>
+#include <iterator>
 
 using namespace LM;
 using namespace std;
 
+namespace {
+	size_t page_align(size_t offset) {
+		return (offset + SparseIntersectMap::PAGE_SIZE - 1) & ~size_t(SparseIntersectMap::PAGE_SIZE - 1);
+	}
+
+	uint32_t get32(const char* data, size_t offset) {
+		return *reinterpret_cast<const uint32_t*>(data + offset);
+	}
+
+	// Size of the fixed fields of the header, up to and including the length of the map name
+	const size_t HEADER_SIZE = 40;
+}
+
 class SparseIntersectMap::ConstMapIterator : public ConstIterator<const SparseIntersectMap::Intersect&>::OpaqueIterator {
 private:
 	const SparseIntersectMap* m_map;
@@ -50,29 +65,36 @@ public:
 SparseIntersectMap::ConstMapIterator::ConstMapIterator(const SparseIntersectMap* map) {
 	m_map = map;
 	m_bucket = 0;
-	m_i = 0;
+	m_i = -1;
 	seek_next();
 }
 
 void SparseIntersectMap::ConstMapIterator::seek_next() {
 	ASSERT(m_bucket < m_map->m_nbuckets);
 
-	if (++m_i < m_map->m_buckets[m_bucket].nsize) {
+	const Element* elts;
+	int size;
+	m_map->get_bucket(m_bucket, &elts, &size);
+	if (++m_i < size) {
 		return;
 	}
-	for (m_i = 0; m_bucket < m_map->m_nbuckets; ++m_bucket) {
-		if (m_map->m_buckets[m_bucket].nsize) {
+	for (m_i = 0, ++m_bucket; m_bucket < m_map->m_nbuckets; ++m_bucket) {
+		m_map->get_bucket(m_bucket, &elts, &size);
+		if (size) {
 			return;
 		}
 	}
 }
 
 bool SparseIntersectMap::ConstMapIterator::has_more() const {
-	return m_bucket >= m_map->m_nbuckets;
+	return m_bucket < m_map->m_nbuckets;
 }
 
 const SparseIntersectMap::Intersect& SparseIntersectMap::ConstMapIterator::next() {
-	const Intersect& n = m_map->m_buckets[m_bucket].elts[m_i].i;
+	const Element* elts;
+	int size;
+	m_map->get_bucket(m_bucket, &elts, &size);
+	const Intersect& n = elts[m_i].i;
 	seek_next();
 	return n;
 }
@@ -90,41 +112,89 @@ SparseIntersectMap::SparseIntersectMap(int granularity, int est_elts) {
 	}
 	m_buckets = new Bucket[m_nbuckets];
 	memset(m_buckets, 0, m_nbuckets * sizeof(Bucket));
+	m_file_buckets = NULL;
+	m_file_elements = NULL;
+	m_file_copy = NULL;
+	m_map_revision = 0;
 }
 
 SparseIntersectMap::SparseIntersectMap(std::istream* f) {
+	m_buckets = NULL;
+	m_file_copy = NULL;
+
+	// Read the whole file, and use it in place
+	string contents((istreambuf_iterator<char>(*f)), istreambuf_iterator<char>());
+	m_file_copy = new char[contents.size() + 1];
+	memcpy(m_file_copy, contents.data(), contents.size());
 	try {
-		static uint16_t v = 0;
-		expect(f, "LMSM", 4);
-		expect(f, &v, 2);
-		read32(f, &m_count);
-		read32(f, &m_grain);
-		read32(f, &m_nbuckets);
-		m_buckets = new Bucket[m_nbuckets];
-		for (int i = 0; i < m_nbuckets; ++i) {
-			Bucket& bucket = m_buckets[i];
-			read32(f, &bucket.psize);
-			bucket.elts = new Element[bucket.psize];
-			int j;
-			for (j = 0; j < bucket.psize; ++j) {
-				read32(f, &bucket.elts[j].x);
-				read32(f, &bucket.elts[j].y);
-				read32(f, &bucket.elts[j].t);
-				read32(f, &bucket.elts[j].i.x);
-				read32(f, &bucket.elts[j].i.y);
-				read32(f, &bucket.elts[j].i.dist);
-			}
-		}
+		load(m_file_copy, contents.size());
 	} catch (const Exception&) {
-		throw Exception("Could not read file");
+		delete[] m_file_copy;
+		throw;
 	}
 }
 
-SparseIntersectMap::~SparseIntersectMap() {
+SparseIntersectMap::SparseIntersectMap(const char* data, size_t length) {
+	m_buckets = NULL;
+	m_file_copy = NULL;
+	load(data, length);
+}
+
+void SparseIntersectMap::load(const char* data, size_t length) {
+	if (length < HEADER_SIZE || memcmp(data, "LMSM", 4) != 0) {
+		throw Exception("Not a map graph file");
+	}
+	if (*reinterpret_cast<const uint16_t*>(data + 4) != FORMAT_VERSION || get32(data, 8) != BYTE_ORDER_MARK) {
+		throw Exception("Map graph file is from an incompatible version or machine");
+	}
+
+	m_map_revision = get32(data, 12);
+	m_count = get32(data, 16);
+	m_grain = get32(data, 20);
+	m_nbuckets = get32(data, 24);
+	size_t buckets_offset = get32(data, 28);
+	size_t elements_offset = get32(data, 32);
+	size_t name_length = get32(data, 36);
+
+	if (m_count < 0 || m_nbuckets <= 0 || HEADER_SIZE + name_length > length
+			|| buckets_offset % 4 != 0 || buckets_offset + (m_nbuckets + 1) * sizeof(uint32_t) > length
+			|| elements_offset % 4 != 0 || elements_offset + m_count * sizeof(Element) > length) {
+		throw Exception("Map graph file is truncated or corrupt");
+	}
+	m_map_name.assign(data + HEADER_SIZE, name_length);
+
+	m_file_buckets = reinterpret_cast<const uint32_t*>(data + buckets_offset);
+	m_file_elements = reinterpret_cast<const Element*>(data + elements_offset);
+
+	// Make sure no bucket lies outside the file
 	for (int i = 0; i < m_nbuckets; ++i) {
-		delete m_buckets[i].elts;
+		if (m_file_buckets[i] > m_file_buckets[i + 1]) {
+			throw Exception("Map graph file is corrupt");
+		}
+	}
+	if (m_file_buckets[0] != 0 || m_file_buckets[m_nbuckets] != uint32_t(m_count)) {
+		throw Exception("Map graph file is corrupt");
+	}
+}
+
+SparseIntersectMap::~SparseIntersectMap() {
+	if (m_buckets) {
+		for (int i = 0; i < m_nbuckets; ++i) {
+			delete[] m_buckets[i].elts;
+		}
+		delete[] m_buckets;
+	}
+	delete[] m_file_copy;
+}
+
+void SparseIntersectMap::get_bucket(int index, const Element** elts, int* size) const {
+	if (m_buckets) {
+		*elts = m_buckets[index].elts;
+		*size = m_buckets[index].nsize;
+	} else {
+		*elts = m_file_elements + m_file_buckets[index];
+		*size = m_file_buckets[index + 1] - m_file_buckets[index];
 	}
-	delete m_buckets;
 }
 
 int SparseIntersectMap::make_hash(int x, int y, int theta) const {
@@ -149,6 +219,9 @@ int SparseIntersectMap::grain_theta(float theta) const {
 }
 
 void SparseIntersectMap::set(float x, float y, float theta, const Intersect& isect) {
+	// Graphs loaded from files are read-only
+	ASSERT(m_buckets != NULL);
+
 	int gx = grain_x(x);
 	int gy = grain_y(y);
 	int gt = grain_theta(theta);
@@ -180,7 +253,7 @@ void SparseIntersectMap::set(float x, float y, float theta, const Intersect& ise
 		bucket.psize <<= 1;
 		Element* nelts = new Element[bucket.psize];
 		memcpy(nelts, bucket.elts, sizeof(Element)*bucket.nsize);
-		delete bucket.elts;
+		delete[] bucket.elts;
 		bucket.elts = nelts;
 	}
 
@@ -196,10 +269,12 @@ bool SparseIntersectMap::get(float x, float y, float theta, Intersect* isect) co
 	int gx = grain_x(x);
 	int gy = grain_y(y);
 	int gt = grain_theta(theta);
-	const Bucket& bucket = m_buckets[make_hash(gx, gy, gt)];
+	const Element* elts;
+	int size;
+	get_bucket(make_hash(gx, gy, gt), &elts, &size);
 
-	for (int i = 0; i < bucket.nsize; ++i) {
-		const Element& e = bucket.elts[i];
+	for (int i = 0; i < size; ++i) {
+		const Element& e = elts[i];
 		if (e.x == gx && e.y == gy && e.t == gt) {
 			*isect = e.i;
 			return true;
@@ -213,34 +288,67 @@ int SparseIntersectMap::count() const {
 	return m_count;
 }
 
+bool SparseIntersectMap::is_read_only() const {
+	return m_buckets == NULL;
+}
+
 ConstIterator<const SparseIntersectMap::Intersect&> SparseIntersectMap::iterate() const {
 	return ConstIterator<const SparseIntersectMap::Intersect&>(new ConstMapIterator(this));
 }
 
-void SparseIntersectMap::write(ostream* f) const {
+void SparseIntersectMap::write(ostream* f, const char* map_name, int map_revision) const {
+	size_t name_length = strlen(map_name);
+	size_t buckets_offset = page_align(HEADER_SIZE + name_length);
+	size_t elements_offset = page_align(buckets_offset + (m_nbuckets + 1) * sizeof(uint32_t));
+
 	(*f) << "LMSM";
+	write16(f, FORMAT_VERSION);
 	write16(f, 0);
+	write32(f, uint32_t(BYTE_ORDER_MARK));
+	write32(f, map_revision);
 	write32(f, m_count);
 	write32(f, m_grain);
 	write32(f, m_nbuckets);
+	write32(f, uint32_t(buckets_offset));
+	write32(f, uint32_t(elements_offset));
+	write32(f, uint32_t(name_length));
+	f->write(map_name, name_length);
+	write0(f, buckets_offset - HEADER_SIZE - name_length);
+
+	uint32_t first = 0;
 	for (int i = 0; i < m_nbuckets; ++i) {
-		const Bucket& bucket = m_buckets[i];
-		write32(f, bucket.psize);
-		int j;
-		for (j = 0; j < bucket.nsize; ++j) {
-			write32(f, bucket.elts[j].x);
-			write32(f, bucket.elts[j].y);
-			write32(f, bucket.elts[j].t);
-			write32(f, bucket.elts[j].i.x);
-			write32(f, bucket.elts[j].i.y);
-			write32(f, bucket.elts[j].i.dist);
-		}
-		for (; j < bucket.psize; ++j) {
-			write0(f, 4*6);
+		const Element* elts;
+		int size;
+		get_bucket(i, &elts, &size);
+		write32(f, first);
+		first += size;
+	}
+	write32(f, first);
+	write0(f, elements_offset - buckets_offset - (m_nbuckets + 1) * sizeof(uint32_t));
+
+	for (int i = 0; i < m_nbuckets; ++i) {
+		const Element* elts;
+		int size;
+		get_bucket(i, &elts, &size);
+		for (int j = 0; j < size; ++j) {
+			write32(f, elts[j].x);
+			write32(f, elts[j].y);
+			write32(f, elts[j].t);
+			write32(f, elts[j].i.x);
+			write32(f, elts[j].i.y);
+			write32(f, elts[j].i.dist);
 		}
 	}
 }
 
+const char* SparseIntersectMap::get_map_name() const {
+	return m_map_name.c_str();
+}
+
+int SparseIntersectMap::get_map_revision() const {
+	return m_map_revision;
+}
+
 float SparseIntersectMap::get_granularity_x() const {
 	return 1 << m_grain;
 }
@@ -28,12 +28,36 @@
 #include "common/Iterator.hpp"
 #include <istream>
 #include <ostream>
+#include <string>
+#include <stdint.h>
+#include <stddef.h>
 
 namespace LM {
+	class PathGraph;
+
+	/*
+	 * A map graph: for positions (x, y) on the map and directions theta, the point and distance
+	 * where a player jumping from there in that direction would land.
+	 *
+	 * A graph is either built up with set(), or loaded from a file written by write(), in which case
+	 * it's read-only.  The file format is designed to be used directly from a memory-mapped file
+	 * (see MappedFile), so that every bot on a host shares one copy of the graph:
+	 *
+	 *	"LMSM", version (16 bits), 0 (16 bits), BYTE_ORDER_MARK, map revision, number of entries,
+	 *	granularity, number of buckets, offset of the bucket table, offset of the entries,
+	 *	length of the map name, map name
+	 *	(padding to a page boundary)
+	 *	bucket table: for each bucket, the index of its first entry, followed by the number of entries
+	 *	(padding to a page boundary)
+	 *	entries: x, y, theta (in grains), and the intersect's x, y, and dist
+	 *
+	 * All fields are 32 bits, in the byte order of the machine which wrote the file.
+	 */
 	class SparseIntersectMap {
 		class ConstMapIterator;
 
 		friend class SparseIntersectMap::ConstMapIterator;
+		friend class PathGraph;
 
 	public:
 		struct Intersect {
@@ -42,6 +66,11 @@ namespace LM {
 			float dist;
 		};
 
+		// Files written with an older version of the format can't be loaded
+		enum { FORMAT_VERSION = 1 };
+		enum { BYTE_ORDER_MARK = 0x01020304 };
+		enum { PAGE_SIZE = 4096 };
+
 	private:
 		struct Element {
 			int x;
@@ -61,24 +90,49 @@ namespace LM {
 		int m_grain;
 		int m_count;
 
+		// When loaded from a file, m_buckets is NULL, and bucket i holds the elements from
+		// m_file_elements[m_file_buckets[i]] up to m_file_elements[m_file_buckets[i + 1]].
+		const uint32_t* m_file_buckets;
+		const Element* m_file_elements;
+		char* m_file_copy; // If loaded from a stream, the file's contents
+		std::string m_map_name;
+		int m_map_revision;
+
+		void load(const char* data, size_t length);
+		void get_bucket(int index, const Element** elts, int* size) const;
+
 		int make_hash(int x, int y, int theta) const;
 
 		int grain_x(float x) const;
 		int grain_y(float y) const;
 		int grain_theta(float theta) const;
 
+		// Not copyable
+		SparseIntersectMap(const SparseIntersectMap&);
+		SparseIntersectMap& operator=(const SparseIntersectMap&);
+
 	public:
 		SparseIntersectMap(int granularity, int est_elts);
+		// Load a graph from a file, throwing an Exception if it isn't valid
 		SparseIntersectMap(std::istream* f);
+		// Use the contents of a file directly, without copying them.  The data must stay valid,
+		// and be at least 4-byte aligned.
+		SparseIntersectMap(const char* data, size_t length);
 		~SparseIntersectMap();
 
 		void set(float x, float y, float theta, const Intersect& isect);
 		bool get(float x, float y, float theta, Intersect* isect) const;
 
 		int count() const;
+		// Whether the graph was loaded from a file (and so can't be changed)
+		bool is_read_only() const;
 
 		ConstIterator<const Intersect&> iterate() const;
-		void write(std::ostream* f) const;
+		void write(std::ostream* f, const char* map_name, int map_revision) const;
+
+		// The map which a graph loaded from a file was made for
+		const char* get_map_name() const;
+		int get_map_revision() const;
 
 		float get_granularity_x() const;
 		float get_granularity_y() const;
@@ -0,0 +1,66 @@
+/*
+ * ai/bothostmain.cpp
+ *
+ * This file is part of Leges Motus, a networked, 2D shooter set in zero gravity.
+ * 
+ * Copyright 2009-2011 Andrew Ayer, Nathan Partlan, Jeffrey Pfau
+ * 
+ * Leges Motus is free and open source software.  You may redistribute it and/or
+ * modify it under the terms of version 2, or (at your option) version 3, of the
+ * GNU General Public License (GPL), as published by the Free Software Foundation.
+ * 
+ * Leges Motus is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.  See the full text of the GNU General Public License for
+ * further detail.
+ * 
+ * For a full copy of the GNU General Public License, please see the COPYING file
+ * in the root of the source code tree.  You may also retrieve a copy from
+ * <http://www.gnu.org/licenses/gpl-2.0.txt>, or request a copy by writing to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ * 02111-1307  USA
+ * 
+ */
+
+#include "ai/BotHost.hpp"
+#include "common/network.hpp"
+#include "common/Configuration.hpp"
+#include <iostream>
+#include <sstream>
+#include <cstdlib>
+
+using namespace LM;
+using namespace std;
+
+extern "C" int main(int argc, char* argv[]) {
+	if (argc > 3) {
+		cerr << "Usage: " << argv[0] << " [NBR_BOTS [NBR_THREADS]]" << endl;
+		return 1;
+	}
+	int nbr_bots = argc > 1 ? atoi(argv[1]) : 8;
+	int nbr_threads = argc > 2 ? atoi(argv[2]) : 0;
+	if (nbr_bots < 1 || nbr_threads < 0) {
+		cerr << argv[0] << ": Invalid number of bots or threads" << endl;
+		return 1;
+	}
+
+	Configuration config("ai.ini");
+	BotHost host(&config, nbr_threads);
+	const char* name = config.get_string("Player", "name", "Bot");
+	for (int i = 0; i < nbr_bots; ++i) {
+		ostringstream bot_name;
+		bot_name << name << '-' << i + 1;
+		host.add_bot(bot_name.str());
+	}
+
+	IPAddress server_address;
+	const char* server = config.get_string("Network", "server", "endrift.com:16876");
+	if (!resolve_hostname(server_address, server)) {
+		cerr << argv[0] << ": Could not resolve " << server << endl;
+		return 1;
+	}
+	host.connect(server_address);
+	host.run();
+
+	return 0;
+}
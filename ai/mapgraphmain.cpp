@@ -0,0 +1,88 @@
+/*
+ * ai/mapgraphmain.cpp
+ *
+ * This file is part of Leges Motus, a networked, 2D shooter set in zero gravity.
+ * 
+ * Copyright 2009-2011 Andrew Ayer, Nathan Partlan, Jeffrey Pfau
+ * 
+ * Leges Motus is free and open source software.  You may redistribute it and/or
+ * modify it under the terms of version 2, or (at your option) version 3, of the
+ * GNU General Public License (GPL), as published by the Free Software Foundation.
+ * 
+ * Leges Motus is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.  See the full text of the GNU General Public License for
+ * further detail.
+ * 
+ * For a full copy of the GNU General Public License, please see the COPYING file
+ * in the root of the source code tree.  You may also retrieve a copy from
+ * <http://www.gnu.org/licenses/gpl-2.0.txt>, or request a copy by writing to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ * 02111-1307  USA
+ * 
+ */
+
+/*
+ * lmmapgraph: generates the map graph files which the AI bots use to find paths, so that
+ * the bots don't each have to map the map themselves when they join a game.
+ *
+ * Usage: lmmapgraph MAPNAME...
+ * The graph files are written to the user's maps directory, next to where the maps are looked for.
+ */
+
+#include "ai/MapGrapher.hpp"
+#include "ai/SparseIntersectMap.hpp"
+#include "common/Map.hpp"
+#include "common/GameLogic.hpp"
+#include "common/Exception.hpp"
+#include "common/file.hpp"
+#include "common/timer.hpp"
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <string>
+
+using namespace LM;
+using namespace std;
+
+extern "C" int main(int argc, char* argv[]) try {
+	if (argc < 2) {
+		cerr << "Usage: " << argv[0] << " MAPNAME..." << endl;
+		return 2;
+	}
+
+	int status = 0;
+	for (int i = 1; i < argc; ++i) {
+		Map* map = new Map;
+		ifstream file;
+		open_resource(&file, (string("maps") + PATH_SEP + argv[i] + ".map").c_str());
+		if (!map->load(file)) {
+			cerr << argv[i] << ": Could not load map" << endl;
+			delete map;
+			status = 1;
+			continue;
+		}
+
+		// The GameLogic owns the map from now on
+		GameLogic logic(map);
+		logic.update_map();
+
+		uint64_t start_time = get_ticks();
+		MapGrapher grapher;
+		grapher.load_map(&logic, logic.get_world(), false);
+		grapher.do_mapping();
+
+		if (!grapher.write_map(map)) {
+			cerr << argv[i] << ": Could not write " << user_dir() << MapGrapher::get_graph_filename(map->get_name()) << endl;
+			status = 1;
+			continue;
+		}
+		cout << map->get_name() << " (revision " << map->get_revision() << "): " << grapher.get_graph()->count() << " entries in " << (get_ticks() - start_time) / 1000.0 << " seconds (" << grapher.get_nbr_workers() << " threads, " << grapher.get_entries_mapped() * 1000.0 / max<uint64_t>(grapher.get_mapping_time(), 1) << " entries/second)" << endl;
+	}
+
+	return status;
+
+} catch (const Exception& e) {
+	cerr << "Error: " << e.what() << endl;
+	return 1;
+}
@@ -0,0 +1,140 @@
+/*
+ * ai/pathbenchmain.cpp
+ *
+ * This file is part of Leges Motus, a networked, 2D shooter set in zero gravity.
+ * 
+ * Copyright 2009-2011 Andrew Ayer, Nathan Partlan, Jeffrey Pfau
+ * 
+ * Leges Motus is free and open source software.  You may redistribute it and/or
+ * modify it under the terms of version 2, or (at your option) version 3, of the
+ * GNU General Public License (GPL), as published by the Free Software Foundation.
+ * 
+ * Leges Motus is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.  See the full text of the GNU General Public License for
+ * further detail.
+ * 
+ * For a full copy of the GNU General Public License, please see the COPYING file
+ * in the root of the source code tree.  You may also retrieve a copy from
+ * <http://www.gnu.org/licenses/gpl-2.0.txt>, or request a copy by writing to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ * 02111-1307  USA
+ * 
+ */
+
+/*
+ * lmpathbench: times the Pathfinder on a map, by finding paths between random points on its graph.
+ *
+ * Usage: lmpathbench MAPNAME [QUERIES]
+ * The map's graph file is used if there is one (see lmmapgraph); otherwise the map is mapped first.
+ * The same queries are made every time, so runs can be compared.  Each goal is used for a few
+ * queries in a row, like a bot heading for a gate, and the queries are made with plain A*, then
+ * with the incremental search, then with the incremental search and the path cache.
+ */
+
+#include "ai/MapGrapher.hpp"
+#include "ai/Pathfinder.hpp"
+#include "ai/PathGraph.hpp"
+#include "ai/SparseIntersectMap.hpp"
+#include "common/Map.hpp"
+#include "common/GameLogic.hpp"
+#include "common/Exception.hpp"
+#include "common/file.hpp"
+#include "common/timer.hpp"
+#include <fstream>
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstdlib>
+
+using namespace LM;
+using namespace std;
+
+namespace {
+	const int	DEFAULT_QUERIES = 1000;
+	const int	QUERIES_PER_GOAL = 20;
+	const float	TOLERANCE = 50;
+
+	void	run_queries(const char* name, Pathfinder* pathfinder, int nbr_queries) {
+		const PathGraph* graph = pathfinder->get_path_graph();
+
+		// Go between places a player can land
+		srand(1);
+		vector<SparseIntersectMap::Intersect> path;
+		SparseIntersectMap::Intersect goal;
+		int nbr_found = 0;
+		uint64_t nbr_expanded = 0;
+		uint64_t nbr_hops = 0;
+		uint64_t start_time = get_ticks_usec();
+		for (int i = 0; i < nbr_queries; ++i) {
+			if (i % QUERIES_PER_GOAL == 0) {
+				goal = graph->get_edge(rand() % graph->get_nbr_edges()).isect;
+			}
+			const SparseIntersectMap::Intersect& start = graph->get_edge(rand() % graph->get_nbr_edges()).isect;
+			path.clear();
+			if (pathfinder->find_path(start.x, start.y, goal.x, goal.y, TOLERANCE, path)) {
+				++nbr_found;
+				nbr_hops += path.size();
+			}
+			nbr_expanded += pathfinder->get_nbr_expanded();
+		}
+		uint64_t query_time = get_ticks_usec() - start_time;
+
+		cout << name << ": " << nbr_queries << " queries in " << query_time / 1000.0 << " ms (" << (nbr_queries ? double(query_time) / nbr_queries : 0) << " us/query), ";
+		cout << nbr_found << " paths found, " << (nbr_found ? double(nbr_hops) / nbr_found : 0) << " hops/path, " << (nbr_queries ? double(nbr_expanded) / nbr_queries : 0) << " nodes expanded/query, " << pathfinder->get_nbr_cache_hits() << " cached" << endl;
+	}
+}
+
+extern "C" int main(int argc, char* argv[]) try {
+	if (argc < 2 || argc > 3) {
+		cerr << "Usage: " << argv[0] << " MAPNAME [QUERIES]" << endl;
+		return 2;
+	}
+	int nbr_queries = argc > 2 ? atoi(argv[2]) : DEFAULT_QUERIES;
+
+	Map* map = new Map;
+	ifstream file;
+	open_resource(&file, (string("maps") + PATH_SEP + argv[1] + ".map").c_str());
+	if (!map->load(file)) {
+		cerr << argv[1] << ": Could not load map" << endl;
+		delete map;
+		return 1;
+	}
+
+	// The GameLogic owns the map from now on
+	GameLogic logic(map);
+	logic.update_map();
+
+	MapGrapher grapher;
+	grapher.load_map(&logic, logic.get_world());
+	grapher.do_mapping();
+
+	uint64_t build_start = get_ticks_usec();
+	Pathfinder pathfinder(grapher.get_graph());
+	pathfinder.set_physics(logic.get_world());
+	uint64_t build_time = get_ticks_usec() - build_start;
+
+	const PathGraph* graph = pathfinder.get_path_graph();
+	cout << map->get_name() << ": " << graph->get_nbr_nodes() << " nodes, " << graph->get_nbr_edges() << " edges, built in " << build_time / 1000.0 << " ms" << endl;
+	if (graph->get_nbr_edges() == 0) {
+		cerr << argv[1] << ": The map graph is empty" << endl;
+		return 1;
+	}
+
+	pathfinder.set_path_cache_size(0);
+	run_queries("A*", &pathfinder, nbr_queries);
+
+	pathfinder.set_incremental(true);
+	run_queries("Incremental", &pathfinder, nbr_queries);
+
+	Pathfinder cached_pathfinder(grapher.get_graph());
+	cached_pathfinder.set_physics(logic.get_world());
+	cached_pathfinder.set_incremental(true);
+	run_queries("Incremental, cached", &cached_pathfinder, nbr_queries);
+
+	return 0;
+
+} catch (const Exception& e) {
+	cerr << "Error: " << e.what() << endl;
+	return 1;
+}
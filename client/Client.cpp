@@ -32,8 +32,11 @@
 #include "common/team.hpp"
 #include "common/Weapon.hpp"
 #include "common/Configuration.hpp"
+#include "common/BinaryReader.hpp"
+#include "common/network.hpp"
 #include <iostream>
 #include <fstream>
+#include <algorithm>
 
 using namespace LM;
 using namespace std;
@@ -41,7 +44,7 @@ using namespace std;
 const uint64_t Client::MAX_CONTINUOUS_JUMP_FREQUENCY = 200;
 const uint64_t Client::PLAYER_UPDATE_RATE = 34;
 
-Client::Client() : m_network(this) {
+Client::Client() : m_network(this), m_snapshot_update(PLAYER_UPDATE_PACKET), m_interpolated_update(PLAYER_UPDATE_PACKET) {
 	m_logic = NULL;
 	m_curr_weapon = -1;
 	m_player_id = -1;
@@ -49,6 +52,9 @@ Client::Client() : m_network(this) {
 	m_jumping = false;
 	m_last_jump_time = 0;
 	m_last_player_update = 0;
+	m_last_snapshot_id = 0;
+	m_server_version = 0;
+	m_interpolation_delay = 0;
 
 	m_weapon_switch_time = 0;
 	m_weapon_switch_delay = 300;
@@ -64,22 +70,33 @@ Client::~Client() {
 	delete m_logic;
 }
 
-uint64_t Client::step(uint64_t diff) {
+void Client::step(uint64_t diff) {
+	if (!begin_step()) {
+		return;
+	}
+
+	update_controller(diff);
+	finish_step();
+}
+
+bool Client::begin_step() {
 	m_network.receive_packets();
+	m_network.send_pending_acks();
 
 	if (m_logic == NULL) {
-		return 0;
-	}
-		
-	Player* player = get_player(m_player_id);
-		
-	if (player == NULL) {
-		return 0;
+		return false;
 	}
 
-	// FIXME: the client sees too many steps if diff is not a multiple of PHYSICS_TIMESTEP
+	return get_player(m_player_id) != NULL;
+}
+
+void Client::update_controller(uint64_t diff) {
 	m_controller->update(diff, *m_logic, m_player_id);
-	
+}
+
+void Client::finish_step() {
+	Player* player = get_player(m_player_id);
+
 	int changes = m_controller->get_changes();
 
 	if (!player->is_frozen()) {
@@ -118,7 +135,10 @@ uint64_t Client::step(uint64_t diff) {
 	}
 	
 	// Step the GameLogic.
-	diff = m_logic->steps(diff);
+	for (unsigned int nbr_steps = m_logic_clock.advance(get_ticks_usec()); nbr_steps > 0; --nbr_steps) {
+		m_logic->step(m_logic_clock.get_tick() - nbr_steps + 1);
+	}
+	interpolate_players();
 	
 	if (m_last_player_update < get_ticks() - PLAYER_UPDATE_RATE) {
 		Packet p;
@@ -129,8 +149,6 @@ uint64_t Client::step(uint64_t diff) {
 	
 	// Check the weapon for hitting any players:
 	check_player_hits();
-	
-	return diff;
 }
 
 void Client::add_player(Player* player) {
@@ -159,6 +177,7 @@ void Client::remove_player(uint32_t id, const string& reason) {
 	
 	Player* deleted_player = m_logic->remove_player(id);
 	delete deleted_player;
+	m_interpolators.erase(id);
 }
 
 Player* Client::get_player(uint32_t id) {
@@ -180,6 +199,8 @@ Packet* Client::attempt_firing() {
 	weapon_discharged_packet = new Packet(WEAPON_DISCHARGED_PACKET);
 	bool fired_successfully = m_logic->attempt_fire(m_player_id, m_curr_weapon, m_controller->get_aim(), &(weapon_discharged_packet->weapon_discharged));
 	if (fired_successfully) {
+		Packet::WeaponDischarged& discharged = weapon_discharged_packet->weapon_discharged;
+		discharged.input_sequence = m_predictor.add_input(m_logic->get_tick(), Predictor::FIRE, discharged.direction, m_curr_weapon);
 		m_network.send_packet(weapon_discharged_packet);
 		return weapon_discharged_packet;
 	}
@@ -210,6 +231,9 @@ void Client::generate_player_update(uint32_t id, Packet* p) {
 	}
 
 	player->generate_player_to_server_update(&p->player_to_server_update);
+	if (id == m_player_id) {
+		p->player_to_server_update.input_sequence = m_predictor.add_input(m_logic->get_tick(), Predictor::AIM);
+	}
 }
 
 void Client::generate_weapon_fired(uint32_t weapon_id, uint32_t player_id) {
@@ -233,6 +257,9 @@ void Client::generate_player_jumped(uint32_t player_id, float angle) {
 	Packet player_jumped(PLAYER_JUMPED_PACKET);
 	player_jumped.player_jumped.player_id = player_id;
 	player_jumped.player_jumped.direction = angle;
+	if (player_id == m_player_id) {
+		player_jumped.player_jumped.input_sequence = m_predictor.add_input(m_logic->get_tick(), Predictor::JUMP, angle);
+	}
 	m_network.send_reliable_packet(&player_jumped);
 }
 
@@ -251,15 +278,24 @@ void Client::set_map(Map* map) {
 		m_logic = NULL;
 	} else if (m_logic == NULL) {
 		m_logic = new GameLogic(map);
+		m_logic_clock.reset();
 	}
 }
 
+bool Client::read_map(Map* map, const string& map_name) {
+	ifstream file;
+	open_resource(&file, (string("maps") + PATH_SEP + map_name + ".map").c_str());
+	return map->load(file);
+}
+
 void Client::round_init(Map* map) {
 	// Do nothing.
 }
 
 void Client::round_cleanup() {
 	set_map(NULL);
+	m_predictor.clear_map();
+	m_interpolators.clear();
 
 	if (m_logic != NULL) {
 		m_logic->round_ended();
@@ -296,6 +332,10 @@ void Client::set_config(Configuration* config) {
 	m_config = config;
 }
 
+void Client::set_name(const string& name) {
+	m_name = name;
+}
+
 void Client::set_controller(Controller* controller) {
 	m_controller = controller;
 }
@@ -330,6 +370,7 @@ void Client::set_param(const string& param_name, const string& param_value) {
 	}
 
 	m_logic->set_param(param_name, param_value);
+	m_predictor.set_param(param_name, param_value);
 	
 	if (param_name == "weapon_switch_delay") {
 		m_weapon_switch_delay = atoi(param_value.c_str());
@@ -342,11 +383,24 @@ void Client::set_running(bool running) {
 
 void Client::connect(const IPAddress& server_address) {
 	if (m_network.connect(server_address)) {
+		m_snapshots.clear();
+		m_last_snapshot_id = 0;
+		m_server_version = 0;
+		m_predictor.reset();
+		m_interpolators.clear();
+		m_server_clock.clear();
+		m_interpolation_delay = std::max(get_config()->get_int("Network", "interpolation_delay", 100), 0);
+
 		Packet join(JOIN_PACKET);
 		join.join.protocol_number = PROTOCOL_VERSION;
 		join.join.compat_version = COMPAT_VERSION;
-		join.join.name = get_config()->get_string("Player", "name", get_username().c_str());
+		if (m_name.empty()) {
+			join.join.name = get_config()->get_string("Player", "name", get_username().c_str());
+		} else {
+			join.join.name = m_name;
+		}
 		join.join.team = 0;
+		join.join.interpolation_delay = m_interpolation_delay;
 
 		m_network.send_reliable_packet(&join);
 	}
@@ -355,25 +409,128 @@ void Client::connect(const IPAddress& server_address) {
 void Client::player_update(const Packet& p) {
 	// XXX don't copy packet
 	Packet update = Packet(p);
-	Player* player = get_player(update.player_update.player_id);
+	// PLAYER_UPDATEs don't say when they were sent, so the best we can do is when they arrived
+	apply_player_update(update.player_update, get_ticks());
+}
+
+void Client::apply_player_update(Packet::PlayerUpdate& update, uint64_t state_time) {
+	Player* player = get_player(update.player_id);
 	if (player == NULL) {
 		return;
 	}
 	
 	// Don't let the server tell us which weapon our own player is using.
-	if (update.player_update.player_id == m_player_id) {
-		update.player_update.current_weapon_id = player->get_current_weapon_id();
+	if (update.player_id == m_player_id) {
+		update.current_weapon_id = player->get_current_weapon_id();
+	} else if (m_interpolation_delay > 0) {
+		// Other players are shown a little behind, so that there's usually a state on either side to move between.
+		// Players waiting to spawn aren't interpolated, so that they appear right where they spawn.
+		Interpolator& interpolator = m_interpolators[update.player_id];
+		if (update.flags->find_first_of('I') != string::npos) {
+			interpolator.clear();
+		} else {
+			interpolator.add_state(state_time, update);
+			interpolator.sample(get_ticks() - m_interpolation_delay, &update);
+		}
 	}
 	
-	player->read_player_update(update.player_update);
+	player->read_player_update(update);
 
 	// XXX if Weapon::select ever has side effects, we need to have a different way of updating the other players' weapons
-	Weapon* weapon = get_game()->get_weapon(update.player_update.current_weapon_id);
+	Weapon* weapon = get_game()->get_weapon(update.current_weapon_id);
 	if (weapon != NULL) {
 		weapon->select(player);
 	}
 }
 
+void Client::interpolate_players() {
+	uint64_t time = get_ticks() - m_interpolation_delay;
+	Packet::PlayerUpdate& update = m_interpolated_update.player_update;
+
+	for (map<uint32_t, Interpolator>::const_iterator it = m_interpolators.begin(); it != m_interpolators.end(); ++it) {
+		Player* player = get_player(it->first);
+		if (player == NULL || player->is_invisible() || !it->second.sample(time, &update)) {
+			continue;
+		}
+
+		player->set_position(update.x, update.y);
+		player->set_velocity(update.x_vel, update.y_vel);
+		player->set_rotation_degrees(update.rotation);
+	}
+}
+
+void Client::world_snapshot(const Packet& p) {
+	uint32_t snapshot_id = p.world_snapshot.snapshot_id;
+	uint32_t baseline_id = p.world_snapshot.baseline_id;
+
+	if (m_logic == NULL || snapshot_id <= m_last_snapshot_id) {
+		// Out of order, or a duplicate
+		return;
+	}
+
+	const Snapshot* baseline = NULL;
+	if (baseline_id != 0) {
+		baseline = m_snapshots.get(baseline_id);
+		if (baseline == NULL || snapshot_id - baseline_id >= SnapshotHistory::HISTORY_SIZE) {
+			// We no longer have the baseline, so this snapshot can't be decoded.
+			// The server will move on to a baseline we do have once it hears our next ACK.
+			return;
+		}
+	}
+
+	// Skip over the fields which have already been unmarshalled
+	BinaryReader r(p.raw);
+	PacketHeader header;
+	r.get_header(header);
+	r.get_varint();
+	r.get_varint();
+
+	// Servers which know that we number our inputs say which of them our own state includes
+	uint32_t input_sequence = 0;
+	uint64_t input_age = 0;
+	if (m_server_version > PIGGYBACK_PROTOCOL_VERSION) {
+		input_sequence = r.get_varint();
+		input_age = r.get_varint();
+	}
+
+	// Newer servers also say when they sent the snapshot, so that network jitter doesn't
+	// end up in the other players' movements; otherwise, it's timed by when it arrived
+	uint64_t now = get_ticks();
+	uint64_t state_time = now;
+	if (m_server_version > INPUT_ACK_PROTOCOL_VERSION) {
+		uint64_t send_time = r.get_varint();
+		m_server_clock.update(send_time, now);
+		state_time = m_server_clock.to_local(send_time);
+	}
+
+	Snapshot& snapshot = m_snapshots.add(snapshot_id);
+	if (!snapshot.read(r, baseline)) {
+		WARN("Received malformed world snapshot " << snapshot_id);
+		return;
+	}
+	m_last_snapshot_id = snapshot_id;
+
+	Packet ack(SNAPSHOT_ACK_PACKET);
+	ack.snapshot_ack.player_id = m_player_id;
+	ack.snapshot_ack.snapshot_id = snapshot_id;
+	m_network.send_packet(&ack);
+
+	// Every up-to-date state is applied, even if it hasn't changed, so that our simulation of a player who
+	// is standing still is pulled back to the server's.  Players whose updates the server is holding back
+	// (because they aren't relevant to us) are left alone, since re-applying a stale state would make them jump back.
+	for (size_t i = 0; i < snapshot.get_nbr_players(); ++i) {
+		const Snapshot::PlayerState& state = snapshot.get_player(i);
+		if (state.flags & Snapshot::FLAG_HELD_BACK) {
+			continue;
+		}
+		state.fill_player_update(&m_snapshot_update.player_update);
+		if (state.player_id == m_player_id) {
+			m_predictor.reconcile(&m_snapshot_update.player_update, input_sequence, input_age, *m_logic);
+		}
+		apply_player_update(m_snapshot_update.player_update, state_time);
+	}
+}
+
 void Client::weapon_discharged(const Packet& p) {
 	if (m_logic == NULL) {
 		return;
@@ -419,9 +576,7 @@ void Client::new_round(const Packet& p) {
 	map = m_logic->get_map();
 	// TODO use time_until_start, remove round_started from packet
 	// TODO preload and tell revision instead of loading the whole thing
-	ifstream file;
-	open_resource(&file, (string("maps") + PATH_SEP + *p.new_round.map_name + ".map").c_str());
-	if (map->load(file)) {
+	if (read_map(map, *p.new_round.map_name)) {
 		// TODO put back during real map loading
 		/*if (map->get_revision() != map_revision) {
 			// this is really lame
@@ -437,9 +592,17 @@ void Client::new_round(const Packet& p) {
 		map->set_height(p.new_round.map_height);
 		map->set_revision(p.new_round.map_revision);
 	}
-	file.close();
 	m_logic->update_map();
 
+	// Our own player is predicted on a private copy of the map
+	Map* prediction_map = new Map;
+	if (read_map(prediction_map, *p.new_round.map_name)) {
+		m_predictor.set_map(prediction_map, m_logic->get_params());
+	} else {
+		delete prediction_map;
+		m_predictor.clear_map();
+	}
+
 	round_init(map);
 }
 
@@ -451,6 +614,7 @@ void Client::round_over(const Packet& p) {
 
 void Client::welcome(const Packet& p) {
 	INFO("Received welcome: " << p.welcome.player_id);
+	m_server_version = p.welcome.server_version;
 	if (get_player(p.welcome.player_id) == NULL) {
 		Player* player = make_player(p.welcome.player_name->c_str(), p.welcome.player_id, p.welcome.team);
 		add_player(player);
@@ -608,8 +772,7 @@ void Client::run() {
 	uint64_t last_time = get_ticks();
 	while (true) { // TODO need a way to quit
 		uint64_t current_time = get_ticks();
-		// Fudge the current time so that the remaining time between steps is accounted for
-		current_time -= step(current_time - last_time);
+		step(current_time - last_time);
 		
 		// XXX: can we determine what FPS we are trying to lock at, rather than always using 60?
 		if ((get_ticks() - last_time) < 17) {
@@ -26,8 +26,14 @@
 #define LM_CLIENT_CLIENT_HPP
 
 #include "ClientNetwork.hpp"
+#include "Predictor.hpp"
+#include "Interpolator.hpp"
+#include "ServerClock.hpp"
 #include "common/Packet.hpp"
+#include "common/Snapshot.hpp"
 #include "common/timer.hpp"
+#include "common/TickClock.hpp"
+#include <map>
 
 namespace LM {
 	class Player;
@@ -44,10 +50,12 @@ namespace LM {
 	
 		Controller* m_controller;
 		GameLogic* m_logic;
+		TickClock m_logic_clock; // Schedules m_logic's steps
 		uint32_t m_player_id;
 		ClientNetwork m_network;
 		long m_curr_weapon;
 		Configuration* m_config;
+		std::string m_name; // If empty, the name in the config is used
 
 		uint64_t m_last_jump_time;
 		uint64_t m_weapon_switch_time;
@@ -56,13 +64,31 @@ namespace LM {
 		
 		Packet* weapon_discharged_packet;
 
+		SnapshotHistory m_snapshots; // The most recent WORLD_SNAPSHOTs, for use as baselines
+		uint32_t m_last_snapshot_id; // The latest WORLD_SNAPSHOT applied
+		Packet m_snapshot_update; // Each player's state in a WORLD_SNAPSHOT is applied through this
+		int m_server_version; // The server's protocol version
+		Predictor m_predictor; // Our own player's state from the server is re-simulated on top of our inputs
+		std::map<uint32_t, Interpolator> m_interpolators; // Other players' states from the server, by player ID
+		ServerClock m_server_clock; // When the server sent each WORLD_SNAPSHOT, by our clock
+		uint64_t m_interpolation_delay; // How far behind the server other players are shown (in milliseconds), or 0 to show them as they arrive
+		Packet m_interpolated_update; // Each other player's interpolated state is sampled into this
+
 		bool m_running;
 		
 		bool m_jumping;
 
 	protected:
 		// Networking, GameLogic calls, and base client updates are handled here
-		uint64_t step(uint64_t diff);
+		void step(uint64_t diff);
+
+		// The parts of step(), for running the controller separately from the rest of the client.
+		// begin_step() handles networking, and returns false if there's nothing else to do this step.
+		// update_controller() only touches the controller, and may be called from another thread.
+		// finish_step() runs however many GameLogic steps are due.
+		bool begin_step();
+		void update_controller(uint64_t diff);
+		void finish_step();
 
 		virtual void add_player(Player* player);
 		virtual void set_own_player(uint32_t id);
@@ -75,6 +101,10 @@ namespace LM {
 		void check_player_hits();
 		
 		void generate_player_update(uint32_t id, Packet* p);
+		// The state is stamped with the given time (from get_ticks()) for interpolation
+		void apply_player_update(Packet::PlayerUpdate& update, uint64_t state_time);
+		// Move the other players to where they were m_interpolation_delay ago
+		void interpolate_players();
 		void generate_weapon_fired(uint32_t weapon_id, uint32_t player_id);
 		void generate_player_died(uint32_t died_id, uint32_t killer_id, bool killer_is_player);
 		void generate_player_jumped(uint32_t player_id, float angle);
@@ -85,6 +115,8 @@ namespace LM {
 		int get_weapon_switch_delay_remaining() const { int remaining = m_weapon_switch_delay - (get_ticks() - m_weapon_switch_time); return remaining > 0 ? remaining : 0;}
 
 		virtual void set_map(Map* map);
+		// Load the named map's file into the map
+		virtual bool read_map(Map* map, const std::string& map_name);
 
 		virtual void round_init(Map* map);
 		virtual void round_started();
@@ -102,6 +134,7 @@ namespace LM {
 
 		void set_controller(Controller* controller);
 		void set_config(Configuration* config);
+		void set_name(const std::string& name);
 
 		const Configuration* get_config() const;
 		Configuration* get_config();
@@ -145,6 +178,8 @@ namespace LM {
 		virtual void round_start(const Packet& p);
 		virtual void spawn(const Packet& p);
 		//virtual void player_to_server_update(const Packet& p); // Should not be received by client.
+		virtual void world_snapshot(const Packet& p);
+		//virtual void snapshot_ack(const Packet& p); // Should not be received by client.
 		// End packet callbacks
 
 		virtual void name_change(Player* player, const std::string& new_name);
@@ -45,6 +45,7 @@ bool	ClientNetwork::connect(const char* hostname, unsigned int portno) {
 	}
 
 	m_ack_manager.clear();
+	m_server_peer.piggyback_acks = true;
 	m_is_connected = true;
 	m_last_packet_time = 0;
 	return true;
@@ -54,6 +55,7 @@ bool	ClientNetwork::connect(const IPAddress& address) {
 	disconnect();
 	m_ack_manager.clear();
 	m_server_address = address;
+	m_server_peer.piggyback_acks = true;
 	m_is_connected = true;
 	m_last_packet_time = 0;
 	return true;
@@ -98,23 +100,26 @@ void	ClientNetwork::receive_packets() {
 		if (is_connected() && packet.raw.get_address() == m_server_address) {
 			packet.free();
 			packet.unmarshal();
-			if (packet.type != PLAYER_UPDATE_PACKET && packet.type != PLAYER_ANIMATION_PACKET) {
+			// Any packet may carry acknowledgements of our reliable packets
+			process_acks(m_server_address, packet.header);
+			if (packet.type != PLAYER_UPDATE_PACKET && packet.type != WORLD_SNAPSHOT_PACKET && packet.type != PLAYER_ANIMATION_PACKET) {
 				// Too many packets will get alerted if we leave this for PLAYER_UPDATE
 				DEBUG("Received packet of type " << packet.type);
 			}
 			if (packet.header.sequence_no) {
 				try {
 					// High reliability packet
-					// Immediately send an ACK
-					send_ack(packet.raw.get_address(), packet);
-					if (packet.header.connection_id == m_server_peer.connection_id && m_server_peer.packet_queue.push(packet)) {
+					acknowledge(m_server_address, packet.header);
+					if (packet.header.connection_id == m_server_peer.connection_id && m_server_peer.packet_queue.push(packet.raw, packet.header.sequence_no)) {
 						// Ready to be processed now.
 						packet.dispatch(m_client);
 
 						// Process any other packets that might be waiting in the queue.
 						while (m_server_peer.packet_queue.has_packet()) {
-							m_server_peer.packet_queue.peek().dispatch(m_client);
-							m_server_peer.packet_queue.pop();
+							m_server_peer.packet_queue.pop(packet.raw);
+							packet.free();
+							packet.unmarshal();
+							packet.dispatch(m_client);
 						}
 					}
 				} catch (PacketQueue::FullQueueException) {
@@ -140,6 +145,16 @@ uint64_t ClientNetwork::get_last_packet_time() {
 	return m_last_packet_time;
 }
 
+CommonNetwork::Peer*	ClientNetwork::get_peer(const IPAddress& peer) {
+	return m_is_connected && peer == m_server_address ? &m_server_peer : NULL;
+}
+
+void	ClientNetwork::send_due_acks(uint64_t now) {
+	if (m_is_connected) {
+		send_pending_ack(m_server_address, m_server_peer, now);
+	}
+}
+
 void	ClientNetwork::excessive_packet_drop(const IPAddress& peer) {
 	if (m_is_connected && peer == m_server_address) {
 		// TODO
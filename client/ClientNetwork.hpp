@@ -44,6 +44,8 @@ namespace LM {
 		bool		m_is_connected;     // Are we currently connected to the server?
 		uint64_t	m_last_packet_time; // The time we last received a packet from the server
 	
+		virtual Peer*	get_peer(const IPAddress& peer);
+		virtual void	send_due_acks(uint64_t now);
 		virtual void	excessive_packet_drop(const IPAddress& peer);
 
 	public:
@@ -85,3 +85,16 @@ LogisticCurve::LogisticCurve(float start, float end, float width) : Curve(start,
 float LogisticCurve::map_progress(float t) const {
 	return m_coeff/(1 + powf(M_E, m_width*(0.5 - t)));
 }
+
+HermiteCurve::HermiteCurve(float start, float end, float start_slope, float end_slope) {
+	m_start = start;
+	m_end = end;
+	m_start_slope = start_slope;
+	m_end_slope = end_slope;
+}
+
+float HermiteCurve::operator()(float t) const {
+	float t2 = t*t;
+	float t3 = t2*t;
+	return (2*t3 - 3*t2 + 1)*m_start + (t3 - 2*t2 + t)*m_start_slope + (-2*t3 + 3*t2)*m_end + (t3 - t2)*m_end_slope;
+}
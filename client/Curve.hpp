@@ -78,6 +78,19 @@ namespace LM {
 	public:
 		LogisticCurve(float start, float end, float width = 6.0);
 	};
+
+	// Not a Curve, since it also depends on the slopes at each end (in units per unit of t),
+	// which lets several of these be joined end to end without any corners
+	class HermiteCurve {
+	private:
+		float m_start;
+		float m_end;
+		float m_start_slope;
+		float m_end_slope;
+	public:
+		HermiteCurve(float start, float end, float start_slope, float end_slope);
+		float operator()(float t) const;
+	};
 }
 
 #endif
@@ -0,0 +1,126 @@
+/*
+ * client/Interpolator.cpp
+ *
+ * This file is part of Leges Motus, a networked, 2D shooter set in zero gravity.
+ * 
+ * Copyright 2009-2011 Andrew Ayer, Nathan Partlan, Jeffrey Pfau
+ * 
+ * Leges Motus is free and open source software.  You may redistribute it and/or
+ * modify it under the terms of version 2, or (at your option) version 3, of the
+ * GNU General Public License (GPL), as published by the Free Software Foundation.
+ * 
+ * Leges Motus is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.  See the full text of the GNU General Public License for
+ * further detail.
+ * 
+ * For a full copy of the GNU General Public License, please see the COPYING file
+ * in the root of the source code tree.  You may also retrieve a copy from
+ * <http://www.gnu.org/licenses/gpl-2.0.txt>, or request a copy by writing to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ * 02111-1307  USA
+ * 
+ */
+
+#include "Interpolator.hpp"
+#include "Curve.hpp"
+#include <cmath>
+#include <algorithm>
+
+using namespace LM;
+using namespace std;
+
+Interpolator::Interpolator() {
+	clear();
+}
+
+void Interpolator::clear() {
+	m_first = 0;
+	m_count = 0;
+}
+
+void Interpolator::add_state(uint64_t time, const Packet::PlayerUpdate& update) {
+	if (m_count > 0) {
+		const State& last = get_state(m_count - 1);
+		if (hypot(update.x - last.x, update.y - last.y) > TELEPORT_DISTANCE) {
+			// The player respawned, or was otherwise moved, so don't slide it across the map
+			clear();
+		} else if (time <= last.time) {
+			// Several states arrived at once; keep them in order
+			time = last.time + 1;
+		}
+	}
+
+	if (m_count == MAX_STATES) {
+		m_first = (m_first + 1) % MAX_STATES;
+		--m_count;
+	}
+
+	State& state = m_states[(m_first + m_count) % MAX_STATES];
+	++m_count;
+	state.time = time;
+	state.x = update.x;
+	state.y = update.y;
+	state.x_vel = update.x_vel;
+	state.y_vel = update.y_vel;
+	state.rotation = update.rotation;
+}
+
+bool Interpolator::sample(uint64_t time, Packet::PlayerUpdate* update) const {
+	if (m_count == 0) {
+		return false;
+	}
+
+	// Find the newest state from before the time
+	size_t i = m_count - 1;
+	while (i > 0 && get_state(i).time > time) {
+		--i;
+	}
+	const State& before = get_state(i);
+
+	if (time <= before.time) {
+		// Older than anything we have
+		update->x = before.x;
+		update->y = before.y;
+		update->x_vel = before.x_vel;
+		update->y_vel = before.y_vel;
+		update->rotation = before.rotation;
+	} else if (i == m_count - 1) {
+		// Newer than anything we have, so extrapolate
+		uint64_t elapsed = time - before.time;
+		float seconds = min<uint64_t>(elapsed, MAX_EXTRAPOLATION) / 1000.0f;
+		update->x = before.x + before.x_vel * seconds;
+		update->y = before.y + before.y_vel * seconds;
+		if (elapsed < MAX_EXTRAPOLATION) {
+			update->x_vel = before.x_vel;
+			update->y_vel = before.y_vel;
+		} else {
+			update->x_vel = 0;
+			update->y_vel = 0;
+		}
+		update->rotation = before.rotation;
+	} else {
+		const State& after = get_state(i + 1);
+		float interval = (after.time - before.time) / 1000.0f;
+		float progress = (time - before.time) / float(after.time - before.time);
+
+		// The velocities are in game units per second, so scale them to the interval to use them as slopes
+		HermiteCurve x_curve(before.x, after.x, before.x_vel * interval, after.x_vel * interval);
+		HermiteCurve y_curve(before.y, after.y, before.y_vel * interval, after.y_vel * interval);
+		update->x = x_curve(progress);
+		update->y = y_curve(progress);
+		update->x_vel = before.x_vel + (after.x_vel - before.x_vel) * progress;
+		update->y_vel = before.y_vel + (after.y_vel - before.y_vel) * progress;
+
+		// Turn the shortest way round
+		float rotation_change = after.rotation - before.rotation;
+		if (rotation_change > 180) {
+			rotation_change -= 360;
+		} else if (rotation_change < -180) {
+			rotation_change += 360;
+		}
+		update->rotation = before.rotation + rotation_change * progress;
+	}
+
+	return true;
+}
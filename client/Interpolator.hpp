@@ -0,0 +1,77 @@
+/*
+ * client/Interpolator.hpp
+ *
+ * This file is part of Leges Motus, a networked, 2D shooter set in zero gravity.
+ * 
+ * Copyright 2009-2011 Andrew Ayer, Nathan Partlan, Jeffrey Pfau
+ * 
+ * Leges Motus is free and open source software.  You may redistribute it and/or
+ * modify it under the terms of version 2, or (at your option) version 3, of the
+ * GNU General Public License (GPL), as published by the Free Software Foundation.
+ * 
+ * Leges Motus is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.  See the full text of the GNU General Public License for
+ * further detail.
+ * 
+ * For a full copy of the GNU General Public License, please see the COPYING file
+ * in the root of the source code tree.  You may also retrieve a copy from
+ * <http://www.gnu.org/licenses/gpl-2.0.txt>, or request a copy by writing to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ * 02111-1307  USA
+ * 
+ */
+
+#ifndef LM_CLIENT_INTERPOLATOR_HPP
+#define LM_CLIENT_INTERPOLATOR_HPP
+
+#include "common/Packet.hpp"
+#include <stdint.h>
+
+namespace LM {
+	// A jitter buffer of one remote player's states from the server, so the player can be shown a short delay behind them.
+	// States are stamped with when the server sent them (by our clock; see ServerClock), or failing that,
+	// with when they arrived.  Between two states, positions follow Hermite curves
+	// whose slopes are the player's velocities, so the player moves smoothly through each state.
+	// If the states run out (e.g. packets were lost), the player carries on along its last velocity
+	// for a limited time, and then stays put until the next state arrives.
+	class Interpolator {
+	public:
+		enum {
+			MAX_STATES = 32,
+			MAX_EXTRAPOLATION = 250,	// in milliseconds
+			TELEPORT_DISTANCE = 256		// States further apart than this (in game units) are jumped between
+		};
+
+	private:
+		struct State {
+			uint64_t	time;		// in milliseconds
+			float		x;
+			float		y;
+			float		x_vel;
+			float		y_vel;
+			float		rotation;	// in degrees
+		};
+
+		State		m_states[MAX_STATES];	// Ring buffer, oldest first
+		size_t		m_first;
+		size_t		m_count;
+
+		const State&	get_state(size_t i) const { return m_states[(m_first + i) % MAX_STATES]; }
+
+	public:
+		Interpolator();
+
+		void		clear();
+		bool		is_empty() const { return m_count == 0; }
+
+		// Add the player's state as of the given time (by get_ticks())
+		void		add_state(uint64_t time, const Packet::PlayerUpdate& update);
+
+		// Fill in the update's position, velocity, and rotation with the player's state at the given time
+		// Returns false if there are no states
+		bool		sample(uint64_t time, Packet::PlayerUpdate* update) const;
+	};
+}
+
+#endif
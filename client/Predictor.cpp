@@ -0,0 +1,187 @@
+/*
+ * client/Predictor.cpp
+ *
+ * This file is part of Leges Motus, a networked, 2D shooter set in zero gravity.
+ * 
+ * Copyright 2009-2011 Andrew Ayer, Nathan Partlan, Jeffrey Pfau
+ * 
+ * Leges Motus is free and open source software.  You may redistribute it and/or
+ * modify it under the terms of version 2, or (at your option) version 3, of the
+ * GNU General Public License (GPL), as published by the Free Software Foundation.
+ * 
+ * Leges Motus is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.  See the full text of the GNU General Public License for
+ * further detail.
+ * 
+ * For a full copy of the GNU General Public License, please see the COPYING file
+ * in the root of the source code tree.  You may also retrieve a copy from
+ * <http://www.gnu.org/licenses/gpl-2.0.txt>, or request a copy by writing to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ * 02111-1307  USA
+ * 
+ */
+
+#include "Predictor.hpp"
+#include "common/GameLogic.hpp"
+#include "common/Map.hpp"
+#include "common/Player.hpp"
+#include "common/Weapon.hpp"
+#include <algorithm>
+
+using namespace LM;
+using namespace std;
+
+Predictor::Predictor() {
+	m_logic = NULL;
+	m_player = NULL;
+	m_next_sequence = 1;
+	m_acked_sequence = 0;
+	m_acked_tick = 0;
+}
+
+Predictor::~Predictor() {
+	delete m_logic;
+}
+
+void Predictor::set_map(Map* map, const std::map<string, string>& params) {
+	clear_map();
+
+	m_logic = new GameLogic(map);
+	m_logic->update_map();
+	for (std::map<string, string>::const_iterator it(params.begin()); it != params.end(); ++it) {
+		m_logic->set_param(it->first, it->second);
+	}
+}
+
+void Predictor::set_param(const string& param_name, const string& param_value) {
+	if (m_logic != NULL) {
+		m_logic->set_param(param_name, param_value);
+	}
+}
+
+void Predictor::clear_map() {
+	// (The GameLogic deletes the map and our stand-in)
+	delete m_logic;
+	m_logic = NULL;
+	m_player = NULL;
+
+	// The ticks start again with the next map's GameLogic
+	m_inputs.clear();
+	m_acked_tick = 0;
+}
+
+void Predictor::reset() {
+	clear_map();
+	m_next_sequence = 1;
+	m_acked_sequence = 0;
+}
+
+uint32_t Predictor::add_input(uint64_t tick, InputType type, float direction, uint32_t weapon_id) {
+	if (m_inputs.size() == MAX_INPUTS) {
+		m_inputs.pop_front();
+	}
+
+	Input	input;
+	input.sequence = m_next_sequence++;
+	input.tick = tick;
+	input.type = type;
+	input.direction = direction;
+	input.weapon_id = weapon_id;
+	m_inputs.push_back(input);
+
+	return input.sequence;
+}
+
+const Predictor::Input* Predictor::find_input(uint32_t sequence) const {
+	if (m_inputs.empty() || sequence < m_inputs.front().sequence || sequence > m_inputs.back().sequence) {
+		return NULL;
+	}
+	return &m_inputs[sequence - m_inputs.front().sequence];
+}
+
+void Predictor::replay_input(const Input& input, GameLogic& game) {
+	if (input.type == JUMP) {
+		m_logic->attempt_jump(m_player->get_id(), input.direction);
+	} else if (input.type == FIRE) {
+		// The weapons are the game's, but firing only affects the player it's given
+		if (Weapon* weapon = game.get_weapon(input.weapon_id)) {
+			weapon->was_fired(m_logic->get_world(), *m_player, input.direction);
+		}
+	}
+}
+
+bool Predictor::reconcile(Packet::PlayerUpdate* update, uint32_t input_sequence, uint64_t input_age, GameLogic& game) {
+	const Player*	player = game.get_player(update->player_id);
+	if (m_logic == NULL || player == NULL || input_sequence == 0 || input_sequence < m_acked_sequence) {
+		return false;
+	}
+
+	// Forget the inputs the server has applied, remembering when we applied the last of them
+	if (input_sequence > m_acked_sequence || m_acked_tick == 0) {
+		const Input*	input = find_input(input_sequence);
+		if (input == NULL) {
+			// Forgotten, or from before the current map
+			return false;
+		}
+		m_acked_sequence = input_sequence;
+		m_acked_tick = input->tick;
+		while (!m_inputs.empty() && m_inputs.front().sequence <= input_sequence) {
+			m_inputs.pop_front();
+		}
+	}
+
+	// Both we and the server have kept simulating since applying that input
+	uint64_t	end_tick = game.get_tick();
+	uint64_t	start_tick = min(m_acked_tick + TickClock::usec_to_ticks(input_age * 1000), end_tick);
+	if (end_tick - start_tick > MAX_REPLAY_TICKS) {
+		return false;
+	}
+
+	// Start the stand-in from the server's state
+	if (m_player == NULL || m_player->get_id() != update->player_id) {
+		if (m_player != NULL) {
+			delete m_logic->remove_player(m_player->get_id());
+		}
+		m_player = new Player(player->get_name(), player->get_id(), player->get_team());
+		m_logic->add_player(m_player);
+	}
+	m_player->read_player_update(*update);
+
+	// Replay the inputs the server hasn't applied, at the ticks at which we applied them
+	// (Inputs still on their way to the server are applied straight away, as the server will when it gets them.)
+	uint64_t	tick = start_tick;
+	for (deque<Input>::const_iterator it(m_inputs.begin()); it != m_inputs.end(); ++it) {
+		for (; tick < it->tick && tick < end_tick; ++tick) {
+			m_logic->step();
+		}
+		replay_input(*it, game);
+	}
+	for (; tick < end_tick; ++tick) {
+		m_logic->step();
+	}
+
+	// Small corrections are blended in over the next few updates.
+	// The rotation is only corrected along with the position, since jumps spin the player randomly.
+	Vector		error(m_player->get_position() - player->get_position());
+	if (error.get_magnitude() < SNAP_DISTANCE) {
+		update->x = player->get_x() + error.x / 2;
+		update->y = player->get_y() + error.y / 2;
+		update->rotation = player->get_rotation_degrees();
+	} else {
+		update->x = m_player->get_x();
+		update->y = m_player->get_y();
+		update->rotation = m_player->get_rotation_degrees();
+	}
+	update->x_vel = m_player->get_x_vel();
+	update->y_vel = m_player->get_y_vel();
+
+	// The replay may have grabbed or let go of an obstacle
+	string&		flags = *update->flags;
+	flags.erase(std::remove(flags.begin(), flags.end(), 'G'), flags.end());
+	if (m_player->is_grabbing_obstacle()) {
+		flags.append(1, 'G');
+	}
+
+	return true;
+}
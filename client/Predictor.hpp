@@ -0,0 +1,108 @@
+/*
+ * client/Predictor.hpp
+ *
+ * This file is part of Leges Motus, a networked, 2D shooter set in zero gravity.
+ * 
+ * Copyright 2009-2011 Andrew Ayer, Nathan Partlan, Jeffrey Pfau
+ * 
+ * Leges Motus is free and open source software.  You may redistribute it and/or
+ * modify it under the terms of version 2, or (at your option) version 3, of the
+ * GNU General Public License (GPL), as published by the Free Software Foundation.
+ * 
+ * Leges Motus is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.  See the full text of the GNU General Public License for
+ * further detail.
+ * 
+ * For a full copy of the GNU General Public License, please see the COPYING file
+ * in the root of the source code tree.  You may also retrieve a copy from
+ * <http://www.gnu.org/licenses/gpl-2.0.txt>, or request a copy by writing to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ * 02111-1307  USA
+ * 
+ */
+
+#ifndef LM_CLIENT_PREDICTOR_HPP
+#define LM_CLIENT_PREDICTOR_HPP
+
+#include "common/Packet.hpp"
+#include <deque>
+#include <map>
+#include <string>
+#include <stdint.h>
+
+namespace LM {
+	class GameLogic;
+	class Map;
+	class Player;
+
+	/*
+	 * Client-side prediction of our own player.
+	 *
+	 * The client applies its inputs straight away, and numbers them when it sends them to the server.
+	 * Each WORLD_SNAPSHOT says which was the last input the server applied, and how long ago, which
+	 * tells us the tick of our own simulation that the server's state for our player matches.
+	 * reconcile() starts from that state and re-simulates up to the current tick, in a private
+	 * GameLogic holding just the map and a stand-in for our player, replaying the inputs which the
+	 * server hadn't applied yet.  Small corrections are blended in, so the player doesn't snap.
+	 */
+	class Predictor {
+	public:
+		enum InputType {
+			AIM,	// The periodic update of the aim and the weapon (doesn't move the player)
+			JUMP,
+			FIRE	// Moves the player by the weapon's recoil
+		};
+
+		enum {
+			MAX_INPUTS = 256,	// Older unacknowledged inputs are forgotten
+			MAX_REPLAY_TICKS = 120,	// Any older state from the server is applied as it is
+			SNAP_DISTANCE = 64	// Bigger corrections (in game units) are applied all at once
+		};
+
+	private:
+		struct Input {
+			uint32_t	sequence;
+			uint64_t	tick;		// The tick of the client's GameLogic (see GameLogic::get_tick) at which the input was applied
+			InputType	type;
+			float		direction;	// In radians
+			uint32_t	weapon_id;	// For FIRE
+		};
+
+		GameLogic*		m_logic;		// NULL if there's no map to predict on
+		Player*			m_player;		// Our stand-in in m_logic (owned by it)
+		std::deque<Input>	m_inputs;		// Unacknowledged inputs, oldest first (with consecutive sequence numbers)
+		uint32_t		m_next_sequence;
+		uint32_t		m_acked_sequence;	// The latest input the server has applied (0 if none)
+		uint64_t		m_acked_tick;		// The tick at which we applied it
+
+		const Input*		find_input(uint32_t sequence) const;
+		void			replay_input(const Input& input, GameLogic& game);
+
+		// Not copyable
+		Predictor(const Predictor&);
+		Predictor& operator=(const Predictor&);
+
+	public:
+		Predictor();
+		~Predictor();
+
+		// Start predicting on a new map (the predictor takes ownership of it), with the given game parameters
+		void		set_map(Map* map, const std::map<std::string, std::string>& params);
+		void		set_param(const std::string& param_name, const std::string& param_value);
+		// Stop predicting until the next map
+		void		clear_map();
+		// Forget the map, and every input (call when connecting to a server)
+		void		reset();
+
+		// Number an input which was applied at the given tick, and remember it until the server has applied it too
+		uint32_t	add_input(uint64_t tick, InputType type, float direction =0, uint32_t weapon_id =0);
+
+		// Replace the server's state for our player, which includes our inputs up to input_sequence (the last of
+		// which the server applied input_age milliseconds ago), with where that state has got to by the current tick
+		// of the given game.  Returns false (leaving the update alone) if the state can't be predicted from.
+		bool		reconcile(Packet::PlayerUpdate* update, uint32_t input_sequence, uint64_t input_age, GameLogic& game);
+	};
+}
+
+#endif
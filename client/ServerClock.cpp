@@ -0,0 +1,48 @@
+/*
+ * client/ServerClock.cpp
+ *
+ * This file is part of Leges Motus, a networked, 2D shooter set in zero gravity.
+ * 
+ * Copyright 2009-2011 Andrew Ayer, Nathan Partlan, Jeffrey Pfau
+ * 
+ * Leges Motus is free and open source software.  You may redistribute it and/or
+ * modify it under the terms of version 2, or (at your option) version 3, of the
+ * GNU General Public License (GPL), as published by the Free Software Foundation.
+ * 
+ * Leges Motus is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.  See the full text of the GNU General Public License for
+ * further detail.
+ * 
+ * For a full copy of the GNU General Public License, please see the COPYING file
+ * in the root of the source code tree.  You may also retrieve a copy from
+ * <http://www.gnu.org/licenses/gpl-2.0.txt>, or request a copy by writing to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ * 02111-1307  USA
+ * 
+ */
+
+#include "ServerClock.hpp"
+#include <algorithm>
+
+using namespace LM;
+using namespace std;
+
+ServerClock::ServerClock() {
+	clear();
+}
+
+void ServerClock::clear() {
+	m_is_synchronized = false;
+	m_offset = 0;
+}
+
+void ServerClock::update(uint64_t server_time, uint64_t local_time) {
+	int64_t offset = int64_t(local_time - server_time);
+	if (!m_is_synchronized || offset < m_offset) {
+		m_offset = offset;
+		m_is_synchronized = true;
+	} else if (offset > m_offset) {
+		m_offset += min<int64_t>(offset - m_offset, CREEP);
+	}
+}
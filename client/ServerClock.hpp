@@ -0,0 +1,60 @@
+/*
+ * client/ServerClock.hpp
+ *
+ * This file is part of Leges Motus, a networked, 2D shooter set in zero gravity.
+ * 
+ * Copyright 2009-2011 Andrew Ayer, Nathan Partlan, Jeffrey Pfau
+ * 
+ * Leges Motus is free and open source software.  You may redistribute it and/or
+ * modify it under the terms of version 2, or (at your option) version 3, of the
+ * GNU General Public License (GPL), as published by the Free Software Foundation.
+ * 
+ * Leges Motus is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.  See the full text of the GNU General Public License for
+ * further detail.
+ * 
+ * For a full copy of the GNU General Public License, please see the COPYING file
+ * in the root of the source code tree.  You may also retrieve a copy from
+ * <http://www.gnu.org/licenses/gpl-2.0.txt>, or request a copy by writing to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ * 02111-1307  USA
+ * 
+ */
+
+#ifndef LM_CLIENT_SERVERCLOCK_HPP
+#define LM_CLIENT_SERVERCLOCK_HPP
+
+#include <stdint.h>
+
+namespace LM {
+	// Maps the times at which the server sent its packets onto our own clock, so that states can be stamped
+	// with when the server sent them rather than when they happened to arrive.
+	// The offset between the clocks follows the packets which arrived soonest after they were sent (those
+	// least delayed by the network), so jitter doesn't move it.  It creeps back up slowly, in case the
+	// route has got slower for good.
+	class ServerClock {
+	public:
+		enum {
+			CREEP = 1	// How far the offset may move later per packet (in milliseconds)
+		};
+
+	private:
+		bool		m_is_synchronized;
+		int64_t		m_offset;	// Our time minus the server's, for the least delayed packets
+
+	public:
+		ServerClock();
+
+		void		clear();
+		bool		is_synchronized() const { return m_is_synchronized; }
+
+		// A packet sent at the given server time arrived at the given time of ours (both in milliseconds)
+		void		update(uint64_t server_time, uint64_t local_time);
+
+		// Our time at which something the server sent at the given time would arrive, if it weren't held up
+		uint64_t	to_local(uint64_t server_time) const { return server_time + m_offset; }
+	};
+}
+
+#endif
@@ -194,6 +194,9 @@ CFLAGS += $(FLAGS_GL) $(INCLUDES)
 # Windows needs Winsock2 for BSD sockets
 ifeq ($(MACHINE),Windows)
  LIBS += -lwsock32
+else
+ # Everywhere else, threads (see common/Thread.hpp) are POSIX threads
+ LIBS += -lpthread
 endif
 
 CLIENTFLAGS = $(FLAGS_SDL) $(shell freetype-config --cflags) -I../client
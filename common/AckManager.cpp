@@ -24,137 +24,451 @@
 
 #include "AckManager.hpp"
 #include "PacketWriter.hpp"
-#include "PacketWriter.hpp"
+#include "network.hpp"
 #include "CommonNetwork.hpp"
 #include "timer.hpp"
 #include <limits>
-#include <iostream>
+#include <algorithm>
 
 using namespace LM;
 using namespace std;
 
+namespace {
+	// A marshalled Packet's raw data starts with its (text) header, which is re-written every time
+	// the packet is sent, so skip the header (the type and sequence number fields) and keep the rest
+	PacketBody	get_packet_body(const Packet& packet) {
+		const char*	data = packet.raw.get_data();
+		const char*	end = data + packet.raw.get_length();
+		const char*	body = std::find(data, end, PACKET_FIELD_SEPARATOR);
+		if (body != end) {
+			body = std::find(body + 1, end, PACKET_FIELD_SEPARATOR);
+		}
+		return PacketBody(body, end - body);
+	}
+}
+
+void	AckManager::Peer::init(const IPAddress& arg_address) {
+	address = arg_address;
+	pending.assign(16, NO_INDEX);
+	nbr_pending = 0;
+	smoothed_rtt = 0;
+	rtt_variance = 0;
+	timeout = INITIAL_TIMEOUT;
+	is_released = false;
+}
+
+AckManager::AckManager() {
+	m_peer_table.assign(16, NO_INDEX);
+	clear();
+}
+
+//
+// Peers
+//
+
+size_t	AckManager::hash(const IPAddress& address) {
+	// Fibonacci hashing of the host and port
+	return size_t(((uint64_t(address.host) << 16 | address.port) * 0x9E3779B97F4A7C15ULL) >> 32);
+}
+
+size_t	AckManager::find_peer_slot(const IPAddress& address) const {
+	const size_t	mask = m_peer_table.size() - 1;
+	size_t		slot = hash(address) & mask;
+	while (m_peer_table[slot] != NO_INDEX && m_peers[m_peer_table[slot]].address != address) {
+		slot = (slot + 1) & mask;
+	}
+	return slot;
+}
 
-AckManager::SentPacket::SentPacket(const IPAddress& peer_addr, const PacketHeader& arg_header, const string& arg_data) : packet_data(arg_data) {
-	send_time = get_ticks();
-	tries_left = RETRIES;
-	add_recipient(peer_addr, arg_header);
+uint32_t	AckManager::find_peer(const IPAddress& address) const {
+	return m_peer_table[find_peer_slot(address)];
 }
 
-AckManager::SentPacket::SentPacket(const string& arg_data) : packet_data(arg_data) {
-	send_time = get_ticks();
-	tries_left = RETRIES;
+uint32_t	AckManager::get_peer(const IPAddress& address) {
+	size_t		slot = find_peer_slot(address);
+	if (m_peer_table[slot] != NO_INDEX) {
+		return m_peer_table[slot];
+	}
+
+	// Keep the table at most half full
+	if ((m_nbr_peers + 1) * 2 > m_peer_table.size()) {
+		grow_peer_table();
+		slot = find_peer_slot(address);
+	}
+
+	uint32_t	peer_index;
+	if (!m_free_peers.empty()) {
+		peer_index = m_free_peers.back();
+		m_free_peers.pop_back();
+	} else {
+		peer_index = m_peers.size();
+		m_peers.push_back(Peer());
+	}
+
+	m_peers[peer_index].init(address);
+	m_peer_table[slot] = peer_index;
+	++m_nbr_peers;
+	return peer_index;
 }
 
-void	AckManager::SentPacket::add_recipient(const IPAddress& addr, const PacketHeader& header) {
-	recipients.insert(make_pair(addr, header));
+void	AckManager::remove_peer(uint32_t peer_index) {
+	const size_t	mask = m_peer_table.size() - 1;
+	size_t		slot = find_peer_slot(m_peers[peer_index].address);
+	m_peer_table[slot] = NO_INDEX;
+
+	// Re-insert the rest of the run of occupied slots, so that none of them are cut off by the hole
+	for (size_t next = (slot + 1) & mask; m_peer_table[next] != NO_INDEX; next = (next + 1) & mask) {
+		uint32_t	moving = m_peer_table[next];
+		m_peer_table[next] = NO_INDEX;
+		m_peer_table[find_peer_slot(m_peers[moving].address)] = moving;
+	}
+
+	m_free_peers.push_back(peer_index);
+	--m_nbr_peers;
 }
 
-void AckManager::SentPacket::ack(const IPAddress& peer_addr) {
-	recipients.erase(peer_addr);
+void	AckManager::remove_peer_if_done(uint32_t peer_index) {
+	if (m_peers[peer_index].is_released && m_peers[peer_index].nbr_pending == 0) {
+		remove_peer(peer_index);
+	}
 }
 
-void AckManager::SentPacket::reset_send_time() {
-	send_time = get_ticks();
+void	AckManager::grow_peer_table() {
+	vector<uint32_t>	old_table(m_peer_table.size() * 2, NO_INDEX);
+	old_table.swap(m_peer_table);
+	for (size_t i = 0; i < old_table.size(); ++i) {
+		if (old_table[i] != NO_INDEX) {
+			m_peer_table[find_peer_slot(m_peers[old_table[i]].address)] = old_table[i];
+		}
+	}
 }
 
-uint64_t AckManager::SentPacket::time_since_send() const {
-	return get_ticks() - send_time;
+void	AckManager::grow_pending(Peer& peer) {
+	vector<uint32_t>	old_pending;
+	old_pending.swap(peer.pending);
+
+	// Keep doubling until all the pending sequence numbers fit without colliding
+	for (size_t size = old_pending.size() * 2; ; size *= 2) {
+		peer.pending.assign(size, NO_INDEX);
+		bool	fits = true;
+		for (size_t i = 0; i < old_pending.size() && fits; ++i) {
+			if (old_pending[i] != NO_INDEX) {
+				uint32_t&	slot(peer.pending[m_entries[old_pending[i]].header.sequence_no & (size - 1)]);
+				fits = slot == NO_INDEX;
+				slot = old_pending[i];
+			}
+		}
+		if (fits) {
+			return;
+		}
+	}
 }
 
-uint64_t AckManager::SentPacket::time_until_resend() const {
-	uint64_t	time_elapsed = time_since_send();
-	if (time_elapsed < ACK_TIME) {
-		return ACK_TIME - time_elapsed;
+void	AckManager::update_rtt(Peer& peer, uint64_t rtt) {
+	// As in RFC 6298
+	if (peer.smoothed_rtt == 0) {
+		peer.smoothed_rtt = std::max<uint64_t>(rtt, 1);
+		peer.rtt_variance = rtt / 2;
 	} else {
-		return 0;
+		uint64_t	difference = peer.smoothed_rtt > rtt ? peer.smoothed_rtt - rtt : rtt - peer.smoothed_rtt;
+		peer.rtt_variance = (3 * peer.rtt_variance + difference) / 4;
+		peer.smoothed_rtt = std::max<uint64_t>((7 * peer.smoothed_rtt + rtt) / 8, 1);
 	}
+	peer.timeout = std::min<uint64_t>(std::max<uint64_t>(peer.smoothed_rtt + 4 * peer.rtt_variance, MIN_TIMEOUT), MAX_TIMEOUT);
 }
 
-void	AckManager::add_packet(const IPAddress& peer_addr, const PacketHeader& packet_header, const std::string& packet_data) {
-	m_packets.push_back(SentPacket(peer_addr, packet_header, packet_data));
-	m_packets_by_id.insert(make_pair(make_pair(peer_addr, packet_header.sequence_no), --m_packets.end()));
+uint64_t	AckManager::get_rtt(const IPAddress& peer_addr) const {
+	uint32_t	peer_index = find_peer(peer_addr);
+	return peer_index != NO_INDEX ? m_peers[peer_index].smoothed_rtt : 0;
 }
 
-void	AckManager::add_packet(const IPAddress& peer_addr, const Packet& packet) {
-	add_packet(peer_addr, packet.header, packet.raw.get_data());
+//
+// Entries
+//
+
+uint32_t	AckManager::allocate_entry() {
+	uint32_t	entry_index;
+	if (m_free_entries != NO_INDEX) {
+		entry_index = m_free_entries;
+		m_free_entries = m_entries[entry_index].timer_next;
+	} else {
+		entry_index = m_entries.size();
+		m_entries.push_back(Entry());
+	}
+	m_entries[entry_index].timer_list = NO_INDEX;
+	++m_nbr_entries;
+	return entry_index;
 }
 
-AckManager::PacketHandle AckManager::add_broadcast_packet(const std::string& packet_data) {
-	m_packets.push_back(SentPacket(packet_data));
-	return --m_packets.end();
+void	AckManager::free_entry(uint32_t entry_index) {
+	unlink_timer(entry_index);
+
+	Entry&		entry(m_entries[entry_index]);
+	Peer&		peer(m_peers[entry.peer]);
+	uint32_t&	slot(peer.pending[entry.header.sequence_no & (peer.pending.size() - 1)]);
+	if (slot == entry_index) {
+		slot = NO_INDEX;
+		--peer.nbr_pending;
+	}
+
+	entry.body = PacketBody();
+	entry.timer_next = m_free_entries;
+	m_free_entries = entry_index;
+	--m_nbr_entries;
 }
 
-AckManager::PacketHandle AckManager::add_broadcast_packet(const Packet& packet) {
-	m_packets.push_back(SentPacket(packet.raw.get_data()));
-	return --m_packets.end();
+//
+// Timer wheel
+//
+
+void	AckManager::link_timer(uint32_t entry_index, uint32_t list) {
+	Entry&		entry(m_entries[entry_index]);
+	entry.timer_list = list;
+	entry.timer_prev = NO_INDEX;
+	entry.timer_next = m_timer_lists[list];
+	if (entry.timer_next != NO_INDEX) {
+		m_entries[entry.timer_next].timer_prev = entry_index;
+	}
+	m_timer_lists[list] = entry_index;
+}
+
+void	AckManager::unlink_timer(uint32_t entry_index) {
+	Entry&		entry(m_entries[entry_index]);
+	if (entry.timer_list == NO_INDEX) {
+		return;
+	}
+
+	if (entry.timer_prev != NO_INDEX) {
+		m_entries[entry.timer_prev].timer_next = entry.timer_next;
+	} else {
+		m_timer_lists[entry.timer_list] = entry.timer_next;
+	}
+	if (entry.timer_next != NO_INDEX) {
+		m_entries[entry.timer_next].timer_prev = entry.timer_prev;
+	}
+	entry.timer_list = NO_INDEX;
 }
 
-void AckManager::add_broadcast_recipient(AckManager::PacketHandle packet, const IPAddress& peer_addr, const PacketHeader& header) {
-	packet->add_recipient(peer_addr, header);
-	m_packets_by_id.insert(make_pair(make_pair(peer_addr, header.sequence_no), packet));
+void	AckManager::schedule(uint32_t entry_index, uint64_t resend_time) {
+	m_entries[entry_index].resend_time = resend_time;
+
+	const int	level2_shift = LEVEL0_BITS + LEVEL_BITS;
+	uint32_t	list;
+	if (resend_time <= m_wheel_time) {
+		list = DUE_LIST;
+	} else if (resend_time - m_wheel_time < LEVEL0_SIZE) {
+		list = resend_time & (LEVEL0_SIZE - 1);
+	} else if ((resend_time >> LEVEL0_BITS) - (m_wheel_time >> LEVEL0_BITS) < LEVEL_SIZE) {
+		list = LEVEL1_START + ((resend_time >> LEVEL0_BITS) & (LEVEL_SIZE - 1));
+	} else {
+		// Anything past the end of the wheel waits in the last slot, and is re-scheduled when that slot is cascaded
+		uint64_t	slot_time = std::min(resend_time, ((m_wheel_time >> level2_shift) + LEVEL_SIZE - 1) << level2_shift);
+		list = LEVEL2_START + ((slot_time >> level2_shift) & (LEVEL_SIZE - 1));
+	}
+
+	link_timer(entry_index, list);
 }
 
-void AckManager::ack(const IPAddress& peer_addr, uint64_t sequence_no) {
-	Map::iterator it(m_packets_by_id.find(make_pair(peer_addr, sequence_no)));
-	if (it != m_packets_by_id.end()) {
-		it->second->ack(peer_addr);
-		if (!it->second->has_recipients()) {
-			// no more recipients on this packet
-			// that means everyone has received it OK
-			// so it can be erased...
-			m_packets.erase(it->second);
+void	AckManager::cascade_timers(uint32_t list) {
+	uint32_t	entry_index = m_timer_lists[list];
+	m_timer_lists[list] = NO_INDEX;
+	while (entry_index != NO_INDEX) {
+		uint32_t	next = m_entries[entry_index].timer_next;
+		m_entries[entry_index].timer_list = NO_INDEX;
+		schedule(entry_index, m_entries[entry_index].resend_time);
+		entry_index = next;
+	}
+}
+
+void	AckManager::advance_timers(uint64_t now) {
+	if (m_nbr_entries == 0) {
+		m_wheel_time = std::max(m_wheel_time, now);
+		return;
+	}
+
+	while (m_wheel_time < now) {
+		const uint64_t	tick = ++m_wheel_time;
+
+		// Every time the lower level wraps around, move the timers in the next slot of the level above down
+		if ((tick & (LEVEL0_SIZE - 1)) == 0) {
+			if (((tick >> LEVEL0_BITS) & (LEVEL_SIZE - 1)) == 0) {
+				cascade_timers(LEVEL2_START + ((tick >> (LEVEL0_BITS + LEVEL_BITS)) & (LEVEL_SIZE - 1)));
+			}
+			cascade_timers(LEVEL1_START + ((tick >> LEVEL0_BITS) & (LEVEL_SIZE - 1)));
+		}
+
+		const uint32_t	list = tick & (LEVEL0_SIZE - 1);
+		while (m_timer_lists[list] != NO_INDEX) {
+			uint32_t	entry_index = m_timer_lists[list];
+			unlink_timer(entry_index);
+			link_timer(entry_index, DUE_LIST);
+		}
+	}
+}
+
+//
+// Public interface
+//
+
+void	AckManager::add_packet(const IPAddress& peer_addr, const PacketHeader& packet_header, const PacketBody& packet_data) {
+	const uint64_t	now = get_ticks();
+	if (m_nbr_entries == 0) {
+		m_wheel_time = std::max(m_wheel_time, now);
+	}
+
+	const uint32_t	peer_index = get_peer(peer_addr);
+	const uint32_t	entry_index = allocate_entry();
+	Peer&		peer(m_peers[peer_index]);
+
+	// Make room in the peer's table for this sequence number
+	for (;;) {
+		uint32_t	existing = peer.pending[packet_header.sequence_no & (peer.pending.size() - 1)];
+		if (existing == NO_INDEX) {
+			break;
+		} else if (m_entries[existing].header.sequence_no == packet_header.sequence_no) {
+			// The same packet again - only keep the latest
+			free_entry(existing);
+			break;
 		}
-		m_packets_by_id.erase(it);
+		grow_pending(peer);
 	}
+
+	Entry&		entry(m_entries[entry_index]);
+	entry.peer = peer_index;
+	entry.header = packet_header;
+	entry.body = packet_data;
+	entry.tries_left = RETRIES;
+	entry.is_resent = false;
+	entry.send_time = now;
+	entry.timeout = peer.timeout;
+
+	peer.pending[packet_header.sequence_no & (peer.pending.size() - 1)] = entry_index;
+	++peer.nbr_pending;
+
+	schedule(entry_index, now + entry.timeout);
+}
+
+void	AckManager::add_packet(const IPAddress& peer_addr, const PacketHeader& packet_header, const std::string& packet_data) {
+	add_packet(peer_addr, packet_header, PacketBody(packet_data));
+}
+
+void	AckManager::add_packet(const IPAddress& peer_addr, const Packet& packet) {
+	add_packet(peer_addr, packet.header, get_packet_body(packet));
+}
+
+AckManager::PacketHandle AckManager::add_broadcast_packet(const Packet& packet) {
+	return get_packet_body(packet);
+}
+
+void AckManager::ack(const IPAddress& peer_addr, uint64_t sequence_no) {
+	uint32_t	peer_index = find_peer(peer_addr);
+	if (peer_index == NO_INDEX) {
+		return;
+	}
+
+	Peer&		peer(m_peers[peer_index]);
+	uint32_t	entry_index = peer.pending[sequence_no & (peer.pending.size() - 1)];
+	if (entry_index == NO_INDEX || m_entries[entry_index].header.sequence_no != sequence_no) {
+		// Not awaiting an ACK (e.g. a duplicate ACK)
+		return;
+	}
+
+	if (!m_entries[entry_index].is_resent) {
+		update_rtt(peer, get_ticks() - m_entries[entry_index].send_time);
+	}
+	free_entry(entry_index);
+	remove_peer_if_done(peer_index);
 }
 
 uint64_t AckManager::time_until_resend() const {
-	return m_packets.empty() ? numeric_limits<uint64_t>::max() : m_packets.front().time_until_resend();
+	if (m_nbr_entries == 0) {
+		return numeric_limits<uint64_t>::max();
+	}
+	if (m_timer_lists[DUE_LIST] != NO_INDEX) {
+		return 0;
+	}
+
+	// Nothing can be due before the first occupied slot of the lowest level, or
+	// the next time that the level above is cascaded down, whichever's first.
+	uint64_t	next_time = (m_wheel_time | (LEVEL0_SIZE - 1)) + 1;
+	for (uint64_t tick = m_wheel_time + 1; tick < next_time; ++tick) {
+		if (m_timer_lists[tick & (LEVEL0_SIZE - 1)] != NO_INDEX) {
+			next_time = tick;
+			break;
+		}
+	}
+
+	uint64_t	now = get_ticks();
+	return next_time > now ? next_time - now : 0;
 }
 
 void AckManager::resend(CommonNetwork& network) {
-	while (!m_packets.empty() && m_packets.front().time_until_resend() == 0) {
-		SentPacket&	packet(m_packets.front());
-		if (packet.tries_left == 0) {
-			// Kick every recipient in this packet
-			for (map<IPAddress, PacketHeader>::iterator recipient(packet.recipients.begin()); recipient != packet.recipients.end(); ++recipient) {
-				network.excessive_packet_drop(recipient->first);
-				m_packets_by_id.erase(make_pair(recipient->first, recipient->second.sequence_no));
-			}
+	const uint64_t	now = get_ticks();
+	advance_timers(now);
 
-			m_packets.pop_front();
-		} else {
-			// Re-send packet to every recipient
-			for (map<IPAddress, PacketHeader>::iterator recipient(packet.recipients.begin()); recipient != packet.recipients.end(); ++recipient) {
-				network.send_packet(recipient->first, recipient->second, packet.packet_data);
-			}
+	while (m_timer_lists[DUE_LIST] != NO_INDEX) {
+		const uint32_t	entry_index = m_timer_lists[DUE_LIST];
+		Entry&		entry(m_entries[entry_index]);
+		const uint32_t	peer_index = entry.peer;
+		const IPAddress	peer_addr(m_peers[peer_index].address);
 
-			// Mark that this packet has been re-sent
-			--packet.tries_left;
-			packet.reset_send_time();
+		if (entry.tries_left == 0) {
+			// Forget the packet before kicking the peer, since that may well clear the peer (or add more packets)
+			free_entry(entry_index);
+			if (m_peers[peer_index].is_released) {
+				// Already gone, so there's no one to kick
+				remove_peer_if_done(peer_index);
+				continue;
+			}
+			network.excessive_packet_drop(peer_addr);
+		} else {
+			network.send_packet(peer_addr, entry.header, entry.body);
 
-			// Move to the back of the queue
-			m_packets.splice(m_packets.end(), m_packets, m_packets.begin());
+			// Mark that this packet has been re-sent, and back off before trying again
+			--entry.tries_left;
+			entry.is_resent = true;
+			entry.send_time = now;
+			entry.timeout = std::min<uint64_t>(entry.timeout * 2, MAX_TIMEOUT);
+			unlink_timer(entry_index);
+			schedule(entry_index, now + entry.timeout);
 		}
 	}
 }
 
 void	AckManager::clear() {
-	m_packets.clear();
-	m_packets_by_id.clear();
+	m_entries.clear();
+	m_free_entries = NO_INDEX;
+	m_nbr_entries = 0;
+
+	m_peers.clear();
+	m_free_peers.clear();
+	std::fill(m_peer_table.begin(), m_peer_table.end(), uint32_t(NO_INDEX));
+	m_nbr_peers = 0;
+
+	std::fill(m_timer_lists, m_timer_lists + NBR_TIMER_LISTS, uint32_t(NO_INDEX));
+	m_wheel_time = get_ticks();
 }
 
-void	AckManager::clear_peer(const IPAddress& peer) {
-	pair<IPAddress, uint64_t>	search_key(peer, 0);
-	Map::iterator			it(m_packets_by_id.lower_bound(search_key));
+void	AckManager::clear_peer(const IPAddress& peer_addr) {
+	uint32_t	peer_index = find_peer(peer_addr);
+	if (peer_index == NO_INDEX) {
+		return;
+	}
 
-	while (it != m_packets_by_id.end() && it->first.first == peer) {
-		it->second->ack(peer); // simulate an ACK on this packet
-		if (!it->second->has_recipients()) {
-			// no more recipients on this packet, so erase it
-			m_packets.erase(it->second);
+	for (size_t i = 0; i < m_peers[peer_index].pending.size(); ++i) {
+		if (m_peers[peer_index].pending[i] != NO_INDEX) {
+			free_entry(m_peers[peer_index].pending[i]);
 		}
-		m_packets_by_id.erase(it++);
 	}
+	remove_peer(peer_index);
 }
 
+void	AckManager::release_peer(const IPAddress& peer_addr) {
+	uint32_t	peer_index = find_peer(peer_addr);
+	if (peer_index == NO_INDEX) {
+		return;
+	}
+
+	m_peers[peer_index].is_released = true;
+	remove_peer_if_done(peer_index);
+}
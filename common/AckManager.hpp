@@ -26,88 +26,138 @@
 #define LM_COMMON_ACKMANAGER_HPP
 
 #include <string>
-#include <list>
-#include <map>
-#include <set>
+#include <vector>
 #include <stdint.h>
 #include "IPAddress.hpp"
 #include "PacketHeader.hpp"
+#include "PacketBody.hpp"
 #include "Packet.hpp"
 
 namespace LM {
 	class PacketWriter;
 	class CommonNetwork;
 	
+	/*
+	 * Keeps track of the reliable packets which have been sent and are awaiting ACKs, and resends them
+	 * when they time out.
+	 *
+	 * Each peer has a flat table of its unacknowledged packets, indexed by sequence number, and the peers
+	 * themselves are found through an open-addressed hash table, so sending, ACKing, and resending
+	 * a packet are all constant-time.  Resends are scheduled on a hierarchical timer wheel with 1ms
+	 * resolution, so resend() only ever looks at the packets which are actually due.
+	 *
+	 * The retransmission timeout adapts to each peer's round trip time (as in RFC 6298), and backs off
+	 * exponentially while a packet goes unacknowledged.
+	 */
 	class AckManager {
+	public:
+		// Parameters controlling ACKs (times in milliseconds)
+		enum {
+			INITIAL_TIMEOUT = 500,		// Used until the peer's round trip time has been measured
+			MIN_TIMEOUT = 50,
+			MAX_TIMEOUT = 2000,
+			RETRIES = 10			// Peers are dropped after this many resends of a packet go unacknowledged
+		};
+
 	private:
-		// Parameters controlling ACKs
+		enum { NO_INDEX = 0xFFFFFFFF };
+
+		// Timer wheel geometry: 256 1ms slots, then 64 256ms slots, then 64 16.384s slots
 		enum {
-			ACK_TIME = 500,
-			RETRIES = 10
+			LEVEL0_BITS = 8,
+			LEVEL0_SIZE = 1 << LEVEL0_BITS,
+			LEVEL_BITS = 6,
+			LEVEL_SIZE = 1 << LEVEL_BITS,
+			LEVEL1_START = LEVEL0_SIZE,
+			LEVEL2_START = LEVEL1_START + LEVEL_SIZE,
+			DUE_LIST = LEVEL2_START + LEVEL_SIZE,	// Packets which are due to be resent right now
+			NBR_TIMER_LISTS = DUE_LIST + 1
 		};
 
-		// This class represents a packet which has been sent (possibly to multiple recipients), and is awaiting ACKs
-		// Note that when the packet is sent to multiple recipients, all recipients receive the same packet data, but
-		// each recipient is sent a different packet header. That's why the packet header is stored in the recipients map.
-		class SentPacket {
-		private:
-			uint64_t				send_time;	// When was it sent?
-			std::map<IPAddress, PacketHeader>	recipients;	// Who was it sent to? (and with what header?)
-			std::string				packet_data;	// What it was
-			int					tries_left;	// How many more times to try sending it
-	
-			// Use this constructor to construct a broadcast packet.
-			// Then call add_recipient() to add the peers to which it was sent.
-			explicit SentPacket(const std::string& packet_data);
+		// A packet which has been sent to one peer, and is awaiting an ACK.
+		// (A broadcast has one Entry per recipient, all sharing the same PacketBody.)
+		struct Entry {
+			uint32_t	peer;		// Index into m_peers
+			PacketHeader	header;
+			PacketBody	body;
+			int		tries_left;	// How many more times to try sending it
+			bool		is_resent;	// Round trip times aren't measured from resent packets (Karn's algorithm)
+			uint64_t	send_time;	// When was it last sent?
+			uint64_t	timeout;	// How long after sending to resend it (doubles with every resend)
+			uint64_t	resend_time;	// When it's due to be resent
+
+			// Links in the timer list the entry is on (or in the free list, if the entry is unused)
+			uint32_t	timer_list;
+			uint32_t	timer_prev;
+			uint32_t	timer_next;
+		};
 
-			// Use this function to construct a unicast packet
-			// It's just shorthand for SentPacket(data) followed by a call to add_recipient(peer_addr, header)
-			SentPacket(const IPAddress& peer_addr, const PacketHeader& header, const std::string& data);
-	
-			// Add a recipient
-			void			add_recipient(const IPAddress&, const PacketHeader&);
+		struct Peer {
+			IPAddress		address;
+			std::vector<uint32_t>	pending;	// Indexes into m_entries, indexed by sequence number modulo the (power of two) size
+			size_t			nbr_pending;
+			uint64_t		smoothed_rtt;	// 0 if not measured yet
+			uint64_t		rtt_variance;
+			uint64_t		timeout;
+			bool			is_released;	// Forget the peer as soon as it has no packets pending
 
-			// Call when an ACK is received for this packet for the given recipient
-			// It will remove the recipient from this SentPacket
-			void			ack(const IPAddress& peer);
+			void			init(const IPAddress& address);
+		};
 
-			uint64_t		time_since_send() const;	// How long since packet was sent?
-			uint64_t		time_until_resend() const;	// How long until we should try resending?
+		std::vector<Entry>		m_entries;
+		uint32_t			m_free_entries;		// Head of the list of unused entries
+		size_t				m_nbr_entries;		// How many entries are in use
 
-			void			reset_send_time();		// Call when the packet has been resent
+		std::vector<Peer>		m_peers;
+		std::vector<uint32_t>		m_free_peers;
+		std::vector<uint32_t>		m_peer_table;		// Open-addressed hash table of indexes into m_peers (power of two size)
+		size_t				m_nbr_peers;
 
-			// When has_recipients() returns false, this SentPacket should be removed
-			// from the AckManager because all its recipients have received the packet OK
-			bool			has_recipients() const { return !recipients.empty(); }
+		uint32_t			m_timer_lists[NBR_TIMER_LISTS];	// Heads of the timer lists
+		uint64_t			m_wheel_time;		// The timer wheel has been advanced up to this time
+
+		static size_t	hash(const IPAddress& address);
+		size_t		find_peer_slot(const IPAddress& address) const;	// Slot in m_peer_table which has (or would have) the peer
+		uint32_t	find_peer(const IPAddress& address) const;	// NO_INDEX if not found
+		uint32_t	get_peer(const IPAddress& address);		// Adds the peer if not found
+		void		remove_peer(uint32_t peer_index);
+		void		remove_peer_if_done(uint32_t peer_index);	// Removes a released peer once nothing is pending for it
+		void		grow_peer_table();
+		void		grow_pending(Peer& peer);
+
+		uint32_t	allocate_entry();
+		void		free_entry(uint32_t entry_index);	// Also removes it from its peer and its timer list
+
+		void		link_timer(uint32_t entry_index, uint32_t list);
+		void		unlink_timer(uint32_t entry_index);
+		void		schedule(uint32_t entry_index, uint64_t resend_time);
+		void		advance_timers(uint64_t now);		// Moves every packet due by now onto the DUE_LIST
+		void		cascade_timers(uint32_t list);
+
+		void		update_rtt(Peer& peer, uint64_t rtt);
 
-			friend class AckManager;
-		};
-		friend class SentPacket;
-	
-		typedef std::list<SentPacket> Queue;
-		typedef std::map<std::pair<IPAddress, uint64_t>, Queue::iterator> Map;
-	
-		// Packets are added to this queue in the order that they are sent
-		Queue								m_packets;
-		// The map allows quick lookup of a packet by IP address and sequence number
-		Map								m_packets_by_id;
-	
 	public:
+		AckManager();
+
 		void		clear();
 		void		clear_peer(const IPAddress& peer); // Remove all packets for this peer from the ACK manager
+		void		release_peer(const IPAddress& peer); // Forget this peer once its pending packets have been ACKed or dropped
 
-		typedef Queue::iterator PacketHandle;
+		// A broadcast packet is tracked separately for each recipient, with every recipient sharing the same body
+		typedef PacketBody PacketHandle;
 
 		// add_packet adds a unicast packet to the AckManager
+		void		add_packet(const IPAddress& peer_addr, const PacketHeader& header, const PacketBody& data);
 		void		add_packet(const IPAddress& peer_addr, const PacketHeader& header, const std::string& data);
 		void		add_packet(const IPAddress& peer_addr, const Packet& packet);
 
 		// Add_broadcast_packet adds a broadcast packet to the AckManager
 		// It returns an opaque PacketHandle object.
 		// Add each recipient of the broadcast packet by calling add_broadcast_recipient with the PacketHandle object.
-		PacketHandle	add_broadcast_packet(const std::string& data);
+		PacketHandle	add_broadcast_packet(const PacketBody& data) { return data; }
+		PacketHandle	add_broadcast_packet(const std::string& data) { return PacketBody(data); }
 		PacketHandle	add_broadcast_packet(const Packet& packet);
-		void		add_broadcast_recipient(PacketHandle, const IPAddress& peer_addr, const PacketHeader& header);
+		void		add_broadcast_recipient(const PacketHandle& packet, const IPAddress& peer_addr, const PacketHeader& header) { add_packet(peer_addr, header, packet); }
 
 		// Call ack() when an ACK is received from the given peer for the given sequence number
 		void		ack(const IPAddress& peer_addr, uint64_t sequence_no);
@@ -117,7 +167,10 @@ namespace LM {
 		void		resend(CommonNetwork& network);
 
 		// if has_packets() returns false, there's no need to periodically call resend()
-		bool		has_packets() const { return !m_packets.empty(); }
+		bool		has_packets() const { return m_nbr_entries != 0; }
+
+		// The smoothed round trip time to the given peer, in milliseconds (0 if it hasn't been measured)
+		uint64_t	get_rtt(const IPAddress& peer_addr) const;
 	};
 }
 
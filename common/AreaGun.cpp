@@ -293,6 +293,23 @@ Packet::PlayerHit* AreaGun::generate_next_hit_packet(Packet::PlayerHit* p, Playe
 	return p;
 }
 
+bool AreaGun::is_valid_hit(const b2World* physics, const PlayerHistory::Transform& shooter, const PlayerHistory::Transform& hit_player, const Packet::PlayerHit* p, float tolerance) const {
+	if (m_area == NULL) {
+		return false;
+	}
+	
+	Point start(shooter.x, shooter.y);
+	Point target(hit_player.x, hit_player.y);
+	
+	// The hit doesn't say which way the shot was aimed, so aim the area straight at the hit player
+	if (!PlayerHistory::overlaps_shape(hit_player, m_area, start, (target - start).get_angle(), tolerance)) {
+		return false;
+	}
+	
+	// As in hit_object(), the player must be visible from the center of the shot
+	return PlayerHistory::is_visible_from(physics, hit_player, start);
+}
+
 int AreaGun::get_damage() const {
 	return m_damage;
 }
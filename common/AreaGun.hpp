@@ -100,6 +100,7 @@ namespace LM {
 		virtual float		get_freeze_time() const;
 		
 		Packet::PlayerHit* generate_next_hit_packet(Packet::PlayerHit* p, Player* shooter);
+		virtual bool		is_valid_hit(const b2World* physics, const PlayerHistory::Transform& shooter, const PlayerHistory::Transform& hit_player, const Packet::PlayerHit* p, float tolerance) const;
 	};
 }
 
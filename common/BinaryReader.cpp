@@ -0,0 +1,120 @@
+/*
+ * common/BinaryReader.cpp
+ *
+ * This file is part of Leges Motus, a networked, 2D shooter set in zero gravity.
+ * 
+ * Copyright 2009-2011 Andrew Ayer, Nathan Partlan, Jeffrey Pfau
+ * 
+ * Leges Motus is free and open source software.  You may redistribute it and/or
+ * modify it under the terms of version 2, or (at your option) version 3, of the
+ * GNU General Public License (GPL), as published by the Free Software Foundation.
+ * 
+ * Leges Motus is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.  See the full text of the GNU General Public License for
+ * further detail.
+ * 
+ * For a full copy of the GNU General Public License, please see the COPYING file
+ * in the root of the source code tree.  You may also retrieve a copy from
+ * <http://www.gnu.org/licenses/gpl-2.0.txt>, or request a copy by writing to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ * 02111-1307  USA
+ * 
+ */
+
+#include "BinaryReader.hpp"
+#include "UDPPacket.hpp"
+#include "PacketHeader.hpp"
+#include "Point.hpp"
+#include "network.hpp"
+#include <cstring>
+
+using namespace LM;
+using namespace std;
+
+BinaryReader::BinaryReader(const UDPPacket& packet) {
+	m_next = reinterpret_cast<const uint8_t*>(packet.get_data());
+	m_end = m_next + packet.get_length();
+	m_has_underflowed = false;
+}
+
+BinaryReader::BinaryReader(const char* data, size_t length) {
+	m_next = reinterpret_cast<const uint8_t*>(data);
+	m_end = m_next + length;
+	m_has_underflowed = false;
+}
+
+bool	BinaryReader::is_binary(const UDPPacket& packet) {
+	return packet.get_length() > 0 && (packet.get_data()[0] == BINARY_PACKET_MARKER || packet.get_data()[0] == BINARY_ACK_PACKET_MARKER);
+}
+
+void	BinaryReader::get_header(PacketHeader& header) {
+	const char	marker = get_char();
+	if (marker != BINARY_PACKET_MARKER && marker != BINARY_ACK_PACKET_MARKER) {
+		m_has_underflowed = true;
+	}
+	header.packet_type = get_varint();
+	header.sequence_no = get_varint();
+	header.connection_id = header.sequence_no ? get_varint() : 0;
+	if (marker == BINARY_ACK_PACKET_MARKER) {
+		header.ack_sequence_no = get_varint();
+		header.ack_bits = get_varint();
+	} else {
+		header.ack_sequence_no = 0;
+		header.ack_bits = 0;
+	}
+}
+
+uint8_t	BinaryReader::get_byte() {
+	if (m_next == m_end) {
+		m_has_underflowed = true;
+		return 0;
+	}
+	return *m_next++;
+}
+
+uint64_t	BinaryReader::get_varint() {
+	uint64_t	value = 0;
+	for (int shift = 0; shift < 64; shift += 7) {
+		uint8_t	byte = get_byte();
+		value |= uint64_t(byte & 0x7F) << shift;
+		if (!(byte & 0x80)) {
+			return value;
+		}
+	}
+
+	// Too many continuation bytes - this is not a valid varint
+	m_has_underflowed = true;
+	m_next = m_end;
+	return 0;
+}
+
+float	BinaryReader::get_float() {
+	uint32_t	bits = get_byte();
+	bits |= uint32_t(get_byte()) << 8;
+	bits |= uint32_t(get_byte()) << 16;
+	bits |= uint32_t(get_byte()) << 24;
+
+	float		value;
+	memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+string	BinaryReader::get_string() {
+	uint64_t	length = get_varint();
+	if (uint64_t(m_end - m_next) < length) {
+		m_has_underflowed = true;
+		m_next = m_end;
+		return string();
+	}
+
+	const char*	start = reinterpret_cast<const char*>(m_next);
+	m_next += length;
+	return string(start, length);
+}
+
+Point	BinaryReader::get_point() {
+	float	x = get_float();
+	float	y = get_float();
+	return Point(x, y);
+}
@@ -0,0 +1,73 @@
+/*
+ * common/BinaryReader.hpp
+ *
+ * This file is part of Leges Motus, a networked, 2D shooter set in zero gravity.
+ * 
+ * Copyright 2009-2011 Andrew Ayer, Nathan Partlan, Jeffrey Pfau
+ * 
+ * Leges Motus is free and open source software.  You may redistribute it and/or
+ * modify it under the terms of version 2, or (at your option) version 3, of the
+ * GNU General Public License (GPL), as published by the Free Software Foundation.
+ * 
+ * Leges Motus is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.  See the full text of the GNU General Public License for
+ * further detail.
+ * 
+ * For a full copy of the GNU General Public License, please see the COPYING file
+ * in the root of the source code tree.  You may also retrieve a copy from
+ * <http://www.gnu.org/licenses/gpl-2.0.txt>, or request a copy by writing to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ * 02111-1307  USA
+ * 
+ */
+
+#ifndef LM_COMMON_BINARYREADER_HPP
+#define LM_COMMON_BINARYREADER_HPP
+
+#include <string>
+#include <stdint.h>
+#include <stddef.h>
+
+namespace LM {
+	class UDPPacket;
+	class PacketHeader;
+	class Point;
+
+	/*
+	 * The binary reader reads the fields of a binary-encoded packet, as written by BinaryWriter
+	 * (which describes the encoding).  Fields must be read in the order they were written.
+	 *
+	 * Reading past the end of the packet, or reading a malformed field, sets the has_underflowed()
+	 * flag, and returns zero (or an empty string) for that field and all following fields.
+	 */
+	class BinaryReader {
+	private:
+		const uint8_t*	m_next;		// The next byte to read
+		const uint8_t*	m_end;		// One past the last byte of the packet
+		bool		m_has_underflowed;
+
+	public:
+		explicit BinaryReader(const UDPPacket& packet);
+		BinaryReader(const char* data, size_t length);
+
+		// Returns true if the given packet is binary-encoded (otherwise, it's text and should be read with a PacketReader)
+		static bool	is_binary(const UDPPacket& packet);
+
+		void		get_header(PacketHeader& header);
+
+		uint8_t		get_byte();
+		bool		get_bool() { return get_byte() != 0; }
+		char		get_char() { return char(get_byte()); }
+		uint64_t	get_varint();
+		int64_t		get_signed_varint() { uint64_t value = get_varint(); return int64_t(value >> 1) ^ -int64_t(value & 1); }
+		float		get_float();
+		std::string	get_string();
+		Point		get_point();
+
+		bool		has_more() const { return m_next < m_end; }
+		bool		has_underflowed() const { return m_has_underflowed; }
+	};
+}
+
+#endif
@@ -0,0 +1,91 @@
+/*
+ * common/BinaryWriter.cpp
+ *
+ * This file is part of Leges Motus, a networked, 2D shooter set in zero gravity.
+ * 
+ * Copyright 2009-2011 Andrew Ayer, Nathan Partlan, Jeffrey Pfau
+ * 
+ * Leges Motus is free and open source software.  You may redistribute it and/or
+ * modify it under the terms of version 2, or (at your option) version 3, of the
+ * GNU General Public License (GPL), as published by the Free Software Foundation.
+ * 
+ * Leges Motus is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.  See the full text of the GNU General Public License for
+ * further detail.
+ * 
+ * For a full copy of the GNU General Public License, please see the COPYING file
+ * in the root of the source code tree.  You may also retrieve a copy from
+ * <http://www.gnu.org/licenses/gpl-2.0.txt>, or request a copy by writing to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ * 02111-1307  USA
+ * 
+ */
+
+#include "BinaryWriter.hpp"
+#include "UDPPacket.hpp"
+#include "PacketHeader.hpp"
+#include "Point.hpp"
+#include "network.hpp"
+#include <cstring>
+
+using namespace LM;
+using namespace std;
+
+BinaryWriter::BinaryWriter(UDPPacket& packet) : m_packet(packet) {
+	m_packet.clear();
+	m_has_overflowed = false;
+}
+
+void	BinaryWriter::put_header(const PacketHeader& header) {
+	put_byte(header.ack_sequence_no ? BINARY_ACK_PACKET_MARKER : BINARY_PACKET_MARKER);
+	put_varint(header.packet_type);
+	put_varint(header.sequence_no);
+	if (header.sequence_no) {
+		put_varint(header.connection_id);
+	}
+	if (header.ack_sequence_no) {
+		put_varint(header.ack_sequence_no);
+		put_varint(header.ack_bits);
+	}
+}
+
+void	BinaryWriter::put_byte(uint8_t byte) {
+	if (m_packet.m_length < m_packet.m_max_length) {
+		m_packet.m_data[m_packet.m_length++] = byte;
+	} else {
+		m_has_overflowed = true;
+	}
+}
+
+void	BinaryWriter::put_varint(uint64_t value) {
+	while (value >= 0x80) {
+		put_byte(uint8_t(value) | 0x80);
+		value >>= 7;
+	}
+	put_byte(uint8_t(value));
+}
+
+void	BinaryWriter::put_float(float value) {
+	uint32_t	bits;
+	memcpy(&bits, &value, sizeof(bits));
+	put_byte(bits);
+	put_byte(bits >> 8);
+	put_byte(bits >> 16);
+	put_byte(bits >> 24);
+}
+
+void	BinaryWriter::put_string(const string& str) {
+	put_varint(str.size());
+	if (m_packet.m_max_length - m_packet.m_length < str.size()) {
+		m_has_overflowed = true;
+		return;
+	}
+	memcpy(m_packet.m_data + m_packet.m_length, str.data(), str.size());
+	m_packet.m_length += str.size();
+}
+
+void	BinaryWriter::put_point(const Point& point) {
+	put_float(point.x);
+	put_float(point.y);
+}
@@ -0,0 +1,86 @@
+/*
+ * common/BinaryWriter.hpp
+ *
+ * This file is part of Leges Motus, a networked, 2D shooter set in zero gravity.
+ * 
+ * Copyright 2009-2011 Andrew Ayer, Nathan Partlan, Jeffrey Pfau
+ * 
+ * Leges Motus is free and open source software.  You may redistribute it and/or
+ * modify it under the terms of version 2, or (at your option) version 3, of the
+ * GNU General Public License (GPL), as published by the Free Software Foundation.
+ * 
+ * Leges Motus is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.  See the full text of the GNU General Public License for
+ * further detail.
+ * 
+ * For a full copy of the GNU General Public License, please see the COPYING file
+ * in the root of the source code tree.  You may also retrieve a copy from
+ * <http://www.gnu.org/licenses/gpl-2.0.txt>, or request a copy by writing to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ * 02111-1307  USA
+ * 
+ */
+
+#ifndef LM_COMMON_BINARYWRITER_HPP
+#define LM_COMMON_BINARYWRITER_HPP
+
+#include <string>
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * The binary writer writes the fields of a binary-encoded packet directly into a UDPPacket's buffer.
+ * Unlike PacketWriter, it never allocates memory.
+ *
+ * Encoding:
+ *	bytes, chars, and bools		1 byte
+ *	unsigned integers		varint (7 bits per byte, least significant group first, high bit set on all but the last byte)
+ *	signed integers			zig-zag encoded, then as a varint
+ *	floats				4 byte IEEE 754, little-endian
+ *	strings				varint length, followed by the bytes of the string (no terminator)
+ *	points				x, then y, as floats
+ *
+ * A binary packet starts with BINARY_PACKET_MARKER, followed by the packet type, sequence number,
+ * and (only if the sequence number is non-zero) the connection ID, all as varints.
+ * If the header carries acknowledgements, it starts with BINARY_ACK_PACKET_MARKER instead,
+ * and the acknowledged sequence number and bitfield follow the connection ID, also as varints.
+ *
+ * Example:
+ * 	BinaryWriter	w(raw_packet);
+ * 	w.put_header(PacketHeader(PLAYER_JUMPED_PACKET, 0, 0));
+ * 	w.put_varint(player_id);
+ * 	w.put_float(direction);
+ */
+
+namespace LM {
+	class UDPPacket;
+	class PacketHeader;
+	class Point;
+
+	class BinaryWriter {
+	private:
+		UDPPacket&	m_packet;
+		bool		m_has_overflowed;	// Set if a field didn't fit in the packet
+
+	public:
+		// Starts writing at the beginning of the given packet (any existing data is discarded)
+		explicit BinaryWriter(UDPPacket& packet);
+
+		void		put_header(const PacketHeader& header);
+
+		void		put_byte(uint8_t byte);
+		void		put_bool(bool b) { put_byte(b ? 1 : 0); }
+		void		put_char(char c) { put_byte(uint8_t(c)); }
+		void		put_varint(uint64_t value);
+		void		put_signed_varint(int64_t value) { put_varint((uint64_t(value) << 1) ^ uint64_t(value >> 63)); }
+		void		put_float(float value);
+		void		put_string(const std::string& str);
+		void		put_point(const Point& point);
+
+		// If this is true, the packet was too small for everything written to it, and is incomplete
+		bool		has_overflowed() const { return m_has_overflowed; }
+	};
+}
+
+#endif
@@ -29,6 +29,7 @@
 #include "PacketWriter.hpp"
 #include "network.hpp"
 #include "Packet.hpp"
+#include "timer.hpp"
 #include <stdint.h>
 #include <stdlib.h>
 
@@ -38,6 +39,14 @@ using namespace std;
 CommonNetwork::Peer::Peer ()
 {
 	next_sequence_no = 1L;
+	binary_packets = false;
+	world_snapshots = false;
+	piggyback_acks = false;
+	input_acks = false;
+	timed_snapshots = false;
+	received_sequence_no = 0;
+	received_bits = 0;
+	ack_due_time = 0;
 }
 
 void	CommonNetwork::Peer::init (uint32_t arg_connection_id, uint64_t next_send_sequence_no, uint64_t next_receive_sequence_no)
@@ -45,9 +54,64 @@ void	CommonNetwork::Peer::init (uint32_t arg_connection_id, uint64_t next_send_s
 	connection_id = arg_connection_id;
 	next_sequence_no = next_send_sequence_no;
 	packet_queue.init(next_receive_sequence_no);
+	binary_packets = false;
+	world_snapshots = false;
+	piggyback_acks = false;
+	input_acks = false;
+	timed_snapshots = false;
+	received_sequence_no = 0;
+	received_bits = 0;
+	ack_due_time = 0;
+}
+
+bool	CommonNetwork::Peer::receive(uint64_t sequence_no)
+{
+	if (sequence_no > received_sequence_no) {
+		// Shift the bitfield so it's relative to the new highest sequence number
+		const uint64_t	shift = sequence_no - received_sequence_no;
+		if (received_sequence_no == 0 || shift > 32) {
+			received_bits = 0;
+		} else if (shift == 32) {
+			received_bits = 1U << 31;
+		} else {
+			received_bits = (received_bits << shift) | (1U << (shift - 1));
+		}
+		received_sequence_no = sequence_no;
+	} else if (sequence_no < received_sequence_no) {
+		const uint64_t	distance = received_sequence_no - sequence_no;
+		if (distance > 32) {
+			return false;
+		}
+		received_bits |= 1U << (distance - 1);
+	}
+	return true;
+}
+
+CommonNetwork::CommonNetwork()
+{
+	m_send_batch_depth = 0;
+	m_next_ack_due_time = 0;
+}
+
+void	CommonNetwork::end_send_batch() {
+	if (--m_send_batch_depth == 0) {
+		flush_send_batch();
+	}
+}
+
+void	CommonNetwork::flush_send_batch() {
+	m_socket.send_batch(m_send_batch);
 }
 
 void	CommonNetwork::send_raw_packet(const UDPPacket& raw_packet) {
+	if (m_send_batch_depth > 0) {
+		if (m_send_batch.is_full()) {
+			flush_send_batch();
+		}
+		m_send_batch.add(raw_packet);
+		return;
+	}
+
 /*
 	static UDPPacket*	buffered_packet = NULL;
 	static long		packet_count = 0;
@@ -77,21 +141,68 @@ void	CommonNetwork::send_raw_packet(const UDPPacket& raw_packet) {
 	//m_socket.send(raw_packet);
 }
 
+void	CommonNetwork::send_raw_packet(const IPAddress& dest, const PacketBody& raw_data) {
+	// The body can only be sent without copying it as part of a batch
+	SendBatch	batch(*this);
+	UDPPacket	no_header(MAX_PACKET_LENGTH);
+	no_header.set_address(dest);
+	if (m_send_batch.is_full()) {
+		flush_send_batch();
+	}
+	m_send_batch.add(no_header, raw_data);
+}
+
 bool	CommonNetwork::receive_raw_packet(UDPPacket& raw_packet) {
-	return m_socket.has_packets() && m_socket.recv(raw_packet);
+	return m_socket.recv_batch(&raw_packet, 1) == 1;
+}
+
+void	CommonNetwork::acknowledge(const IPAddress& peer_address, const PacketHeader& packet_to_ack) {
+	Peer*	peer = get_peer(peer_address);
+	if (!peer || !peer->piggyback_acks || packet_to_ack.connection_id != peer->connection_id || !peer->receive(packet_to_ack.sequence_no)) {
+		// Immediately send an ACK
+		send_ack(peer_address, packet_to_ack);
+		return;
+	}
+
+	// Give an outgoing packet the chance to carry the acknowledgement
+	if (!peer->ack_due_time) {
+		peer->ack_due_time = get_ticks() + MAX_ACK_DELAY;
+		if (!m_next_ack_due_time || peer->ack_due_time < m_next_ack_due_time) {
+			m_next_ack_due_time = peer->ack_due_time;
+		}
+	}
 }
 
-void	CommonNetwork::send_ack(const IPAddress& peer, const PacketReader& packet_to_ack) {
+void	CommonNetwork::send_ack(const IPAddress& peer, const PacketHeader& packet_to_ack) {
 	PacketWriter		ack_packet(ACK_PACKET);
-	ack_packet << packet_to_ack.packet_type() << packet_to_ack.sequence_no();
+	ack_packet << packet_to_ack.packet_type << packet_to_ack.sequence_no;
 	send_packet(peer, ack_packet);
 }
 
-void	CommonNetwork::send_ack(const IPAddress& peer, const Packet& packet_to_ack) {
-	Packet ack_packet(ACK_PACKET);
-	ack_packet.ack.packet_type = packet_to_ack.header.packet_type;
-	ack_packet.ack.sequence_no = packet_to_ack.header.sequence_no;
-	send_packet(peer, &ack_packet);
+void	CommonNetwork::add_acks(const IPAddress& peer_address, PacketHeader& header) {
+	Peer*	peer = get_peer(peer_address);
+	if (peer && peer->piggyback_acks && peer->received_sequence_no) {
+		// Acknowledgements are repeated in every packet, in case some are lost
+		header.ack_sequence_no = peer->received_sequence_no;
+		header.ack_bits = peer->received_bits;
+		peer->ack_due_time = 0;
+	} else {
+		header.ack_sequence_no = 0;
+		header.ack_bits = 0;
+	}
+}
+
+void	CommonNetwork::process_acks(const IPAddress& peer, const PacketHeader& header) {
+	if (!header.ack_sequence_no) {
+		return;
+	}
+
+	m_ack_manager.ack(peer, header.ack_sequence_no);
+	for (uint32_t bits = header.ack_bits, i = 0; bits && header.ack_sequence_no > i + 1; bits >>= 1, ++i) {
+		if (bits & 1) {
+			m_ack_manager.ack(peer, header.ack_sequence_no - 1 - i);
+		}
+	}
 }
 
 void	CommonNetwork::process_ack(const IPAddress& peer, PacketReader& ack_packet) {
@@ -106,25 +217,86 @@ void	CommonNetwork::process_ack(const Packet& ack_packet) {
 	m_ack_manager.ack(ack_packet.raw.get_address(), ack_packet.ack.sequence_no);
 }
 
+void	CommonNetwork::send_pending_ack(const IPAddress& peer_address, Peer& peer, uint64_t now) {
+	if (!peer.ack_due_time) {
+		return;
+	}
+
+	if (peer.ack_due_time <= now) {
+		// No packet has carried the acknowledgements in time, so send them on their own.
+		// (The header carries all of them, the body just the latest for the benefit of process_ack.)
+		PacketWriter	ack_packet(ACK_PACKET);
+		ack_packet << 0 << peer.received_sequence_no;
+		send_packet(peer_address, ack_packet);
+	} else if (!m_next_ack_due_time || peer.ack_due_time < m_next_ack_due_time) {
+		m_next_ack_due_time = peer.ack_due_time;
+	}
+}
+
 void	CommonNetwork::send_packet(const IPAddress& dest, Packet* packet) {
+	add_acks(dest, packet->header);
 	packet->marshal();
 	packet->raw.set_address(dest);
 	send_raw_packet(packet->raw);
 }
 
 void	CommonNetwork::send_packet(const IPAddress& dest, const PacketWriter& packet) {
-	send_packet(dest, packet.get_header(), packet.packet_data());
+	send_packet(dest, packet.get_header(), packet);
+}
+
+void	CommonNetwork::send_packet(const IPAddress& dest, const PacketHeader& packet_header, const PacketWriter& packet) {
+	PacketHeader	header(packet_header);
+	add_acks(dest, header);
+	UDPPacket	raw_packet(MAX_PACKET_LENGTH);
+	raw_packet.set_address(dest);
+	header.write(raw_packet);
+	raw_packet.append(packet.get_data(), packet.get_length());
+	send_raw_packet(raw_packet);
+}
+
+void	CommonNetwork::send_packet(const IPAddress& dest, const PacketHeader& packet_header, const PacketBody& body) {
+	// The body can only be sent without copying it as part of a batch
+	SendBatch	batch(*this);
+	PacketHeader	header(packet_header);
+	add_acks(dest, header);
+	UDPPacket	raw_header(MAX_PACKET_LENGTH);
+	raw_header.set_address(dest);
+	header.write(raw_header);
+	if (m_send_batch.is_full()) {
+		flush_send_batch();
+	}
+	m_send_batch.add(raw_header, body);
 }
 
 void	CommonNetwork::send_packet(const IPAddress& dest, const PacketHeader& packet_header, const std::string& packet_data) {
+	PacketHeader	header(packet_header);
+	add_acks(dest, header);
 	UDPPacket	raw_packet(MAX_PACKET_LENGTH);
 	raw_packet.set_address(dest);
-	raw_packet.fill(packet_header.make_string());
+	header.write(raw_packet);
 	raw_packet.append(packet_data);
 	send_raw_packet(raw_packet);
 }
 
 void	CommonNetwork::resend_acks() {
+	SendBatch	batch(*this);
 	m_ack_manager.resend(*this);
 }
 
+
+uint64_t	CommonNetwork::time_until_acks_due() const {
+	uint64_t	now = get_ticks();
+	return m_next_ack_due_time > now ? m_next_ack_due_time - now : 0;
+}
+
+void	CommonNetwork::send_pending_acks() {
+	uint64_t	now = get_ticks();
+	if (!m_next_ack_due_time || m_next_ack_due_time > now) {
+		return;
+	}
+
+	// send_pending_ack() reschedules the acknowledgements which aren't due yet
+	SendBatch	batch(*this);
+	m_next_ack_due_time = 0;
+	send_due_acks(now);
+}
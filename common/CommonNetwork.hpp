@@ -26,6 +26,7 @@
 #define LM_COMMON_COMMONNETWORK_HPP
 
 #include "UDPSocket.hpp"
+#include "UDPPacketBatch.hpp"
 #include "AckManager.hpp"
 #include "PacketQueue.hpp"
 #include <stdint.h>
@@ -44,39 +45,102 @@ namespace LM {
 			uint32_t		connection_id;			// For both sending and receiving packets
 			uint64_t		next_sequence_no;		// For sending packets
 			PacketQueue		packet_queue;			// For receiving packets
+			bool			binary_packets;			// Does this peer understand binary-encoded packets?
+			bool			world_snapshots;		// Is this peer sent WORLD_SNAPSHOTs instead of PLAYER_UPDATEs?
+			bool			piggyback_acks;			// Are this peer's reliable packets acknowledged in the headers of our packets?
+			bool			input_acks;			// Does this peer number its inputs, and want to know which we've applied?
+			bool			timed_snapshots;		// Does this peer want to know when each WORLD_SNAPSHOT was sent?
+
+			// The reliable packets received from this peer, in the same form as PacketHeader::ack_sequence_no and ack_bits
+			uint64_t		received_sequence_no;
+			uint32_t		received_bits;
+			// When a standalone ACK must be sent, if no other packet has carried the acknowledgements by then (0 if none is pending)
+			uint64_t		ack_due_time;
 
 			Peer();
 			
 			void			init (uint32_t connection_id, uint64_t next_send_sequence_no =1L, uint64_t next_receive_sequence_no =1L);
+
+			// Record that the given reliable packet has been received.
+			// Returns false if it's too old to be acknowledged in a header.
+			bool			receive(uint64_t sequence_no);
 		};
+
+		// How long to wait for an outgoing packet to carry acknowledgements before sending a standalone ACK (in milliseconds)
+		enum { MAX_ACK_DELAY = 40 };
 	protected:
 		AckManager	m_ack_manager;
 		UDPSocket	m_socket;
 
+		// While a SendBatch object exists, outgoing packets are collected in m_send_batch instead of
+		// being sent immediately, and are then sent with as few system calls as possible when the
+		// (outermost) SendBatch is destroyed.
+		class SendBatch {
+		private:
+			CommonNetwork&	m_network;
+		public:
+			explicit SendBatch(CommonNetwork& network) : m_network(network) { ++m_network.m_send_batch_depth; }
+			~SendBatch() { m_network.end_send_batch(); }
+		};
+		friend class SendBatch;
+
+		UDPPacketBatch	m_send_batch;
+		int		m_send_batch_depth;
+
+		// The earliest Peer::ack_due_time of any peer (0 if no acknowledgements are pending)
+		uint64_t	m_next_ack_due_time;
+
+		void		end_send_batch();
+		void		flush_send_batch();
+
 		// Send/receive _single_ packets, in raw form.
 		void		send_raw_packet(const UDPPacket& raw_packet);
+		void		send_raw_packet(const IPAddress& dest, const PacketBody& raw_data); // raw_data is shared, not copied
 		// Returns true if a packet was received, false if no packets are waiting to be received
 		bool		receive_raw_packet(UDPPacket& raw_packet);
 
+		// Returns the registered peer with the given address, or NULL if there is none
+		virtual Peer*	get_peer(const IPAddress&) { return NULL; }
+
+		// Acknowledge the given reliable packet: in the header of the next packet sent to the peer if it
+		// supports that, and with a standalone ACK packet otherwise
+		void		acknowledge(const IPAddress& peer, const PacketHeader& packet_to_ack);
 		// Send an ACK packet for the given packet
-		void		send_ack(const IPAddress& peer, const PacketReader& packet_to_ack);
-		void		send_ack(const IPAddress& peer, const Packet& packet_to_ack);
+		void		send_ack(const IPAddress& peer, const PacketHeader& packet_to_ack);
+		// Stamp the given header with the acknowledgements owed to the peer
+		void		add_acks(const IPAddress& peer, PacketHeader& header);
+		// Process the acknowledgements carried in the header of any received packet
+		void		process_acks(const IPAddress& peer, const PacketHeader& header);
 		// Process an ACK packet
 		void		process_ack(const IPAddress& peer, PacketReader& ack_packet);
 		void		process_ack(const Packet& ack_packet);
 
+		// Send a standalone ACK to the given peer if its acknowledgements are due, or reschedule them otherwise
+		void		send_pending_ack(const IPAddress& peer_address, Peer& peer, uint64_t now);
+		// Call send_pending_ack() for every registered peer
+		virtual void	send_due_acks(uint64_t now) { }
+
 	public:
+		CommonNetwork();
 		virtual ~CommonNetwork() { }
 
 		// Send a packet
 		void		send_packet(const IPAddress& dest, Packet* packet);
 		void		send_packet(const IPAddress& dest, const PacketWriter& packet);
+		void		send_packet(const IPAddress& dest, const PacketHeader& header, const PacketWriter& packet); // Sent with the given header instead of packet's
+		void		send_packet(const IPAddress& dest, const PacketHeader& header, const PacketBody& body); // body is shared, not copied
 		void		send_packet(const IPAddress& dest, const PacketHeader& header, const std::string& data);
 
 		bool		has_ack_packets() const { return m_ack_manager.has_packets(); }
 		uint64_t	time_until_ack_resend() const { return m_ack_manager.time_until_resend(); }
+		uint64_t	get_rtt(const IPAddress& peer) const { return m_ack_manager.get_rtt(peer); } // 0 if not measured yet
 		void		resend_acks();
 
+		// Acknowledgements which no outgoing packet has carried yet are sent in standalone ACKs once they're due
+		bool		has_pending_acks() const { return m_next_ack_due_time != 0; }
+		uint64_t	time_until_acks_due() const;
+		void		send_pending_acks();
+
 		virtual void	excessive_packet_drop(const IPAddress& peer) { }
 	};
 }
@@ -0,0 +1,258 @@
+/*
+ * common/EventPoller.cpp
+ *
+ * This file is part of Leges Motus, a networked, 2D shooter set in zero gravity.
+ * 
+ * Copyright 2009-2011 Andrew Ayer, Nathan Partlan, Jeffrey Pfau
+ * 
+ * Leges Motus is free and open source software.  You may redistribute it and/or
+ * modify it under the terms of version 2, or (at your option) version 3, of the
+ * GNU General Public License (GPL), as published by the Free Software Foundation.
+ * 
+ * Leges Motus is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.  See the full text of the GNU General Public License for
+ * further detail.
+ * 
+ * For a full copy of the GNU General Public License, please see the COPYING file
+ * in the root of the source code tree.  You may also retrieve a copy from
+ * <http://www.gnu.org/licenses/gpl-2.0.txt>, or request a copy by writing to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ * 02111-1307  USA
+ * 
+ */
+
+#include "EventPoller.hpp"
+#include "Exception.hpp"
+
+using namespace LM;
+using namespace std;
+
+#ifdef __WIN32
+#include "Winsock2.h"
+#else
+#include <sys/types.h>
+#include <sys/select.h>
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <string.h>
+#endif
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#endif
+
+#include <algorithm>
+
+const uint64_t	EventPoller::NO_TIMEOUT;
+
+EventPoller::EventPoller() {
+	m_wake_fds[0] = m_wake_fds[1] = -1;
+
+#ifdef __WIN32
+	// Connected to its own address, so that each end of the pipe is the same socket
+	struct sockaddr_in	addr;
+	int			addr_len = sizeof(addr);
+	if (m_wake_socket.bind("127.0.0.1", 0) &&
+			getsockname(m_wake_socket.get_fd(), reinterpret_cast<struct sockaddr*>(&addr), &addr_len) == 0 &&
+			connect(m_wake_socket.get_fd(), reinterpret_cast<struct sockaddr*>(&addr), addr_len) == 0) {
+		u_long	one = 1;
+		ioctlsocket(m_wake_socket.get_fd(), FIONBIO, &one);
+		m_wake_fds[0] = m_wake_fds[1] = m_wake_socket.get_fd();
+	}
+#else
+	if (pipe(m_wake_fds) == 0) {
+		for (int i = 0; i < 2; ++i) {
+			fcntl(m_wake_fds[i], F_SETFL, fcntl(m_wake_fds[i], F_GETFL) | O_NONBLOCK);
+			fcntl(m_wake_fds[i], F_SETFD, FD_CLOEXEC);
+		}
+	} else {
+		m_wake_fds[0] = m_wake_fds[1] = -1;
+	}
+#endif
+
+#ifdef __linux__
+	m_epoll_fd = epoll_create(8);
+	if (m_epoll_fd >= 0) {
+		fcntl(m_epoll_fd, F_SETFD, FD_CLOEXEC);
+	}
+	m_timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+
+	if (m_epoll_fd < 0 || m_timer_fd < 0) {
+		throw Exception("Failed to initialize the event poller");
+	}
+
+	struct epoll_event	ev;
+	memset(&ev, 0, sizeof(ev));
+	ev.events = EPOLLIN;
+	ev.data.fd = m_timer_fd;
+	epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, m_timer_fd, &ev);
+
+	if (m_wake_fds[0] >= 0) {
+		ev.data.fd = m_wake_fds[0];
+		epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, m_wake_fds[0], &ev);
+	}
+#endif
+}
+
+EventPoller::~EventPoller() {
+#ifdef __linux__
+	::close(m_timer_fd);
+	::close(m_epoll_fd);
+#endif
+#ifndef __WIN32
+	if (m_wake_fds[0] >= 0) {
+		::close(m_wake_fds[0]);
+		::close(m_wake_fds[1]);
+	}
+#endif
+}
+
+bool	EventPoller::add(int fd) {
+	if (fd < 0) {
+		return false;
+	}
+
+#ifdef __linux__
+	struct epoll_event	ev;
+	memset(&ev, 0, sizeof(ev));
+	ev.events = EPOLLIN;
+	ev.data.fd = fd;
+	if (epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+		return false;
+	}
+#endif
+
+	m_fds.push_back(fd);
+	return true;
+}
+
+void	EventPoller::remove(int fd) {
+	std::vector<int>::iterator	it(std::find(m_fds.begin(), m_fds.end(), fd));
+	if (it == m_fds.end()) {
+		return;
+	}
+	m_fds.erase(it);
+
+#ifdef __linux__
+	struct epoll_event	ev;
+	memset(&ev, 0, sizeof(ev));
+	epoll_ctl(m_epoll_fd, EPOLL_CTL_DEL, fd, &ev);
+#endif
+}
+
+void	EventPoller::wake() {
+#ifdef __WIN32
+	if (m_wake_fds[1] >= 0) {
+		// If the socket's buffer is full, a wakeup is already pending, so failure is OK.
+		char	byte = 0;
+		::send(m_wake_fds[1], &byte, 1, 0);
+	}
+#else
+	if (m_wake_fds[1] >= 0) {
+		// Async-signal-safe.  If the pipe is full, a wakeup is already pending, so failure is OK.
+		char	byte = 0;
+		if (write(m_wake_fds[1], &byte, 1) < 0) {
+			return;
+		}
+	}
+#endif
+}
+
+void	EventPoller::drain_wake_pipe() {
+	char	buffer[64];
+#ifdef __WIN32
+	while (m_wake_fds[0] >= 0 && ::recv(m_wake_fds[0], buffer, sizeof(buffer), 0) > 0);
+#else
+	while (m_wake_fds[0] >= 0 && read(m_wake_fds[0], buffer, sizeof(buffer)) > 0);
+#endif
+}
+
+#ifdef __linux__
+
+int	EventPoller::wait(uint64_t timeout_usec) {
+	int			epoll_timeout = -1;
+	struct itimerspec	timer;
+	memset(&timer, 0, sizeof(timer));
+
+	if (timeout_usec == 0) {
+		epoll_timeout = 0;
+	} else if (timeout_usec != NO_TIMEOUT) {
+		// epoll_wait only has millisecond resolution, so the real deadline is armed on the timerfd
+		timer.it_value.tv_sec = timeout_usec / 1000000;
+		timer.it_value.tv_nsec = (timeout_usec % 1000000) * 1000;
+	}
+	timerfd_settime(m_timer_fd, 0, &timer, NULL);
+
+	sigset_t		no_signals;
+	sigemptyset(&no_signals);
+
+	struct epoll_event	events[8];
+	int			nevents = epoll_pwait(m_epoll_fd, events, 8, epoll_timeout, &no_signals);
+
+	if (nevents < 0) {
+		return errno == EINTR ? INTERRUPTED : TIMEOUT;
+	}
+
+	int			result = TIMEOUT;
+	for (int i = 0; i < nevents; ++i) {
+		if (events[i].data.fd == m_timer_fd) {
+			// Acknowledge the expiration so the timerfd stops being readable
+			uint64_t	expirations;
+			if (read(m_timer_fd, &expirations, sizeof(expirations)) < 0) {
+				continue;
+			}
+		} else if (events[i].data.fd == m_wake_fds[0]) {
+			drain_wake_pipe();
+			result = INTERRUPTED;
+		} else if (result == TIMEOUT) {
+			result = READABLE;
+		}
+	}
+
+	return result;
+}
+
+#else
+
+int	EventPoller::wait(uint64_t timeout_usec) {
+	fd_set		read_fds;
+	FD_ZERO(&read_fds);
+
+	int		max_fd = -1;
+	for (std::vector<int>::const_iterator it(m_fds.begin()); it != m_fds.end(); ++it) {
+		FD_SET(*it, &read_fds);
+		max_fd = std::max(max_fd, *it);
+	}
+	if (m_wake_fds[0] >= 0) {
+		FD_SET(m_wake_fds[0], &read_fds);
+		max_fd = std::max(max_fd, m_wake_fds[0]);
+	}
+
+#ifdef __WIN32
+	struct timeval	timeout = { long(timeout_usec / 1000000), long(timeout_usec % 1000000) };
+	int		retval = select(max_fd + 1, &read_fds, 0, 0, timeout_usec == NO_TIMEOUT ? NULL : &timeout);
+#else
+	struct timespec	timeout = { time_t(timeout_usec / 1000000), long((timeout_usec % 1000000) * 1000) };
+	sigset_t	no_signals;
+	sigemptyset(&no_signals);
+	int		retval = pselect(max_fd + 1, &read_fds, 0, 0, timeout_usec == NO_TIMEOUT ? NULL : &timeout, &no_signals);
+#endif
+
+	if (retval < 0) {
+		return INTERRUPTED;
+	} else if (retval == 0) {
+		return TIMEOUT;
+	}
+
+	if (m_wake_fds[0] >= 0 && FD_ISSET(m_wake_fds[0], &read_fds)) {
+		drain_wake_pipe();
+		return INTERRUPTED;
+	}
+	return READABLE;
+}
+
+#endif
@@ -0,0 +1,93 @@
+/*
+ * common/EventPoller.hpp
+ *
+ * This file is part of Leges Motus, a networked, 2D shooter set in zero gravity.
+ * 
+ * Copyright 2009-2011 Andrew Ayer, Nathan Partlan, Jeffrey Pfau
+ * 
+ * Leges Motus is free and open source software.  You may redistribute it and/or
+ * modify it under the terms of version 2, or (at your option) version 3, of the
+ * GNU General Public License (GPL), as published by the Free Software Foundation.
+ * 
+ * Leges Motus is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.  See the full text of the GNU General Public License for
+ * further detail.
+ * 
+ * For a full copy of the GNU General Public License, please see the COPYING file
+ * in the root of the source code tree.  You may also retrieve a copy from
+ * <http://www.gnu.org/licenses/gpl-2.0.txt>, or request a copy by writing to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ * 02111-1307  USA
+ * 
+ */
+
+#ifndef LM_COMMON_EVENTPOLLER_HPP
+#define LM_COMMON_EVENTPOLLER_HPP
+
+#include <stdint.h>
+#include <vector>
+#ifdef __WIN32
+#include "common/UDPSocket.hpp"
+#endif
+
+namespace LM {
+	/*
+	 * Waits for any of a set of file descriptors to become readable, for a timeout
+	 * to elapse, or for wake() to be called - whichever happens first.
+	 *
+	 * On Linux this is built on epoll, with a timerfd providing microsecond-precision
+	 * timeouts.  Elsewhere it falls back to pselect() (or select() on Windows, where
+	 * wake() sends to a loopback socket instead of writing to a pipe).
+	 *
+	 * While waiting, all signals are unblocked, so a process that keeps its signals
+	 * blocked the rest of the time (like the server) will have them delivered during
+	 * the wait, and the wait will return early.
+	 */
+	class EventPoller {
+	public:
+		// Pass as a timeout to wait forever
+		static const uint64_t	NO_TIMEOUT = ~0ULL;
+
+		// Why did wait() return?
+		enum {
+			TIMEOUT = 0,		// The timeout elapsed
+			READABLE = 1,		// At least one file descriptor is readable
+			INTERRUPTED = 2		// A signal was received or wake() was called
+		};
+
+	private:
+		std::vector<int>	m_fds;		// The file descriptors we're watching
+		int			m_wake_fds[2];	// Self-pipe used by wake() ([0] = read end, [1] = write end)
+#ifdef __WIN32
+		UDPSocket		m_wake_socket;	// select() only takes sockets here, so the "pipe" is a loopback socket sending to itself
+#endif
+#ifdef __linux__
+		int			m_epoll_fd;
+		int			m_timer_fd;
+#endif
+
+		void			drain_wake_pipe();
+
+		// Uncopyable
+		EventPoller(const EventPoller&);
+		EventPoller&		operator=(const EventPoller&);
+
+	public:
+		EventPoller();
+		~EventPoller();
+
+		// Start/stop watching the given file descriptor for readability
+		bool			add(int fd);
+		void			remove(int fd);
+
+		// Wait up to timeout_usec microseconds.  Returns TIMEOUT, READABLE, or INTERRUPTED.
+		int			wait(uint64_t timeout_usec);
+
+		// Make a concurrent (or future) call to wait() return INTERRUPTED.
+		// Safe to call from a signal handler or another thread.
+		void			wake();
+	};
+}
+
+#endif
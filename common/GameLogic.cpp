@@ -31,10 +31,18 @@
 #include "common/MapObject.hpp"
 #include "common/misc.hpp"
 #include <ctime>
+#include <algorithm>
 
 using namespace LM;
 using namespace std;
 
+namespace {
+	// For binary searches of the players by ID
+	struct PlayerIdLess {
+		bool operator()(const Player* player, uint32_t id) const { return player->get_id() < id; }
+	};
+}
+
 GameLogic::GameLogic(Map* map) {
 	// XXX don't do this here, it breaks encapsulation
 	// XXX we probably shouldn't be using rand() at all actually
@@ -48,6 +56,9 @@ GameLogic::GameLogic(Map* map) {
 	
 	m_physics->SetContactListener(this);
 	
+	m_tick = 0;
+	m_records_history = false;
+	
 	m_energy_recharge = 1;
 	m_energy_recharge_rate = 150;
 	m_energy_recharge_delay = 300;
@@ -61,8 +72,8 @@ GameLogic::GameLogic(Map* map) {
 }
 
 GameLogic::~GameLogic() {
-	for (map<uint32_t, Player*>::iterator iter = m_players.begin(); iter != m_players.end(); ++iter) {
-		delete iter->second;
+	for (vector<Player*>::iterator iter = m_players.begin(); iter != m_players.end(); ++iter) {
+		delete *iter;
 	}
 	delete m_map;
 	
@@ -73,6 +84,10 @@ GameLogic::~GameLogic() {
 
 void GameLogic::update_map() {
 	m_map->initialize_physics(m_physics);
+	m_static_geometry.build(m_physics);
+	
+	m_grid.init(m_map->get_width(), m_map->get_height());
+	refile_players();
 }
 
 Map* GameLogic::get_map() {
@@ -88,6 +103,7 @@ Map* GameLogic::unregister_map() {
 void GameLogic::round_started() {
 	m_round_in_progress = true;
 	m_round_start_time = get_ticks();
+	m_history.clear();
 }
 
 void GameLogic::round_ended() {
@@ -118,7 +134,13 @@ void GameLogic::add_player(Player* player) {
 	// TODO: Testing code for physics - remove later.
 	//player->apply_force(b2Vec2(200.0f, 50.0f));
 	
-	m_players[player->get_id()] = player;
+	vector<Player*>::iterator it(find_player(player->get_id()));
+	if (it != m_players.end() && (*it)->get_id() == player->get_id()) {
+		*it = player;
+	} else {
+		m_players.insert(it, player);
+	}
+	refile_players();
 }
 
 Player* GameLogic::remove_player(uint32_t id) {
@@ -128,34 +150,37 @@ Player* GameLogic::remove_player(uint32_t id) {
 		return NULL;
 	}
 	
-	m_players.erase(id);
+	m_players.erase(find_player(id));
+	refile_players();
 	return player;
 }
 
+vector<Player*>::iterator GameLogic::find_player(uint32_t id) {
+	return lower_bound(m_players.begin(), m_players.end(), id, PlayerIdLess());
+}
+
+vector<Player*>::const_iterator GameLogic::find_player(uint32_t id) const {
+	return lower_bound(m_players.begin(), m_players.end(), id, PlayerIdLess());
+}
+
 Player* GameLogic::get_player(const uint32_t id) {
-	if (m_players.find(id) == m_players.end()) {
+	vector<Player*>::iterator it(find_player(id));
+	if (it == m_players.end() || (*it)->get_id() != id) {
 		WARN("No player found for id: " << id);
 		return NULL;
 	}
 
-	return m_players[id];
+	return *it;
 }
 
 const Player* GameLogic::get_player(const uint32_t id) const {
-	if (m_players.find(id) == m_players.end()) {
+	vector<Player*>::const_iterator it(find_player(id));
+	if (it == m_players.end() || (*it)->get_id() != id) {
 		WARN("No player found for id: " << id);
 		return NULL;
 	}
 
-	return m_players.find(id)->second;
-}
-
-Iterator<pair<uint32_t, Player*> > GameLogic::list_players() {
-	return Iterator<pair<uint32_t, Player*> >(new StdMapIterator<uint32_t, Player*>(&m_players));
-}
-
-ConstIterator<pair<uint32_t, Player*> > GameLogic::list_players() const {
-	return ConstIterator<pair<uint32_t, Player*> >(new ConstStdMapIterator<uint32_t, Player*>(&m_players));
+	return *it;
 }
 
 int GameLogic::num_players() const {
@@ -216,9 +241,14 @@ const string& GameLogic::get_param(const string& name) const {
 	return m_params.find(name)->second;
 }
 
-void GameLogic::step() {
-	for (map<uint32_t, Player*>::iterator iter = m_players.begin(); iter != m_players.end(); ++iter) {
-		Player* player = iter->second;
+void GameLogic::step(uint64_t tick) {
+	m_tick = tick;
+
+	// Every player sees the same time for this step
+	uint64_t now = get_ticks();
+
+	for (vector<Player*>::iterator iter = m_players.begin(); iter != m_players.end(); ++iter) {
+		Player* player = *iter;
 		
 		if (!player->is_grabbing_obstacle() && player->get_attach_joint() != NULL) {
 			player->set_attach_joint(NULL);
@@ -230,35 +260,47 @@ void GameLogic::step() {
 	// Remove any forces we applied for this timestep.
 	m_physics->ClearForces();
 
-	for (map<uint32_t, Player*>::iterator iter = m_players.begin(); iter != m_players.end(); ++iter) {
-		Player* player = iter->second;
-		player->update_physics();
-		
-		// Create any contact joints we need to have.		
-		while (m_joints_to_create.size() > 0) {
-			pair<b2Body*, b2JointDef*> this_joint_pair = m_joints_to_create.back();
-			create_contact_joint(this_joint_pair.first, this_joint_pair.second);
-			m_joints_to_create.pop_back();
+	// Create any contact joints we need to have, now that the world is unlocked.
+	// Welds are queued at the front, so they are created last and replace any other attach joint.
+	for (vector<JointRequest>::reverse_iterator it(m_joints_to_create.rbegin()); it != m_joints_to_create.rend(); ++it) {
+		if (it->weld) {
+			create_contact_joint(it->player_body, &it->weld_def);
+		} else {
+			create_contact_joint(it->player_body, &it->revolute_def);
 		}
+	}
+	m_joints_to_create.clear();
 
+	for (vector<Player*>::iterator iter = m_players.begin(); iter != m_players.end(); ++iter) {
+		Player* player = *iter;
+		player->update_physics();
+		
 		// Recharge energy if necessary.
-		if (player->is_frozen() || !player->is_damaged() || player->get_last_recharge_time() > get_ticks() - m_energy_recharge_rate) {
+		if (player->is_frozen() || !player->is_damaged() || player->get_last_recharge_time() > now - m_energy_recharge_rate) {
 			continue;
 		}
 		
-		if (m_recharge_continuously || player->get_last_damage_time() < get_ticks() - m_energy_recharge_delay) {
+		if (m_recharge_continuously || player->get_last_damage_time() < now - m_energy_recharge_delay) {
 			player->change_energy(m_energy_recharge);
 		}
 	}
+	
+	if (m_records_history) {
+		m_history.record(m_tick, m_players);
+	}
+	
+	refile_players();
 }
 
-uint64_t GameLogic::steps(uint64_t ticks) {
-	float nsteps = ticks/(1000.0f*PHYSICS_TIMESTEP);
-	float dummy;
-	for (int i = nsteps; i > 0; --i) {
-		step();
+void GameLogic::refile_players() {
+	m_grid.clear_players();
+	for (vector<Player*>::iterator iter = m_players.begin(); iter != m_players.end(); ++iter) {
+		m_grid.add_player(*iter);
 	}
-	return modf(nsteps, &dummy)*(1000.0f*PHYSICS_TIMESTEP);
+}
+
+void GameLogic::find_players_near(const Point& center, float radius, vector<Player*>& players) const {
+	m_grid.find_players(center, radius, players);
 }
 
 b2World* GameLogic::get_world() {
@@ -269,6 +311,11 @@ const b2World* GameLogic::get_world() const {
 	return m_physics;
 }
 
+void GameLogic::set_records_history(bool records_history) {
+	m_records_history = records_history;
+	m_history.clear();
+}
+
 bool GameLogic::attempt_jump(uint32_t player_id, float angle) {
 	Player* player = get_player(player_id);
 	
@@ -368,40 +415,40 @@ void GameLogic::set_param(const string& param_name, const string& param_value) {
 	}
 }
 
-void GameLogic::create_contact_joint(b2Body* body1, b2JointDef* joint_def) {
+void GameLogic::create_contact_joint(b2Body* body1, const b2JointDef* joint_def) {
 	PhysicsObject* userdata = static_cast<PhysicsObject*>(body1->GetUserData());
 
 	b2Joint* joint = m_physics->CreateJoint(joint_def);
 	Player* player = static_cast<Player*>(userdata);
 
 	player->set_attach_joint(joint);
-	
-	delete joint_def;
 }
 
 void GameLogic::create_grab(Player* player, b2Body* body2, b2WorldManifold* manifold, bool weld) {
 	b2Body* body1 = player->get_physics_body();
 	
 	if (!weld && !player->is_grabbing_obstacle() && !player->is_frozen()) {
-		b2RevoluteJointDef* joint_def = new b2RevoluteJointDef;
-		joint_def->Initialize(body1, body2, manifold->points[0]);
-		joint_def->collideConnected = true;
-		joint_def->maxMotorTorque = 5.0f;
-		joint_def->motorSpeed = 0.0f;
-		joint_def->enableMotor = false;
-
-		m_joints_to_create.push_back(pair<b2Body*, b2JointDef*>(body1, joint_def));
+		m_joints_to_create.push_back(JointRequest());
+		JointRequest& request = m_joints_to_create.back();
+		request.player_body = body1;
+		request.weld = false;
+		request.revolute_def.Initialize(body1, body2, manifold->points[0]);
+		request.revolute_def.collideConnected = true;
+		request.revolute_def.maxMotorTorque = 5.0f;
+		request.revolute_def.motorSpeed = 0.0f;
+		request.revolute_def.enableMotor = false;
 		player->set_is_grabbing_obstacle(true);
 		return;
 	}
 	
 	if (weld && !player->is_frozen() && (!player->is_grabbing_obstacle() || (player->get_attach_joint() != NULL &&
 					player->get_attach_joint()->GetType() != e_weldJoint))) {
-		b2WeldJointDef* joint_def = new b2WeldJointDef;
-		joint_def->Initialize(body1, body2, manifold->points[0]);
-		joint_def->collideConnected = true;
-
-		m_joints_to_create.insert(m_joints_to_create.begin(), pair<b2Body*, b2JointDef*>(body1, joint_def));
+		m_joints_to_create.insert(m_joints_to_create.begin(), JointRequest());
+		JointRequest& request = m_joints_to_create.front();
+		request.player_body = body1;
+		request.weld = true;
+		request.weld_def.Initialize(body1, body2, manifold->points[0]);
+		request.weld_def.collideConnected = true;
 		player->set_is_grabbing_obstacle(true);
 		return;
 	}
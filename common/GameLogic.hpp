@@ -32,6 +32,10 @@
 #include <utility>
 #include "common/MapObject.hpp"
 #include "common/Iterator.hpp"
+#include "common/PlayerHistory.hpp"
+#include "common/SpatialGrid.hpp"
+#include "common/StaticGeometry.hpp"
+#include "common/TickClock.hpp"
 
 class b2World;
 
@@ -41,13 +45,15 @@ namespace LM {
 
 	class GameLogic : public b2ContactListener {
 	
-	const static float PHYSICS_TIMESTEP = 1.0f / 60.0f;
+	const static float PHYSICS_TIMESTEP = 1.0f / TickClock::TICKS_PER_SECOND;
 	const static int VEL_ITERATIONS = 10;
 	const static int POS_ITERATIONS = 10;
 	const static float JUMP_ROTATION = 15.0f;
 	
 	private:
-		std::map<uint32_t, Player*> m_players;
+		std::vector<Player*> m_players; // Sorted by ID, so they can be looked up by binary search and walked in order
+		std::vector<Player*>::iterator find_player(uint32_t id);
+		std::vector<Player*>::const_iterator find_player(uint32_t id) const;
 		Map* m_map;
 		b2World* m_physics;
 		std::vector<Weapon*> m_weapons;
@@ -62,7 +68,27 @@ namespace LM {
 		bool m_round_in_progress;
 		uint64_t m_round_start_time;
 		
-		std::vector< std::pair<b2Body*, b2JointDef*> > m_joints_to_create;
+		// Grabs made during the step, which can only be turned into joints once the world is unlocked.
+		// The definitions are initialized when the grab is made, from the bodies' positions at the time of contact.
+		struct JointRequest {
+			b2Body* player_body;
+			bool weld;
+			b2WeldJointDef weld_def;	// If weld
+			b2RevoluteJointDef revolute_def;	// Otherwise
+		};
+		std::vector<JointRequest> m_joints_to_create; // Keeps its storage from step to step
+		
+		uint64_t m_tick; // The tick of the last step run (as numbered by the TickClock which schedules the steps)
+		
+		bool m_records_history;
+		PlayerHistory m_history;
+		
+		// The players (as of the last step) and interactive map objects, by where they are
+		SpatialGrid m_grid;
+		void refile_players();
+		
+		// The map's bodies, for ray casts (see RayCast)
+		StaticGeometry m_static_geometry;
 		
 		float get_dist(b2Vec2 point1, b2Vec2 point2);
 
@@ -75,8 +101,7 @@ namespace LM {
 		Player* remove_player(uint32_t id);
 		Player* get_player(const uint32_t id);
 		const Player* get_player(const uint32_t id) const;
-		Iterator<std::pair<uint32_t, Player*> > list_players();
-		ConstIterator<std::pair<uint32_t, Player*> > list_players() const;
+		const std::vector<Player*>& get_players() const { return m_players; } // Sorted by ID
 		int num_players() const;
 		
 		void add_weapon(size_t index, Weapon* weapon);
@@ -101,14 +126,27 @@ namespace LM {
 		bool round_in_progress() const;
 		uint64_t get_round_start_time() const; // Value is only valid if round_in_progress() is true.
 		
-		// Run the next step of the game logic.
-		void step();
-
-		// Run the number of steps for a period of time, and return the number of unused ticks
-		uint64_t steps(uint64_t ticks);
+		// Run the given tick of the game logic.
+		// Steps should be scheduled with a TickClock, so that each one stands for the same length of time,
+		// and given the clock's tick numbers, so that the ticks the clock drops are still counted.
+		void step(uint64_t tick);
+		// Run the tick after the last one (for simulations which aren't scheduled by a clock)
+		void step() { step(m_tick + 1); }
+		
+		uint64_t get_tick() const { return m_tick; }
+		static float get_step_length() { return PHYSICS_TIMESTEP; } // In seconds
 
 		b2World* get_world();
 		const b2World* get_world() const;
+		// Pass to RayCast along with the world, so rays skip Box2D for the map's bodies
+		const StaticGeometry* get_static_geometry() const { return &m_static_geometry; }
+		
+		// Find the players whose bounding circles come within radius of the given point, as of the last step
+		void find_players_near(const Point& center, float radius, std::vector<Player*>& players) const;
+		
+		// Keep the transforms of every player for the last few ticks, for lag-compensated hit checks
+		void set_records_history(bool records_history);
+		const PlayerHistory& get_history() const { return m_history; }
 		
 		// Attempt to jump off an obstacle
 		virtual bool attempt_jump(uint32_t player_id, float angle);
@@ -127,7 +165,7 @@ namespace LM {
 		virtual void set_param(const std::string& param_name, const std::string& param_value);
 		
 		// Physics helper methods
-		virtual void create_contact_joint(b2Body* body1, b2JointDef* joint_def);
+		virtual void create_contact_joint(b2Body* body1, const b2JointDef* joint_def);
 		virtual MapObject::CollisionResult collide(PhysicsObject* userdata1, PhysicsObject* userdata2, b2Contact* contact, bool isnew, bool disengage);
 		virtual void create_grab(Player* player, b2Body* body2, b2WorldManifold* manifold, bool weld);
 		
@@ -0,0 +1,115 @@
+/*
+ * common/MappedFile.cpp
+ *
+ * This file is part of Leges Motus, a networked, 2D shooter set in zero gravity.
+ * 
+ * Copyright 2009-2011 Andrew Ayer, Nathan Partlan, Jeffrey Pfau
+ * 
+ * Leges Motus is free and open source software.  You may redistribute it and/or
+ * modify it under the terms of version 2, or (at your option) version 3, of the
+ * GNU General Public License (GPL), as published by the Free Software Foundation.
+ * 
+ * Leges Motus is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.  See the full text of the GNU General Public License for
+ * further detail.
+ * 
+ * For a full copy of the GNU General Public License, please see the COPYING file
+ * in the root of the source code tree.  You may also retrieve a copy from
+ * <http://www.gnu.org/licenses/gpl-2.0.txt>, or request a copy by writing to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ * 02111-1307  USA
+ * 
+ */
+
+#include "MappedFile.hpp"
+#include "file.hpp"
+#include <string>
+
+#ifdef __WIN32
+#include <fstream>
+#else
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace LM;
+using namespace std;
+
+MappedFile::MappedFile() {
+	m_data = NULL;
+	m_length = 0;
+	m_is_mapped = false;
+}
+
+MappedFile::~MappedFile() {
+	close();
+}
+
+bool	MappedFile::open(const char* path) {
+	close();
+
+#ifdef __WIN32
+	ifstream	file(path, ios_base::in | ios_base::binary);
+	if (!file) {
+		return false;
+	}
+	file.seekg(0, ios_base::end);
+	size_t		length = file.tellg();
+	file.seekg(0, ios_base::beg);
+	char*		data = new char[length ? length : 1];
+	if (!file.read(data, length)) {
+		delete[] data;
+		return false;
+	}
+	m_data = data;
+	m_length = length;
+	m_is_mapped = false;
+#else
+	int		fd = ::open(path, O_RDONLY);
+	if (fd == -1) {
+		return false;
+	}
+
+	struct stat	st;
+	if (fstat(fd, &st) == -1 || st.st_size == 0) {
+		::close(fd);
+		return false;
+	}
+
+	void*		data = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	::close(fd); // The mapping stays valid
+	if (data == MAP_FAILED) {
+		return false;
+	}
+	m_data = static_cast<const char*>(data);
+	m_length = st.st_size;
+	m_is_mapped = true;
+#endif
+	return true;
+}
+
+bool	MappedFile::open_resource(const char* filename) {
+	return open((string(user_dir()) + filename).c_str()) || open((string(resource_dir()) + filename).c_str());
+}
+
+void	MappedFile::close() {
+	if (m_data == NULL) {
+		return;
+	}
+
+#ifndef __WIN32
+	if (m_is_mapped) {
+		munmap(const_cast<char*>(m_data), m_length);
+	}
+#endif
+	if (!m_is_mapped) {
+		delete[] m_data;
+	}
+	m_data = NULL;
+	m_length = 0;
+	m_is_mapped = false;
+}
@@ -0,0 +1,66 @@
+/*
+ * common/MappedFile.hpp
+ *
+ * This file is part of Leges Motus, a networked, 2D shooter set in zero gravity.
+ * 
+ * Copyright 2009-2011 Andrew Ayer, Nathan Partlan, Jeffrey Pfau
+ * 
+ * Leges Motus is free and open source software.  You may redistribute it and/or
+ * modify it under the terms of version 2, or (at your option) version 3, of the
+ * GNU General Public License (GPL), as published by the Free Software Foundation.
+ * 
+ * Leges Motus is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.  See the full text of the GNU General Public License for
+ * further detail.
+ * 
+ * For a full copy of the GNU General Public License, please see the COPYING file
+ * in the root of the source code tree.  You may also retrieve a copy from
+ * <http://www.gnu.org/licenses/gpl-2.0.txt>, or request a copy by writing to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ * 02111-1307  USA
+ * 
+ */
+
+#ifndef LM_COMMON_MAPPEDFILE_HPP
+#define LM_COMMON_MAPPEDFILE_HPP
+
+#include <stddef.h>
+
+namespace LM {
+	/*
+	 * Read-only access to the whole contents of a file.
+	 *
+	 * Where possible, the file is memory-mapped, so it's only read in as its pages are used, and
+	 * every process which maps the same file shares a single copy of it in memory.  (Elsewhere, the
+	 * file is simply read into memory.)  The file must not be modified while it's open - replace it
+	 * by renaming a new file over it instead.
+	 */
+	class MappedFile {
+	private:
+		const char*	m_data;
+		size_t		m_length;
+		bool		m_is_mapped;	// Otherwise, m_data was allocated with new[]
+
+		// Not copyable
+		MappedFile(const MappedFile&);
+		MappedFile&	operator=(const MappedFile&);
+
+	public:
+		MappedFile();
+		~MappedFile();
+
+		// Returns false if the file couldn't be opened
+		bool		open(const char* path);
+		// Looks in the user's directory, then the resource directory, like open_resource() (see file.hpp)
+		bool		open_resource(const char* filename);
+		void		close();
+
+		bool		is_open() const { return m_data != NULL; }
+		// The data is at least 8-byte aligned
+		const char*	get_data() const { return m_data; }
+		size_t		get_length() const { return m_length; }
+	};
+}
+
+#endif
@@ -1,6 +1,8 @@
 // Auto-generated by parse_idl.py
 
 #include "Packet.hpp"
+#include "BinaryWriter.hpp"
+#include "BinaryReader.hpp"
 #include <cstring>
 
 using namespace LM;
@@ -16,6 +18,16 @@ static void unmarshal_ACK(PacketReader& r, Packet* p) {
 	r >> p->ack.sequence_no;
 }
 
+static void marshal_binary_ACK(BinaryWriter& w, Packet* p) {
+	w.put_varint(p->ack.packet_type);
+	w.put_varint(p->ack.sequence_no);
+}
+
+static void unmarshal_binary_ACK(BinaryReader& r, Packet* p) {
+	p->ack.packet_type = r.get_varint();
+	p->ack.sequence_no = r.get_varint();
+}
+
 static void marshal_PLAYER_UPDATE(PacketWriter& w, Packet* p) {
 	w << p->player_update.player_id;
 	w << p->player_update.x;
@@ -42,6 +54,32 @@ static void unmarshal_PLAYER_UPDATE(PacketReader& r, Packet* p) {
 	r >> p->player_update.flags;
 }
 
+static void marshal_binary_PLAYER_UPDATE(BinaryWriter& w, Packet* p) {
+	w.put_varint(p->player_update.player_id);
+	w.put_float(p->player_update.x);
+	w.put_float(p->player_update.y);
+	w.put_float(p->player_update.x_vel);
+	w.put_float(p->player_update.y_vel);
+	w.put_float(p->player_update.rotation);
+	w.put_signed_varint(p->player_update.energy);
+	w.put_float(p->player_update.gun_rotation);
+	w.put_varint(p->player_update.current_weapon_id);
+	w.put_string(*p->player_update.flags);
+}
+
+static void unmarshal_binary_PLAYER_UPDATE(BinaryReader& r, Packet* p) {
+	p->player_update.player_id = r.get_varint();
+	p->player_update.x = r.get_float();
+	p->player_update.y = r.get_float();
+	p->player_update.x_vel = r.get_float();
+	p->player_update.y_vel = r.get_float();
+	p->player_update.rotation = r.get_float();
+	p->player_update.energy = r.get_signed_varint();
+	p->player_update.gun_rotation = r.get_float();
+	p->player_update.current_weapon_id = r.get_varint();
+	p->player_update.flags = r.get_string();
+}
+
 static void marshal_WEAPON_DISCHARGED(PacketWriter& w, Packet* p) {
 	w << p->weapon_discharged.player_id;
 	w << p->weapon_discharged.weapon_id;
@@ -50,6 +88,7 @@ static void marshal_WEAPON_DISCHARGED(PacketWriter& w, Packet* p) {
 	w << p->weapon_discharged.start_y;
 	w << p->weapon_discharged.end_x;
 	w << p->weapon_discharged.end_y;
+	w << p->weapon_discharged.input_sequence;
 }
 
 static void unmarshal_WEAPON_DISCHARGED(PacketReader& r, Packet* p) {
@@ -60,6 +99,29 @@ static void unmarshal_WEAPON_DISCHARGED(PacketReader& r, Packet* p) {
 	r >> p->weapon_discharged.start_y;
 	r >> p->weapon_discharged.end_x;
 	r >> p->weapon_discharged.end_y;
+	r >> p->weapon_discharged.input_sequence;
+}
+
+static void marshal_binary_WEAPON_DISCHARGED(BinaryWriter& w, Packet* p) {
+	w.put_varint(p->weapon_discharged.player_id);
+	w.put_varint(p->weapon_discharged.weapon_id);
+	w.put_float(p->weapon_discharged.direction);
+	w.put_float(p->weapon_discharged.start_x);
+	w.put_float(p->weapon_discharged.start_y);
+	w.put_float(p->weapon_discharged.end_x);
+	w.put_float(p->weapon_discharged.end_y);
+	w.put_varint(p->weapon_discharged.input_sequence);
+}
+
+static void unmarshal_binary_WEAPON_DISCHARGED(BinaryReader& r, Packet* p) {
+	p->weapon_discharged.player_id = r.get_varint();
+	p->weapon_discharged.weapon_id = r.get_varint();
+	p->weapon_discharged.direction = r.get_float();
+	p->weapon_discharged.start_x = r.get_float();
+	p->weapon_discharged.start_y = r.get_float();
+	p->weapon_discharged.end_x = r.get_float();
+	p->weapon_discharged.end_y = r.get_float();
+	p->weapon_discharged.input_sequence = r.get_varint();
 }
 
 static void marshal_PLAYER_HIT(PacketWriter& w, Packet* p) {
@@ -78,6 +140,22 @@ static void unmarshal_PLAYER_HIT(PacketReader& r, Packet* p) {
 	r >> p->player_hit.extradata;
 }
 
+static void marshal_binary_PLAYER_HIT(BinaryWriter& w, Packet* p) {
+	w.put_varint(p->player_hit.shooter_id);
+	w.put_varint(p->player_hit.weapon_id);
+	w.put_varint(p->player_hit.shot_player_id);
+	w.put_bool(p->player_hit.has_effect);
+	w.put_string(*p->player_hit.extradata);
+}
+
+static void unmarshal_binary_PLAYER_HIT(BinaryReader& r, Packet* p) {
+	p->player_hit.shooter_id = r.get_varint();
+	p->player_hit.weapon_id = r.get_varint();
+	p->player_hit.shot_player_id = r.get_varint();
+	p->player_hit.has_effect = r.get_bool();
+	p->player_hit.extradata = r.get_string();
+}
+
 static void marshal_MESSAGE(PacketWriter& w, Packet* p) {
 	w << p->message.sender_id;
 	w << p->message.recipient;
@@ -90,6 +168,18 @@ static void unmarshal_MESSAGE(PacketReader& r, Packet* p) {
 	r >> p->message.message_text;
 }
 
+static void marshal_binary_MESSAGE(BinaryWriter& w, Packet* p) {
+	w.put_varint(p->message.sender_id);
+	w.put_string(*p->message.recipient);
+	w.put_string(*p->message.message_text);
+}
+
+static void unmarshal_binary_MESSAGE(BinaryReader& r, Packet* p) {
+	p->message.sender_id = r.get_varint();
+	p->message.recipient = r.get_string();
+	p->message.message_text = r.get_string();
+}
+
 static void marshal_NEW_ROUND(PacketWriter& w, Packet* p) {
 	w << p->new_round.map_name;
 	w << p->new_round.map_revision;
@@ -108,6 +198,24 @@ static void unmarshal_NEW_ROUND(PacketReader& r, Packet* p) {
 	r >> p->new_round.time_until_start;
 }
 
+static void marshal_binary_NEW_ROUND(BinaryWriter& w, Packet* p) {
+	w.put_string(*p->new_round.map_name);
+	w.put_signed_varint(p->new_round.map_revision);
+	w.put_signed_varint(p->new_round.map_width);
+	w.put_signed_varint(p->new_round.map_height);
+	w.put_bool(p->new_round.game_started);
+	w.put_varint(p->new_round.time_until_start);
+}
+
+static void unmarshal_binary_NEW_ROUND(BinaryReader& r, Packet* p) {
+	p->new_round.map_name = r.get_string();
+	p->new_round.map_revision = r.get_signed_varint();
+	p->new_round.map_width = r.get_signed_varint();
+	p->new_round.map_height = r.get_signed_varint();
+	p->new_round.game_started = r.get_bool();
+	p->new_round.time_until_start = r.get_varint();
+}
+
 static void marshal_ROUND_OVER(PacketWriter& w, Packet* p) {
 	w << p->round_over.winning_team;
 	w << p->round_over.team_a_score;
@@ -120,6 +228,18 @@ static void unmarshal_ROUND_OVER(PacketReader& r, Packet* p) {
 	r >> p->round_over.team_b_score;
 }
 
+static void marshal_binary_ROUND_OVER(BinaryWriter& w, Packet* p) {
+	w.put_char(p->round_over.winning_team);
+	w.put_signed_varint(p->round_over.team_a_score);
+	w.put_signed_varint(p->round_over.team_b_score);
+}
+
+static void unmarshal_binary_ROUND_OVER(BinaryReader& r, Packet* p) {
+	p->round_over.winning_team = r.get_char();
+	p->round_over.team_a_score = r.get_signed_varint();
+	p->round_over.team_b_score = r.get_signed_varint();
+}
+
 static void marshal_SCORE_UPDATE(PacketWriter& w, Packet* p) {
 	w << p->score_update.subject;
 	w << p->score_update.score;
@@ -130,6 +250,16 @@ static void unmarshal_SCORE_UPDATE(PacketReader& r, Packet* p) {
 	r >> p->score_update.score;
 }
 
+static void marshal_binary_SCORE_UPDATE(BinaryWriter& w, Packet* p) {
+	w.put_string(*p->score_update.subject);
+	w.put_signed_varint(p->score_update.score);
+}
+
+static void unmarshal_binary_SCORE_UPDATE(BinaryReader& r, Packet* p) {
+	p->score_update.subject = r.get_string();
+	p->score_update.score = r.get_signed_varint();
+}
+
 static void marshal_WELCOME(PacketWriter& w, Packet* p) {
 	w << p->welcome.server_version;
 	w << p->welcome.player_id;
@@ -144,6 +274,20 @@ static void unmarshal_WELCOME(PacketReader& r, Packet* p) {
 	r >> p->welcome.team;
 }
 
+static void marshal_binary_WELCOME(BinaryWriter& w, Packet* p) {
+	w.put_signed_varint(p->welcome.server_version);
+	w.put_signed_varint(p->welcome.player_id);
+	w.put_string(*p->welcome.player_name);
+	w.put_char(p->welcome.team);
+}
+
+static void unmarshal_binary_WELCOME(BinaryReader& r, Packet* p) {
+	p->welcome.server_version = r.get_signed_varint();
+	p->welcome.player_id = r.get_signed_varint();
+	p->welcome.player_name = r.get_string();
+	p->welcome.team = r.get_char();
+}
+
 static void marshal_ANNOUNCE(PacketWriter& w, Packet* p) {
 	w << p->announce.player_id;
 	w << p->announce.player_name;
@@ -156,6 +300,18 @@ static void unmarshal_ANNOUNCE(PacketReader& r, Packet* p) {
 	r >> p->announce.team;
 }
 
+static void marshal_binary_ANNOUNCE(BinaryWriter& w, Packet* p) {
+	w.put_varint(p->announce.player_id);
+	w.put_string(*p->announce.player_name);
+	w.put_char(p->announce.team);
+}
+
+static void unmarshal_binary_ANNOUNCE(BinaryReader& r, Packet* p) {
+	p->announce.player_id = r.get_varint();
+	p->announce.player_name = r.get_string();
+	p->announce.team = r.get_char();
+}
+
 static void marshal_GATE_UPDATE(PacketWriter& w, Packet* p) {
 	w << p->gate_update.acting_player_id;
 	w << p->gate_update.team;
@@ -174,11 +330,30 @@ static void unmarshal_GATE_UPDATE(PacketReader& r, Packet* p) {
 	r >> p->gate_update.sequence_no;
 }
 
+static void marshal_binary_GATE_UPDATE(BinaryWriter& w, Packet* p) {
+	w.put_varint(p->gate_update.acting_player_id);
+	w.put_char(p->gate_update.team);
+	w.put_float(p->gate_update.progress);
+	w.put_signed_varint(p->gate_update.change_in_players);
+	w.put_varint(p->gate_update.new_nbr_players);
+	w.put_varint(p->gate_update.sequence_no);
+}
+
+static void unmarshal_binary_GATE_UPDATE(BinaryReader& r, Packet* p) {
+	p->gate_update.acting_player_id = r.get_varint();
+	p->gate_update.team = r.get_char();
+	p->gate_update.progress = r.get_float();
+	p->gate_update.change_in_players = r.get_signed_varint();
+	p->gate_update.new_nbr_players = r.get_varint();
+	p->gate_update.sequence_no = r.get_varint();
+}
+
 static void marshal_JOIN(PacketWriter& w, Packet* p) {
 	w << p->join.protocol_number;
 	w << p->join.compat_version;
 	w << p->join.name;
 	w << p->join.team;
+	w << p->join.interpolation_delay;
 }
 
 static void unmarshal_JOIN(PacketReader& r, Packet* p) {
@@ -186,6 +361,7 @@ static void unmarshal_JOIN(PacketReader& r, Packet* p) {
 	r >> p->join.compat_version;
 	r >> p->join.name;
 	r >> p->join.team;
+	r >> p->join.interpolation_delay;
 }
 
 static void marshal_INFO_server(PacketWriter& w, Packet* p) {
@@ -244,6 +420,16 @@ static void unmarshal_LEAVE(PacketReader& r, Packet* p) {
 	r >> p->leave.message;
 }
 
+static void marshal_binary_LEAVE(BinaryWriter& w, Packet* p) {
+	w.put_varint(p->leave.player_id);
+	w.put_string(*p->leave.message);
+}
+
+static void unmarshal_binary_LEAVE(BinaryReader& r, Packet* p) {
+	p->leave.player_id = r.get_varint();
+	p->leave.message = r.get_string();
+}
+
 static void marshal_PLAYER_ANIMATION(PacketWriter& w, Packet* p) {
 	w << p->player_animation.player_id;
 	w << p->player_animation.sprite_list;
@@ -258,6 +444,20 @@ static void unmarshal_PLAYER_ANIMATION(PacketReader& r, Packet* p) {
 	r >> p->player_animation.value;
 }
 
+static void marshal_binary_PLAYER_ANIMATION(BinaryWriter& w, Packet* p) {
+	w.put_varint(p->player_animation.player_id);
+	w.put_string(*p->player_animation.sprite_list);
+	w.put_string(*p->player_animation.field);
+	w.put_signed_varint(p->player_animation.value);
+}
+
+static void unmarshal_binary_PLAYER_ANIMATION(BinaryReader& r, Packet* p) {
+	p->player_animation.player_id = r.get_varint();
+	p->player_animation.sprite_list = r.get_string();
+	p->player_animation.field = r.get_string();
+	p->player_animation.value = r.get_signed_varint();
+}
+
 static void marshal_REQUEST_DENIED(PacketWriter& w, Packet* p) {
 	w << p->request_denied.packet_type;
 	w << p->request_denied.message;
@@ -268,6 +468,16 @@ static void unmarshal_REQUEST_DENIED(PacketReader& r, Packet* p) {
 	r >> p->request_denied.message;
 }
 
+static void marshal_binary_REQUEST_DENIED(BinaryWriter& w, Packet* p) {
+	w.put_signed_varint(p->request_denied.packet_type);
+	w.put_string(*p->request_denied.message);
+}
+
+static void unmarshal_binary_REQUEST_DENIED(BinaryReader& r, Packet* p) {
+	p->request_denied.packet_type = r.get_signed_varint();
+	p->request_denied.message = r.get_string();
+}
+
 static void marshal_NAME_CHANGE(PacketWriter& w, Packet* p) {
 	w << p->name_change.player_id;
 	w << p->name_change.name;
@@ -278,6 +488,16 @@ static void unmarshal_NAME_CHANGE(PacketReader& r, Packet* p) {
 	r >> p->name_change.name;
 }
 
+static void marshal_binary_NAME_CHANGE(BinaryWriter& w, Packet* p) {
+	w.put_varint(p->name_change.player_id);
+	w.put_string(*p->name_change.name);
+}
+
+static void unmarshal_binary_NAME_CHANGE(BinaryReader& r, Packet* p) {
+	p->name_change.player_id = r.get_varint();
+	p->name_change.name = r.get_string();
+}
+
 static void marshal_TEAM_CHANGE(PacketWriter& w, Packet* p) {
 	w << p->team_change.player_id;
 	w << p->team_change.name;
@@ -288,6 +508,16 @@ static void unmarshal_TEAM_CHANGE(PacketReader& r, Packet* p) {
 	r >> p->team_change.name;
 }
 
+static void marshal_binary_TEAM_CHANGE(BinaryWriter& w, Packet* p) {
+	w.put_varint(p->team_change.player_id);
+	w.put_char(p->team_change.name);
+}
+
+static void unmarshal_binary_TEAM_CHANGE(BinaryReader& r, Packet* p) {
+	p->team_change.player_id = r.get_varint();
+	p->team_change.name = r.get_char();
+}
+
 static void marshal_REGISTER_SERVER_server(PacketWriter& w, Packet* p) {
 	w << p->register_server_server.server_protocol_version;
 	w << p->register_server_server.server_version;
@@ -310,6 +540,16 @@ static void unmarshal_REGISTER_SERVER_metaserver(PacketReader& r, Packet* p) {
 	r >> p->register_server_metaserver.metaserver_contact_frequency;
 }
 
+static void marshal_binary_REGISTER_SERVER_metaserver(BinaryWriter& w, Packet* p) {
+	w.put_varint(p->register_server_metaserver.metaserver_token);
+	w.put_varint(p->register_server_metaserver.metaserver_contact_frequency);
+}
+
+static void unmarshal_binary_REGISTER_SERVER_metaserver(BinaryReader& r, Packet* p) {
+	p->register_server_metaserver.metaserver_token = r.get_varint();
+	p->register_server_metaserver.metaserver_contact_frequency = r.get_varint();
+}
+
 static void marshal_UNREGISTER_SERVER(PacketWriter& w, Packet* p) {
 	w << p->unregister_server.server_listen_address;
 	w << p->unregister_server.metaserver_token;
@@ -328,6 +568,14 @@ static void unmarshal_UPGRADE_AVAILABLE(PacketReader& r, Packet* p) {
 	r >> p->upgrade_available.latest_version;
 }
 
+static void marshal_binary_UPGRADE_AVAILABLE(BinaryWriter& w, Packet* p) {
+	w.put_string(*p->upgrade_available.latest_version);
+}
+
+static void unmarshal_binary_UPGRADE_AVAILABLE(BinaryReader& r, Packet* p) {
+	p->upgrade_available.latest_version = r.get_string();
+}
+
 static void marshal_MAP_INFO(PacketWriter& w, Packet* p) {
 	w << p->map_info.transmission_id;
 	w << p->map_info.map;
@@ -348,6 +596,14 @@ static void unmarshal_MAP_OBJECT(PacketReader& r, Packet* p) {
 	r >> p->map_object.transmission_id;
 }
 
+static void marshal_binary_MAP_OBJECT(BinaryWriter& w, Packet* p) {
+	w.put_varint(p->map_object.transmission_id);
+}
+
+static void unmarshal_binary_MAP_OBJECT(BinaryReader& r, Packet* p) {
+	p->map_object.transmission_id = r.get_varint();
+}
+
 static void marshal_GAME_PARAM(PacketWriter& w, Packet* p) {
 	w << p->game_param.param_name;
 	w << p->game_param.param_value;
@@ -358,6 +614,16 @@ static void unmarshal_GAME_PARAM(PacketReader& r, Packet* p) {
 	r >> p->game_param.param_value;
 }
 
+static void marshal_binary_GAME_PARAM(BinaryWriter& w, Packet* p) {
+	w.put_string(*p->game_param.param_name);
+	w.put_string(*p->game_param.param_value);
+}
+
+static void unmarshal_binary_GAME_PARAM(BinaryReader& r, Packet* p) {
+	p->game_param.param_name = r.get_string();
+	p->game_param.param_value = r.get_string();
+}
+
 static void marshal_HOLE_PUNCH(PacketWriter& w, Packet* p) {
 	w << p->hole_punch.client_address;
 	w << p->hole_punch.scan_id;
@@ -382,6 +648,20 @@ static void unmarshal_PLAYER_DIED(PacketReader& r, Packet* p) {
 	r >> p->player_died.killer_type;
 }
 
+static void marshal_binary_PLAYER_DIED(BinaryWriter& w, Packet* p) {
+	w.put_varint(p->player_died.killed_player_id);
+	w.put_varint(p->player_died.killer_id);
+	w.put_varint(p->player_died.freeze_time);
+	w.put_signed_varint(p->player_died.killer_type);
+}
+
+static void unmarshal_binary_PLAYER_DIED(BinaryReader& r, Packet* p) {
+	p->player_died.killed_player_id = r.get_varint();
+	p->player_died.killer_id = r.get_varint();
+	p->player_died.freeze_time = r.get_varint();
+	p->player_died.killer_type = r.get_signed_varint();
+}
+
 static void marshal_WEAPON_INFO(PacketWriter& w, Packet* p) {
 	w << p->weapon_info.index;
 	w << p->weapon_info.weapon_data;
@@ -400,6 +680,14 @@ static void unmarshal_ROUND_START(PacketReader& r, Packet* p) {
 	r >> p->round_start.time_left_in_round;
 }
 
+static void marshal_binary_ROUND_START(BinaryWriter& w, Packet* p) {
+	w.put_varint(p->round_start.time_left_in_round);
+}
+
+static void unmarshal_binary_ROUND_START(BinaryReader& r, Packet* p) {
+	p->round_start.time_left_in_round = r.get_varint();
+}
+
 static void marshal_SPAWN(PacketWriter& w, Packet* p) {
 	w << p->spawn.position;
 	w << p->spawn.velocity;
@@ -416,26 +704,112 @@ static void unmarshal_SPAWN(PacketReader& r, Packet* p) {
 	r >> p->spawn.freeze_time;
 }
 
+static void marshal_binary_SPAWN(BinaryWriter& w, Packet* p) {
+	w.put_point(*p->spawn.position);
+	w.put_point(*p->spawn.velocity);
+	w.put_bool(p->spawn.is_grabbing_obstacle);
+	w.put_bool(p->spawn.is_alive);
+	w.put_varint(p->spawn.freeze_time);
+}
+
+static void unmarshal_binary_SPAWN(BinaryReader& r, Packet* p) {
+	p->spawn.position = r.get_point();
+	p->spawn.velocity = r.get_point();
+	p->spawn.is_grabbing_obstacle = r.get_bool();
+	p->spawn.is_alive = r.get_bool();
+	p->spawn.freeze_time = r.get_varint();
+}
+
 static void marshal_PLAYER_JUMPED(PacketWriter& w, Packet* p) {
 	w << p->player_jumped.player_id;
 	w << p->player_jumped.direction;
+	w << p->player_jumped.input_sequence;
 }
 
 static void unmarshal_PLAYER_JUMPED(PacketReader& r, Packet* p) {
 	r >> p->player_jumped.player_id;
 	r >> p->player_jumped.direction;
+	r >> p->player_jumped.input_sequence;
+}
+
+static void marshal_binary_PLAYER_JUMPED(BinaryWriter& w, Packet* p) {
+	w.put_varint(p->player_jumped.player_id);
+	w.put_float(p->player_jumped.direction);
+	w.put_varint(p->player_jumped.input_sequence);
+}
+
+static void unmarshal_binary_PLAYER_JUMPED(BinaryReader& r, Packet* p) {
+	p->player_jumped.player_id = r.get_varint();
+	p->player_jumped.direction = r.get_float();
+	p->player_jumped.input_sequence = r.get_varint();
 }
 
 static void marshal_PLAYER_TO_SERVER_UPDATE(PacketWriter& w, Packet* p) {
 	w << p->player_to_server_update.player_id;
 	w << p->player_to_server_update.gun_rotation;
 	w << p->player_to_server_update.current_weapon_id;
+	w << p->player_to_server_update.input_sequence;
 }
 
 static void unmarshal_PLAYER_TO_SERVER_UPDATE(PacketReader& r, Packet* p) {
 	r >> p->player_to_server_update.player_id;
 	r >> p->player_to_server_update.gun_rotation;
 	r >> p->player_to_server_update.current_weapon_id;
+	r >> p->player_to_server_update.input_sequence;
+}
+
+static void marshal_binary_PLAYER_TO_SERVER_UPDATE(BinaryWriter& w, Packet* p) {
+	w.put_varint(p->player_to_server_update.player_id);
+	w.put_float(p->player_to_server_update.gun_rotation);
+	w.put_varint(p->player_to_server_update.current_weapon_id);
+	w.put_varint(p->player_to_server_update.input_sequence);
+}
+
+static void unmarshal_binary_PLAYER_TO_SERVER_UPDATE(BinaryReader& r, Packet* p) {
+	p->player_to_server_update.player_id = r.get_varint();
+	p->player_to_server_update.gun_rotation = r.get_float();
+	p->player_to_server_update.current_weapon_id = r.get_varint();
+	p->player_to_server_update.input_sequence = r.get_varint();
+}
+
+static void marshal_WORLD_SNAPSHOT(PacketWriter& w, Packet* p) {
+	w << p->world_snapshot.snapshot_id;
+	w << p->world_snapshot.baseline_id;
+}
+
+static void unmarshal_WORLD_SNAPSHOT(PacketReader& r, Packet* p) {
+	r >> p->world_snapshot.snapshot_id;
+	r >> p->world_snapshot.baseline_id;
+}
+
+static void marshal_binary_WORLD_SNAPSHOT(BinaryWriter& w, Packet* p) {
+	w.put_varint(p->world_snapshot.snapshot_id);
+	w.put_varint(p->world_snapshot.baseline_id);
+}
+
+static void unmarshal_binary_WORLD_SNAPSHOT(BinaryReader& r, Packet* p) {
+	p->world_snapshot.snapshot_id = r.get_varint();
+	p->world_snapshot.baseline_id = r.get_varint();
+}
+
+static void marshal_SNAPSHOT_ACK(PacketWriter& w, Packet* p) {
+	w << p->snapshot_ack.player_id;
+	w << p->snapshot_ack.snapshot_id;
+}
+
+static void unmarshal_SNAPSHOT_ACK(PacketReader& r, Packet* p) {
+	r >> p->snapshot_ack.player_id;
+	r >> p->snapshot_ack.snapshot_id;
+}
+
+static void marshal_binary_SNAPSHOT_ACK(BinaryWriter& w, Packet* p) {
+	w.put_varint(p->snapshot_ack.player_id);
+	w.put_varint(p->snapshot_ack.snapshot_id);
+}
+
+static void unmarshal_binary_SNAPSHOT_ACK(BinaryReader& r, Packet* p) {
+	p->snapshot_ack.player_id = r.get_varint();
+	p->snapshot_ack.snapshot_id = r.get_varint();
 }
 
 Packet::Packet() {
@@ -480,6 +854,7 @@ Packet::Packet(const Packet& other) {
 		weapon_discharged.start_y = other.weapon_discharged.start_y;
 		weapon_discharged.end_x = other.weapon_discharged.end_x;
 		weapon_discharged.end_y = other.weapon_discharged.end_y;
+		weapon_discharged.input_sequence = other.weapon_discharged.input_sequence;
 		break;
 
 	case PLAYER_HIT_PACKET:
@@ -543,6 +918,7 @@ Packet::Packet(const Packet& other) {
 		join.compat_version = *other.join.compat_version;
 		join.name = *other.join.name;
 		join.team = other.join.team;
+		join.interpolation_delay = other.join.interpolation_delay;
 		break;
 
 	case INFO_server_PACKET:
@@ -662,12 +1038,24 @@ Packet::Packet(const Packet& other) {
 	case PLAYER_JUMPED_PACKET:
 		player_jumped.player_id = other.player_jumped.player_id;
 		player_jumped.direction = other.player_jumped.direction;
+		player_jumped.input_sequence = other.player_jumped.input_sequence;
 		break;
 
 	case PLAYER_TO_SERVER_UPDATE_PACKET:
 		player_to_server_update.player_id = other.player_to_server_update.player_id;
 		player_to_server_update.gun_rotation = other.player_to_server_update.gun_rotation;
 		player_to_server_update.current_weapon_id = other.player_to_server_update.current_weapon_id;
+		player_to_server_update.input_sequence = other.player_to_server_update.input_sequence;
+		break;
+
+	case WORLD_SNAPSHOT_PACKET:
+		world_snapshot.snapshot_id = other.world_snapshot.snapshot_id;
+		world_snapshot.baseline_id = other.world_snapshot.baseline_id;
+		break;
+
+	case SNAPSHOT_ACK_PACKET:
+		snapshot_ack.player_id = other.snapshot_ack.player_id;
+		snapshot_ack.snapshot_id = other.snapshot_ack.snapshot_id;
 		break;
 
 	}
@@ -842,6 +1230,12 @@ void Packet::free() {
 	case PLAYER_TO_SERVER_UPDATE_PACKET:
 		break;
 
+	case WORLD_SNAPSHOT_PACKET:
+		break;
+
+	case SNAPSHOT_ACK_PACKET:
+		break;
+
 	}
 }
 
@@ -851,6 +1245,11 @@ void Packet::clear() {
 }
 void Packet::marshal() {
 	PacketWriter w(type, header);
+	marshal(w);
+	w.fill_packet(raw);
+}
+
+void Packet::marshal(PacketWriter& w) {
 	switch(type) {
 	case ACK_PACKET:
 		marshal_ACK(w, this);
@@ -984,15 +1383,144 @@ void Packet::marshal() {
 		marshal_PLAYER_TO_SERVER_UPDATE(w, this);
 		break;
 
+	case WORLD_SNAPSHOT_PACKET:
+		marshal_WORLD_SNAPSHOT(w, this);
+		break;
+
+	case SNAPSHOT_ACK_PACKET:
+		marshal_SNAPSHOT_ACK(w, this);
+		break;
+
 	default:
 		break;
 	}
+}
+
+bool Packet::marshal_binary() {
+	BinaryWriter w(raw);
+	w.put_header(PacketHeader(type, header.sequence_no, header.connection_id));
+	switch(type) {
+	case ACK_PACKET:
+		marshal_binary_ACK(w, this);
+		break;
+
+	case PLAYER_UPDATE_PACKET:
+		marshal_binary_PLAYER_UPDATE(w, this);
+		break;
+
+	case WEAPON_DISCHARGED_PACKET:
+		marshal_binary_WEAPON_DISCHARGED(w, this);
+		break;
+
+	case PLAYER_HIT_PACKET:
+		marshal_binary_PLAYER_HIT(w, this);
+		break;
+
+	case MESSAGE_PACKET:
+		marshal_binary_MESSAGE(w, this);
+		break;
+
+	case NEW_ROUND_PACKET:
+		marshal_binary_NEW_ROUND(w, this);
+		break;
+
+	case ROUND_OVER_PACKET:
+		marshal_binary_ROUND_OVER(w, this);
+		break;
+
+	case SCORE_UPDATE_PACKET:
+		marshal_binary_SCORE_UPDATE(w, this);
+		break;
+
+	case WELCOME_PACKET:
+		marshal_binary_WELCOME(w, this);
+		break;
+
+	case ANNOUNCE_PACKET:
+		marshal_binary_ANNOUNCE(w, this);
+		break;
+
+	case GATE_UPDATE_PACKET:
+		marshal_binary_GATE_UPDATE(w, this);
+		break;
+
+	case LEAVE_PACKET:
+		marshal_binary_LEAVE(w, this);
+		break;
+
+	case PLAYER_ANIMATION_PACKET:
+		marshal_binary_PLAYER_ANIMATION(w, this);
+		break;
+
+	case REQUEST_DENIED_PACKET:
+		marshal_binary_REQUEST_DENIED(w, this);
+		break;
+
+	case NAME_CHANGE_PACKET:
+		marshal_binary_NAME_CHANGE(w, this);
+		break;
+
+	case TEAM_CHANGE_PACKET:
+		marshal_binary_TEAM_CHANGE(w, this);
+		break;
+
+	case REGISTER_SERVER_metaserver_PACKET:
+		marshal_binary_REGISTER_SERVER_metaserver(w, this);
+		break;
+
+	case UPGRADE_AVAILABLE_PACKET:
+		marshal_binary_UPGRADE_AVAILABLE(w, this);
+		break;
+
+	case MAP_OBJECT_PACKET:
+		marshal_binary_MAP_OBJECT(w, this);
+		break;
+
+	case GAME_PARAM_PACKET:
+		marshal_binary_GAME_PARAM(w, this);
+		break;
+
+	case PLAYER_DIED_PACKET:
+		marshal_binary_PLAYER_DIED(w, this);
+		break;
+
+	case ROUND_START_PACKET:
+		marshal_binary_ROUND_START(w, this);
+		break;
+
+	case SPAWN_PACKET:
+		marshal_binary_SPAWN(w, this);
+		break;
+
+	case PLAYER_JUMPED_PACKET:
+		marshal_binary_PLAYER_JUMPED(w, this);
+		break;
+
+	case PLAYER_TO_SERVER_UPDATE_PACKET:
+		marshal_binary_PLAYER_TO_SERVER_UPDATE(w, this);
+		break;
+
+	case WORLD_SNAPSHOT_PACKET:
+		marshal_binary_WORLD_SNAPSHOT(w, this);
+		break;
+
+	case SNAPSHOT_ACK_PACKET:
+		marshal_binary_SNAPSHOT_ACK(w, this);
+		break;
+
+	default:
+		return false;
+	}
 
-	raw.fill(w.get_header().make_string());
-	raw.append(w.packet_data());
+	return !w.has_overflowed();
 }
 
 void Packet::unmarshal() {
+	if (BinaryReader::is_binary(raw)) {
+		unmarshal_binary();
+		return;
+	}
+
 	PacketReader r(raw);
 	type = (PacketEnum) r.packet_type();
 	header = r.get_header();
@@ -1129,6 +1657,131 @@ void Packet::unmarshal() {
 		unmarshal_PLAYER_TO_SERVER_UPDATE(r, this);
 		break;
 
+	case WORLD_SNAPSHOT_PACKET:
+		unmarshal_WORLD_SNAPSHOT(r, this);
+		break;
+
+	case SNAPSHOT_ACK_PACKET:
+		unmarshal_SNAPSHOT_ACK(r, this);
+		break;
+
+	default:
+		break;
+	}
+}
+void Packet::unmarshal_binary() {
+	BinaryReader r(raw);
+	r.get_header(header);
+	type = (PacketEnum) header.packet_type;
+	switch(type) {
+	case ACK_PACKET:
+		unmarshal_binary_ACK(r, this);
+		break;
+
+	case PLAYER_UPDATE_PACKET:
+		unmarshal_binary_PLAYER_UPDATE(r, this);
+		break;
+
+	case WEAPON_DISCHARGED_PACKET:
+		unmarshal_binary_WEAPON_DISCHARGED(r, this);
+		break;
+
+	case PLAYER_HIT_PACKET:
+		unmarshal_binary_PLAYER_HIT(r, this);
+		break;
+
+	case MESSAGE_PACKET:
+		unmarshal_binary_MESSAGE(r, this);
+		break;
+
+	case NEW_ROUND_PACKET:
+		unmarshal_binary_NEW_ROUND(r, this);
+		break;
+
+	case ROUND_OVER_PACKET:
+		unmarshal_binary_ROUND_OVER(r, this);
+		break;
+
+	case SCORE_UPDATE_PACKET:
+		unmarshal_binary_SCORE_UPDATE(r, this);
+		break;
+
+	case WELCOME_PACKET:
+		unmarshal_binary_WELCOME(r, this);
+		break;
+
+	case ANNOUNCE_PACKET:
+		unmarshal_binary_ANNOUNCE(r, this);
+		break;
+
+	case GATE_UPDATE_PACKET:
+		unmarshal_binary_GATE_UPDATE(r, this);
+		break;
+
+	case LEAVE_PACKET:
+		unmarshal_binary_LEAVE(r, this);
+		break;
+
+	case PLAYER_ANIMATION_PACKET:
+		unmarshal_binary_PLAYER_ANIMATION(r, this);
+		break;
+
+	case REQUEST_DENIED_PACKET:
+		unmarshal_binary_REQUEST_DENIED(r, this);
+		break;
+
+	case NAME_CHANGE_PACKET:
+		unmarshal_binary_NAME_CHANGE(r, this);
+		break;
+
+	case TEAM_CHANGE_PACKET:
+		unmarshal_binary_TEAM_CHANGE(r, this);
+		break;
+
+	case REGISTER_SERVER_metaserver_PACKET:
+		unmarshal_binary_REGISTER_SERVER_metaserver(r, this);
+		break;
+
+	case UPGRADE_AVAILABLE_PACKET:
+		unmarshal_binary_UPGRADE_AVAILABLE(r, this);
+		break;
+
+	case MAP_OBJECT_PACKET:
+		unmarshal_binary_MAP_OBJECT(r, this);
+		break;
+
+	case GAME_PARAM_PACKET:
+		unmarshal_binary_GAME_PARAM(r, this);
+		break;
+
+	case PLAYER_DIED_PACKET:
+		unmarshal_binary_PLAYER_DIED(r, this);
+		break;
+
+	case ROUND_START_PACKET:
+		unmarshal_binary_ROUND_START(r, this);
+		break;
+
+	case SPAWN_PACKET:
+		unmarshal_binary_SPAWN(r, this);
+		break;
+
+	case PLAYER_JUMPED_PACKET:
+		unmarshal_binary_PLAYER_JUMPED(r, this);
+		break;
+
+	case PLAYER_TO_SERVER_UPDATE_PACKET:
+		unmarshal_binary_PLAYER_TO_SERVER_UPDATE(r, this);
+		break;
+
+	case WORLD_SNAPSHOT_PACKET:
+		unmarshal_binary_WORLD_SNAPSHOT(r, this);
+		break;
+
+	case SNAPSHOT_ACK_PACKET:
+		unmarshal_binary_SNAPSHOT_ACK(r, this);
+		break;
+
 	default:
 		break;
 	}
@@ -1267,6 +1920,14 @@ void Packet::dispatch(PacketReceiver* r) {
 		r->player_to_server_update(*this);
 		break;
 
+	case WORLD_SNAPSHOT_PACKET:
+		r->world_snapshot(*this);
+		break;
+
+	case SNAPSHOT_ACK_PACKET:
+		r->snapshot_ack(*this);
+		break;
+
 	default:
 		break;
 	}
@@ -50,6 +50,8 @@ namespace LM {
 		SPAWN_PACKET = 30,
 		PLAYER_JUMPED_PACKET = 31,
 		PLAYER_TO_SERVER_UPDATE_PACKET = 32,
+		WORLD_SNAPSHOT_PACKET = 33,
+		SNAPSHOT_ACK_PACKET = 34,
 	};
 
 	class PacketReceiver;
@@ -62,7 +64,13 @@ namespace LM {
 		void clear();
 		void free();
 		void marshal();
+		// Write just the fields (not the header) as text
+		void marshal(PacketWriter& w);
+		// Returns false (leaving raw in an unspecified state) if this type of packet has no binary encoding
+		bool marshal_binary();
+		// Handles both text and binary packets
 		void unmarshal();
+		void unmarshal_binary();
 		void dispatch(PacketReceiver* r);
 		struct Ack {
 			uint32_t packet_type;
@@ -90,6 +98,7 @@ namespace LM {
 			float start_y;
 			float end_x;
 			float end_y;
+			uint32_t input_sequence;
 		};
 
 		struct PlayerHit {
@@ -153,6 +162,7 @@ namespace LM {
 			TypeWrapper<Version> compat_version;
 			TypeWrapper<std::string> name;
 			char team;
+			uint32_t interpolation_delay;
 		};
 
 		struct InfoServer {
@@ -272,12 +282,24 @@ namespace LM {
 		struct PlayerJumped {
 			uint32_t player_id;
 			float direction;
+			uint32_t input_sequence;
 		};
 
 		struct PlayerToServerUpdate {
 			uint32_t player_id;
 			float gun_rotation;
 			uint32_t current_weapon_id;
+			uint32_t input_sequence;
+		};
+
+		struct WorldSnapshot {
+			uint32_t snapshot_id;
+			uint32_t baseline_id;
+		};
+
+		struct SnapshotAck {
+			uint32_t player_id;
+			uint32_t snapshot_id;
 		};
 
 		PacketEnum type;
@@ -318,6 +340,8 @@ namespace LM {
 			Spawn spawn;
 			PlayerJumped player_jumped;
 			PlayerToServerUpdate player_to_server_update;
+			WorldSnapshot world_snapshot;
+			SnapshotAck snapshot_ack;
 		};
 	};
 
@@ -357,6 +381,8 @@ namespace LM {
 		virtual void spawn(const Packet& p) { }
 		virtual void player_jumped(const Packet& p) { }
 		virtual void player_to_server_update(const Packet& p) { }
+		virtual void world_snapshot(const Packet& p) { }
+		virtual void snapshot_ack(const Packet& p) { }
 	};
 
 }
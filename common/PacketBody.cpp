@@ -0,0 +1,73 @@
+/*
+ * common/PacketBody.cpp
+ *
+ * This file is part of Leges Motus, a networked, 2D shooter set in zero gravity.
+ * 
+ * Copyright 2009-2011 Andrew Ayer, Nathan Partlan, Jeffrey Pfau
+ * 
+ * Leges Motus is free and open source software.  You may redistribute it and/or
+ * modify it under the terms of version 2, or (at your option) version 3, of the
+ * GNU General Public License (GPL), as published by the Free Software Foundation.
+ * 
+ * Leges Motus is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.  See the full text of the GNU General Public License for
+ * further detail.
+ * 
+ * For a full copy of the GNU General Public License, please see the COPYING file
+ * in the root of the source code tree.  You may also retrieve a copy from
+ * <http://www.gnu.org/licenses/gpl-2.0.txt>, or request a copy by writing to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ * 02111-1307  USA
+ * 
+ */
+
+#include "PacketBody.hpp"
+#include "UDPPacketPool.hpp"
+#include "network.hpp"
+#include <cstring>
+#include <algorithm>
+
+using namespace LM;
+using namespace std;
+
+PacketBody::PacketBody(const char* data, size_t length) {
+	m_data = NULL;
+	if (length > 0) {
+		// Use a packet-sized buffer if possible, since those are pooled
+		size_t	buffer_size = std::max<size_t>(sizeof(Data) + length, MAX_PACKET_LENGTH);
+		m_data = reinterpret_cast<Data*>(UDPPacketPool::allocate(buffer_size));
+		m_data->buffer_size = buffer_size;
+		m_data->length = length;
+		m_data->nbr_references = 1;
+		memcpy(m_data->get_body(), data, length);
+	}
+}
+
+PacketBody::PacketBody(const string& data) {
+	m_data = NULL;
+	*this = PacketBody(data.data(), data.size());
+}
+
+PacketBody::PacketBody(const PacketBody& other) {
+	m_data = other.m_data;
+	if (m_data) {
+		++m_data->nbr_references;
+	}
+}
+
+PacketBody&	PacketBody::operator=(const PacketBody& other) {
+	if (other.m_data) {
+		++other.m_data->nbr_references;
+	}
+	release();
+	m_data = other.m_data;
+	return *this;
+}
+
+void	PacketBody::release() {
+	if (m_data && --m_data->nbr_references == 0) {
+		UDPPacketPool::release(reinterpret_cast<char*>(m_data), m_data->buffer_size);
+	}
+	m_data = NULL;
+}
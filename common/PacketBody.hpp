@@ -0,0 +1,68 @@
+/*
+ * common/PacketBody.hpp
+ *
+ * This file is part of Leges Motus, a networked, 2D shooter set in zero gravity.
+ * 
+ * Copyright 2009-2011 Andrew Ayer, Nathan Partlan, Jeffrey Pfau
+ * 
+ * Leges Motus is free and open source software.  You may redistribute it and/or
+ * modify it under the terms of version 2, or (at your option) version 3, of the
+ * GNU General Public License (GPL), as published by the Free Software Foundation.
+ * 
+ * Leges Motus is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.  See the full text of the GNU General Public License for
+ * further detail.
+ * 
+ * For a full copy of the GNU General Public License, please see the COPYING file
+ * in the root of the source code tree.  You may also retrieve a copy from
+ * <http://www.gnu.org/licenses/gpl-2.0.txt>, or request a copy by writing to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ * 02111-1307  USA
+ * 
+ */
+
+#ifndef LM_COMMON_PACKETBODY_HPP
+#define LM_COMMON_PACKETBODY_HPP
+
+#include <string>
+#include <stddef.h>
+
+namespace LM {
+	/*
+	 * An immutable, reference-counted buffer holding the body of a packet (everything after the header).
+	 * Copying a PacketBody just adds a reference, so one body can be marshalled once and then shared
+	 * by every datagram of a broadcast, by the send batch, and by the AckManager.
+	 *
+	 * Bodies which fit in a packet don't need any heap allocations.  The reference count is not thread-safe.
+	 */
+	class PacketBody {
+	private:
+		// Lives at the start of a buffer from the UDPPacketPool, and is followed by the body itself
+		struct Data {
+			size_t		buffer_size;
+			size_t		length;
+			int		nbr_references;
+
+			char*		get_body() { return reinterpret_cast<char*>(this + 1); }
+		};
+		Data*			m_data;		// NULL if this body is empty
+
+		void			release();
+
+	public:
+		PacketBody() { m_data = NULL; }
+		PacketBody(const char* data, size_t length);
+		explicit PacketBody(const std::string& data);
+		PacketBody(const PacketBody& other);
+		~PacketBody() { release(); }
+
+		PacketBody&		operator=(const PacketBody& other);
+
+		const char*		get_data() const { return m_data ? m_data->get_body() : NULL; }
+		size_t			get_length() const { return m_data ? m_data->length : 0; }
+		bool			is_empty() const { return get_length() == 0; }
+	};
+}
+
+#endif
@@ -25,21 +25,55 @@
 #include "PacketHeader.hpp"
 #include "StringTokenizer.hpp"
 #include "network.hpp"
+#include "UDPPacket.hpp"
 #include <sstream>
 
 using namespace LM;
 using namespace std;
 
+namespace {
+	void	append_decimal(UDPPacket& raw_packet, uint64_t value) {
+		char	digits[20];
+		size_t	nbr_digits = 0;
+		do {
+			digits[sizeof(digits) - ++nbr_digits] = '0' + value % 10;
+			value /= 10;
+		} while (value);
+		raw_packet.append(digits + sizeof(digits) - nbr_digits, nbr_digits);
+	}
+}
+
 string	PacketHeader::make_string() const {
 	ostringstream	str;
 	str << packet_type << PACKET_FIELD_SEPARATOR << sequence_no;
-	if (connection_id) {
+	if (connection_id || ack_sequence_no) {
 		str << ':' << connection_id;
 	}
+	if (ack_sequence_no) {
+		str << ':' << ack_sequence_no << ':' << ack_bits;
+	}
 	return str.str();
 }
+
+void	PacketHeader::write(UDPPacket& raw_packet) const {
+	raw_packet.clear();
+	append_decimal(raw_packet, packet_type);
+	raw_packet.append(&PACKET_FIELD_SEPARATOR, 1);
+	append_decimal(raw_packet, sequence_no);
+	if (connection_id || ack_sequence_no) {
+		raw_packet.append(":", 1);
+		append_decimal(raw_packet, connection_id);
+	}
+	if (ack_sequence_no) {
+		raw_packet.append(":", 1);
+		append_decimal(raw_packet, ack_sequence_no);
+		raw_packet.append(":", 1);
+		append_decimal(raw_packet, ack_bits);
+	}
+}
+
 void	PacketHeader::read(StringTokenizer& tok) {
 	string		packet_id_string;
 	tok >> packet_type >> packet_id_string;
-	StringTokenizer(packet_id_string, ':') >> sequence_no >> connection_id;
+	StringTokenizer(packet_id_string, ':') >> sequence_no >> connection_id >> ack_sequence_no >> ack_bits;
 }
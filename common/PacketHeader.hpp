@@ -30,17 +30,31 @@
 
 namespace LM {
 	class StringTokenizer;
+	class UDPPacket;
 
+	/*
+	 * The header of every packet.
+	 *
+	 * Any packet sent to a peer may also acknowledge the reliable packets received from that peer:
+	 * ack_sequence_no is the highest sequence number received (0 if the header carries no acknowledgements),
+	 * and bit N of ack_bits is set if sequence number ack_sequence_no - 1 - N has been received as well.
+	 *
+	 * In text form, the header is "type\fseq", "type\fseq:cid", or "type\fseq:cid:ack_seq:ack_bits".
+	 */
 	class PacketHeader {
 	public:
 		uint32_t	packet_type;
 		uint64_t	sequence_no;
 		uint32_t	connection_id;
+		uint64_t	ack_sequence_no;
+		uint32_t	ack_bits;
 
-		PacketHeader(uint32_t type, uint64_t seqno, uint32_t cid) { packet_type = type; sequence_no = seqno; connection_id = cid; }
-		PacketHeader() { packet_type = 0; sequence_no = 0; connection_id = 0; }
+		PacketHeader(uint32_t type, uint64_t seqno, uint32_t cid) { packet_type = type; sequence_no = seqno; connection_id = cid; ack_sequence_no = 0; ack_bits = 0; }
+		PacketHeader() { packet_type = 0; sequence_no = 0; connection_id = 0; ack_sequence_no = 0; ack_bits = 0; }
 
 		std::string	make_string() const;
+		// Fill the given raw packet with the same text as make_string(), without allocating any memory
+		void		write(UDPPacket& raw_packet) const;
 		void		read(StringTokenizer&);
 	};
 }
@@ -23,111 +23,153 @@
  */
 
 #include "PacketQueue.hpp"
+#include "UDPPacket.hpp"
+#include "UDPPacketPool.hpp"
+#include "network.hpp"
+#include <algorithm>
+#include <cstring>
 
 using namespace LM;
 using namespace std;
 
+namespace {
+	size_t	round_up_to_power_of_two(size_t n) {
+		size_t	power = 1;
+		while (power < n) {
+			power <<= 1;
+		}
+		return power;
+	}
+}
 
 PacketQueue::PacketQueue(uint64_t next_expected_sequence_no, size_t max_size) {
-	m_next_expected_sequence_no = next_expected_sequence_no;
-	m_max_size = max_size;
+	init(next_expected_sequence_no, max_size);
 }
 
-bool PacketQueue::push_r(const PacketReader& packet) {
-	if (packet.sequence_no() < m_next_expected_sequence_no) {
-		// This packet is a dupe of one that already arrived
-		return false;
-	} else if (packet.sequence_no() == m_next_expected_sequence_no) {
-		// This packet arrived in its expected order -- It's ready to be processed NOW
-		++m_next_expected_sequence_no;
-		return true;
-	}
+PacketQueue::PacketQueue(const PacketQueue& other) {
+	copy(other);
+}
 
-	// This packet arrived out of order -- Add it to the queue!
-	list<PacketReader>::reverse_iterator	it(m_queued_packets_r.rbegin());
+PacketQueue::~PacketQueue() {
+	release_all();
+}
 
-	while (it != m_queued_packets_r.rend() && it->sequence_no() > packet.sequence_no()) {
-		++it;
+PacketQueue&	PacketQueue::operator=(const PacketQueue& other) {
+	if (this != &other) {
+		release_all();
+		copy(other);
 	}
+	return *this;
+}
 
-	// Make sure we don't add a packet that's already in the queue
-	if (it != m_queued_packets_r.rend() && it->sequence_no() == packet.sequence_no()) {
-		return false;
+void	PacketQueue::copy(const PacketQueue& other) {
+	m_slots = other.m_slots;
+	for (size_t i = 0; i < m_slots.size(); ++i) {
+		if (m_slots[i].data) {
+			const char*	other_data = m_slots[i].data;
+			m_slots[i].data = UDPPacketPool::allocate(MAX_PACKET_LENGTH);
+			memcpy(m_slots[i].data, other_data, m_slots[i].length);
+		}
 	}
+	m_next_expected_sequence_no = other.m_next_expected_sequence_no;
+	m_nbr_reordered = other.m_nbr_reordered;
+	m_max_reorder_depth = other.m_max_reorder_depth;
+	m_nbr_duplicates = other.m_nbr_duplicates;
+	m_nbr_dropped = other.m_nbr_dropped;
+}
 
-	// Make sure there's room in the queue for another packet
-	if (m_queued_packets_r.size() >= m_max_size) {
-		throw FullQueueException();
+void	PacketQueue::release(Slot& slot) {
+	if (slot.data) {
+		UDPPacketPool::release(slot.data, MAX_PACKET_LENGTH);
+		slot.data = NULL;
 	}
+}
 
-	m_queued_packets_r.insert(it.base(), packet);
-	return false;
+void	PacketQueue::release_all() {
+	for (size_t i = 0; i < m_slots.size(); ++i) {
+		release(m_slots[i]);
+	}
+}
+
+void	PacketQueue::init(uint64_t next_expected_sequence_no, size_t max_size) {
+	release_all();
+	Slot	empty_slot = { 0, NULL, 0 };
+	m_slots.assign(round_up_to_power_of_two(max_size), empty_slot);
+	m_next_expected_sequence_no = next_expected_sequence_no;
+	m_nbr_reordered = 0;
+	m_max_reorder_depth = 0;
+	m_nbr_duplicates = 0;
+	m_nbr_dropped = 0;
+}
+
+void	PacketQueue::set_max_size(size_t max_size) {
+	std::vector<Slot>	old_slots;
+	old_slots.swap(m_slots);
+	Slot	empty_slot = { 0, NULL, 0 };
+	m_slots.assign(round_up_to_power_of_two(max_size), empty_slot);
+
+	// Move the queued packets to their slots in the new ring
+	for (size_t i = 0; i < old_slots.size(); ++i) {
+		Slot&	slot(old_slots[i]);
+		if (!slot.data) {
+			continue;
+		}
+		if (slot.sequence_no >= m_next_expected_sequence_no && slot.sequence_no - m_next_expected_sequence_no < m_slots.size()) {
+			get_slot(slot.sequence_no) = slot;
+		} else {
+			if (slot.sequence_no >= m_next_expected_sequence_no) {
+				++m_nbr_dropped;
+			}
+			UDPPacketPool::release(slot.data, MAX_PACKET_LENGTH);
+		}
+	}
 }
 
-bool PacketQueue::push(const Packet& packet) {
-	if (packet.header.sequence_no < m_next_expected_sequence_no) {
+bool	PacketQueue::push(const UDPPacket& raw_packet, uint64_t sequence_no) {
+	if (sequence_no < m_next_expected_sequence_no) {
 		// This packet is a dupe of one that already arrived
+		++m_nbr_duplicates;
 		return false;
-	} else if (packet.header.sequence_no == m_next_expected_sequence_no) {
+	} else if (sequence_no == m_next_expected_sequence_no) {
 		// This packet arrived in its expected order -- It's ready to be processed NOW
+		// (If a copy of it was queued, that copy is now stale, and its buffer will be reused.)
 		++m_next_expected_sequence_no;
 		return true;
 	}
 
 	// This packet arrived out of order -- Add it to the queue!
-	list<Packet>::reverse_iterator it(m_queued_packets.rbegin());
-
-	while (it != m_queued_packets.rend() && it->header.sequence_no > packet.header.sequence_no) {
-		++it;
+	const uint64_t	depth = sequence_no - m_next_expected_sequence_no;
+	if (depth >= m_slots.size()) {
+		// Too far ahead for the ring
+		++m_nbr_dropped;
+		throw FullQueueException();
 	}
 
-	// Make sure we don't add a packet that's already in the queue
-	if (it != m_queued_packets.rend() && it->header.sequence_no == packet.header.sequence_no) {
+	Slot&		slot(get_slot(sequence_no));
+	if (is_queued(slot, sequence_no)) {
+		// Make sure we don't add a packet that's already in the queue
+		++m_nbr_duplicates;
 		return false;
 	}
 
-	// Make sure there's room in the queue for another packet
-	if (m_queued_packets.size() >= m_max_size) {
-		throw FullQueueException();
+	if (!slot.data) {
+		slot.data = UDPPacketPool::allocate(MAX_PACKET_LENGTH);
 	}
+	slot.sequence_no = sequence_no;
+	slot.length = std::min<size_t>(raw_packet.get_length(), MAX_PACKET_LENGTH);
+	memcpy(slot.data, raw_packet.get_data(), slot.length);
 
-	m_queued_packets.insert(it.base(), packet);
+	++m_nbr_reordered;
+	m_max_reorder_depth = std::max(m_max_reorder_depth, depth);
 	return false;
 }
 
-PacketReader& PacketQueue::peek_r() {
-	if (!has_packet()) {
-		throw EmptyQueueException();
-	}
-	return m_queued_packets_r.front();
-}
-
-Packet& PacketQueue::peek() {
-	if (!has_packet()) {
-		throw EmptyQueueException();
-	}
-	return m_queued_packets.front();
-}
-
-void	PacketQueue::pop_r() {
-	if (!has_packet()) {
-		throw EmptyQueueException();
-	}
-	m_queued_packets_r.pop_front();
-	++m_next_expected_sequence_no;
-}
-
-void PacketQueue::pop() {
+void	PacketQueue::pop(UDPPacket& raw_packet) {
 	if (!has_packet()) {
 		throw EmptyQueueException();
 	}
-	m_queued_packets.pop_front();
+	Slot&	slot(get_slot(m_next_expected_sequence_no));
+	raw_packet.fill(slot.data, slot.length);
+	release(slot);
 	++m_next_expected_sequence_no;
 }
-
-void PacketQueue::init(uint64_t next_expected_sequence_no, size_t max_size) {
-	m_next_expected_sequence_no = next_expected_sequence_no;
-	m_max_size = max_size;
-	m_queued_packets.clear();
-}
-
@@ -25,39 +25,83 @@
 #ifndef LM_COMMON_PACKETQUEUE_HPP
 #define LM_COMMON_PACKETQUEUE_HPP
 
-#include <list>
-#include "PacketReader.hpp"
-#include "Packet.hpp"
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
 
 namespace LM {
+	class UDPPacket;
+
+	/*
+	 * Puts the reliable packets received from a peer back in order.
+	 *
+	 * Packets which arrive ahead of the next expected sequence number are copied into pooled packet
+	 * buffers (see UDPPacketPool), held in a ring indexed by sequence_no % capacity.  The capacity is
+	 * a power of two, so queueing a packet, detecting a duplicate, and taking the next packet in order
+	 * all take constant time.  A packet can't be queued more than capacity packets ahead.
+	 *
+	 * Example:
+	 * 	if (queue.push(raw_packet, sequence_no)) {
+	 * 		// process raw_packet
+	 * 		while (queue.has_packet()) {
+	 * 			queue.pop(raw_packet);
+	 * 			// process raw_packet
+	 * 		}
+	 * 	}
+	 */
 	class PacketQueue {
 	private:
-		size_t			m_max_size;
+		struct Slot {
+			uint64_t	sequence_no;	// The slot only holds a packet if data is non-NULL, and this is >= the next expected sequence number
+			char*		data;		// From UDPPacketPool
+			size_t		length;
+		};
+
+		std::vector<Slot>	m_slots;
 		uint64_t		m_next_expected_sequence_no;
-		std::list<PacketReader>	m_queued_packets_r;
-		std::list<Packet>	m_queued_packets;
+
+		// Statistics
+		uint64_t		m_nbr_reordered;	// Packets which arrived early, and were queued
+		uint64_t		m_max_reorder_depth;	// The furthest ahead of the next expected packet that a packet has arrived
+		uint64_t		m_nbr_duplicates;	// Packets which had already been received
+		uint64_t		m_nbr_dropped;		// Packets which arrived too far ahead to be queued
+
+		Slot&			get_slot(uint64_t sequence_no) { return m_slots[sequence_no & (m_slots.size() - 1)]; }
+		const Slot&		get_slot(uint64_t sequence_no) const { return m_slots[sequence_no & (m_slots.size() - 1)]; }
+		bool			is_queued(const Slot& slot, uint64_t sequence_no) const { return slot.data && slot.sequence_no == sequence_no; }
+		void			release(Slot& slot);
+		void			release_all();
+		void			copy(const PacketQueue& other);
 
 	public:
 		explicit PacketQueue(uint64_t next_expected_sequence_no =1, size_t max_size =256);
+		PacketQueue(const PacketQueue& other);
+		~PacketQueue();
+
+		PacketQueue&		operator=(const PacketQueue& other);
 
+		// Forgets all queued packets and statistics
 		void			init(uint64_t next_expected_sequence_no =1, size_t max_size =256);
-		void			set_max_size(size_t max_size) { m_max_size = max_size; }
+		// max_size is rounded up to a power of two.  Queued packets that no longer fit are dropped.
+		void			set_max_size(size_t max_size);
+		size_t			get_max_size() const { return m_slots.size(); }
 
-		// Returns true if the given packet is ready to be processed NOW:
-		bool			push_r(const PacketReader& packet);
-		bool			push(const Packet& packet);
+		// Returns true if the given packet is ready to be processed NOW (in which case it's not queued)
+		// Throws FullQueueException if the packet is too far ahead to be queued
+		bool			push(const UDPPacket& raw_packet, uint64_t sequence_no);
 
 		// Returns true if there is a packet ready to be processed:
-		bool			has_packet_r() const { return !m_queued_packets_r.empty() && m_queued_packets_r.front().sequence_no() == m_next_expected_sequence_no; }
-		bool			has_packet() const { return !m_queued_packets.empty() && m_queued_packets.front().header.sequence_no == m_next_expected_sequence_no; }
+		bool			has_packet() const { return is_queued(get_slot(m_next_expected_sequence_no), m_next_expected_sequence_no); }
 
-		// Return the next packet that is ready to be processed (ONLY CALL if has_packet() returns TRUE!)
-		PacketReader&		peek_r();
-		Packet&				peek();
+		// Copy the next packet that is ready to be processed into raw_packet, and remove it from the queue
+		// (ONLY CALL if has_packet() returns TRUE!)
+		void			pop(UDPPacket& raw_packet);
 
-		// Pop the next packet that was ready to be processed (ONLY CALL if has_packet() returns TRUE!)
-		void			pop_r();
-		void			pop();
+		uint64_t		get_next_expected_sequence_no() const { return m_next_expected_sequence_no; }
+		uint64_t		get_nbr_reordered() const { return m_nbr_reordered; }
+		uint64_t		get_max_reorder_depth() const { return m_max_reorder_depth; }
+		uint64_t		get_nbr_duplicates() const { return m_nbr_duplicates; }
+		uint64_t		get_nbr_dropped() const { return m_nbr_dropped; }
 
 		class EmptyQueueException { };
 		class FullQueueException { };
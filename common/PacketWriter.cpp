@@ -23,6 +23,8 @@
  */
 
 #include "PacketWriter.hpp"
+#include "UDPPacket.hpp"
+#include "UDPPacketPool.hpp"
 #include <iomanip>
 
 // See .hpp file for extensive comments.
@@ -30,13 +32,26 @@
 using namespace LM;
 using namespace std;
 
-PacketWriter::PacketWriter(uint32_t packet_type) {
+PacketWriter::Buffer::Buffer() {
+	m_data = UDPPacketPool::allocate(MAX_PACKET_LENGTH);
+	setp(m_data, m_data + MAX_PACKET_LENGTH);
+}
+
+PacketWriter::Buffer::~Buffer() {
+	UDPPacketPool::release(m_data, MAX_PACKET_LENGTH);
+}
+
+PacketWriter::PacketWriter(uint32_t packet_type) : m_out(&m_buffer) {
 	m_out.setf(ios::boolalpha);		// use true/false when outputting bools
 	m_header.packet_type = packet_type;
 }
 
-PacketWriter::PacketWriter(uint32_t packet_type, const PacketHeader& header) : m_header(header) {
+PacketWriter::PacketWriter(uint32_t packet_type, const PacketHeader& header) : m_header(header), m_out(&m_buffer) {
 	m_out.setf(ios::boolalpha);		// use true/false when outputting bools
 	m_header.packet_type = packet_type;
 }
 
+void	PacketWriter::fill_packet(UDPPacket& raw_packet) const {
+	m_header.write(raw_packet);
+	raw_packet.append(get_data(), get_length());
+}
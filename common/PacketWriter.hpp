@@ -25,7 +25,8 @@
 #ifndef LM_COMMON_PACKETWRITER_HPP
 #define LM_COMMON_PACKETWRITER_HPP
 
-#include <sstream>
+#include <ostream>
+#include <streambuf>
 #include <string>
 #include <stdint.h>
 #include <stddef.h>
@@ -41,17 +42,40 @@
  * 	packet << this_player_id << recipient_player_id << message_text;
  *
  * 	packet.packet_data(); // Would return something like "5\fB\fCover me, I'm going for the gate!"
+ *
+ * The fields are written straight into a buffer from the UDPPacketPool, so (apart from packet_data(),
+ * which returns a copy) writing a packet does not allocate any memory.  Fields which don't fit in
+ * MAX_PACKET_LENGTH bytes are dropped.
  */
 
 namespace LM {
+	class UDPPacket;
+
 	class PacketWriter {
 	private:
+		// A stream buffer which writes into a fixed-size buffer from the UDPPacketPool
+		class Buffer : public std::streambuf {
+		private:
+			char*		m_data;
+
+			// Uncopyable
+			Buffer(const Buffer&);
+			Buffer&		operator=(const Buffer&);
+		public:
+			Buffer();
+			~Buffer();
+
+			const char*	get_data() const { return pbase(); }
+			size_t		get_length() const { return pptr() - pbase(); }
+		};
+
 		// Packet header for this packet:
 		PacketHeader		m_header;
 	
-		// Raw packet data is written into this string stream:
-		// Note: this does NOT include the values in the header - you have to write those to the raw packet yourself
-		std::ostringstream	m_out;
+		// Raw packet data is written into this stream:
+		// Note: this does NOT include the values in the header - you have to write those to the raw packet yourself (or use fill_packet())
+		Buffer			m_buffer;
+		std::ostream		m_out;
 
 	public:
 		explicit PacketWriter(uint32_t packet_type);
@@ -64,7 +88,12 @@ namespace LM {
 		uint32_t		connection_id() const { return m_header.connection_id; }
 	
 		// Get the raw packet data:
-		std::string		packet_data() const { return m_out.str(); }
+		const char*		get_data() const { return m_buffer.get_data(); }
+		size_t			get_length() const { return m_buffer.get_length(); }
+		std::string		packet_data() const { return std::string(get_data(), get_length()); }
+
+		// Fill the given raw packet with the header and data of this packet
+		void			fill_packet(UDPPacket& raw_packet) const;
 	
 		// Write a field into the packet:
 		template<class T> PacketWriter& operator<<(const T& obj) {
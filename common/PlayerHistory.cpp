@@ -0,0 +1,240 @@
+/*
+ * common/PlayerHistory.cpp
+ *
+ * This file is part of Leges Motus, a networked, 2D shooter set in zero gravity.
+ * 
+ * Copyright 2009-2011 Andrew Ayer, Nathan Partlan, Jeffrey Pfau
+ * 
+ * Leges Motus is free and open source software.  You may redistribute it and/or
+ * modify it under the terms of version 2, or (at your option) version 3, of the
+ * GNU General Public License (GPL), as published by the Free Software Foundation.
+ * 
+ * Leges Motus is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.  See the full text of the GNU General Public License for
+ * further detail.
+ * 
+ * For a full copy of the GNU General Public License, please see the COPYING file
+ * in the root of the source code tree.  You may also retrieve a copy from
+ * <http://www.gnu.org/licenses/gpl-2.0.txt>, or request a copy by writing to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ * 02111-1307  USA
+ * 
+ */
+
+#include "PlayerHistory.hpp"
+#include "common/Player.hpp"
+#include "common/MapObject.hpp"
+#include "common/physics.hpp"
+#include "common/math.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace LM;
+using namespace std;
+
+namespace {
+	bool compare_player_id(const PlayerHistory::Transform& transform, uint32_t player_id) {
+		return transform.player_id < player_id;
+	}
+
+	// Find whether anything a shot can't pass through lies along a ray
+	class ObstacleCast : public b2RayCastCallback {
+	public:
+		bool	is_blocked;
+
+		ObstacleCast() : is_blocked(false) { }
+
+		float32 ReportFixture(b2Fixture* fixture, const b2Vec2& point, const b2Vec2& normal, float32 fraction) {
+			const PhysicsObject* object = static_cast<const PhysicsObject*>(fixture->GetBody()->GetUserData());
+			if (object == NULL || fixture->IsSensor()) {
+				return -1;
+			}
+
+			if (object->get_type() == PhysicsObject::PLAYER || object->get_type() == PhysicsObject::SHOT) {
+				return -1;
+			}
+
+			if (object->get_type() == PhysicsObject::MAP_OBJECT && !static_cast<const MapObject*>(object)->is_shootable()) {
+				return -1;
+			}
+
+			is_blocked = true;
+			return 0;
+		}
+	};
+}
+
+PlayerHistory::PlayerHistory() {
+	m_next_frame = 0;
+	m_nbr_frames = 0;
+}
+
+void PlayerHistory::clear() {
+	m_next_frame = 0;
+	m_nbr_frames = 0;
+}
+
+const PlayerHistory::Frame& PlayerHistory::get_frame(size_t age) const {
+	return m_frames[(m_next_frame + LENGTH - m_nbr_frames + age) % LENGTH];
+}
+
+const PlayerHistory::Transform* PlayerHistory::find_player(const Frame& frame, uint32_t player_id) {
+	vector<Transform>::const_iterator it(lower_bound(frame.players.begin(), frame.players.end(), player_id, compare_player_id));
+	if (it == frame.players.end() || it->player_id != player_id) {
+		return NULL;
+	}
+	return &*it;
+}
+
+void PlayerHistory::record(uint64_t tick, const vector<Player*>& players) {
+	Frame& frame = m_frames[m_next_frame];
+	frame.tick = tick;
+	frame.players.clear(); // Keeps its storage from the last time around the ring
+
+	for (vector<Player*>::const_iterator it(players.begin()); it != players.end(); ++it) {
+		Transform transform;
+		transform.player_id = (*it)->get_id();
+		transform.x = (*it)->get_x();
+		transform.y = (*it)->get_y();
+		transform.rotation = (*it)->get_rotation_radians();
+		frame.players.push_back(transform);
+	}
+
+	m_next_frame = (m_next_frame + 1) % LENGTH;
+	if (m_nbr_frames < LENGTH) {
+		++m_nbr_frames;
+	}
+}
+
+uint64_t PlayerHistory::get_oldest_tick() const {
+	return m_nbr_frames ? get_frame(0).tick : 0;
+}
+
+uint64_t PlayerHistory::get_newest_tick() const {
+	return m_nbr_frames ? get_frame(m_nbr_frames - 1).tick : 0;
+}
+
+bool PlayerHistory::rewind(double tick, uint32_t player_id, Transform* transform) const {
+	if (m_nbr_frames == 0) {
+		return false;
+	}
+
+	// Find the first frame recorded after the tick
+	size_t	low = 0;
+	size_t	high = m_nbr_frames;
+	while (low < high) {
+		size_t	mid = (low + high) / 2;
+		if (get_frame(mid).tick <= tick) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+
+	const Transform* before = low > 0 ? find_player(get_frame(low - 1), player_id) : NULL;
+	const Transform* after = low < m_nbr_frames ? find_player(get_frame(low), player_id) : NULL;
+
+	if (before == NULL && after == NULL) {
+		return false;
+	} else if (after == NULL) {
+		*transform = *before;
+	} else if (before == NULL) {
+		*transform = *after;
+	} else {
+		uint64_t	before_tick = get_frame(low - 1).tick;
+		float		progress = float(tick - before_tick) / float(get_frame(low).tick - before_tick);
+
+		// Turn the short way around
+		float		rotation_change = after->rotation - before->rotation;
+		if (rotation_change > M_PI) {
+			rotation_change -= 2 * M_PI;
+		} else if (rotation_change < -M_PI) {
+			rotation_change += 2 * M_PI;
+		}
+
+		transform->player_id = player_id;
+		transform->x = before->x + (after->x - before->x) * progress;
+		transform->y = before->y + (after->y - before->y) * progress;
+		transform->rotation = before->rotation + rotation_change * progress;
+	}
+	return true;
+}
+
+float PlayerHistory::intersect_ray(const Transform& player, const Point& start, float direction, float margin) {
+	// Move the ray into the box's frame, where the box is axis-aligned and centered on the origin
+	float	cos_rotation = cos(player.rotation);
+	float	sin_rotation = sin(player.rotation);
+	float	dx = start.x - player.x;
+	float	dy = start.y - player.y;
+	float	origin[2] = { dx * cos_rotation + dy * sin_rotation, dy * cos_rotation - dx * sin_rotation };
+	float	ray[2] = { cos(direction - player.rotation), sin(direction - player.rotation) };
+	float	extents[2] = { Player::PLAYER_WIDTH + margin, Player::PLAYER_HEIGHT + margin };
+
+	// Clip the ray against each pair of sides in turn
+	float	enter = 0;
+	float	exit = numeric_limits<float>::max();
+	for (int axis = 0; axis < 2; ++axis) {
+		if (fabs(ray[axis]) < 1e-6f) {
+			if (fabs(origin[axis]) > extents[axis]) {
+				return -1;
+			}
+			continue;
+		}
+		float	near_side = (-extents[axis] - origin[axis]) / ray[axis];
+		float	far_side = (extents[axis] - origin[axis]) / ray[axis];
+		if (near_side > far_side) {
+			swap(near_side, far_side);
+		}
+		enter = max(enter, near_side);
+		exit = min(exit, far_side);
+		if (enter > exit) {
+			return -1;
+		}
+	}
+	return enter;
+}
+
+bool PlayerHistory::overlaps_shape(const Transform& player, const b2Shape* shape, const Point& position, float rotation, float margin) {
+	b2PolygonShape	box;
+	box.SetAsBox(to_physics(Player::PLAYER_WIDTH + margin), to_physics(Player::PLAYER_HEIGHT + margin));
+
+	b2Transform	box_transform;
+	box_transform.Set(b2Vec2(to_physics(player.x), to_physics(player.y)), player.rotation);
+	b2Transform	shape_transform;
+	shape_transform.Set(b2Vec2(to_physics(position.x), to_physics(position.y)), rotation);
+
+	return b2TestOverlap(shape, 0, &box, 0, shape_transform, box_transform);
+}
+
+bool PlayerHistory::is_line_clear(const b2World* physics, const Point& start, const Point& end) {
+	b2Vec2		physics_start(to_physics(start.x), to_physics(start.y));
+	b2Vec2		physics_end(to_physics(end.x), to_physics(end.y));
+	if (physics == NULL || physics_start == physics_end) {
+		return true;
+	}
+
+	ObstacleCast	cast;
+	physics->RayCast(&cast, physics_start, physics_end);
+	return !cast.is_blocked;
+}
+
+bool PlayerHistory::is_visible_from(const b2World* physics, const Transform& player, const Point& start) {
+	if (is_line_clear(physics, start, Point(player.x, player.y))) {
+		return true;
+	}
+
+	// Try the corners
+	float	cos_rotation = cos(player.rotation);
+	float	sin_rotation = sin(player.rotation);
+	for (int corner = 0; corner < 4; ++corner) {
+		float	x = (corner & 1) ? Player::PLAYER_WIDTH : -Player::PLAYER_WIDTH;
+		float	y = (corner & 2) ? Player::PLAYER_HEIGHT : -Player::PLAYER_HEIGHT;
+		Point	end(player.x + x * cos_rotation - y * sin_rotation, player.y + x * sin_rotation + y * cos_rotation);
+		if (is_line_clear(physics, start, end)) {
+			return true;
+		}
+	}
+	return false;
+}
@@ -0,0 +1,103 @@
+/*
+ * common/PlayerHistory.hpp
+ *
+ * This file is part of Leges Motus, a networked, 2D shooter set in zero gravity.
+ * 
+ * Copyright 2009-2011 Andrew Ayer, Nathan Partlan, Jeffrey Pfau
+ * 
+ * Leges Motus is free and open source software.  You may redistribute it and/or
+ * modify it under the terms of version 2, or (at your option) version 3, of the
+ * GNU General Public License (GPL), as published by the Free Software Foundation.
+ * 
+ * Leges Motus is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.  See the full text of the GNU General Public License for
+ * further detail.
+ * 
+ * For a full copy of the GNU General Public License, please see the COPYING file
+ * in the root of the source code tree.  You may also retrieve a copy from
+ * <http://www.gnu.org/licenses/gpl-2.0.txt>, or request a copy by writing to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ * 02111-1307  USA
+ * 
+ */
+
+#ifndef LM_COMMON_PLAYERHISTORY_HPP
+#define LM_COMMON_PLAYERHISTORY_HPP
+
+#include "common/Point.hpp"
+#include <vector>
+#include <stdint.h>
+
+class b2World;
+class b2Shape;
+
+namespace LM {
+	class Player;
+
+	/*
+	 * The transforms of every player over the last LENGTH logic ticks, so that the server
+	 * can check a hit against where the players were when the shooter saw them, rather than
+	 * where they are by the time the hit arrives.
+	 *
+	 * Frames live in a ring and are reused, and each frame's players are sorted by ID, so
+	 * recording a tick and rewinding a player are both allocation-free binary searches.
+	 */
+	class PlayerHistory {
+	public:
+		enum { LENGTH = 64 };	// In ticks (a bit over a second at 60 Hz)
+
+		struct Transform {
+			uint32_t	player_id;
+			float		x;		// Center of the player, in game coordinates
+			float		y;
+			float		rotation;	// In radians
+		};
+
+	private:
+		struct Frame {
+			uint64_t		tick;
+			std::vector<Transform>	players;	// Sorted by player_id
+		};
+
+		Frame		m_frames[LENGTH];
+		size_t		m_next_frame;	// Where the next frame will be recorded
+		size_t		m_nbr_frames;
+
+		const Frame&	get_frame(size_t age) const;	// 0 is the oldest frame
+		static const Transform*	find_player(const Frame& frame, uint32_t player_id);
+
+	public:
+		PlayerHistory();
+
+		void		clear();
+
+		// Record the transforms of the given players as of the given tick (see GameLogic::get_tick)
+		void		record(uint64_t tick, const std::vector<Player*>& players); // players must be sorted by ID
+
+		bool		is_empty() const { return m_nbr_frames == 0; }
+		uint64_t	get_oldest_tick() const;
+		uint64_t	get_newest_tick() const;
+
+		// Get the transform of a player at the given tick, which may fall between ticks, interpolated between
+		// the two frames around it.  Ticks outside of the history are clamped to it.
+		// Returns false if the player isn't in the history.
+		bool		rewind(double tick, uint32_t player_id, Transform* transform) const;
+
+		//
+		// Hit tests against historical transforms.  All coordinates are in game coordinates, and
+		// margin grows the player's box on every side to absorb the error in the rewound time.
+		//
+
+		// The distance along a ray at which it enters the player's box, or -1 if the ray misses it
+		static float	intersect_ray(const Transform& player, const Point& start, float direction, float margin = 0);
+		// Does a shape, placed at the given position and rotation, overlap the player's box?
+		static bool	overlaps_shape(const Transform& player, const b2Shape* shape, const Point& position, float rotation, float margin = 0);
+		// Can a shot get from start to end without passing through an obstacle? (Players don't block)
+		static bool	is_line_clear(const b2World* physics, const Point& start, const Point& end);
+		// Is any part of the player's box visible from the given point?  (Like RayCast::cast_at_player)
+		static bool	is_visible_from(const b2World* physics, const Transform& player, const Point& start);
+	};
+}
+
+#endif
@@ -27,6 +27,7 @@
 #include "common/PhysicsObject.hpp"
 #include "common/MapObject.hpp"
 #include "common/Player.hpp"
+#include "common/StaticGeometry.hpp"
 
 using namespace LM;
 using namespace std;
@@ -34,12 +35,18 @@ using namespace std;
 
 RayCast::RayCast() {
 	m_physics = NULL;
+	m_static_geometry = NULL;
 	m_ignore_collidable = false;
+	m_skip_static_bodies = false;
+	m_current_result = &m_ray_cast;
 }
 
-RayCast::RayCast(const b2World* physics) {
+RayCast::RayCast(const b2World* physics, const StaticGeometry* static_geometry) {
 	m_physics = physics;
+	m_static_geometry = static_geometry;
 	m_ignore_collidable = false;
+	m_skip_static_bodies = false;
+	m_current_result = &m_ray_cast;
 }
 
 RayCast::~RayCast() {
@@ -49,32 +56,72 @@ RayCast::RayCastResult& RayCast::get_result() {
 	return m_ray_cast;
 }
 
-void RayCast::set_physics(const b2World* physics) {
+void RayCast::set_physics(const b2World* physics, const StaticGeometry* static_geometry) {
 	m_physics = physics;
+	m_static_geometry = static_geometry;
 }
 
-float RayCast::do_ray_cast(const b2Vec2& start_point, float direction, float distance, const PhysicsObject* starting_object, bool ignore_collidable) {
-	m_ignore_collidable = ignore_collidable;
-	
+void RayCast::start_result(const Ray& ray, RayCastResult& result) {
+	float distance = ray.distance;
 	if (distance == -1) {
 		distance = 20000;
 	}
-	float end_x = start_point.x + cos(direction) * distance;
-	float end_y = start_point.y + sin(direction) * distance;
+	float end_x = ray.start.x + cos(ray.direction) * distance;
+	float end_y = ray.start.y + sin(ray.direction) * distance;
 	
-	m_ray_cast.ray_start = start_point;
-	m_ray_cast.ray_end = b2Vec2(end_x, end_y);
-	m_ray_cast.ray_direction = direction;
-	m_ray_cast.start_object = starting_object;
-	m_ray_cast.closest_object = NULL;
-	m_ray_cast.shortest_dist = -1;
-	m_ray_cast.hit_point = b2Vec2(-1, -1);
-	
-	if (m_physics == NULL) {
-		return -1;
+	result.ray_start = ray.start;
+	result.ray_end = b2Vec2(end_x, end_y);
+	result.ray_direction = ray.direction;
+	result.start_object = ray.start_object;
+	result.closest_object = NULL;
+	result.shortest_dist = -1;
+	result.hit_point = b2Vec2(-1, -1);
+}
+
+void RayCast::cast_rays(const Ray* rays, size_t count, RayCastResult* results) {
+	for (size_t i = 0; i < count; ++i) {
+		RayCastResult& result = results[i];
+		start_result(rays[i], result);
+		
+		if (m_physics == NULL) {
+			continue;
+		}
+		
+		m_ignore_collidable = rays[i].ignore_collidable;
+		m_current_result = &result;
+		m_skip_static_bodies = m_static_geometry != NULL;
+		
+		b2Vec2 end = result.ray_end;
+		if (m_static_geometry != NULL) {
+			float fraction = 1;
+			if (PhysicsObject* hitobj = m_static_geometry->cast_ray(result.ray_start, result.ray_end, m_ignore_collidable, fraction, fraction)) {
+				b2Vec2 delta = result.ray_end - result.ray_start;
+				result.closest_object = hitobj;
+				result.hit_point = result.ray_start + fraction * delta;
+				result.shortest_dist = fraction * delta.Length();
+				// A moving body only matters if it's in front of the static geometry
+				end = result.hit_point;
+			}
+		}
+		
+		if (!(end == result.ray_start)) {
+			m_physics->RayCast(this, result.ray_start, end);
+		}
 	}
 	
-	m_physics->RayCast(this, start_point, m_ray_cast.ray_end);
+	m_current_result = &m_ray_cast;
+	m_skip_static_bodies = false;
+}
+
+float RayCast::do_ray_cast(const b2Vec2& start_point, float direction, float distance, const PhysicsObject* starting_object, bool ignore_collidable) {
+	Ray ray;
+	ray.start = start_point;
+	ray.direction = direction;
+	ray.distance = distance;
+	ray.start_object = starting_object;
+	ray.ignore_collidable = ignore_collidable;
+	
+	cast_rays(&ray, 1, &m_ray_cast);
 	
 	return m_ray_cast.shortest_dist;
 }
@@ -239,38 +286,45 @@ float32 RayCast::ReportFixture(b2Fixture* fixture, const b2Vec2& point, const b2
 	
 	if (body->GetUserData() == NULL) {
 		WARN("Body has no user data!");
-		return 1;
+		return -1;
 	}
 	
 	if (fraction < 0) {
-		return 1;
+		return -1;
+	}
+	
+	// (Already cast against the static geometry)
+	if (m_skip_static_bodies && body->GetType() == b2_staticBody) {
+		return -1;
 	}
 	
+	RayCastResult& result = *m_current_result;
 	PhysicsObject* hitobj = static_cast<PhysicsObject*>(body->GetUserData());
 	Point end = Point(point.x, point.y);
-	float dist = (end-Point(m_ray_cast.ray_start.x, m_ray_cast.ray_start.y)).get_magnitude();
+	float dist = (end-Point(result.ray_start.x, result.ray_start.y)).get_magnitude();
 	
 	if (fixture->IsSensor()) {
-		return 1;
+		return -1;
 	}
 	
-	if (m_ray_cast.shortest_dist != -1 && dist > m_ray_cast.shortest_dist) {
-		return 1;
+	if (result.shortest_dist != -1 && dist > result.shortest_dist) {
+		return -1;
 	}
 	
 	if (hitobj->get_type() == PhysicsObject::MAP_OBJECT) {
 		MapObject* object = static_cast<MapObject*>(hitobj);
 		
 		if (!m_ignore_collidable && !object->is_collidable()) {
-			return 1;
+			return -1;
 		}
 	}
 	
-	m_ray_cast.shortest_dist = dist;
+	result.shortest_dist = dist;
 	
-	m_ray_cast.closest_object = hitobj;
+	result.closest_object = hitobj;
 	
-	m_ray_cast.hit_point = b2Vec2(end.x, end.y);
+	result.hit_point = b2Vec2(end.x, end.y);
 	
-	return 1;
+	// Nothing further along the ray matters now (returning -1 above ignores a fixture without un-clipping the ray)
+	return fraction;
 }
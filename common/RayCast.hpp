@@ -26,15 +26,32 @@
 #define LM_COMMON_RAYCAST_HPP
 
 #include "common/physics.hpp"
+#include <stddef.h>
 
 namespace LM {
 	class PhysicsObject;
 	class Player;
 	class MapObject;
+	class StaticGeometry;
 
+	/*
+	 * Casts rays through a physics world, finding the first thing each one hits.
+	 *
+	 * If the world's static geometry is given (see StaticGeometry), rays are cast through it
+	 * directly first.  Box2D's world query is then only used for the moving bodies (the players),
+	 * along the part of the ray in front of whatever static geometry it hit.
+	 */
 	class RayCast : public b2RayCastCallback {
 	public:
 	
+	struct Ray {
+		b2Vec2			start;			// The starting point of the ray
+		float			direction;		// In radians
+		float			distance;		// The length of the ray (-1 for as far as it goes)
+		const PhysicsObject*	start_object;		// The object (if any) where this ray starts
+		bool			ignore_collidable;	// Are map objects which players pass through hit anyways?
+	};
+	
 	struct RayCastResult {
 		const PhysicsObject*	start_object;	// The object (if any) where this ray started
 		b2Vec2		ray_start;	// The starting point of the ray cast
@@ -48,17 +65,28 @@ namespace LM {
 	private:
 		RayCastResult m_ray_cast;
 		const b2World* m_physics;
+		const StaticGeometry* m_static_geometry; // NULL to cast everything through Box2D
+		
+		// For the Box2D callback:
 		bool m_ignore_collidable;
+		bool m_skip_static_bodies;
+		RayCastResult* m_current_result;
+		
+		void start_result(const Ray& ray, RayCastResult& result);
 
 	public:
 		RayCast();
-		RayCast(const b2World* physics);
+		RayCast(const b2World* physics, const StaticGeometry* static_geometry = NULL);
 		
 		~RayCast();
 		
 		RayCastResult& get_result();
 		
-		void set_physics(const b2World* physics);
+		// The static geometry, if given, must have been built from the same world
+		void set_physics(const b2World* physics, const StaticGeometry* static_geometry = NULL);
+		
+		// Cast every ray, putting the result of rays[i] in results[i]
+		void cast_rays(const Ray* rays, size_t count, RayCastResult* results);
 	
 		float cast_at_player(const Point& ray_start, const Player* other_player, float max_radius = -1);
 		float cast_at_player(const b2Vec2& ray_start, const Player* other_player, float max_radius = -1);
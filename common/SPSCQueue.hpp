@@ -0,0 +1,129 @@
+/*
+ * common/SPSCQueue.hpp
+ *
+ * This file is part of Leges Motus, a networked, 2D shooter set in zero gravity.
+ * 
+ * Copyright 2009-2011 Andrew Ayer, Nathan Partlan, Jeffrey Pfau
+ * 
+ * Leges Motus is free and open source software.  You may redistribute it and/or
+ * modify it under the terms of version 2, or (at your option) version 3, of the
+ * GNU General Public License (GPL), as published by the Free Software Foundation.
+ * 
+ * Leges Motus is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.  See the full text of the GNU General Public License for
+ * further detail.
+ * 
+ * For a full copy of the GNU General Public License, please see the COPYING file
+ * in the root of the source code tree.  You may also retrieve a copy from
+ * <http://www.gnu.org/licenses/gpl-2.0.txt>, or request a copy by writing to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ * 02111-1307  USA
+ * 
+ */
+
+#ifndef LM_COMMON_SPSCQUEUE_HPP
+#define LM_COMMON_SPSCQUEUE_HPP
+
+#include <vector>
+#include <stddef.h>
+
+namespace LM {
+	/*
+	 * A fixed-size queue which one thread puts items onto, and another thread takes them off of,
+	 * without either thread ever locking or waiting for the other.
+	 *
+	 * The items live in a ring of pre-constructed slots, which are filled and read in place,
+	 * so nothing is allocated or copied once the queue has been created.
+	 *
+	 * Example:
+	 * 	// Producer thread:
+	 * 	if (T* item = queue.get_free_slot()) {
+	 * 		// fill in *item
+	 * 		queue.push();
+	 * 	}
+	 *
+	 * 	// Consumer thread:
+	 * 	while (const T* item = queue.get_front()) {
+	 * 		// use *item
+	 * 		queue.pop();
+	 * 	}
+	 */
+	template<class T> class SPSCQueue {
+	private:
+		std::vector<T>	m_slots;
+		size_t		m_mask;		// m_slots.size() - 1 (the size is a power of two)
+		volatile size_t	m_head;		// Incremented only by the consumer, past the items it's finished with
+		volatile size_t	m_tail;		// Incremented only by the producer, past the items it's filled in
+
+		// Not copyable
+		SPSCQueue(const SPSCQueue&);
+		SPSCQueue&	operator=(const SPSCQueue&);
+
+		static size_t	round_up(size_t capacity) {
+			size_t	size = 1;
+			while (size < capacity) {
+				size <<= 1;
+			}
+			return size;
+		}
+
+	public:
+		// The capacity is rounded up to a power of two.  Every slot starts off as a copy of prototype.
+		explicit SPSCQueue(size_t capacity, const T& prototype =T()) : m_slots(round_up(capacity), prototype) {
+			m_mask = m_slots.size() - 1;
+			m_head = 0;
+			m_tail = 0;
+		}
+
+		size_t		get_capacity() const { return m_slots.size(); }
+
+		/*
+		 * Producer functions
+		 */
+		// The slot to fill in with the next item, or NULL if the queue is full
+		T*		get_free_slot() {
+			size_t	tail = m_tail;
+			if (tail - m_head == m_slots.size()) {
+				return NULL;
+			}
+			// Don't touch the slot until we've seen that the consumer is finished with it
+			__sync_synchronize();
+			return &m_slots[tail & m_mask];
+		}
+		// Hand the slot returned by get_free_slot() over to the consumer
+		void		push() {
+			// The item must be completely written before the consumer can see it
+			__sync_synchronize();
+			m_tail = m_tail + 1;
+		}
+		// How many more items can be pushed right now
+		size_t		get_nbr_free() const { return m_slots.size() - size(); }
+
+		/*
+		 * Consumer functions
+		 */
+		// The next item, or NULL if the queue is empty
+		T*		get_front() {
+			size_t	head = m_head;
+			if (head == m_tail) {
+				return NULL;
+			}
+			// Don't read the item until we've seen that the producer is finished with it
+			__sync_synchronize();
+			return &m_slots[head & m_mask];
+		}
+		// Hand the slot returned by get_front() back to the producer
+		void		pop() {
+			// We must be completely finished with the item before the producer can overwrite it
+			__sync_synchronize();
+			m_head = m_head + 1;
+		}
+		bool		is_empty() const { return m_head == m_tail; }
+
+		// How many items are in the queue (though the other thread may be changing that)
+		size_t		size() const { return m_tail - m_head; }
+	};
+}
+
+#endif
@@ -0,0 +1,294 @@
+/*
+ * common/Snapshot.cpp
+ *
+ * This file is part of Leges Motus, a networked, 2D shooter set in zero gravity.
+ * 
+ * Copyright 2009-2011 Andrew Ayer, Nathan Partlan, Jeffrey Pfau
+ * 
+ * Leges Motus is free and open source software.  You may redistribute it and/or
+ * modify it under the terms of version 2, or (at your option) version 3, of the
+ * GNU General Public License (GPL), as published by the Free Software Foundation.
+ * 
+ * Leges Motus is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.  See the full text of the GNU General Public License for
+ * further detail.
+ * 
+ * For a full copy of the GNU General Public License, please see the COPYING file
+ * in the root of the source code tree.  You may also retrieve a copy from
+ * <http://www.gnu.org/licenses/gpl-2.0.txt>, or request a copy by writing to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ * 02111-1307  USA
+ * 
+ */
+
+#include "Snapshot.hpp"
+
+using namespace LM;
+using namespace std;
+
+#include "Player.hpp"
+#include "BinaryWriter.hpp"
+#include "BinaryReader.hpp"
+#include <algorithm>
+#include <math.h>
+
+namespace {
+	int32_t		quantize(float value, int scale) {
+		return int32_t(floor(value * scale + 0.5));
+	}
+
+	uint16_t	quantize_angle(float degrees) {
+		return uint16_t(int32_t(floor(degrees * (Snapshot::ANGLE_STEPS / 360.0) + 0.5)) & 0xFFFF);
+	}
+
+	// Angles come back in the range [-180, 180)
+	float		dequantize_angle(uint16_t angle) {
+		return int16_t(angle) * (360.0f / Snapshot::ANGLE_STEPS);
+	}
+}
+
+Snapshot::PlayerState::PlayerState(uint32_t id) {
+	player_id = id;
+	x = y = 0;
+	x_vel = y_vel = 0;
+	rotation = gun_rotation = 0;
+	energy = 0;
+	current_weapon_id = 0;
+	flags = 0;
+}
+
+void	Snapshot::PlayerState::capture(const Player& player) {
+	player_id = player.get_id();
+	x = quantize(player.get_x(), POSITION_SCALE);
+	y = quantize(player.get_y(), POSITION_SCALE);
+	x_vel = quantize(player.get_x_vel(), VELOCITY_SCALE);
+	y_vel = quantize(player.get_y_vel(), VELOCITY_SCALE);
+	rotation = quantize_angle(player.get_rotation_degrees());
+	gun_rotation = quantize_angle(player.get_gun_rotation_degrees());
+	energy = player.get_energy();
+	current_weapon_id = player.get_current_weapon_id();
+
+	flags = 0;
+	if (player.is_invisible())		{ flags |= FLAG_INVISIBLE; }
+	if (player.is_frozen())			{ flags |= FLAG_FROZEN; }
+	if (player.is_grabbing_obstacle())	{ flags |= FLAG_GRABBING_OBSTACLE; }
+}
+
+void	Snapshot::PlayerState::fill_player_update(Packet::PlayerUpdate* p) const {
+	p->player_id = player_id;
+	p->x = float(x) / POSITION_SCALE;
+	p->y = float(y) / POSITION_SCALE;
+	p->x_vel = float(x_vel) / VELOCITY_SCALE;
+	p->y_vel = float(y_vel) / VELOCITY_SCALE;
+	p->rotation = dequantize_angle(rotation);
+	p->energy = energy;
+	p->gun_rotation = dequantize_angle(gun_rotation);
+	p->current_weapon_id = current_weapon_id;
+	p->flags = "";
+	if (flags & FLAG_INVISIBLE) {
+		p->flags->append(1, 'I');
+	}
+	if (flags & FLAG_FROZEN) {
+		p->flags->append(1, 'F');
+	}
+	if (flags & FLAG_GRABBING_OBSTACLE) {
+		p->flags->append(1, 'G');
+	}
+}
+
+int	Snapshot::PlayerState::get_changed_fields(const PlayerState& other) const {
+	int	changed = 0;
+	if (x != other.x || y != other.y)			{ changed |= FIELD_POSITION; }
+	if (x_vel != other.x_vel || y_vel != other.y_vel)	{ changed |= FIELD_VELOCITY; }
+	if (rotation != other.rotation)				{ changed |= FIELD_ROTATION; }
+	if (gun_rotation != other.gun_rotation)			{ changed |= FIELD_GUN_ROTATION; }
+	if (energy != other.energy)				{ changed |= FIELD_ENERGY; }
+	if (current_weapon_id != other.current_weapon_id)	{ changed |= FIELD_WEAPON; }
+	if (flags != other.flags)				{ changed |= FIELD_FLAGS; }
+	return changed;
+}
+
+Snapshot::Snapshot() {
+	m_id = 0;
+}
+
+void	Snapshot::reset(uint32_t id) {
+	m_id = id;
+	m_players.clear();
+}
+
+void	Snapshot::add_player(const Player& player) {
+	PlayerState	state;
+	state.capture(player);
+	add_player(state);
+}
+
+void	Snapshot::add_player(const PlayerState& state) {
+	m_players.insert(std::upper_bound(m_players.begin(), m_players.end(), state), state);
+}
+
+const Snapshot::PlayerState*	Snapshot::find_player(uint32_t player_id) const {
+	std::vector<PlayerState>::const_iterator	it(std::lower_bound(m_players.begin(), m_players.end(), PlayerState(player_id)));
+	return it != m_players.end() && it->player_id == player_id ? &*it : NULL;
+}
+
+void	Snapshot::write(BinaryWriter& w, const Snapshot* baseline) const {
+	static const std::vector<PlayerState>	no_players;
+	const std::vector<PlayerState>&		baseline_players(baseline ? baseline->m_players : no_players);
+	const PlayerState			zero_state;
+
+	// Both lists of players are sorted, so the players which have been removed, added, or changed
+	// can be found by walking the two lists in step.  The first pass just counts them.
+	size_t		nbr_removed = 0;
+	size_t		nbr_changed = 0;
+	{
+		std::vector<PlayerState>::const_iterator	old_it(baseline_players.begin());
+		std::vector<PlayerState>::const_iterator	new_it(m_players.begin());
+		while (old_it != baseline_players.end() || new_it != m_players.end()) {
+			if (new_it == m_players.end() || (old_it != baseline_players.end() && old_it->player_id < new_it->player_id)) {
+				++nbr_removed;
+				++old_it;
+			} else if (old_it == baseline_players.end() || new_it->player_id < old_it->player_id) {
+				++nbr_changed;
+				++new_it;
+			} else {
+				if (new_it->get_changed_fields(*old_it)) {
+					++nbr_changed;
+				}
+				++old_it;
+				++new_it;
+			}
+		}
+	}
+
+	w.put_varint(nbr_removed);
+	if (nbr_removed) {
+		std::vector<PlayerState>::const_iterator	new_it(m_players.begin());
+		for (std::vector<PlayerState>::const_iterator old_it(baseline_players.begin()); old_it != baseline_players.end(); ++old_it) {
+			while (new_it != m_players.end() && new_it->player_id < old_it->player_id) {
+				++new_it;
+			}
+			if (new_it == m_players.end() || new_it->player_id != old_it->player_id) {
+				w.put_varint(old_it->player_id);
+			}
+		}
+	}
+
+	w.put_varint(nbr_changed);
+	std::vector<PlayerState>::const_iterator	old_it(baseline_players.begin());
+	for (std::vector<PlayerState>::const_iterator new_it(m_players.begin()); new_it != m_players.end(); ++new_it) {
+		while (old_it != baseline_players.end() && old_it->player_id < new_it->player_id) {
+			++old_it;
+		}
+		const PlayerState&	old_state(old_it != baseline_players.end() && old_it->player_id == new_it->player_id ? *old_it : zero_state);
+		const int		changed = new_it->get_changed_fields(old_state);
+		if (!changed && &old_state != &zero_state) {
+			continue;
+		}
+
+		w.put_varint(new_it->player_id);
+		w.put_byte(changed);
+		if (changed & FIELD_POSITION) {
+			w.put_signed_varint(int64_t(new_it->x) - old_state.x);
+			w.put_signed_varint(int64_t(new_it->y) - old_state.y);
+		}
+		if (changed & FIELD_VELOCITY) {
+			w.put_signed_varint(int64_t(new_it->x_vel) - old_state.x_vel);
+			w.put_signed_varint(int64_t(new_it->y_vel) - old_state.y_vel);
+		}
+		if (changed & FIELD_ROTATION) {
+			w.put_signed_varint(int16_t(new_it->rotation - old_state.rotation));
+		}
+		if (changed & FIELD_GUN_ROTATION) {
+			w.put_signed_varint(int16_t(new_it->gun_rotation - old_state.gun_rotation));
+		}
+		if (changed & FIELD_ENERGY) {
+			w.put_signed_varint(int64_t(new_it->energy) - old_state.energy);
+		}
+		if (changed & FIELD_WEAPON) {
+			w.put_varint(new_it->current_weapon_id);
+		}
+		if (changed & FIELD_FLAGS) {
+			w.put_byte(new_it->flags);
+		}
+	}
+}
+
+bool	Snapshot::read(BinaryReader& r, const Snapshot* baseline) {
+	uint32_t	id = m_id;
+	reset(0);
+	if (baseline) {
+		m_players = baseline->m_players;
+	}
+
+	size_t		nbr_removed = r.get_varint();
+	for (size_t i = 0; i < nbr_removed && !r.has_underflowed(); ++i) {
+		PlayerState	removed(r.get_varint());
+		std::vector<PlayerState>::iterator	it(std::lower_bound(m_players.begin(), m_players.end(), removed));
+		if (it == m_players.end() || it->player_id != removed.player_id) {
+			return false;
+		}
+		m_players.erase(it);
+	}
+
+	size_t		nbr_changed = r.get_varint();
+	for (size_t i = 0; i < nbr_changed && !r.has_underflowed(); ++i) {
+		PlayerState	changed_state(r.get_varint());
+		std::vector<PlayerState>::iterator	it(std::lower_bound(m_players.begin(), m_players.end(), changed_state));
+		if (it == m_players.end() || it->player_id != changed_state.player_id) {
+			it = m_players.insert(it, changed_state);
+		}
+
+		PlayerState&	state(*it);
+		const int	changed = r.get_byte();
+		if (changed & FIELD_POSITION) {
+			state.x += r.get_signed_varint();
+			state.y += r.get_signed_varint();
+		}
+		if (changed & FIELD_VELOCITY) {
+			state.x_vel += r.get_signed_varint();
+			state.y_vel += r.get_signed_varint();
+		}
+		if (changed & FIELD_ROTATION) {
+			state.rotation += r.get_signed_varint();
+		}
+		if (changed & FIELD_GUN_ROTATION) {
+			state.gun_rotation += r.get_signed_varint();
+		}
+		if (changed & FIELD_ENERGY) {
+			state.energy += r.get_signed_varint();
+		}
+		if (changed & FIELD_WEAPON) {
+			state.current_weapon_id = r.get_varint();
+		}
+		if (changed & FIELD_FLAGS) {
+			state.flags = r.get_byte();
+		}
+	}
+
+	if (r.has_underflowed()) {
+		m_players.clear();
+		return false;
+	}
+
+	m_id = id;
+	return true;
+}
+
+Snapshot&	SnapshotHistory::add(uint32_t id) {
+	Snapshot&	snapshot(m_snapshots[id % HISTORY_SIZE]);
+	snapshot.reset(id);
+	return snapshot;
+}
+
+const Snapshot*	SnapshotHistory::get(uint32_t id) const {
+	const Snapshot&	snapshot(m_snapshots[id % HISTORY_SIZE]);
+	return id != 0 && snapshot.get_id() == id ? &snapshot : NULL;
+}
+
+void	SnapshotHistory::clear() {
+	for (size_t i = 0; i < HISTORY_SIZE; ++i) {
+		m_snapshots[i].reset(0);
+	}
+}
@@ -0,0 +1,168 @@
+/*
+ * common/Snapshot.hpp
+ *
+ * This file is part of Leges Motus, a networked, 2D shooter set in zero gravity.
+ * 
+ * Copyright 2009-2011 Andrew Ayer, Nathan Partlan, Jeffrey Pfau
+ * 
+ * Leges Motus is free and open source software.  You may redistribute it and/or
+ * modify it under the terms of version 2, or (at your option) version 3, of the
+ * GNU General Public License (GPL), as published by the Free Software Foundation.
+ * 
+ * Leges Motus is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.  See the full text of the GNU General Public License for
+ * further detail.
+ * 
+ * For a full copy of the GNU General Public License, please see the COPYING file
+ * in the root of the source code tree.  You may also retrieve a copy from
+ * <http://www.gnu.org/licenses/gpl-2.0.txt>, or request a copy by writing to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ * 02111-1307  USA
+ * 
+ */
+
+#ifndef LM_COMMON_SNAPSHOT_HPP
+#define LM_COMMON_SNAPSHOT_HPP
+
+#include "Packet.hpp"
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+namespace LM {
+	class Player;
+	class BinaryWriter;
+	class BinaryReader;
+
+	/*
+	 * A snapshot of the state of every player in the world at one instant, as sent in a WORLD_SNAPSHOT packet.
+	 *
+	 * Fields are quantized when the snapshot is taken, so that the sender and the receiver (which only ever
+	 * sees the quantized values) agree exactly on the contents of every snapshot.  This lets a snapshot be
+	 * delta-encoded against an earlier snapshot (the baseline) which the receiver is known to have:
+	 *
+	 *   varint	number of players removed since the baseline
+	 *   varint	ID of each removed player
+	 *   varint	number of players added or changed since the baseline
+	 *   For each added or changed player:
+	 *     varint	player ID
+	 *     byte	bitmask of the fields which have changed (FIELD_*)
+	 *     Then each changed field, in the order of the FIELD_* bits:
+	 *       Position, velocity, rotation, gun rotation, energy - signed varint difference from the baseline
+	 *       Weapon - varint
+	 *       Flags - byte (FLAG_*)
+	 *
+	 * Players which are unchanged since the baseline aren't sent at all.  A player missing from
+	 * the baseline is encoded against a player whose fields are all zero.
+	 */
+	class Snapshot {
+	public:
+		// Quantization of the fields
+		enum {
+			POSITION_SCALE = 16,		// 1/16 of a pixel
+			VELOCITY_SCALE = 16,		// 1/16 of a pixel per second
+			ANGLE_STEPS = 65536		// Angles are stored in 16 bits
+		};
+
+		// Bits of the changed-field bitmask
+		enum {
+			FIELD_POSITION = 1,
+			FIELD_VELOCITY = 2,
+			FIELD_ROTATION = 4,
+			FIELD_GUN_ROTATION = 8,
+			FIELD_ENERGY = 16,
+			FIELD_WEAPON = 32,
+			FIELD_FLAGS = 64
+		};
+
+		// Bits of PlayerState::flags
+		enum {
+			FLAG_INVISIBLE = 1,
+			FLAG_FROZEN = 2,
+			FLAG_GRABBING_OBSTACLE = 4,
+			FLAG_HELD_BACK = 8		// The sender held back this player's update, so the state is the one it last sent
+		};
+
+		struct PlayerState {
+			uint32_t	player_id;
+			int32_t		x;
+			int32_t		y;
+			int32_t		x_vel;
+			int32_t		y_vel;
+			uint16_t	rotation;
+			uint16_t	gun_rotation;
+			int32_t		energy;
+			uint32_t	current_weapon_id;
+			uint8_t		flags;
+
+			explicit PlayerState(uint32_t id =0);
+
+			// Quantize the given player's current state
+			void		capture(const Player& player);
+
+			// Fill in a PLAYER_UPDATE with this state (so it can be applied with Player::read_player_update)
+			void		fill_player_update(Packet::PlayerUpdate* p) const;
+
+			// Which fields (FIELD_* bits) differ from the other state?
+			int		get_changed_fields(const PlayerState& other) const;
+
+			bool		operator<(const PlayerState& other) const { return player_id < other.player_id; }
+		};
+
+	private:
+		uint32_t			m_id;		// 0 if this snapshot is invalid
+		std::vector<PlayerState>	m_players;	// Sorted by player ID
+
+	public:
+		Snapshot();
+
+		uint32_t		get_id() const { return m_id; }
+		bool			is_valid() const { return m_id != 0; }
+
+		// Empty the snapshot, and give it a new ID (keeps the storage for the players)
+		void			reset(uint32_t id);
+
+		// Add the current state of the given player
+		void			add_player(const Player& player);
+		// Add a state taken from another snapshot
+		void			add_player(const PlayerState& state);
+
+		size_t			get_nbr_players() const { return m_players.size(); }
+		const PlayerState&	get_player(size_t i) const { return m_players[i]; }
+		// Returns NULL if the given player isn't in this snapshot
+		const PlayerState*	find_player(uint32_t player_id) const;
+
+		// Write the delta encoding of this snapshot against the given baseline (or against an empty snapshot if NULL)
+		void			write(BinaryWriter& w, const Snapshot* baseline) const;
+
+		// Read the delta encoding of a snapshot against the given baseline (which must not be this snapshot)
+		// Returns false if the encoding was malformed, in which case this snapshot is left invalid.
+		bool			read(BinaryReader& r, const Snapshot* baseline);
+	};
+
+	/*
+	 * The most recent snapshots, kept around so that they can be used as baselines.
+	 * Snapshot IDs must be non-zero and increasing.
+	 */
+	class SnapshotHistory {
+	public:
+		enum { HISTORY_SIZE = 32 };	// About a second's worth of snapshots at the player update rate
+
+	private:
+		Snapshot	m_snapshots[HISTORY_SIZE];
+
+	public:
+		// Make room for the snapshot with the given ID, overwriting the oldest snapshot
+		// The returned snapshot is empty.
+		Snapshot&	add(uint32_t id);
+
+		// Returns NULL if the snapshot with the given ID has been overwritten (or never added)
+		const Snapshot*	get(uint32_t id) const;
+
+		// Forget all snapshots
+		void		clear();
+	};
+}
+
+#endif
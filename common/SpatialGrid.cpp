@@ -0,0 +1,97 @@
+/*
+ * common/SpatialGrid.cpp
+ *
+ * This file is part of Leges Motus, a networked, 2D shooter set in zero gravity.
+ * 
+ * Copyright 2009-2011 Andrew Ayer, Nathan Partlan, Jeffrey Pfau
+ * 
+ * Leges Motus is free and open source software.  You may redistribute it and/or
+ * modify it under the terms of version 2, or (at your option) version 3, of the
+ * GNU General Public License (GPL), as published by the Free Software Foundation.
+ * 
+ * Leges Motus is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.  See the full text of the GNU General Public License for
+ * further detail.
+ * 
+ * For a full copy of the GNU General Public License, please see the COPYING file
+ * in the root of the source code tree.  You may also retrieve a copy from
+ * <http://www.gnu.org/licenses/gpl-2.0.txt>, or request a copy by writing to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ * 02111-1307  USA
+ * 
+ */
+
+#include "SpatialGrid.hpp"
+#include "common/Player.hpp"
+#include <algorithm>
+#include <cmath>
+
+using namespace LM;
+using namespace std;
+
+namespace {
+	// The radius of the circle around a player's box, however it's rotated
+	// (PLAYER_WIDTH and PLAYER_HEIGHT are already half-extents, as passed to SetAsBox)
+	const float PLAYER_RADIUS = sqrt(Player::PLAYER_WIDTH * Player::PLAYER_WIDTH + Player::PLAYER_HEIGHT * Player::PLAYER_HEIGHT);
+}
+
+SpatialGrid::SpatialGrid() {
+	init(0, 0);
+}
+
+void	SpatialGrid::init(float map_width, float map_height, float cell_size) {
+	m_cell_size = cell_size;
+	m_width = max(1, int(ceil(map_width / cell_size)));
+	m_height = max(1, int(ceil(map_height / cell_size)));
+	m_cells.clear();
+	m_cells.resize(m_width * m_height);
+	m_occupied_cells.clear();
+}
+
+// Clamped before converting to int, so that points far off of the map don't overflow
+int	SpatialGrid::get_column(float x) const {
+	return int(max(0.0f, min(float(m_width - 1), floor(x / m_cell_size))));
+}
+
+int	SpatialGrid::get_row(float y) const {
+	return int(max(0.0f, min(float(m_height - 1), floor(y / m_cell_size))));
+}
+
+SpatialGrid::Cell&	SpatialGrid::get_cell(const Point& point) {
+	return m_cells[get_row(point.y) * m_width + get_column(point.x)];
+}
+
+void	SpatialGrid::clear_players() {
+	for (size_t i = 0; i < m_occupied_cells.size(); ++i) {
+		m_cells[m_occupied_cells[i]].players.clear();
+	}
+	m_occupied_cells.clear();
+}
+
+void	SpatialGrid::add_player(Player* player) {
+	Cell&	cell(get_cell(player->get_position()));
+	if (cell.players.empty()) {
+		m_occupied_cells.push_back(&cell - &m_cells[0]);
+	}
+	cell.players.push_back(player);
+}
+
+void	SpatialGrid::find_players(const Point& center, float radius, vector<Player*>& players) const {
+	float	max_distance = radius + PLAYER_RADIUS;
+
+	int	first_column = get_column(center.x - max_distance);
+	int	last_column = get_column(center.x + max_distance);
+	int	first_row = get_row(center.y - max_distance);
+	int	last_row = get_row(center.y + max_distance);
+	for (int row = first_row; row <= last_row; ++row) {
+		for (int column = first_column; column <= last_column; ++column) {
+			const vector<Player*>&	cell_players(m_cells[row * m_width + column].players);
+			for (size_t i = 0; i < cell_players.size(); ++i) {
+				if (Point::distance(center, cell_players[i]->get_position()) <= max_distance) {
+					players.push_back(cell_players[i]);
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,76 @@
+/*
+ * common/SpatialGrid.hpp
+ *
+ * This file is part of Leges Motus, a networked, 2D shooter set in zero gravity.
+ * 
+ * Copyright 2009-2011 Andrew Ayer, Nathan Partlan, Jeffrey Pfau
+ * 
+ * Leges Motus is free and open source software.  You may redistribute it and/or
+ * modify it under the terms of version 2, or (at your option) version 3, of the
+ * GNU General Public License (GPL), as published by the Free Software Foundation.
+ * 
+ * Leges Motus is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.  See the full text of the GNU General Public License for
+ * further detail.
+ * 
+ * For a full copy of the GNU General Public License, please see the COPYING file
+ * in the root of the source code tree.  You may also retrieve a copy from
+ * <http://www.gnu.org/licenses/gpl-2.0.txt>, or request a copy by writing to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ * 02111-1307  USA
+ * 
+ */
+
+#ifndef LM_COMMON_SPATIALGRID_HPP
+#define LM_COMMON_SPATIALGRID_HPP
+
+#include "common/Point.hpp"
+#include <vector>
+#include <stddef.h>
+
+namespace LM {
+	class Player;
+
+	/*
+	 * A uniform grid laid over the map, for finding the players near a point without looking
+	 * at every one of them.
+	 *
+	 * Players are filed under the cell containing their center, and must be re-filed whenever
+	 * they move (GameLogic does this after every step).  Players outside the map are filed
+	 * under the nearest cell on the edge.
+	 */
+	class SpatialGrid {
+	public:
+		enum { DEFAULT_CELL_SIZE = 256 };	// In game units
+
+	private:
+		struct Cell {
+			std::vector<Player*>	players;
+		};
+
+		float			m_cell_size;
+		int			m_width;		// In cells
+		int			m_height;
+		std::vector<Cell>	m_cells;
+		std::vector<size_t>	m_occupied_cells;	// Cells with players in them, so they can be emptied quickly
+
+		int			get_column(float x) const;
+		int			get_row(float y) const;
+		Cell&			get_cell(const Point& point);
+
+	public:
+		SpatialGrid();
+
+		// Forget everything, and cover a map of the given size (in game units)
+		void			init(float map_width, float map_height, float cell_size =DEFAULT_CELL_SIZE);
+
+		void			clear_players();
+		void			add_player(Player* player);
+
+		// Append the players whose bounding circles come within radius of the given point
+		void			find_players(const Point& center, float radius, std::vector<Player*>& players) const;
+	};
+}
+
+#endif
@@ -401,6 +401,36 @@ Packet::PlayerHit* StandardGun::generate_next_hit_packet(Packet::PlayerHit* p, P
 	return NULL;
 }
 
+bool StandardGun::is_valid_hit(const b2World* physics, const PlayerHistory::Transform& shooter, const PlayerHistory::Transform& hit_player, const Packet::PlayerHit* p, float tolerance) const {
+	stringstream s(*p->extradata.item);
+	
+	float direction;
+	if (!(s >> direction)) {
+		return false;
+	}
+	
+	Point start(shooter.x, shooter.y);
+	
+	// Follow each projectile of the shot, as fire() does
+	float currdirection = direction - m_angle/2.0f;
+	
+	for (int i = 0; i < m_nbr_projectiles; i++) {
+		float distance = PlayerHistory::intersect_ray(hit_player, start, currdirection, tolerance);
+		
+		if (distance >= 0 && distance <= m_max_range + tolerance) {
+			// Walls stop the projectile, unless it can penetrate them
+			Point end(start.x + distance * cos(currdirection), start.y + distance * sin(currdirection));
+			if (m_penetrates_walls > 0 || PlayerHistory::is_line_clear(physics, start, end)) {
+				return true;
+			}
+		}
+		
+		currdirection += m_angle/(m_nbr_projectiles - 1.0);
+	}
+	
+	return false;
+}
+
 float32 StandardGun::ReportFixture(b2Fixture* fixture, const b2Vec2& point, const b2Vec2& normal, float32 fraction) {
 	b2Body* body = fixture->GetBody();
 	
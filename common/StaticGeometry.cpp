@@ -0,0 +1,231 @@
+/*
+ * common/StaticGeometry.cpp
+ *
+ * This file is part of Leges Motus, a networked, 2D shooter set in zero gravity.
+ * 
+ * Copyright 2009-2011 Andrew Ayer, Nathan Partlan, Jeffrey Pfau
+ * 
+ * Leges Motus is free and open source software.  You may redistribute it and/or
+ * modify it under the terms of version 2, or (at your option) version 3, of the
+ * GNU General Public License (GPL), as published by the Free Software Foundation.
+ * 
+ * Leges Motus is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.  See the full text of the GNU General Public License for
+ * further detail.
+ * 
+ * For a full copy of the GNU General Public License, please see the COPYING file
+ * in the root of the source code tree.  You may also retrieve a copy from
+ * <http://www.gnu.org/licenses/gpl-2.0.txt>, or request a copy by writing to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ * 02111-1307  USA
+ * 
+ */
+
+#include "StaticGeometry.hpp"
+#include "common/PhysicsObject.hpp"
+#include "common/MapObject.hpp"
+#include <algorithm>
+
+using namespace LM;
+using namespace std;
+
+namespace {
+	// For sorting fixtures along an axis, when splitting a node
+	struct CompareX {
+		template<class T> bool operator()(const T& a, const T& b) const { return a.center_x < b.center_x; }
+	};
+	struct CompareY {
+		template<class T> bool operator()(const T& a, const T& b) const { return a.center_y < b.center_y; }
+	};
+}
+
+void	StaticGeometry::clear() {
+	m_nodes.clear();
+	m_fixtures.clear();
+}
+
+void	StaticGeometry::build(const b2World* world) {
+	clear();
+
+	for (const b2Body* body = world->GetBodyList(); body != NULL; body = body->GetNext()) {
+		if (body->GetType() != b2_staticBody || body->GetUserData() == NULL) {
+			continue;
+		}
+
+		for (const b2Fixture* fixture = body->GetFixtureList(); fixture != NULL; fixture = fixture->GetNext()) {
+			if (fixture->IsSensor()) {
+				continue;
+			}
+
+			// Map geometry is made of polygons and circles, which only have one child
+			b2AABB		aabb;
+			fixture->GetShape()->ComputeAABB(&aabb, body->GetTransform(), 0);
+
+			Fixture		entry;
+			entry.bounds.min_x = aabb.lowerBound.x;
+			entry.bounds.min_y = aabb.lowerBound.y;
+			entry.bounds.max_x = aabb.upperBound.x;
+			entry.bounds.max_y = aabb.upperBound.y;
+			entry.center_x = (aabb.lowerBound.x + aabb.upperBound.x) / 2;
+			entry.center_y = (aabb.lowerBound.y + aabb.upperBound.y) / 2;
+			entry.fixture = fixture;
+			entry.object = static_cast<PhysicsObject*>(body->GetUserData());
+			m_fixtures.push_back(entry);
+		}
+	}
+
+	if (!m_fixtures.empty()) {
+		m_nodes.reserve(2 * m_fixtures.size() / MAX_LEAF_SIZE + 1);
+		build_node(0, m_fixtures.size(), 0);
+	}
+}
+
+uint32_t	StaticGeometry::build_node(size_t first, size_t count, unsigned int depth) {
+	uint32_t	node_index = m_nodes.size();
+	m_nodes.push_back(Node());
+
+	Bounds		bounds = m_fixtures[first].bounds;
+	Bounds		centers = { m_fixtures[first].center_x, m_fixtures[first].center_y, m_fixtures[first].center_x, m_fixtures[first].center_y };
+	for (size_t i = first + 1; i < first + count; ++i) {
+		const Fixture&	fixture(m_fixtures[i]);
+		bounds.min_x = min(bounds.min_x, fixture.bounds.min_x);
+		bounds.min_y = min(bounds.min_y, fixture.bounds.min_y);
+		bounds.max_x = max(bounds.max_x, fixture.bounds.max_x);
+		bounds.max_y = max(bounds.max_y, fixture.bounds.max_y);
+		centers.min_x = min(centers.min_x, fixture.center_x);
+		centers.min_y = min(centers.min_y, fixture.center_y);
+		centers.max_x = max(centers.max_x, fixture.center_x);
+		centers.max_y = max(centers.max_y, fixture.center_y);
+	}
+	m_nodes[node_index].bounds = bounds;
+
+	if (count <= MAX_LEAF_SIZE || depth + 1 >= MAX_DEPTH) {
+		m_nodes[node_index].index = first;
+		m_nodes[node_index].count = count;
+		return node_index;
+	}
+
+	// Split at the median, along the axis where the fixtures are most spread out
+	vector<Fixture>::iterator	begin(m_fixtures.begin() + first);
+	vector<Fixture>::iterator	middle(begin + count / 2);
+	if (centers.max_x - centers.min_x >= centers.max_y - centers.min_y) {
+		nth_element(begin, middle, begin + count, CompareX());
+	} else {
+		nth_element(begin, middle, begin + count, CompareY());
+	}
+
+	build_node(first, count / 2, depth + 1);
+	uint32_t	second_child = build_node(first + count / 2, count - count / 2, depth + 1);
+	m_nodes[node_index].index = second_child;
+	m_nodes[node_index].count = 0;
+	return node_index;
+}
+
+bool	StaticGeometry::intersects(const Bounds& bounds, const b2Vec2& start, const b2Vec2& delta, const b2Vec2& inv_delta, float max_t, float& t_enter) {
+	float	t_min = 0;
+	float	t_max = max_t;
+
+	if (delta.x != 0) {
+		float	t1 = (bounds.min_x - start.x) * inv_delta.x;
+		float	t2 = (bounds.max_x - start.x) * inv_delta.x;
+		t_min = max(t_min, min(t1, t2));
+		t_max = min(t_max, max(t1, t2));
+	} else if (start.x < bounds.min_x || start.x > bounds.max_x) {
+		return false;
+	}
+
+	if (delta.y != 0) {
+		float	t1 = (bounds.min_y - start.y) * inv_delta.y;
+		float	t2 = (bounds.max_y - start.y) * inv_delta.y;
+		t_min = max(t_min, min(t1, t2));
+		t_max = min(t_max, max(t1, t2));
+	} else if (start.y < bounds.min_y || start.y > bounds.max_y) {
+		return false;
+	}
+
+	t_enter = t_min;
+	return t_min <= t_max;
+}
+
+PhysicsObject*	StaticGeometry::cast_ray(const b2Vec2& start, const b2Vec2& end, bool ignore_collidable, float max_fraction, float& fraction) const {
+	if (m_nodes.empty()) {
+		return NULL;
+	}
+
+	b2Vec2		delta(end - start);
+	b2Vec2		inv_delta(delta.x != 0 ? 1 / delta.x : 0, delta.y != 0 ? 1 / delta.y : 0);
+
+	b2RayCastInput	input;
+	input.p1 = start;
+	input.p2 = end;
+
+	PhysicsObject*	closest_object = NULL;
+	float		closest_fraction = max_fraction;
+
+	// Nodes still to visit (the nearer child of each interior node is visited first)
+	uint32_t	stack[MAX_DEPTH];
+	size_t		stack_size = 0;
+	uint32_t	node_index = 0;
+	float		t_enter;
+
+	if (!intersects(m_nodes[0].bounds, start, delta, inv_delta, closest_fraction, t_enter)) {
+		return NULL;
+	}
+
+	while (true) {
+		const Node&	node(m_nodes[node_index]);
+
+		if (node.count) {
+			for (uint32_t i = node.index; i < node.index + node.count; ++i) {
+				const Fixture&	fixture(m_fixtures[i]);
+				if (!intersects(fixture.bounds, start, delta, inv_delta, closest_fraction, t_enter)) {
+					continue;
+				}
+
+				if (fixture.object->get_type() == PhysicsObject::MAP_OBJECT && !ignore_collidable && !static_cast<const MapObject*>(fixture.object)->is_collidable()) {
+					continue;
+				}
+
+				b2RayCastOutput	output;
+				input.maxFraction = closest_fraction;
+				if (fixture.fixture->RayCast(&output, input, 0) && output.fraction >= 0 && output.fraction <= closest_fraction) {
+					closest_fraction = output.fraction;
+					closest_object = fixture.object;
+				}
+			}
+		} else {
+			uint32_t	first_child = node_index + 1;
+			uint32_t	second_child = node.index;
+			float		first_t;
+			float		second_t;
+			bool		hits_first = intersects(m_nodes[first_child].bounds, start, delta, inv_delta, closest_fraction, first_t);
+			bool		hits_second = intersects(m_nodes[second_child].bounds, start, delta, inv_delta, closest_fraction, second_t);
+
+			if (hits_first && hits_second) {
+				// Visit the nearer child now, and come back to the other if nothing closer turns up
+				if (second_t < first_t) {
+					swap(first_child, second_child);
+				}
+				stack[stack_size++] = second_child;
+				node_index = first_child;
+				continue;
+			} else if (hits_first) {
+				node_index = first_child;
+				continue;
+			} else if (hits_second) {
+				node_index = second_child;
+				continue;
+			}
+		}
+
+		// Pop the next node which the ray might still hit something closer in
+		do {
+			if (stack_size == 0) {
+				fraction = closest_fraction;
+				return closest_object;
+			}
+			node_index = stack[--stack_size];
+		} while (!intersects(m_nodes[node_index].bounds, start, delta, inv_delta, closest_fraction, t_enter));
+	}
+}
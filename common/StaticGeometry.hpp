@@ -0,0 +1,100 @@
+/*
+ * common/StaticGeometry.hpp
+ *
+ * This file is part of Leges Motus, a networked, 2D shooter set in zero gravity.
+ * 
+ * Copyright 2009-2011 Andrew Ayer, Nathan Partlan, Jeffrey Pfau
+ * 
+ * Leges Motus is free and open source software.  You may redistribute it and/or
+ * modify it under the terms of version 2, or (at your option) version 3, of the
+ * GNU General Public License (GPL), as published by the Free Software Foundation.
+ * 
+ * Leges Motus is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.  See the full text of the GNU General Public License for
+ * further detail.
+ * 
+ * For a full copy of the GNU General Public License, please see the COPYING file
+ * in the root of the source code tree.  You may also retrieve a copy from
+ * <http://www.gnu.org/licenses/gpl-2.0.txt>, or request a copy by writing to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ * 02111-1307  USA
+ * 
+ */
+
+#ifndef LM_COMMON_STATICGEOMETRY_HPP
+#define LM_COMMON_STATICGEOMETRY_HPP
+
+#include "common/physics.hpp"
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+namespace LM {
+	class PhysicsObject;
+
+	/*
+	 * A bounding volume hierarchy over the static bodies of a physics world (the map's edges and
+	 * objects), for casting rays without going through Box2D's world query and its callbacks.
+	 * Map geometry never moves, so the hierarchy is built once, and then only read - any number of
+	 * threads can cast rays through it at once.
+	 *
+	 * The tree is flattened into an array in depth-first order: an interior node's first child comes
+	 * straight after it, and it stores the index of its second child.  Each leaf holds a short run of
+	 * fixtures, kept together in a second array.  Every bounding box is four floats, so a cast is a
+	 * walk through two contiguous arrays with a simple slab test at each step.
+	 *
+	 * Only non-sensor fixtures on static bodies with user data are included (sensors never stop a ray).
+	 * Static bodies created after build() are not seen.
+	 */
+	class StaticGeometry {
+	public:
+		enum {
+			MAX_LEAF_SIZE = 4,	// Fixtures per leaf
+			MAX_DEPTH = 64		// Deeper than any tree with fewer than 2^60 fixtures
+		};
+
+	private:
+		struct Bounds {
+			float		min_x;		// In physics units
+			float		min_y;
+			float		max_x;
+			float		max_y;
+		};
+
+		struct Node {
+			Bounds		bounds;
+			uint32_t	index;		// Leaf: its first fixture in m_fixtures.  Interior: its second child in m_nodes.
+			uint32_t	count;		// Leaf: how many fixtures it has.  Interior: 0
+		};
+
+		struct Fixture {
+			Bounds		bounds;
+			float		center_x;	// Of the bounds (for splitting nodes)
+			float		center_y;
+			const b2Fixture*	fixture;
+			PhysicsObject*	object;		// The body's user data
+		};
+
+		std::vector<Node>	m_nodes;
+		std::vector<Fixture>	m_fixtures;
+
+		// Build the subtree over m_fixtures[first, first + count), returning its index in m_nodes
+		uint32_t	build_node(size_t first, size_t count, unsigned int depth);
+
+		// Does the ray (start + t * delta, for t in [0, max_t]) pass through the box?  If so, set t_enter.
+		static bool	intersects(const Bounds& bounds, const b2Vec2& start, const b2Vec2& delta, const b2Vec2& inv_delta, float max_t, float& t_enter);
+
+	public:
+		void		clear();
+		void		build(const b2World* world);
+		bool		is_empty() const { return m_nodes.empty(); }
+
+		// Find the first thing hit by the ray from start to end, ignoring map objects which aren't
+		// collidable (unless ignore_collidable is true).  Only hits closer than max_fraction count.
+		// Returns the object hit (NULL if none), and sets fraction to how far along the ray it was hit.
+		PhysicsObject*	cast_ray(const b2Vec2& start, const b2Vec2& end, bool ignore_collidable, float max_fraction, float& fraction) const;
+	};
+}
+
+#endif
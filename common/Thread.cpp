@@ -0,0 +1,178 @@
+/*
+ * common/Thread.cpp
+ *
+ * This file is part of Leges Motus, a networked, 2D shooter set in zero gravity.
+ * 
+ * Copyright 2009-2011 Andrew Ayer, Nathan Partlan, Jeffrey Pfau
+ * 
+ * Leges Motus is free and open source software.  You may redistribute it and/or
+ * modify it under the terms of version 2, or (at your option) version 3, of the
+ * GNU General Public License (GPL), as published by the Free Software Foundation.
+ * 
+ * Leges Motus is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.  See the full text of the GNU General Public License for
+ * further detail.
+ * 
+ * For a full copy of the GNU General Public License, please see the COPYING file
+ * in the root of the source code tree.  You may also retrieve a copy from
+ * <http://www.gnu.org/licenses/gpl-2.0.txt>, or request a copy by writing to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ * 02111-1307  USA
+ * 
+ */
+
+#include "Thread.hpp"
+
+#ifdef __WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+using namespace LM;
+using namespace std;
+
+Thread::Thread() {
+	m_is_running = false;
+	m_function = NULL;
+	m_arg = NULL;
+}
+
+Thread::~Thread() {
+	join();
+}
+
+#ifdef __WIN32
+
+unsigned long __stdcall	Thread::run(void* thread) {
+	static_cast<Thread*>(thread)->m_function(static_cast<Thread*>(thread)->m_arg);
+	return 0;
+}
+
+bool	Thread::start(Function function, void* arg) {
+	join();
+	m_function = function;
+	m_arg = arg;
+	m_handle = CreateThread(NULL, 0, run, this, 0, NULL);
+	m_is_running = m_handle != NULL;
+	return m_is_running;
+}
+
+void	Thread::join() {
+	if (m_is_running) {
+		WaitForSingleObject(m_handle, INFINITE);
+		CloseHandle(m_handle);
+		m_is_running = false;
+	}
+}
+
+unsigned int	Thread::get_nbr_processors() {
+	SYSTEM_INFO	info;
+	GetSystemInfo(&info);
+	return info.dwNumberOfProcessors > 0 ? info.dwNumberOfProcessors : 1;
+}
+
+Mutex::Mutex() {
+	InitializeCriticalSection(reinterpret_cast<CRITICAL_SECTION*>(m_critical_section));
+}
+
+Mutex::~Mutex() {
+	DeleteCriticalSection(reinterpret_cast<CRITICAL_SECTION*>(m_critical_section));
+}
+
+void	Mutex::lock() {
+	EnterCriticalSection(reinterpret_cast<CRITICAL_SECTION*>(m_critical_section));
+}
+
+void	Mutex::unlock() {
+	LeaveCriticalSection(reinterpret_cast<CRITICAL_SECTION*>(m_critical_section));
+}
+
+Condition::Condition() {
+	InitializeConditionVariable(reinterpret_cast<CONDITION_VARIABLE*>(&m_condition_variable));
+}
+
+Condition::~Condition() {
+}
+
+void	Condition::wait(Mutex& mutex) {
+	SleepConditionVariableCS(reinterpret_cast<CONDITION_VARIABLE*>(&m_condition_variable), reinterpret_cast<CRITICAL_SECTION*>(mutex.m_critical_section), INFINITE);
+}
+
+void	Condition::signal() {
+	WakeConditionVariable(reinterpret_cast<CONDITION_VARIABLE*>(&m_condition_variable));
+}
+
+void	Condition::broadcast() {
+	WakeAllConditionVariable(reinterpret_cast<CONDITION_VARIABLE*>(&m_condition_variable));
+}
+
+#else
+
+void*	Thread::run(void* thread) {
+	static_cast<Thread*>(thread)->m_function(static_cast<Thread*>(thread)->m_arg);
+	return NULL;
+}
+
+bool	Thread::start(Function function, void* arg) {
+	join();
+	m_function = function;
+	m_arg = arg;
+	m_is_running = pthread_create(&m_thread, NULL, run, this) == 0;
+	return m_is_running;
+}
+
+void	Thread::join() {
+	if (m_is_running) {
+		pthread_join(m_thread, NULL);
+		m_is_running = false;
+	}
+}
+
+unsigned int	Thread::get_nbr_processors() {
+#ifdef _SC_NPROCESSORS_ONLN
+	long	nbr_processors = sysconf(_SC_NPROCESSORS_ONLN);
+	return nbr_processors > 0 ? nbr_processors : 1;
+#else
+	return 1;
+#endif
+}
+
+Mutex::Mutex() {
+	pthread_mutex_init(&m_mutex, NULL);
+}
+
+Mutex::~Mutex() {
+	pthread_mutex_destroy(&m_mutex);
+}
+
+void	Mutex::lock() {
+	pthread_mutex_lock(&m_mutex);
+}
+
+void	Mutex::unlock() {
+	pthread_mutex_unlock(&m_mutex);
+}
+
+Condition::Condition() {
+	pthread_cond_init(&m_condition, NULL);
+}
+
+Condition::~Condition() {
+	pthread_cond_destroy(&m_condition);
+}
+
+void	Condition::wait(Mutex& mutex) {
+	pthread_cond_wait(&m_condition, &mutex.m_mutex);
+}
+
+void	Condition::signal() {
+	pthread_cond_signal(&m_condition);
+}
+
+void	Condition::broadcast() {
+	pthread_cond_broadcast(&m_condition);
+}
+
+#endif
@@ -0,0 +1,145 @@
+/*
+ * common/Thread.hpp
+ *
+ * This file is part of Leges Motus, a networked, 2D shooter set in zero gravity.
+ * 
+ * Copyright 2009-2011 Andrew Ayer, Nathan Partlan, Jeffrey Pfau
+ * 
+ * Leges Motus is free and open source software.  You may redistribute it and/or
+ * modify it under the terms of version 2, or (at your option) version 3, of the
+ * GNU General Public License (GPL), as published by the Free Software Foundation.
+ * 
+ * Leges Motus is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.  See the full text of the GNU General Public License for
+ * further detail.
+ * 
+ * For a full copy of the GNU General Public License, please see the COPYING file
+ * in the root of the source code tree.  You may also retrieve a copy from
+ * <http://www.gnu.org/licenses/gpl-2.0.txt>, or request a copy by writing to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ * 02111-1307  USA
+ * 
+ */
+
+#ifndef LM_COMMON_THREAD_HPP
+#define LM_COMMON_THREAD_HPP
+
+#ifndef __WIN32
+#include <pthread.h>
+#endif
+
+namespace LM {
+	/*
+	 * A thread of execution, running a function until it returns.
+	 * Destroying a Thread waits for the function to return.
+	 */
+	class Thread {
+	public:
+		typedef void	(*Function)(void* arg);
+
+	private:
+#ifdef __WIN32
+		void*		m_handle;
+#else
+		pthread_t	m_thread;
+#endif
+		bool		m_is_running;
+		Function	m_function;
+		void*		m_arg;
+
+#ifdef __WIN32
+		static unsigned long __stdcall	run(void* thread);
+#else
+		static void*	run(void* thread);
+#endif
+
+		// Not copyable
+		Thread(const Thread&);
+		Thread&		operator=(const Thread&);
+
+	public:
+		Thread();
+		~Thread();
+
+		// Returns false if the thread couldn't be created (the function is not called)
+		bool		start(Function function, void* arg);
+		// Wait for the function to return (returns immediately if the thread isn't running)
+		void		join();
+		bool		is_running() const { return m_is_running; }
+
+		// The number of processors that threads can run on (at least 1)
+		static unsigned int	get_nbr_processors();
+	};
+
+	/*
+	 * A mutual exclusion lock.  Lock one with a Mutex::Lock:
+	 *
+	 *	{
+	 *		Mutex::Lock	lock(m_mutex);
+	 *		// ...only one thread at a time gets here...
+	 *	}
+	 */
+	class Mutex {
+		friend class Condition;
+
+	private:
+#ifdef __WIN32
+		void*		m_critical_section[8]; // A CRITICAL_SECTION, without including windows.h here
+#else
+		pthread_mutex_t	m_mutex;
+#endif
+
+		// Not copyable
+		Mutex(const Mutex&);
+		Mutex&		operator=(const Mutex&);
+
+	public:
+		Mutex();
+		~Mutex();
+
+		void		lock();
+		void		unlock();
+
+		class Lock {
+		private:
+			Mutex&	m_mutex;
+			Lock(const Lock&);
+			Lock&	operator=(const Lock&);
+		public:
+			explicit Lock(Mutex& mutex) : m_mutex(mutex) { m_mutex.lock(); }
+			~Lock() { m_mutex.unlock(); }
+		};
+	};
+
+	/*
+	 * A condition variable, for a thread to wait until another thread tells it that something
+	 * (guarded by a Mutex) has changed.
+	 */
+	class Condition {
+	private:
+#ifdef __WIN32
+		void*		m_condition_variable; // A CONDITION_VARIABLE
+#else
+		pthread_cond_t	m_condition;
+#endif
+
+		// Not copyable
+		Condition(const Condition&);
+		Condition&	operator=(const Condition&);
+
+	public:
+		Condition();
+		~Condition();
+
+		// Unlock the mutex (which must be locked), wait to be signalled, and lock it again.
+		// The wait can end without a signal, so check what's being waited for in a loop.
+		void		wait(Mutex& mutex);
+		// Wake one of the waiting threads
+		void		signal();
+		// Wake all the waiting threads
+		void		broadcast();
+	};
+}
+
+#endif
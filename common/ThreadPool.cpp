@@ -0,0 +1,116 @@
+/*
+ * common/ThreadPool.cpp
+ *
+ * This file is part of Leges Motus, a networked, 2D shooter set in zero gravity.
+ * 
+ * Copyright 2009-2011 Andrew Ayer, Nathan Partlan, Jeffrey Pfau
+ * 
+ * Leges Motus is free and open source software.  You may redistribute it and/or
+ * modify it under the terms of version 2, or (at your option) version 3, of the
+ * GNU General Public License (GPL), as published by the Free Software Foundation.
+ * 
+ * Leges Motus is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.  See the full text of the GNU General Public License for
+ * further detail.
+ * 
+ * For a full copy of the GNU General Public License, please see the COPYING file
+ * in the root of the source code tree.  You may also retrieve a copy from
+ * <http://www.gnu.org/licenses/gpl-2.0.txt>, or request a copy by writing to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ * 02111-1307  USA
+ * 
+ */
+
+#include "ThreadPool.hpp"
+
+using namespace LM;
+using namespace std;
+
+ThreadPool::ThreadPool(size_t nbr_threads) {
+	m_task = NULL;
+	m_args = NULL;
+	m_nbr_args = 0;
+	m_next_arg = 0;
+	m_nbr_running = 0;
+	m_stopping = false;
+
+	if (nbr_threads == 0) {
+		nbr_threads = Thread::get_nbr_processors();
+	}
+
+	// The caller is one of the threads
+	for (size_t i = 1; i < nbr_threads; ++i) {
+		Thread*	thread = new Thread;
+		if (!thread->start(run_worker, this)) {
+			// Make do with what we have
+			delete thread;
+			break;
+		}
+		m_threads.push_back(thread);
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		Mutex::Lock	lock(m_mutex);
+		m_stopping = true;
+		m_work_ready.broadcast();
+	}
+
+	for (size_t i = 0; i < m_threads.size(); ++i) {
+		delete m_threads[i];
+	}
+}
+
+void	ThreadPool::run_worker(void* arg) {
+	ThreadPool*	pool = static_cast<ThreadPool*>(arg);
+
+	Mutex::Lock	lock(pool->m_mutex);
+	while (!pool->m_stopping) {
+		if (pool->m_next_arg < pool->m_nbr_args) {
+			pool->run_next();
+		} else {
+			pool->m_work_ready.wait(pool->m_mutex);
+		}
+	}
+}
+
+void	ThreadPool::run_next() {
+	void*	arg = m_args[m_next_arg++];
+	Task	task = m_task;
+	++m_nbr_running;
+
+	m_mutex.unlock();
+	task(arg);
+	m_mutex.lock();
+
+	if (--m_nbr_running == 0 && m_next_arg == m_nbr_args) {
+		m_work_done.broadcast();
+	}
+}
+
+void	ThreadPool::run_all(Task task, void* const* args, size_t nbr_args) {
+	if (nbr_args == 0) {
+		return;
+	}
+
+	Mutex::Lock	lock(m_mutex);
+	m_task = task;
+	m_args = args;
+	m_nbr_args = nbr_args;
+	m_next_arg = 0;
+	m_work_ready.broadcast();
+
+	while (m_next_arg < m_nbr_args) {
+		run_next();
+	}
+	while (m_nbr_running > 0) {
+		m_work_done.wait(m_mutex);
+	}
+
+	m_task = NULL;
+	m_args = NULL;
+	m_nbr_args = 0;
+	m_next_arg = 0;
+}
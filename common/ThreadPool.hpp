@@ -0,0 +1,75 @@
+/*
+ * common/ThreadPool.hpp
+ *
+ * This file is part of Leges Motus, a networked, 2D shooter set in zero gravity.
+ * 
+ * Copyright 2009-2011 Andrew Ayer, Nathan Partlan, Jeffrey Pfau
+ * 
+ * Leges Motus is free and open source software.  You may redistribute it and/or
+ * modify it under the terms of version 2, or (at your option) version 3, of the
+ * GNU General Public License (GPL), as published by the Free Software Foundation.
+ * 
+ * Leges Motus is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.  See the full text of the GNU General Public License for
+ * further detail.
+ * 
+ * For a full copy of the GNU General Public License, please see the COPYING file
+ * in the root of the source code tree.  You may also retrieve a copy from
+ * <http://www.gnu.org/licenses/gpl-2.0.txt>, or request a copy by writing to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ * 02111-1307  USA
+ * 
+ */
+
+#ifndef LM_COMMON_THREADPOOL_HPP
+#define LM_COMMON_THREADPOOL_HPP
+
+#include "Thread.hpp"
+#include <vector>
+#include <stddef.h>
+
+namespace LM {
+	/*
+	 * A set of threads which run a task on each of a list of arguments, in parallel.
+	 * The thread which calls run_all() runs tasks too, until they've all been started.
+	 */
+	class ThreadPool {
+	public:
+		typedef void	(*Task)(void* arg);
+
+	private:
+		std::vector<Thread*>	m_threads;
+		Mutex		m_mutex;
+		Condition	m_work_ready;
+		Condition	m_work_done;
+
+		// The current run_all(), guarded by m_mutex
+		Task		m_task;
+		void* const*	m_args;
+		size_t		m_nbr_args;
+		size_t		m_next_arg;	// The next argument to run the task on
+		size_t		m_nbr_running;	// Tasks which have been started but haven't returned yet
+		bool		m_stopping;
+
+		static void	run_worker(void* pool);
+		// Run the task on the next argument (m_mutex must be locked, and is unlocked while the task runs)
+		void		run_next();
+
+		// Not copyable
+		ThreadPool(const ThreadPool&);
+		ThreadPool&	operator=(const ThreadPool&);
+
+	public:
+		// Use the given number of threads (including the caller's), or one per processor if 0
+		explicit ThreadPool(size_t nbr_threads = 0);
+		~ThreadPool();
+
+		// Run task(args[i]) for every i, and wait for them all to return
+		void		run_all(Task task, void* const* args, size_t nbr_args);
+
+		size_t		get_nbr_threads() const { return m_threads.size() + 1; }
+	};
+}
+
+#endif
@@ -0,0 +1,80 @@
+/*
+ * common/TickClock.cpp
+ *
+ * This file is part of Leges Motus, a networked, 2D shooter set in zero gravity.
+ * 
+ * Copyright 2009-2011 Andrew Ayer, Nathan Partlan, Jeffrey Pfau
+ * 
+ * Leges Motus is free and open source software.  You may redistribute it and/or
+ * modify it under the terms of version 2, or (at your option) version 3, of the
+ * GNU General Public License (GPL), as published by the Free Software Foundation.
+ * 
+ * Leges Motus is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.  See the full text of the GNU General Public License for
+ * further detail.
+ * 
+ * For a full copy of the GNU General Public License, please see the COPYING file
+ * in the root of the source code tree.  You may also retrieve a copy from
+ * <http://www.gnu.org/licenses/gpl-2.0.txt>, or request a copy by writing to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ * 02111-1307  USA
+ * 
+ */
+
+#include "TickClock.hpp"
+
+using namespace LM;
+
+TickClock::TickClock(unsigned int max_catchup) {
+	m_max_catchup = max_catchup;
+	m_nbr_dropped = 0;
+	reset();
+}
+
+void TickClock::reset(uint64_t now) {
+	m_started = true;
+	m_last_time = now;
+	m_accumulator = 0;
+	m_tick = 0;
+}
+
+void TickClock::reset() {
+	reset(0);
+	m_started = false;
+}
+
+unsigned int TickClock::advance(uint64_t now) {
+	if (!m_started) {
+		reset(now);
+		return 0;
+	}
+
+	if (now <= m_last_time) {
+		return 0;
+	}
+
+	m_accumulator += (now - m_last_time) * TICKS_PER_SECOND;
+	m_last_time = now;
+
+	uint64_t	nbr_due = m_accumulator / USEC_PER_SECOND;
+	m_accumulator %= USEC_PER_SECOND;
+	m_tick += nbr_due;
+
+	if (nbr_due > m_max_catchup) {
+		// We've fallen too far behind to catch up
+		m_nbr_dropped += nbr_due - m_max_catchup;
+		nbr_due = m_max_catchup;
+	}
+
+	return nbr_due;
+}
+
+uint64_t TickClock::get_next_tick_time() const {
+	if (!m_started) {
+		return 0;
+	}
+
+	// Round up, so that the tick is really due by then
+	return m_last_time + (USEC_PER_SECOND - m_accumulator + TICKS_PER_SECOND - 1) / TICKS_PER_SECOND;
+}
@@ -0,0 +1,86 @@
+/*
+ * common/TickClock.hpp
+ *
+ * This file is part of Leges Motus, a networked, 2D shooter set in zero gravity.
+ * 
+ * Copyright 2009-2011 Andrew Ayer, Nathan Partlan, Jeffrey Pfau
+ * 
+ * Leges Motus is free and open source software.  You may redistribute it and/or
+ * modify it under the terms of version 2, or (at your option) version 3, of the
+ * GNU General Public License (GPL), as published by the Free Software Foundation.
+ * 
+ * Leges Motus is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.  See the full text of the GNU General Public License for
+ * further detail.
+ * 
+ * For a full copy of the GNU General Public License, please see the COPYING file
+ * in the root of the source code tree.  You may also retrieve a copy from
+ * <http://www.gnu.org/licenses/gpl-2.0.txt>, or request a copy by writing to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ * 02111-1307  USA
+ * 
+ */
+
+#ifndef LM_COMMON_TICKCLOCK_HPP
+#define LM_COMMON_TICKCLOCK_HPP
+
+#include <stdint.h>
+
+namespace LM {
+	/*
+	 * Schedules fixed-length logic ticks against a clock in microseconds (e.g. from get_ticks_usec()).
+	 *
+	 * Elapsed time is accumulated as an integer, scaled by TICKS_PER_SECOND, so a tick is exactly
+	 * 1/TICKS_PER_SECOND of a second and no time is lost to rounding: the part of a tick that hasn't
+	 * elapsed yet carries over to the next call, and two peers count the same ticks over the same time.
+	 *
+	 * Ticks are numbered from the last reset.  If more than max_catchup ticks are due at once
+	 * (e.g. after a stall), the rest are dropped rather than run back-to-back, but they still count
+	 * towards the tick number.
+	 */
+	class TickClock {
+	public:
+		enum {
+			TICKS_PER_SECOND = 60,
+			DEFAULT_MAX_CATCHUP = 5
+		};
+
+	private:
+		enum {
+			USEC_PER_SECOND = 1000000
+		};
+
+		bool		m_started;
+		uint64_t	m_last_time;	// The time of the last advance
+		uint64_t	m_accumulator;	// The time since the latest tick was due, in microseconds * TICKS_PER_SECOND
+		uint64_t	m_tick;		// The number of ticks which have been due, including dropped ones
+		uint64_t	m_nbr_dropped;	// The number of ticks dropped since the clock was made
+		unsigned int	m_max_catchup;
+
+	public:
+		explicit TickClock(unsigned int max_catchup = DEFAULT_MAX_CATCHUP);
+
+		// Start counting ticks from the given time
+		void		reset(uint64_t now);
+		// Start counting ticks from the time of the next advance
+		void		reset();
+
+		void		set_max_catchup(unsigned int max_catchup) { m_max_catchup = max_catchup; }
+
+		// Move the clock forward to the given time, and return the number of ticks to run
+		unsigned int	advance(uint64_t now);
+
+		uint64_t	get_tick() const { return m_tick; }
+		uint64_t	get_nbr_dropped() const { return m_nbr_dropped; }
+
+		// How long ago the latest tick was due, as of the last advance (in microseconds)
+		uint64_t	get_lateness() const { return m_accumulator / TICKS_PER_SECOND; }
+		// The time at which the next tick is due (0 if the clock hasn't started)
+		uint64_t	get_next_tick_time() const;
+
+		static uint64_t	usec_to_ticks(uint64_t usec) { return usec * TICKS_PER_SECOND / USEC_PER_SECOND; }
+	};
+}
+
+#endif
@@ -0,0 +1,47 @@
+/*
+ * common/TimingStats.cpp
+ *
+ * This file is part of Leges Motus, a networked, 2D shooter set in zero gravity.
+ * 
+ * Copyright 2009-2011 Andrew Ayer, Nathan Partlan, Jeffrey Pfau
+ * 
+ * Leges Motus is free and open source software.  You may redistribute it and/or
+ * modify it under the terms of version 2, or (at your option) version 3, of the
+ * GNU General Public License (GPL), as published by the Free Software Foundation.
+ * 
+ * Leges Motus is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.  See the full text of the GNU General Public License for
+ * further detail.
+ * 
+ * For a full copy of the GNU General Public License, please see the COPYING file
+ * in the root of the source code tree.  You may also retrieve a copy from
+ * <http://www.gnu.org/licenses/gpl-2.0.txt>, or request a copy by writing to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ * 02111-1307  USA
+ * 
+ */
+
+#include "TimingStats.hpp"
+#include <ostream>
+
+using namespace LM;
+using namespace std;
+
+void	TimingStats::record(uint64_t sample) {
+	++m_count;
+	m_total += sample;
+	if (sample > m_max) {
+		m_max = sample;
+	}
+}
+
+void	TimingStats::reset() {
+	m_count = 0;
+	m_total = 0;
+	m_max = 0;
+}
+
+ostream&	LM::operator<<(ostream& out, const TimingStats& stats) {
+	return out << stats.get_mean() << '/' << stats.get_max() << " (" << stats.get_count() << ')';
+}
@@ -0,0 +1,57 @@
+/*
+ * common/TimingStats.hpp
+ *
+ * This file is part of Leges Motus, a networked, 2D shooter set in zero gravity.
+ * 
+ * Copyright 2009-2011 Andrew Ayer, Nathan Partlan, Jeffrey Pfau
+ * 
+ * Leges Motus is free and open source software.  You may redistribute it and/or
+ * modify it under the terms of version 2, or (at your option) version 3, of the
+ * GNU General Public License (GPL), as published by the Free Software Foundation.
+ * 
+ * Leges Motus is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.  See the full text of the GNU General Public License for
+ * further detail.
+ * 
+ * For a full copy of the GNU General Public License, please see the COPYING file
+ * in the root of the source code tree.  You may also retrieve a copy from
+ * <http://www.gnu.org/licenses/gpl-2.0.txt>, or request a copy by writing to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ * 02111-1307  USA
+ * 
+ */
+
+#ifndef LM_COMMON_TIMINGSTATS_HPP
+#define LM_COMMON_TIMINGSTATS_HPP
+
+#include <stdint.h>
+#include <iosfwd>
+
+namespace LM {
+	/*
+	 * Accumulates a running count, mean, and maximum of timing samples (e.g. how
+	 * late a tick ran, in microseconds).  Cheap enough to record on every tick.
+	 */
+	class TimingStats {
+	private:
+		uint64_t	m_count;
+		uint64_t	m_total;
+		uint64_t	m_max;
+
+	public:
+		TimingStats() { reset(); }
+
+		void		record(uint64_t sample);
+		void		reset();
+
+		uint64_t	get_count() const { return m_count; }
+		uint64_t	get_mean() const { return m_count ? m_total / m_count : 0; }
+		uint64_t	get_max() const { return m_max; }
+	};
+
+	// Writes "mean/max (count)"
+	std::ostream&	operator<<(std::ostream& out, const TimingStats& stats);
+}
+
+#endif
@@ -34,10 +34,12 @@ namespace LM {
 		T* item;
 
 		TypeWrapper<T>& operator=(const T& other) {
+			// Re-use the existing item, if there is one, to avoid allocating a new one
 			if (item != NULL) {
-				delete item;
+				*item = other;
+			} else {
+				item = new T(other);
 			}
-			item = new T(other);
 			return *this;
 		}
 
@@ -26,6 +26,7 @@
 #include <cstring>
 #include <string>
 #include "PacketWriter.hpp"
+#include "UDPPacketPool.hpp"
 
 using namespace LM;
 using namespace std;
@@ -33,25 +34,25 @@ using namespace std;
 UDPPacket::UDPPacket(size_t max_length) {
 	m_max_length = max_length;
 	m_length = 0;
-	m_data = new char[m_max_length];
+	m_data = UDPPacketPool::allocate(m_max_length);
 }
 
 UDPPacket::UDPPacket(const UDPPacket& other) {
 	m_max_length = other.m_max_length;
 	m_length = other.m_length;
-	m_data = new char[m_max_length];
+	m_data = UDPPacketPool::allocate(m_max_length);
 	m_address = other.m_address;
 	memcpy(m_data, other.m_data, m_length);
 }
 
 UDPPacket::~UDPPacket() {
-	delete[] m_data;
+	UDPPacketPool::release(m_data, m_max_length);
 }
 
 UDPPacket&	UDPPacket::operator=(const UDPPacket& other) {
 	if (m_max_length != other.m_max_length) {
-		char*	new_data = new char[other.m_max_length];
-		delete[] m_data;
+		char*	new_data = UDPPacketPool::allocate(other.m_max_length);
+		UDPPacketPool::release(m_data, m_max_length);
 		m_data = new_data;
 		m_max_length = other.m_max_length;
 	}
@@ -38,6 +38,7 @@ namespace LM {
 		IPAddress	m_address;
 	
 		friend class UDPSocket;
+		friend class BinaryWriter;
 	public:
 		explicit UDPPacket(size_t max_length = MAX_PACKET_LENGTH);
 		UDPPacket(const UDPPacket& other);
@@ -0,0 +1,55 @@
+/*
+ * common/UDPPacketBatch.cpp
+ *
+ * This file is part of Leges Motus, a networked, 2D shooter set in zero gravity.
+ * 
+ * Copyright 2009-2011 Andrew Ayer, Nathan Partlan, Jeffrey Pfau
+ * 
+ * Leges Motus is free and open source software.  You may redistribute it and/or
+ * modify it under the terms of version 2, or (at your option) version 3, of the
+ * GNU General Public License (GPL), as published by the Free Software Foundation.
+ * 
+ * Leges Motus is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.  See the full text of the GNU General Public License for
+ * further detail.
+ * 
+ * For a full copy of the GNU General Public License, please see the COPYING file
+ * in the root of the source code tree.  You may also retrieve a copy from
+ * <http://www.gnu.org/licenses/gpl-2.0.txt>, or request a copy by writing to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ * 02111-1307  USA
+ * 
+ */
+
+#include "UDPPacketBatch.hpp"
+#include <algorithm>
+
+using namespace LM;
+using namespace std;
+
+UDPPacketBatch::UDPPacketBatch(size_t capacity, size_t max_packet_length) : m_packets(std::min<size_t>(capacity, MAX_CAPACITY), UDPPacket(max_packet_length)), m_bodies(m_packets.size()) {
+	m_size = 0;
+}
+
+UDPPacket&	UDPPacketBatch::add() {
+	UDPPacket&	packet(m_packets[m_size++]);
+	packet.clear();
+	return packet;
+}
+
+void	UDPPacketBatch::add(const UDPPacket& packet) {
+	m_packets[m_size++] = packet;
+}
+
+void	UDPPacketBatch::add(const UDPPacket& packet, const PacketBody& body) {
+	m_bodies[m_size] = body;
+	add(packet);
+}
+
+void	UDPPacketBatch::clear() {
+	for (size_t i = 0; i < m_size; ++i) {
+		m_bodies[i] = PacketBody();
+	}
+	m_size = 0;
+}
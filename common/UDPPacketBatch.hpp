@@ -0,0 +1,79 @@
+/*
+ * common/UDPPacketBatch.hpp
+ *
+ * This file is part of Leges Motus, a networked, 2D shooter set in zero gravity.
+ * 
+ * Copyright 2009-2011 Andrew Ayer, Nathan Partlan, Jeffrey Pfau
+ * 
+ * Leges Motus is free and open source software.  You may redistribute it and/or
+ * modify it under the terms of version 2, or (at your option) version 3, of the
+ * GNU General Public License (GPL), as published by the Free Software Foundation.
+ * 
+ * Leges Motus is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.  See the full text of the GNU General Public License for
+ * further detail.
+ * 
+ * For a full copy of the GNU General Public License, please see the COPYING file
+ * in the root of the source code tree.  You may also retrieve a copy from
+ * <http://www.gnu.org/licenses/gpl-2.0.txt>, or request a copy by writing to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ * 02111-1307  USA
+ * 
+ */
+
+#ifndef LM_COMMON_UDPPACKETBATCH_HPP
+#define LM_COMMON_UDPPACKETBATCH_HPP
+
+#include "UDPPacket.hpp"
+#include "PacketBody.hpp"
+#include "network.hpp"
+#include <stddef.h>
+#include <vector>
+
+namespace LM {
+	/*
+	 * A fixed set of UDPPacket buffers which is filled by UDPSocket::recv_batch(),
+	 * or filled by the caller and then sent with UDPSocket::send_batch().
+	 * The buffers are allocated once, up front, and are reused for every batch.
+	 *
+	 * When sending, each packet may have a (shared) PacketBody attached, which is sent straight
+	 * after the packet's own data, without being copied into the packet.
+	 */
+	class UDPPacketBatch {
+	public:
+		enum {
+			MAX_CAPACITY = 64	// The most packets that a batch can hold
+		};
+
+	private:
+		std::vector<UDPPacket>	m_packets;
+		std::vector<PacketBody>	m_bodies;	// Attached to the corresponding entries of m_packets
+		size_t			m_size;		// How many of m_packets are in use
+
+		friend class UDPSocket;
+	public:
+		explicit UDPPacketBatch(size_t capacity = MAX_CAPACITY, size_t max_packet_length = MAX_PACKET_LENGTH);
+
+		size_t			get_capacity() const { return m_packets.size(); }
+		size_t			size() const { return m_size; }
+		bool			is_empty() const { return m_size == 0; }
+		bool			is_full() const { return m_size == m_packets.size(); }
+
+		UDPPacket&		operator[](size_t i) { return m_packets[i]; }
+		const UDPPacket&	operator[](size_t i) const { return m_packets[i]; }
+		const PacketBody&	get_body(size_t i) const { return m_bodies[i]; }
+
+		// Claim the next unused buffer (which will be empty).  The batch must not be full.
+		UDPPacket&		add();
+		// Copy the given packet into the next unused buffer.  The batch must not be full.
+		void			add(const UDPPacket& packet);
+		// Same, but the given body will be sent after the packet's data
+		void			add(const UDPPacket& packet, const PacketBody& body);
+
+		// Mark all buffers as unused (they stay allocated), and release any attached bodies
+		void			clear();
+	};
+}
+
+#endif
@@ -0,0 +1,84 @@
+/*
+ * common/UDPPacketPool.cpp
+ *
+ * This file is part of Leges Motus, a networked, 2D shooter set in zero gravity.
+ * 
+ * Copyright 2009-2011 Andrew Ayer, Nathan Partlan, Jeffrey Pfau
+ * 
+ * Leges Motus is free and open source software.  You may redistribute it and/or
+ * modify it under the terms of version 2, or (at your option) version 3, of the
+ * GNU General Public License (GPL), as published by the Free Software Foundation.
+ * 
+ * Leges Motus is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.  See the full text of the GNU General Public License for
+ * further detail.
+ * 
+ * For a full copy of the GNU General Public License, please see the COPYING file
+ * in the root of the source code tree.  You may also retrieve a copy from
+ * <http://www.gnu.org/licenses/gpl-2.0.txt>, or request a copy by writing to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ * 02111-1307  USA
+ * 
+ */
+
+#include "UDPPacketPool.hpp"
+#include "network.hpp"
+
+using namespace LM;
+using namespace std;
+
+uint64_t	UDPPacketPool::s_nbr_heap_allocations = 0;
+uint64_t	UDPPacketPool::s_nbr_pool_allocations = 0;
+
+vector<char*>&	UDPPacketPool::get_free_buffers() {
+	// Intentionally never destroyed, so that packets which are destroyed during
+	// static destruction can still return their buffers.
+	static vector<char*>*	free_buffers = new vector<char*>;
+	return *free_buffers;
+}
+
+Mutex&	UDPPacketPool::get_mutex() {
+	// Never destroyed either
+	static Mutex*	mutex = new Mutex;
+	return *mutex;
+}
+
+char*	UDPPacketPool::allocate(size_t length) {
+	Mutex::Lock	lock(get_mutex());
+	vector<char*>&	free_buffers(get_free_buffers());
+
+	if (length == MAX_PACKET_LENGTH && !free_buffers.empty()) {
+		char*	buffer = free_buffers.back();
+		free_buffers.pop_back();
+		++s_nbr_pool_allocations;
+		return buffer;
+	}
+
+	++s_nbr_heap_allocations;
+	return new char[length];
+}
+
+void	UDPPacketPool::release(char* buffer, size_t length) {
+	if (length == MAX_PACKET_LENGTH) {
+		Mutex::Lock	lock(get_mutex());
+		get_free_buffers().push_back(buffer);
+	} else {
+		delete[] buffer;
+	}
+}
+
+uint64_t	UDPPacketPool::get_nbr_heap_allocations() {
+	Mutex::Lock	lock(get_mutex());
+	return s_nbr_heap_allocations;
+}
+
+uint64_t	UDPPacketPool::get_nbr_pool_allocations() {
+	Mutex::Lock	lock(get_mutex());
+	return s_nbr_pool_allocations;
+}
+
+size_t	UDPPacketPool::get_nbr_free() {
+	Mutex::Lock	lock(get_mutex());
+	return get_free_buffers().size();
+}
@@ -0,0 +1,64 @@
+/*
+ * common/UDPPacketPool.hpp
+ *
+ * This file is part of Leges Motus, a networked, 2D shooter set in zero gravity.
+ * 
+ * Copyright 2009-2011 Andrew Ayer, Nathan Partlan, Jeffrey Pfau
+ * 
+ * Leges Motus is free and open source software.  You may redistribute it and/or
+ * modify it under the terms of version 2, or (at your option) version 3, of the
+ * GNU General Public License (GPL), as published by the Free Software Foundation.
+ * 
+ * Leges Motus is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.  See the full text of the GNU General Public License for
+ * further detail.
+ * 
+ * For a full copy of the GNU General Public License, please see the COPYING file
+ * in the root of the source code tree.  You may also retrieve a copy from
+ * <http://www.gnu.org/licenses/gpl-2.0.txt>, or request a copy by writing to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ * 02111-1307  USA
+ * 
+ */
+
+#ifndef LM_COMMON_UDPPACKETPOOL_HPP
+#define LM_COMMON_UDPPACKETPOOL_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include "Thread.hpp"
+
+namespace LM {
+	/*
+	 * A pool of packet data buffers, which UDPPacket and PacketWriter use instead of allocating and
+	 * freeing a buffer for every packet.  Buffers of MAX_PACKET_LENGTH bytes are pooled; buffers of
+	 * any other length are simply allocated from (and freed to) the heap.
+	 *
+	 * Once the pool has grown to hold as many buffers as are ever in use at once, no more buffers
+	 * are allocated from the heap - get_nbr_heap_allocations() stops increasing.
+	 *
+	 * The pool is shared by the whole process, and is thread-safe, so packets may be passed between threads.
+	 */
+	class UDPPacketPool {
+	private:
+		static std::vector<char*>&	get_free_buffers();
+		static Mutex&			get_mutex();	// Guards the free buffers and the counts
+
+		static uint64_t			s_nbr_heap_allocations;	// Buffers which had to be allocated from the heap
+		static uint64_t			s_nbr_pool_allocations;	// Buffers which were taken from the pool
+
+	public:
+		// Get a buffer of the given length
+		static char*			allocate(size_t length);
+		// Return a buffer which was returned from allocate(length)
+		static void			release(char* buffer, size_t length);
+
+		static uint64_t			get_nbr_heap_allocations();
+		static uint64_t			get_nbr_pool_allocations();
+		static size_t			get_nbr_free();
+	};
+}
+
+#endif
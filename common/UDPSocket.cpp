@@ -24,6 +24,7 @@
 
 #include "common/Exception.hpp"
 #include "common/UDPPacket.hpp"
+#include "common/UDPPacketBatch.hpp"
 #include "common/IPAddress.hpp"
 #include "common/network.hpp"
 #include "UDPSocket.hpp"
@@ -39,6 +40,10 @@
 #include <string.h>
 #include <unistd.h>
 #endif
+#ifdef __linux__
+#include <sys/uio.h>
+#endif
+#include <algorithm>
 
 
 using namespace LM;
@@ -65,6 +70,7 @@ void	UDPSocket::init() {
 	} winsock;
 #endif
 
+	owns_fd = true;
 	if ((fd = ::socket(AF_INET, SOCK_DGRAM, 0)) < 0) {
 		throw Exception("Failed to create UDP socket");
 	}
@@ -104,16 +110,31 @@ UDPSocket::~UDPSocket() {
 	close();
 }
 
+void	UDPSocket::share(const UDPSocket& other) {
+	close();
+	fd = other.fd;
+	owns_fd = false;
+}
+
 void	UDPSocket::close() {
-	if (fd >= 0) {
+	if (fd >= 0 && owns_fd) {
 #ifdef __WIN32
 		::closesocket(fd);
 #else
 		::close(fd);
 #endif
-
-		fd = -1;
 	}
+	fd = -1;
+}
+
+bool	UDPSocket::set_reuse_port() {
+	// Other systems have SO_REUSEPORT, but only Linux shares out unicast packets between the sockets
+#if defined(__linux__) && defined(SO_REUSEPORT)
+	int		one = 1;
+	return setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) == 0;
+#else
+	return false;
+#endif
 }
 
 bool	UDPSocket::bind(const char* interface_address, unsigned int portno) {
@@ -163,10 +184,10 @@ bool	UDPSocket::send(const UDPPacket& packet) {
 	return bytes_sent >= 0 && size_t(bytes_sent) == packet.get_length();
 }
 
-bool	UDPSocket::recv(UDPPacket& packet) {
+bool	UDPSocket::recv(UDPPacket& packet, int flags) {
 	struct sockaddr_in	addr;
 	socklen_t		addr_len = sizeof(addr);
-	ssize_t			bytes_received = recvfrom(fd, packet.m_data, packet.get_max_length(), 0, reinterpret_cast<sockaddr*>(&addr), &addr_len);
+	ssize_t			bytes_received = recvfrom(fd, packet.m_data, packet.get_max_length(), flags, reinterpret_cast<sockaddr*>(&addr), &addr_len);
 
 	if (bytes_received < 0) {
 		packet.clear();
@@ -178,3 +199,135 @@ bool	UDPSocket::recv(UDPPacket& packet) {
 	return true;
 }
 
+#ifdef __linux__
+// Linux can send and receive a whole batch of packets in one system call
+
+size_t	UDPSocket::recv_batch(UDPPacket* packets, size_t count) {
+	struct mmsghdr		headers[UDPPacketBatch::MAX_CAPACITY];
+	struct iovec		iovecs[UDPPacketBatch::MAX_CAPACITY];
+	struct sockaddr_in	addrs[UDPPacketBatch::MAX_CAPACITY];
+
+	count = std::min<size_t>(count, UDPPacketBatch::MAX_CAPACITY);
+	memset(headers, 0, sizeof(headers[0]) * count);
+	for (size_t i = 0; i < count; ++i) {
+		iovecs[i].iov_base = packets[i].m_data;
+		iovecs[i].iov_len = packets[i].get_max_length();
+		headers[i].msg_hdr.msg_name = &addrs[i];
+		headers[i].msg_hdr.msg_namelen = sizeof(addrs[i]);
+		headers[i].msg_hdr.msg_iov = &iovecs[i];
+		headers[i].msg_hdr.msg_iovlen = 1;
+	}
+
+	int			nbr_received = recvmmsg(fd, headers, count, MSG_DONTWAIT, NULL);
+	if (nbr_received <= 0) {
+		return 0;
+	}
+
+	for (int i = 0; i < nbr_received; ++i) {
+		packets[i].set_address(addrs[i]);
+		packets[i].m_length = headers[i].msg_len;
+	}
+	return nbr_received;
+}
+
+size_t	UDPSocket::send_batch(const UDPPacket* packets, const PacketBody* bodies, size_t count) {
+	struct mmsghdr		headers[UDPPacketBatch::MAX_CAPACITY];
+	struct iovec		iovecs[UDPPacketBatch::MAX_CAPACITY][2];	// [0] = the packet's data, [1] = its body (if any)
+	struct sockaddr_in	addrs[UDPPacketBatch::MAX_CAPACITY];
+	size_t			nbr_sent = 0;
+
+	while (count > 0) {
+		size_t		nbr_to_send = std::min<size_t>(count, UDPPacketBatch::MAX_CAPACITY);
+
+		memset(headers, 0, sizeof(headers[0]) * nbr_to_send);
+		for (size_t i = 0; i < nbr_to_send; ++i) {
+			packets[i].get_address().populate_sockaddr(addrs[i]);
+			iovecs[i][0].iov_base = const_cast<char*>(packets[i].get_data());
+			iovecs[i][0].iov_len = packets[i].get_length();
+			headers[i].msg_hdr.msg_name = &addrs[i];
+			headers[i].msg_hdr.msg_namelen = sizeof(addrs[i]);
+			headers[i].msg_hdr.msg_iov = iovecs[i];
+			headers[i].msg_hdr.msg_iovlen = 1;
+			if (bodies && !bodies[i].is_empty()) {
+				iovecs[i][1].iov_base = const_cast<char*>(bodies[i].get_data());
+				iovecs[i][1].iov_len = bodies[i].get_length();
+				headers[i].msg_hdr.msg_iovlen = 2;
+			}
+		}
+
+		size_t		offset = 0;
+		while (offset < nbr_to_send) {
+			int	retval = sendmmsg(fd, headers + offset, nbr_to_send - offset, 0);
+			if (retval < 0) {
+				// The packet at offset couldn't be sent - skip it and carry on with the rest
+				++offset;
+				continue;
+			}
+			for (int i = 0; i < retval; ++i, ++offset) {
+				if (headers[offset].msg_len == packets[offset].get_length() + (bodies ? bodies[offset].get_length() : 0)) {
+					++nbr_sent;
+				}
+			}
+		}
+
+		packets += nbr_to_send;
+		if (bodies) {
+			bodies += nbr_to_send;
+		}
+		count -= nbr_to_send;
+	}
+
+	return nbr_sent;
+}
+
+#else
+// Elsewhere, fall back to one system call per packet
+
+size_t	UDPSocket::recv_batch(UDPPacket* packets, size_t count) {
+	size_t	nbr_received = 0;
+#ifdef __WIN32
+	while (nbr_received < count && has_packets() && recv(packets[nbr_received], 0)) {
+#else
+	while (nbr_received < count && recv(packets[nbr_received], MSG_DONTWAIT)) {
+#endif
+		++nbr_received;
+	}
+	return nbr_received;
+}
+
+size_t	UDPSocket::send_batch(const UDPPacket* packets, const PacketBody* bodies, size_t count) {
+	size_t	nbr_sent = 0;
+	for (size_t i = 0; i < count; ++i) {
+		bool	is_sent;
+		if (bodies && !bodies[i].is_empty()) {
+			// Have to join the packet and its body together first
+			UDPPacket	joined_packet(packets[i]);
+			joined_packet.append(bodies[i].get_data(), bodies[i].get_length());
+			is_sent = send(joined_packet);
+		} else {
+			is_sent = send(packets[i]);
+		}
+		if (is_sent) {
+			++nbr_sent;
+		}
+	}
+	return nbr_sent;
+}
+
+#endif
+
+size_t	UDPSocket::recv_batch(UDPPacketBatch& batch) {
+	batch.clear();
+	batch.m_size = recv_batch(&batch.m_packets[0], batch.get_capacity());
+	return batch.m_size;
+}
+
+size_t	UDPSocket::send_batch(UDPPacketBatch& batch) {
+	if (batch.is_empty()) {
+		return 0;
+	}
+
+	size_t	nbr_sent = send_batch(&batch.m_packets[0], &batch.m_bodies[0], batch.size());
+	batch.clear();
+	return nbr_sent;
+}
@@ -30,14 +30,21 @@
 
 namespace LM {
 	class UDPPacket;
+	class UDPPacketBatch;
+	class PacketBody;
 	class IPAddress;
 	
 	class UDPSocket {
 	private:
 		int	fd;
+		bool	owns_fd;	// False if the descriptor belongs to another UDPSocket (see share())
 	
 		void	init();
 		void	close();
+
+		bool	recv(UDPPacket&, int flags);
+		// bodies may be NULL; otherwise bodies[i] is sent straight after packets[i]'s data
+		size_t	send_batch(const UDPPacket* packets, const PacketBody* bodies, size_t count);
 	
 	public:
 		UDPSocket();
@@ -49,13 +56,36 @@ namespace LM {
 		bool	bind(unsigned int portno) { return bind(NULL, portno); }
 		bool	bind(const IPAddress& bind_address);
 		bool	bind(const char* interface_address, unsigned int portno);
+
+		// Let other sockets (which also call this) bind to the same address, with the kernel spreading
+		// incoming packets between them.  Call before bind().  Returns false if not supported here.
+		bool	set_reuse_port();
+
+		// Send from the other socket's file descriptor (which must outlive this socket) instead of our own.
+		// Reading from a shared socket is left to the other socket's owner.
+		void	share(const UDPSocket& other);
 	
 		// return true as soon as a packet is ready for reading
 		// will wait for up to wait_time milliseconds for a packet, after which it will return false
 		bool	has_packets(uint32_t wait_time =0); 
 	
 		bool	send(const UDPPacket&);
-		bool	recv(UDPPacket&);
+		bool	recv(UDPPacket& packet) { return recv(packet, 0); }
+
+		// Receive as many waiting packets as will fit, without blocking, using as few system calls as possible.
+		// Returns the number of packets received (0 if none were waiting).
+		// The batch version replaces the contents of the batch with the received packets.
+		size_t	recv_batch(UDPPacket* packets, size_t count);
+		size_t	recv_batch(UDPPacketBatch& batch);
+
+		// Send all the given packets, using as few system calls as possible.
+		// Returns the number of packets successfully sent.
+		// The batch version sends any bodies attached to the packets, and clears the batch once it's been sent.
+		size_t	send_batch(const UDPPacket* packets, size_t count) { return send_batch(packets, NULL, count); }
+		size_t	send_batch(UDPPacketBatch& batch);
+
+		// The underlying file descriptor, for use with an EventPoller
+		int	get_fd() const { return fd; }
 	
 		operator const void* () const { return fd >= 0 ? this : 0; }
 		bool	operator! () const { return fd < 0; }
@@ -29,6 +29,7 @@
 #include "common/Packet.hpp"
 #include "common/PhysicsObject.hpp"
 #include "common/Shot.hpp"
+#include "common/PlayerHistory.hpp"
 #include <string>
 #include <stdint.h>
 
@@ -75,6 +76,10 @@ namespace LM {
 		
 		virtual Packet::PlayerHit*	generate_next_hit_packet(Packet::PlayerHit* p, Player* shooter) = 0;
 		
+		// Could this hit have happened, given where the shooter and the hit player were when it was fired?
+		// (Used by the server to check hits reported by clients; tolerance is in game units.)
+		virtual bool		is_valid_hit(const b2World* physics, const PlayerHistory::Transform& shooter, const PlayerHistory::Transform& hit_player, const Packet::PlayerHit* p, float tolerance) const { return true; }
+		
 		// Call when a player selects this weapon:
 		virtual void		select(Player* player);
 		// Call when the round ends to reset this weapon's state:
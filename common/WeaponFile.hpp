@@ -50,7 +50,7 @@ namespace LM {
 		// Remove all weapons from the set:
 		void	clear();
 
-		const std::list<WeaponReader>	get_weapons() const { return m_weapons; }
+		const std::list<WeaponReader>&	get_weapons() const { return m_weapons; }
 	};
 }
 
@@ -211,7 +211,7 @@ void LM::write16(std::ostream* f, int v) {
 
 void LM::write32(std::ostream* f, uint32_t v) {
 	uint8_t* va = (uint8_t*) &v;
-	uint8_t in[2];
+	uint8_t in[4];
 	in[0] = va[0];
 	in[1] = va[1];
 	in[2] = va[2];
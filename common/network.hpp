@@ -32,6 +32,11 @@ namespace LM {
 	// What to use to separate packet fields?
 	const char PACKET_FIELD_SEPARATOR = '\f';	// Formfeed
 
+	// Binary-encoded packets (see BinaryWriter) start with this byte.  Text packets always start with a digit.
+	const char BINARY_PACKET_MARKER = '\xB1';
+	// Same as BINARY_PACKET_MARKER, but the header is followed by piggybacked acknowledgements (see PacketHeader)
+	const char BINARY_ACK_PACKET_MARKER = '\xB2';
+
 	// Maximum length of packets:
 	enum { MAX_PACKET_LENGTH = 1024 };
 
@@ -45,7 +50,19 @@ namespace LM {
 	enum { METASERVER_PORTNO = 16878 };
 	extern const char METASERVER_HOSTNAME[];
 
-	const int PROTOCOL_VERSION = 7;
+	const int PROTOCOL_VERSION = 12;
+	// Clients with this protocol version are still accepted, but are only ever sent text packets.
+	// Later protocol versions understand binary packets as well.
+	const int TEXT_PROTOCOL_VERSION = 7;
+	// Clients with this protocol version are still accepted, and are sent PLAYER_UPDATEs instead of WORLD_SNAPSHOTs.
+	const int BINARY_PROTOCOL_VERSION = 8;
+	// Clients with this protocol version are still accepted, but are sent a separate ACK for every reliable packet.
+	const int SNAPSHOT_PROTOCOL_VERSION = 9;
+	// Clients with this protocol version are still accepted, but don't number their inputs, and aren't told which inputs have been applied.
+	const int PIGGYBACK_PROTOCOL_VERSION = 10;
+	// Clients with this protocol version are still accepted, but aren't told when each WORLD_SNAPSHOT was sent,
+	// and don't say how far behind they show other players.
+	const int INPUT_ACK_PROTOCOL_VERSION = 11;
 
 	bool		resolve_hostname(IPAddress& resolved_addr, const char* hostname_port_string); // hostname_port_string should be in form "hostname:portno" (i.e. colon separator)
 	bool		resolve_hostname(IPAddress& resolved_addr, const char* hostname_to_resolve, uint16_t portno); // portno must be in host-byte order
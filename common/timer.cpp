@@ -46,11 +46,15 @@ namespace {
 }
 
 uint64_t LM::get_ticks() {
+	return get_ticks_usec() / 1000;
+}
+
+uint64_t LM::get_ticks_usec() {
 	static const uint64_t	frequency(get_performance_frequency());
 	static const uint64_t	start(get_performance_counter());
 	const uint64_t		now(get_performance_counter());
 
-	return (now - start) / frequency;
+	return (now - start) * 1000ULL / frequency;
 }
 
 uint64_t LM::utc_time() {
@@ -73,6 +77,7 @@ void LM::msleep(uint64_t millis) {
 
 #include <sys/time.h>
 #include <unistd.h>
+#include <time.h>
 
 namespace {
 	struct TimeOfDay {
@@ -81,13 +86,34 @@ namespace {
 			gettimeofday(&tv, NULL);
 		}
 	};
+
+	// Ticks come from the monotonic clock where we have one, so that they
+	// don't jump when the wall clock is adjusted.
+	struct MonotonicTime {
+		uint64_t usec;
+		MonotonicTime() {
+#ifdef CLOCK_MONOTONIC
+			struct timespec	ts;
+			if (clock_gettime(CLOCK_MONOTONIC, &ts) == 0) {
+				usec = ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+				return;
+			}
+#endif
+			const TimeOfDay	now;
+			usec = now.tv.tv_sec * 1000000ULL + now.tv.tv_usec;
+		}
+	};
 }
 
 uint64_t LM::get_ticks() {
-	static const TimeOfDay	start;
-	const TimeOfDay		now;
+	return get_ticks_usec() / 1000;
+}
+
+uint64_t LM::get_ticks_usec() {
+	static const MonotonicTime	start;
+	const MonotonicTime		now;
 
-	return (now.tv.tv_sec - start.tv.tv_sec) * 1000ULL + (now.tv.tv_usec - start.tv.tv_usec) / 1000;
+	return now.usec - start.usec;
 }
 
 uint64_t LM::utc_time() {
@@ -31,6 +31,7 @@ namespace LM {
 	const uint64_t FOREVER = 0x7FFFFFFFFFFFFFFFULL;
 
 	uint64_t get_ticks();
+	uint64_t get_ticks_usec();	// Like get_ticks(), but in microseconds
 	uint64_t utc_time();
 	void msleep(uint64_t millis);
 }
@@ -368,8 +368,7 @@ void GuiClient::run() {
 
 		m_input->update();
 
-		// Fudge the current time so that the remaining time between steps is accounted for
-		current_time -= step(diff);
+		step(diff);
 		
 		if (!running()) {
 			break;
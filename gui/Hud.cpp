@@ -324,25 +324,23 @@ void Hud::draw_radar(DrawContext* ctx) const {
 	ctx->pop_transform();
 }
 
-void Hud::update_radar(ConstIterator<pair<uint32_t, Player*> > players) {
+void Hud::update_radar(const vector<Player*>& players) {
 	list<RadarBlip>::iterator blips = m_radar.begin();
-	if (!players.has_more()) {
+	if (players.empty()) {
 		m_radar.clear();
 	}
 
-	while (players.has_more()) {
-		pair<uint32_t, Player*> p = players.next();
-
-		while (blips != m_radar.end() && blips->id > p.second->get_id()) {
+	for (vector<Player*>::const_iterator p = players.begin(); p != players.end(); ++p) {
+		while (blips != m_radar.end() && blips->id > (*p)->get_id()) {
 			// We passed by one...
 			blips = m_radar.erase(blips);
 		}
 
-		if (blips == m_radar.end() || blips->id < p.second->get_id()) {
-			RadarBlip blip = make_blip(p.second);
+		if (blips == m_radar.end() || blips->id < (*p)->get_id()) {
+			RadarBlip blip = make_blip(*p);
 			m_radar.insert(blips, blip);
-		} else if (blips->id == p.second->get_id()) {
-			*blips = make_blip(p.second);
+		} else if (blips->id == (*p)->get_id()) {
+			*blips = make_blip(*p);
 			++blips;
 		}
 	}
@@ -449,7 +447,7 @@ void Hud::update(const GameLogic* logic) {
 		m_radar_center = m_active_player->get_position();
 	}
 
-	update_radar(logic->list_players());
+	update_radar(logic->get_players());
 
 	m_our_gate->set_progress(1.0f - logic->get_gate_progress(m_active_team));
 	m_their_gate->set_progress(1.0f - logic->get_gate_progress(get_other_team(m_active_team)));
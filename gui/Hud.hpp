@@ -31,6 +31,7 @@
 #include "common/GameLogic.hpp"
 
 #include <list>
+#include <vector>
 
 namespace LM {
 	class GraphicalPlayer;
@@ -123,7 +124,7 @@ namespace LM {
 		void draw_player_status(DrawContext* ctx) const;
 		void draw_game_status(DrawContext* ctx) const;
 		void draw_radar(DrawContext* ctx) const;
-		void update_radar(ConstIterator<std::pair<uint32_t, Player*> > players);
+		void update_radar(const std::vector<Player*>& players);
 		RadarBlip make_blip(const Player* player);
 
 	public:
@@ -0,0 +1,178 @@
+/*
+ * server/ArenaHost.cpp
+ *
+ * This file is part of Leges Motus, a networked, 2D shooter set in zero gravity.
+ * 
+ * Copyright 2009-2011 Andrew Ayer, Nathan Partlan, Jeffrey Pfau
+ * 
+ * Leges Motus is free and open source software.  You may redistribute it and/or
+ * modify it under the terms of version 2, or (at your option) version 3, of the
+ * GNU General Public License (GPL), as published by the Free Software Foundation.
+ * 
+ * Leges Motus is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.  See the full text of the GNU General Public License for
+ * further detail.
+ * 
+ * For a full copy of the GNU General Public License, please see the COPYING file
+ * in the root of the source code tree.  You may also retrieve a copy from
+ * <http://www.gnu.org/licenses/gpl-2.0.txt>, or request a copy by writing to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ * 02111-1307  USA
+ * 
+ */
+
+#include "ArenaHost.hpp"
+#include "Server.hpp"
+#include "ServerResources.hpp"
+#include "common/Exception.hpp"
+#include "common/PacketReader.hpp"
+#include "common/network.hpp"
+#include "common/misc.hpp"
+#include "common/timer.hpp"
+#include <algorithm>
+
+using namespace LM;
+using namespace std;
+
+ArenaHost::ArenaHost(ServerConfig& config, ServerResources& resources, size_t nbr_arenas, size_t nbr_threads) : m_config(config), m_resources(resources), m_pool(nbr_threads) {
+	m_last_route_check = 0;
+	m_is_running = false;
+
+	for (size_t i = 0; i < std::max<size_t>(nbr_arenas, 1); ++i) {
+		Arena*	arena = new Arena;
+		arena->config = config;
+		if (i > 0) {
+			arena->config.set("register_server", false);
+		}
+		arena->server = new Server(arena->config, m_resources);
+		arena->inbox_size = 0;
+		arena->next_update_time = 0;
+		m_arenas.push_back(arena);
+	}
+}
+
+ArenaHost::~ArenaHost() {
+	for (size_t i = 0; i < m_arenas.size(); ++i) {
+		delete m_arenas[i]->server;
+		delete m_arenas[i];
+	}
+}
+
+void	ArenaHost::start() {
+	if (!resolve_hostname(m_listen_address, m_config.get<const char*>("interface"), m_config.get<uint16_t>("portno"))) {
+		throw Exception("Failed to resolve the interface address.  Please make sure it's correct.");
+	}
+
+	if (!m_socket.bind(m_listen_address) || !m_poller.add(m_socket.get_fd())) {
+		throw Exception("Failed to start server network on interface and port.");
+	}
+
+	for (size_t i = 0; i < m_arenas.size(); ++i) {
+		m_arenas[i]->server->start(&m_socket);
+	}
+
+	m_is_running = true;
+}
+
+void	ArenaHost::run() {
+	while (m_is_running) {
+		// Sleep until an arena has something to do, or until packets arrive
+		uint64_t	now = get_ticks_usec();
+		uint64_t	sleep_time = EventPoller::NO_TIMEOUT;
+		for (size_t i = 0; i < m_arenas.size(); ++i) {
+			uint64_t	next_update_time = m_arenas[i]->next_update_time;
+			if (next_update_time != EventPoller::NO_TIMEOUT) {
+				sleep_time = std::min(sleep_time, next_update_time > now ? next_update_time - now : 0);
+			}
+		}
+
+		if (m_poller.wait(sleep_time) == EventPoller::READABLE) {
+			size_t	nbr_received;
+			do {
+				nbr_received = m_socket.recv_batch(m_recv_batch);
+				for (size_t i = 0; i < nbr_received; ++i) {
+					route_packet(m_recv_batch[i]);
+				}
+			} while (nbr_received == m_recv_batch.get_capacity());
+		}
+
+		now = get_ticks_usec();
+		m_active_arenas.clear();
+		for (size_t i = 0; i < m_arenas.size(); ++i) {
+			Arena*	arena = m_arenas[i];
+			if (arena->inbox_size > 0 || now >= arena->next_update_time) {
+				m_active_arenas.push_back(arena);
+			}
+		}
+
+		if (!m_active_arenas.empty()) {
+			m_pool.run_all(run_arena, &m_active_arenas[0], m_active_arenas.size());
+		}
+
+		if (get_ticks() - m_last_route_check >= ROUTE_CHECK_INTERVAL) {
+			check_routes();
+		}
+	}
+
+	for (size_t i = 0; i < m_arenas.size(); ++i) {
+		m_arenas[i]->server->shutdown();
+	}
+}
+
+void	ArenaHost::stop() {
+	m_is_running = false;
+	m_poller.wake();
+}
+
+void	ArenaHost::run_arena(void* arena_ptr) {
+	Arena*	arena = static_cast<Arena*>(arena_ptr);
+	Server&	server = *arena->server;
+
+	if (arena->inbox_size > 0) {
+		server.receive_packets(&arena->inbox[0], arena->inbox_size);
+		arena->inbox_size = 0;
+	}
+
+	server.update();
+
+	uint64_t	sleep_time = server.server_sleep_time();
+	arena->next_update_time = sleep_time == EventPoller::NO_TIMEOUT ? EventPoller::NO_TIMEOUT : get_ticks_usec() + sleep_time;
+}
+
+void	ArenaHost::route_packet(const UDPPacket& packet) {
+	Arena*			arena = m_arenas[0];
+
+	Routes::iterator	route(m_routes.find(packet.get_address()));
+	if (route != m_routes.end()) {
+		arena = route->second;
+	} else if (PacketReader(packet).packet_type() == JOIN_PACKET) {
+		// Joining players are spread out between the arenas
+		for (size_t i = 1; i < m_arenas.size(); ++i) {
+			if (m_arenas[i]->server->get_nbr_players() < arena->server->get_nbr_players()) {
+				arena = m_arenas[i];
+			}
+		}
+		m_routes.insert(make_pair(packet.get_address(), arena));
+	}
+
+	// The inbox's packets are re-used, so that their buffers are too
+	if (arena->inbox_size < arena->inbox.size()) {
+		arena->inbox[arena->inbox_size] = packet;
+	} else {
+		arena->inbox.push_back(packet);
+	}
+	++arena->inbox_size;
+}
+
+void	ArenaHost::check_routes() {
+	Routes::iterator	it(m_routes.begin());
+	while (it != m_routes.end()) {
+		if (it->second->server->is_connected(it->first)) {
+			++it;
+		} else {
+			m_routes.erase(it++);
+		}
+	}
+	m_last_route_check = get_ticks();
+}
@@ -0,0 +1,110 @@
+/*
+ * server/ArenaHost.hpp
+ *
+ * This file is part of Leges Motus, a networked, 2D shooter set in zero gravity.
+ * 
+ * Copyright 2009-2011 Andrew Ayer, Nathan Partlan, Jeffrey Pfau
+ * 
+ * Leges Motus is free and open source software.  You may redistribute it and/or
+ * modify it under the terms of version 2, or (at your option) version 3, of the
+ * GNU General Public License (GPL), as published by the Free Software Foundation.
+ * 
+ * Leges Motus is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.  See the full text of the GNU General Public License for
+ * further detail.
+ * 
+ * For a full copy of the GNU General Public License, please see the COPYING file
+ * in the root of the source code tree.  You may also retrieve a copy from
+ * <http://www.gnu.org/licenses/gpl-2.0.txt>, or request a copy by writing to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ * 02111-1307  USA
+ * 
+ */
+
+#ifndef LM_SERVER_ARENAHOST_HPP
+#define LM_SERVER_ARENAHOST_HPP
+
+#include "ServerConfig.hpp"
+#include "common/UDPSocket.hpp"
+#include "common/UDPPacket.hpp"
+#include "common/UDPPacketBatch.hpp"
+#include "common/EventPoller.hpp"
+#include "common/ThreadPool.hpp"
+#include "common/IPAddress.hpp"
+#include <stdint.h>
+#include <vector>
+#include <map>
+
+namespace LM {
+	class Server;
+	class ServerResources;
+
+	/*
+	 * Runs a number of independent games ("arenas") in one server process, on one port.
+	 *
+	 * Each arena is a Server with its own players, map, and GameLogic, but the arenas share the
+	 * listening socket and the files they load (see ServerResources).  Only the first arena
+	 * registers with the meta server, and answers packets from anyone who isn't playing.
+	 *
+	 * The socket is read on the thread which calls run(), and each packet is passed to the arena
+	 * that its sender is connected to.  A JOIN from a new sender goes to the arena with the fewest players.
+	 * Then the arenas with packets to process or other work due are run in parallel on a ThreadPool,
+	 * so each arena only ever runs on one thread at a time.
+	 */
+	class ArenaHost {
+	public:
+		enum {
+			ROUTE_CHECK_INTERVAL = 1000	// How often to forget senders who've left their arenas (in milliseconds)
+		};
+
+	private:
+		struct Arena {
+			ServerConfig		config;
+			Server*			server;
+			std::vector<UDPPacket>	inbox;		// Packets received since the arena last ran (only the first inbox_size are in use)
+			size_t			inbox_size;
+			uint64_t		next_update_time;	// When the arena next has something to do (from get_ticks_usec())
+		};
+		typedef std::map<IPAddress, Arena*> Routes;	// Which arena each sender is connected to
+
+		ServerConfig&		m_config;
+		ServerResources&	m_resources;
+		std::vector<Arena*>	m_arenas;
+		std::vector<void*>	m_active_arenas;	// The arenas which run this time round
+		Routes			m_routes;
+		uint64_t		m_last_route_check;
+
+		IPAddress		m_listen_address;
+		UDPSocket		m_socket;
+		EventPoller		m_poller;
+		UDPPacketBatch		m_recv_batch;
+		ThreadPool		m_pool;
+		bool			m_is_running;
+
+		static void		run_arena(void* arena);
+		// Pass the packet to the right arena
+		void			route_packet(const UDPPacket& packet);
+		// Forget the senders whose arenas don't have them connected any more
+		void			check_routes();
+
+		// Not copyable
+		ArenaHost(const ArenaHost&);
+		ArenaHost& operator=(const ArenaHost&);
+
+	public:
+		// Use the given number of threads to run the arenas, or one per processor if 0
+		ArenaHost(ServerConfig& config, ServerResources& resources, size_t nbr_arenas, size_t nbr_threads =0);
+		~ArenaHost();
+
+		void			start();
+		void			run();
+		// Safe to call from a signal handler
+		void			stop();
+
+		size_t			get_nbr_arenas() const { return m_arenas.size(); }
+		size_t			get_nbr_threads() const { return m_pool.get_nbr_threads(); }
+	};
+}
+
+#endif
@@ -0,0 +1,182 @@
+/*
+ * server/ReceiveThread.cpp
+ *
+ * This file is part of Leges Motus, a networked, 2D shooter set in zero gravity.
+ * 
+ * Copyright 2009-2011 Andrew Ayer, Nathan Partlan, Jeffrey Pfau
+ * 
+ * Leges Motus is free and open source software.  You may redistribute it and/or
+ * modify it under the terms of version 2, or (at your option) version 3, of the
+ * GNU General Public License (GPL), as published by the Free Software Foundation.
+ * 
+ * Leges Motus is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.  See the full text of the GNU General Public License for
+ * further detail.
+ * 
+ * For a full copy of the GNU General Public License, please see the COPYING file
+ * in the root of the source code tree.  You may also retrieve a copy from
+ * <http://www.gnu.org/licenses/gpl-2.0.txt>, or request a copy by writing to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ * 02111-1307  USA
+ * 
+ */
+
+#include "ReceiveThread.hpp"
+#include "common/PacketReader.hpp"
+#include "common/timer.hpp"
+
+using namespace LM;
+using namespace std;
+
+ReceiveThread::ReceiveThread(EventPoller& notify) : m_notify(notify), m_received(RECEIVED_QUEUE_SIZE), m_peer_changes(PEER_CHANGE_QUEUE_SIZE) {
+	m_is_stopping = false;
+}
+
+ReceiveThread::~ReceiveThread() {
+	stop();
+}
+
+bool	ReceiveThread::start(const IPAddress& bind_address) {
+	return m_socket.set_reuse_port() && m_socket.bind(bind_address) && m_poller.add(m_socket.get_fd()) && m_thread.start(run, this);
+}
+
+bool	ReceiveThread::start(const UDPSocket& shared_socket) {
+	m_socket.share(shared_socket);
+	return m_poller.add(m_socket.get_fd()) && m_thread.start(run, this);
+}
+
+void	ReceiveThread::stop() {
+	m_is_stopping = true;
+	m_poller.wake();
+	m_thread.join();
+}
+
+void	ReceiveThread::run(void* receive_thread) {
+	static_cast<ReceiveThread*>(receive_thread)->run();
+}
+
+void	ReceiveThread::run() {
+	while (!m_is_stopping) {
+		// Woken up without packets when there are peer changes waiting, or when stopping
+		int	event = m_poller.wait(EventPoller::NO_TIMEOUT);
+		apply_peer_changes();
+		if (event != EventPoller::READABLE) {
+			continue;
+		}
+
+		size_t	nbr_received;
+		do {
+			nbr_received = m_socket.recv_batch(m_recv_batch);
+			apply_peer_changes();
+			for (size_t i = 0; i < nbr_received; ++i) {
+				if (!wait_for_room()) {
+					return;
+				}
+				receive_packet(m_recv_batch[i]);
+			}
+			m_notify.wake();
+		} while (nbr_received == m_recv_batch.get_capacity());
+	}
+}
+
+bool	ReceiveThread::wait_for_room() {
+	// A packet can release every packet queued behind it
+	while (m_received.get_nbr_free() <= MAX_QUEUED_PACKETS) {
+		// The game thread has fallen behind - leave the packets in the socket until it catches up
+		m_notify.wake();
+		msleep(1);
+		// The game thread may itself be waiting on us to make room for its peer changes
+		apply_peer_changes();
+		if (m_is_stopping) {
+			return false;
+		}
+	}
+	return true;
+}
+
+void	ReceiveThread::apply_peer_changes() {
+	while (const PeerChange* change = m_peer_changes.get_front()) {
+		if (change->next_receive_sequence_no) {
+			Peer&	peer(m_peers[change->address]);
+			peer.connection_id = change->connection_id;
+			peer.packet_queue.init(change->next_receive_sequence_no, MAX_QUEUED_PACKETS);
+		} else {
+			m_peers.erase(change->address);
+		}
+		m_peer_changes.pop();
+	}
+}
+
+void	ReceiveThread::push(int actions, const PacketHeader* header, const UDPPacket& raw_packet) {
+	Received*	received = m_received.get_free_slot();
+	received->actions = actions;
+	if (header) {
+		received->header = *header;
+	}
+	if (actions & Received::PROCESS) {
+		received->packet.fill(raw_packet.get_data(), raw_packet.get_length());
+	} else {
+		received->packet.clear();
+	}
+	received->packet.set_address(raw_packet.get_address());
+	m_received.push();
+}
+
+// This follows the same rules as ServerNetwork::receive_packet(), which is used when there are no receive threads
+void	ReceiveThread::receive_packet(const UDPPacket& raw_packet) {
+	PacketReader	packet(raw_packet);
+
+	if (!packet.sequence_no()) {
+		// Low reliability packet - we don't care if, when, or how often it arrives
+		push(Received::ARRIVED | Received::PROCESS, &packet.get_header(), raw_packet);
+		return;
+	}
+
+	map<IPAddress, Peer>::iterator	it(m_peers.find(raw_packet.get_address()));
+	if (it == m_peers.end()) {
+		// From an unbound peer, so we can't attempt to re-order it, but it can be processed anyways
+		push(Received::ARRIVED | Received::PROCESS, &packet.get_header(), raw_packet);
+		return;
+	}
+
+	Peer&	peer(it->second);
+	try {
+		if (packet.connection_id() == peer.connection_id && peer.packet_queue.push(raw_packet, packet.sequence_no())) {
+			// Ready to be processed now, along with any other packets that were waiting for it
+			push(Received::ARRIVED | Received::PROCESS, &packet.get_header(), raw_packet);
+			while (peer.packet_queue.has_packet()) {
+				Received*	received = m_received.get_free_slot();
+				peer.packet_queue.pop(received->packet);
+				received->packet.set_address(raw_packet.get_address());
+				received->actions = Received::PROCESS;
+				m_received.push();
+			}
+		} else if (packet.connection_id() > peer.connection_id) {
+			// From a newer connection than is currently registered - process it without re-ordering
+			push(Received::ARRIVED | Received::PROCESS, &packet.get_header(), raw_packet);
+		} else {
+			// Queued, a duplicate, or from an old connection - only needs acknowledging
+			push(Received::ARRIVED, &packet.get_header(), raw_packet);
+		}
+	} catch (PacketQueue::FullQueueException) {
+		push(Received::ARRIVED | Received::EXCESSIVE_DROP, &packet.get_header(), raw_packet);
+	}
+}
+
+void	ReceiveThread::register_peer(const IPAddress& address, uint32_t connection_id, uint64_t next_receive_sequence_no) {
+	PeerChange*	change;
+	while (!(change = m_peer_changes.get_free_slot())) {
+		// The receive thread applies changes whenever it receives packets or waits for room, so this shouldn't last long
+		m_poller.wake();
+		msleep(1);
+	}
+	change->address = address;
+	change->connection_id = connection_id;
+	change->next_receive_sequence_no = next_receive_sequence_no;
+	m_peer_changes.push();
+}
+
+void	ReceiveThread::unregister_peer(const IPAddress& address) {
+	register_peer(address, 0, 0);
+}
@@ -0,0 +1,143 @@
+/*
+ * server/ReceiveThread.hpp
+ *
+ * This file is part of Leges Motus, a networked, 2D shooter set in zero gravity.
+ * 
+ * Copyright 2009-2011 Andrew Ayer, Nathan Partlan, Jeffrey Pfau
+ * 
+ * Leges Motus is free and open source software.  You may redistribute it and/or
+ * modify it under the terms of version 2, or (at your option) version 3, of the
+ * GNU General Public License (GPL), as published by the Free Software Foundation.
+ * 
+ * Leges Motus is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.  See the full text of the GNU General Public License for
+ * further detail.
+ * 
+ * For a full copy of the GNU General Public License, please see the COPYING file
+ * in the root of the source code tree.  You may also retrieve a copy from
+ * <http://www.gnu.org/licenses/gpl-2.0.txt>, or request a copy by writing to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ * 02111-1307  USA
+ * 
+ */
+
+#ifndef LM_SERVER_RECEIVETHREAD_HPP
+#define LM_SERVER_RECEIVETHREAD_HPP
+
+#include "common/SPSCQueue.hpp"
+#include "common/Thread.hpp"
+#include "common/EventPoller.hpp"
+#include "common/UDPSocket.hpp"
+#include "common/UDPPacket.hpp"
+#include "common/UDPPacketBatch.hpp"
+#include "common/PacketHeader.hpp"
+#include "common/PacketQueue.hpp"
+#include "common/IPAddress.hpp"
+#include <stdint.h>
+#include <map>
+
+namespace LM {
+	/*
+	 * Receives the server's packets on a thread of its own, so that the thread running the game
+	 * is never held up by a burst of incoming packets.
+	 *
+	 * Each packet is parsed, checked against the connection it claims to be from, and put back
+	 * in order with the peer's other reliable packets.  The results are handed to the game thread
+	 * through a lock-free queue (see SPSCQueue), and the game thread's EventPoller is woken up.
+	 * Recording and sending acknowledgements is left to the game thread, since they're carried
+	 * in the headers of the packets it sends.
+	 *
+	 * The game thread tells us which peers are registered through a second queue going the other
+	 * way, so the two threads share nothing but the queues.
+	 */
+	class ReceiveThread {
+	public:
+		// A packet (or news about a peer) for the game thread
+		struct Received {
+			enum {
+				ARRIVED = 1,		// Just arrived: process the acknowledgements in its header, and acknowledge it if it's reliable
+				PROCESS = 2,		// Ready to be processed
+				EXCESSIVE_DROP = 4	// The peer has sent too many packets ahead of one which hasn't arrived
+			};
+			int		actions;
+			PacketHeader	header;		// Only set if ARRIVED
+			UDPPacket	packet;		// Only holds data if PROCESS, but always has the sender's address
+		};
+
+	private:
+		// A change to the registered peers, from the game thread
+		struct PeerChange {
+			IPAddress	address;
+			uint32_t	connection_id;
+			uint64_t	next_receive_sequence_no;	// 0 if the peer is being unregistered
+		};
+
+		struct Peer {
+			uint32_t	connection_id;
+			PacketQueue	packet_queue;
+		};
+
+		enum {
+			RECEIVED_QUEUE_SIZE = 2048,
+			PEER_CHANGE_QUEUE_SIZE = 256,
+			MAX_QUEUED_PACKETS = 256	// The size of each peer's PacketQueue
+		};
+
+		UDPSocket			m_socket;
+		EventPoller			m_poller;		// Waits for our socket, or for stop()
+		EventPoller&			m_notify;		// The game thread's poller, woken when there are packets for it
+		UDPPacketBatch			m_recv_batch;
+		Thread				m_thread;
+		volatile bool			m_is_stopping;
+
+		SPSCQueue<Received>		m_received;		// To the game thread
+		SPSCQueue<PeerChange>		m_peer_changes;		// From the game thread
+
+		// Only touched by the receive thread
+		std::map<IPAddress, Peer>	m_peers;
+
+		static void	run(void* receive_thread);
+		void		run();
+
+		void		apply_peer_changes();
+		// Parse and re-order a packet which has been received
+		void		receive_packet(const UDPPacket& raw_packet);
+		// Queue up a Received for the game thread (there must be room for it)
+		void		push(int actions, const PacketHeader* header, const UDPPacket& raw_packet);
+		// Wait until the game thread has made room for any packet (and any packets it releases from a PacketQueue)
+		bool		wait_for_room();
+
+		// Not copyable
+		ReceiveThread(const ReceiveThread&);
+		ReceiveThread&	operator=(const ReceiveThread&);
+
+	public:
+		// notify is woken whenever there's something to take off of the queue
+		explicit ReceiveThread(EventPoller& notify);
+		~ReceiveThread();
+
+		// Either bind a socket of our own (see UDPSocket::set_reuse_port()), or read from
+		// another socket (which must outlive us), and then start receiving.
+		// Returns false if the socket couldn't be bound, or the thread couldn't be started.
+		bool		start(const IPAddress& bind_address);
+		bool		start(const UDPSocket& shared_socket);
+		// Stop receiving, and wait for the thread to finish
+		void		stop();
+
+		/*
+		 * Game thread functions
+		 */
+		// The next thing received, or NULL if there's nothing waiting
+		const Received*	get_front() { return m_received.get_front(); }
+		void		pop() { m_received.pop(); }
+		bool		has_received() const { return !m_received.is_empty(); }
+		size_t		get_nbr_received() const { return m_received.size(); }
+
+		// Re-order the peer's reliable packets, starting at the given sequence number
+		void		register_peer(const IPAddress& address, uint32_t connection_id, uint64_t next_receive_sequence_no);
+		void		unregister_peer(const IPAddress& address);
+	};
+}
+
+#endif
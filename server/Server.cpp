@@ -36,17 +36,22 @@
 #include "common/network.hpp"
 #include "common/team.hpp"
 #include "common/misc.hpp"
-#include "common/PathManager.hpp"
+#include "ServerResources.hpp"
 #include "common/timer.hpp"
 #include "common/Version.hpp"
 #include "common/GameLogic.hpp"
 #include "common/Weapon.hpp"
+#include "common/UDPPacketPool.hpp"
+#include "common/RayCast.hpp"
+#include "common/physics.hpp"
+#include "heap.hpp"
 #include <string>
 #include <cstdlib>
 #include <cstring>
 #include <cmath>
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <set>
 #include <limits>
 
@@ -55,8 +60,13 @@ using namespace std;
 
 const char	Server::SERVER_VERSION[] = LM_VERSION;
 
-Server::Server (ServerConfig& config, PathManager& path_manager) : m_config(config), m_path_manager(path_manager), m_network(*this), m_gates(2, GateStatus(*this))
+namespace {
+	const WeaponFile	no_weapons;	// Until a weapon set is loaded
+}
+
+Server::Server (ServerConfig& config, ServerResources& resources) : m_config(config), m_resources(resources), m_network(*this), m_gates(2, GateStatus(*this)), m_player_update_packet(PLAYER_UPDATE_PACKET)
 {
+	m_weapon_set = &no_weapons;
 	m_next_player_id = 1;
 	m_is_running = false;
 	m_game_start_time = 0;
@@ -70,13 +80,122 @@ Server::Server (ServerConfig& config, PathManager& path_manager) : m_config(conf
 	m_team_score[0] = m_team_score[1] = 0;
 	
 	m_game_logic = NULL;
+
+	m_logic_clock.set_max_catchup(MAX_CATCHUP_TICKS);
+	m_next_player_update = 0;
+	m_last_snapshot_id = 0;
+
+	m_relevance_filter = false;
+	m_relevance_view_width = m_relevance_view_height = 0;
+	m_relevance_update_interval = 1;
+
+	m_validate_hits = false;
+	m_hit_tolerance = 0;
+	m_max_rewind = 0;
+	m_player_update_rate = 34;
 }
 
 void	Server::send_player_update(Player* player) {
 	// Re-broadcast the packet to all _other_ players
-	PacketWriter	outbound_packet(PLAYER_UPDATE_PACKET);
-	player->write_update_packet(outbound_packet);
-	m_network.broadcast_packet(outbound_packet);
+	player->generate_player_update(&m_player_update_packet.player_update);
+	m_network.broadcast_packet(&m_player_update_packet, NULL, true);
+}
+
+void	Server::send_world_snapshots() {
+	const uint32_t	snapshot_id = ++m_last_snapshot_id;
+	m_world_snapshot.reset(snapshot_id);
+	for (PlayerMap::const_iterator it(m_players.begin()); it != m_players.end(); ++it) {
+		m_world_snapshot.add_player(it->second);
+	}
+
+	RayCast				ray_cast(m_game_logic != NULL ? m_game_logic->get_world() : NULL, m_game_logic != NULL ? m_game_logic->get_static_geometry() : NULL);
+	ServerNetwork::SendBatch	batch(m_network);
+	const uint64_t			now = get_ticks();
+	for (PlayerMap::iterator it(m_players.begin()); it != m_players.end(); ++it) {
+		ServerPlayer&	player(it->second);
+		if (!player.receives_snapshots()) {
+			continue;
+		}
+
+		// Each player is sent its own copy of the snapshot, in which the players that aren't due an update
+		// keep the state the player was last sent (marked as held back, which only costs a byte when it changes).
+		// The copies are kept, since they're the player's baselines.
+		SnapshotHistory&	history(player.get_sent_snapshots());
+		const Snapshot*		previous = history.get(snapshot_id - 1);
+		Snapshot&		snapshot(history.add(snapshot_id));
+
+		// m_world_snapshot has the players in the same order as m_players
+		PlayerMap::const_iterator	other_it(m_players.begin());
+		for (size_t i = 0; i < m_world_snapshot.get_nbr_players(); ++i, ++other_it) {
+			const Snapshot::PlayerState&	state(m_world_snapshot.get_player(i));
+			const Snapshot::PlayerState*	previous_state = previous ? previous->find_player(state.player_id) : NULL;
+			if (previous_state != NULL && !is_update_due(player, other_it->second, snapshot_id, ray_cast)) {
+				Snapshot::PlayerState	held_state(*previous_state);
+				held_state.flags |= Snapshot::FLAG_HELD_BACK;
+				snapshot.add_player(held_state);
+			} else {
+				snapshot.add_player(state);
+			}
+		}
+
+		// Tell the player which of its inputs its own state in the snapshot includes, so it can replay the rest on top
+		uint32_t	input_sequence = player.get_last_input_sequence();
+		uint64_t	input_age = input_sequence != 0 ? now - player.get_last_input_time() : 0;
+
+		// If the player hasn't acknowledged a snapshot recently enough, the baseline is NULL, and the whole snapshot is sent
+		const Snapshot*	baseline = history.get(player.get_acked_snapshot_id());
+		size_t		size = m_network.send_world_snapshot(player.get_address(), snapshot, baseline, now, input_sequence, input_age);
+		if (size == 0 && baseline != NULL) {
+			size = m_network.send_world_snapshot(player.get_address(), snapshot, NULL, now, input_sequence, input_age);
+		}
+
+		if (size != 0) {
+			m_snapshot_sizes.record(size);
+		} else {
+			send_player_updates_to(player);
+		}
+	}
+}
+
+bool	Server::is_update_due(const ServerPlayer& recipient, const ServerPlayer& other, uint32_t snapshot_id, RayCast& ray_cast) const {
+	if (!m_relevance_filter || &recipient == &other || (snapshot_id + other.get_id()) % m_relevance_update_interval == 0) {
+		// (Offsetting by the player ID spreads out the reduced-rate updates)
+		return true;
+	}
+
+	if (fabs(other.get_x() - recipient.get_x()) > m_relevance_view_width / 2 || fabs(other.get_y() - recipient.get_y()) > m_relevance_view_height / 2) {
+		return false;
+	}
+
+	if (m_game_logic == NULL || recipient.get_physics_body() == NULL || other.get_physics_body() == NULL) {
+		return true;
+	}
+
+	b2Vec2		start_pos(to_physics(recipient.get_x()), to_physics(recipient.get_y()));
+	return ray_cast.cast_at_player(start_pos, &other) != numeric_limits<float>::max();
+}
+
+void	Server::send_player_updates_to(const ServerPlayer& recipient) {
+	for (PlayerMap::iterator it(m_players.begin()); it != m_players.end(); ++it) {
+		it->second.generate_player_update(&m_player_update_packet.player_update);
+		m_player_update_packet.header = PacketHeader(PLAYER_UPDATE_PACKET, 0, 0);
+		m_network.send_packet_to(recipient.get_address(), &m_player_update_packet);
+	}
+}
+
+void	Server::snapshot_ack(const IPAddress& address, PacketReader& inbound_packet)
+{
+	uint32_t		player_id;
+	uint32_t		snapshot_id;
+	inbound_packet >> player_id >> snapshot_id;
+
+	// Only snapshots which can still be used as a baseline are worth remembering
+	if (is_authorized(address, player_id)) {
+		ServerPlayer*	player = get_player(player_id);
+		if (player->get_sent_snapshots().get(snapshot_id) != NULL) {
+			player->ack_snapshot(snapshot_id);
+		}
+	}
 }
 
 void	Server::player_animation(const IPAddress& address, PacketReader& inbound_packet)
@@ -253,7 +372,7 @@ void	Server::broadcast_system_message(const char* message) {
 
 void	Server::send_map_list(const ServerPlayer& player) {
 	list<string>			files;
-	scan_directory(files, m_path_manager.data_path("", "maps"));
+	m_resources.list_map_files(files);
 
 	send_system_message(player, "Installed maps:");
 
@@ -279,6 +398,7 @@ void	Server::command_server(uint32_t player_id, const char* command) {
 		send_system_message(*player, "/server teamscore - Return the score for each team");
 		send_system_message(*player, "/server teamcount - Return the number of players on each team");
 		send_system_message(*player, "/server maps - Display the maps installed on the server");
+		send_system_message(*player, "/server stats - Display main loop timing statistics");
 		if (player->is_op()) {
 			send_system_message(*player, "/server balance - Balance the teams [op]");
 			send_system_message(*player, "/server shakeup - Randomize the teams [op]");
@@ -313,6 +433,25 @@ void	Server::command_server(uint32_t player_id, const char* command) {
 	} else if (strcmp(command, "maps") == 0) {
 		send_map_list(*player);
 
+	} else if (strcmp(command, "stats") == 0) {
+		ostringstream	msg;
+		msg << "Tick lateness: " << m_tick_lateness << " us / Ticks dropped: " << m_logic_clock.get_nbr_dropped() << " / Wake lateness: " << m_wake_lateness << " us";
+		send_system_message(*player, msg.str().c_str());
+
+		ostringstream	alloc_msg;
+		alloc_msg << "Allocations per update round: " << m_update_allocations << " / per logic step: " << m_step_allocations << " / Packet buffers from heap: " << UDPPacketPool::get_nbr_heap_allocations() << ", from pool: " << UDPPacketPool::get_nbr_pool_allocations();
+		send_system_message(*player, alloc_msg.str().c_str());
+
+		ostringstream	snapshot_msg;
+		snapshot_msg << "World snapshot size: " << m_snapshot_sizes << " bytes";
+		send_system_message(*player, snapshot_msg.str().c_str());
+
+		if (const PacketQueue* queue = m_network.get_packet_queue(player->get_address())) {
+			ostringstream	queue_msg;
+			queue_msg << "Your packets reordered: " << queue->get_nbr_reordered() << " (max depth " << queue->get_max_reorder_depth() << ") / Duplicates: " << queue->get_nbr_duplicates() << " / Dropped: " << queue->get_nbr_dropped();
+			send_system_message(*player, queue_msg.str().c_str());
+		}
+
 	} else if (strcmp(command, "shakeup") == 0 && player->is_op()) {
 		game_over(0);
 		shakeup_teams();
@@ -389,6 +528,13 @@ void	Server::player_hit(const IPAddress& address, PacketReader& inbound_packet)
 		return;
 	}
 
+	// Don't trust the shooter: the hit must have been possible from where the shooter saw things
+	// (and a hit from a weapon we don't know about can't be checked, so it's rejected)
+	Weapon* weapon = m_game_logic->get_weapon(weapon_id);
+	if (m_validate_hits && (weapon == NULL || !is_valid_hit(*weapon, *shooter, *shot_player, hitdata))) {
+		return;
+	}
+
 	// Tell the current game mode that this player was shot
 	has_effect = m_game_mode->player_shot(*shooter, *shot_player);
 	
@@ -399,7 +545,6 @@ void	Server::player_hit(const IPAddress& address, PacketReader& inbound_packet)
 	
 	bool already_frozen = shot_player->is_frozen();
 	
-	Weapon* weapon = m_game_logic->get_weapon(weapon_id);
 	if (weapon != NULL) {
 		weapon->hit(shot_player, shooter, &hitdata);
 	} else {
@@ -417,6 +562,28 @@ void	Server::player_hit(const IPAddress& address, PacketReader& inbound_packet)
 	}
 }
 
+bool	Server::is_valid_hit(const Weapon& weapon, const ServerPlayer& shooter, const ServerPlayer& shot_player, const Packet::PlayerHit& hitdata) const {
+	const PlayerHistory&	history(m_game_logic->get_history());
+	const double		now = m_game_logic->get_tick();
+	const double		ticks_per_ms = TickClock::TICKS_PER_SECOND / 1000.0;
+	uint64_t		rtt = m_network.get_rtt(shooter.get_address());
+
+	// The shooter saw the shot player as it was a whole round trip ago (half for its position to reach the shooter,
+	// and half for the hit to come back), plus however far behind its client shows other players.
+	// It saw itself where its own updates put it half a round trip ago.
+	uint64_t		shooter_rewind = std::min(rtt / 2, m_max_rewind);
+	uint64_t		shot_player_rewind = std::min(rtt + shooter.get_interpolation_delay(), m_max_rewind);
+	PlayerHistory::Transform	shooter_transform;
+	PlayerHistory::Transform	shot_player_transform;
+	if (!history.rewind(now - shooter_rewind * ticks_per_ms, shooter.get_id(), &shooter_transform) ||
+			!history.rewind(now - shot_player_rewind * ticks_per_ms, shot_player.get_id(), &shot_player_transform)) {
+		// Nothing recorded to check against yet
+		return true;
+	}
+
+	return weapon.is_valid_hit(m_game_logic->get_world(), shooter_transform, shot_player_transform, &hitdata, m_hit_tolerance);
+}
+
 void	Server::player_died(const IPAddress& address, PacketReader& packet)
 {            
 	uint32_t killed_player_id;
@@ -449,7 +616,8 @@ void	Server::weapon_discharged(const IPAddress& address, PacketReader& inbound_p
 	float direction;
 	float start_x, start_y;
 	float end_x, end_y;
-	inbound_packet >> shooter_id >> weapon_id >> direction >> start_x >> start_y >> end_x >> end_y;
+	uint32_t input_sequence;
+	inbound_packet >> shooter_id >> weapon_id >> direction >> start_x >> start_y >> end_x >> end_y >> input_sequence; // (0 from older clients)
 
 	if (!is_authorized(address, shooter_id)) {
 		return;
@@ -470,6 +638,7 @@ void	Server::weapon_discharged(const IPAddress& address, PacketReader& inbound_p
 	if (weapon != NULL && shooter != NULL) {
 		weapon->was_fired(m_game_logic->get_world(), *shooter, direction);
 	}
+	get_player(shooter_id)->applied_input(input_sequence);
 	
 	broadcast_packet_except(outbound_packet, shooter_id);
 }
@@ -484,16 +653,22 @@ void	Server::join(const IPAddress& address, PacketReader& packet) {
 	string			requested_name;
 	char			team;
 	Version			client_compat_version;
+	uint32_t		interpolation_delay = 0;
 
 	packet >> client_proto_version;
 
-	if (client_proto_version == PROTOCOL_VERSION) {
+	const bool		is_supported_version = client_proto_version >= TEXT_PROTOCOL_VERSION && client_proto_version <= PROTOCOL_VERSION;
+
+	if (is_supported_version) {
 		packet >> client_compat_version >> requested_name >> team;
+		if (client_proto_version > INPUT_ACK_PROTOCOL_VERSION) {
+			packet >> interpolation_delay;
+		}
 	}
 
 	cerr << "Join request from " << format_ip_address(address) << ": Client protocol version: " << client_proto_version << ", Client gameplay version: " << client_compat_version << endl;
 
-	if (client_proto_version != PROTOCOL_VERSION || client_compat_version != COMPAT_VERSION) {
+	if (!is_supported_version || client_compat_version != COMPAT_VERSION) {
 		cerr << "Rejected join for incompatible client version." << endl;
 		reject_join(address, "Incompatible version.  Please upgrade your client.");
 		return;
@@ -561,7 +736,8 @@ void	Server::join(const IPAddress& address, PacketReader& packet) {
 	}
 
 	// Register this player with the network
-	m_network.register_peer(address, packet.connection_id(), 1, packet.sequence_no() + 1);
+	// (Clients newer than the text-only protocol can be sent binary packets, and the newest are sent WORLD_SNAPSHOTs)
+	m_network.register_peer(address, packet.connection_id(), 1, packet.sequence_no() + 1, client_proto_version);
 
 	// Get a unique name for the player
 	string			name(get_unique_player_name(requested_name.c_str()));
@@ -570,6 +746,7 @@ void	Server::join(const IPAddress& address, PacketReader& packet) {
 
 	uint32_t		player_id = m_next_player_id++;
 	ServerPlayer&		new_player = m_players[player_id].init(player_id, address, client_proto_version, name.c_str(), team, m_timeout_queue);
+	new_player.set_interpolation_delay(interpolation_delay);
 
 	cerr << requested_name << ": Joined on team " << team << ", with ID " << player_id << endl;
 
@@ -629,7 +806,8 @@ void	Server::info(const IPAddress& address, PacketReader& request_packet) {
 void	Server::player_jumped(const IPAddress& address, PacketReader& packet) {
 	uint32_t	player_id;
 	float		direction;
-	packet >> player_id >> direction;
+	uint32_t	input_sequence;
+	packet >> player_id >> direction >> input_sequence; // (0 from older clients)
 	
 	if (is_authorized(address, player_id)) {
 		// Re-broadcast the packet to all _other_ players
@@ -639,6 +817,7 @@ void	Server::player_jumped(const IPAddress& address, PacketReader& packet) {
 		if (m_game_logic != NULL) {
 			m_game_logic->attempt_jump(player_id, direction);
 		}
+		get_player(player_id)->applied_input(input_sequence);
 		
 		broadcast_packet_except(outbound_packet, player_id);
 	}
@@ -657,6 +836,10 @@ void	Server::player_to_server_update(const IPAddress& address, PacketReader& inb
 
 		// Process the update packet
 		player->read_player_to_server_update_packet(inbound_packet);
+
+		uint32_t	input_sequence;
+		inbound_packet >> input_sequence; // (0 from older clients)
+		player->applied_input(input_sequence);
 	}
 }
 
@@ -753,7 +936,7 @@ void	Server::release_player_resources(ServerPlayer& player) {
 	--m_team_count[player.get_team() - 'A'];
 }
 
-void	Server::start()
+void	Server::start(const UDPSocket* shared_socket)
 {
 	if (!load_map(m_config.get<const char*>("map"))) {
 		throw Exception("Failed to load map.");
@@ -763,7 +946,9 @@ void	Server::start()
 		throw Exception("Failed to resolve the interface address.  Please make sure it's correct.");
 	}
 
-	if (!m_network.start(m_listen_address)) {
+	if (shared_socket != NULL) {
+		m_network.start(*shared_socket);
+	} else if (!m_network.start(m_listen_address, std::max(m_config.get<int>("network_threads"), 0))) {
 		throw Exception("Failed to start server network on interface and port.");
 	}
 
@@ -772,6 +957,17 @@ void	Server::start()
 
 	m_register_with_metaserver = m_config.get<bool>("register_server");
 
+	m_relevance_filter = m_config.get<bool>("relevance_filter");
+	m_relevance_view_width = m_config.get<float>("relevance_view_width");
+	m_relevance_view_height = m_config.get<float>("relevance_view_height");
+	m_relevance_update_interval = std::max(m_config.get<uint32_t>("relevance_update_interval"), uint32_t(1));
+
+	m_player_update_rate = std::max(m_config.get<uint64_t>("player_update_rate"), uint64_t(1));
+
+	m_validate_hits = m_config.get<bool>("validate_hits");
+	m_hit_tolerance = m_config.get<float>("hit_tolerance");
+	m_max_rewind = m_config.get<uint64_t>("max_rewind");
+
 	if (m_register_with_metaserver) {
 		// TODO: better error messages if meta server address can't be resolved
 		if (const char* metaserver_address = getenv("LM_METASERVER")) {
@@ -788,120 +984,117 @@ void	Server::start()
 	if (m_register_with_metaserver) {
 		register_with_metaserver();
 	}
+
+	m_is_running = true;
+	m_next_player_update = get_ticks_usec();
 }
 
 void	Server::run()
 {
-	m_is_running = true;
-	uint64_t last_logic_update = get_ticks();
-	uint64_t last_player_update = get_ticks();
-	
-	set<uint32_t> frozen_players;
-	
 	while (m_is_running) {
-		timeout_players();
-		m_network.resend_acks();
-
-		if (m_register_with_metaserver && get_ticks() - m_last_metaserver_contact_time >= m_metaserver_contact_frequency) {
-			register_with_metaserver();
+		update();
+
+		// Sleep until there's something to do, or until packets arrive
+		uint64_t	sleep_time = server_sleep_time();
+		uint64_t	deadline = get_ticks_usec() + sleep_time;
+		if (!m_network.receive_packets(sleep_time) && sleep_time != EventPoller::NO_TIMEOUT) {
+			uint64_t	now = get_ticks_usec();
+			if (now >= deadline) {
+				m_wake_lateness.record(now - deadline);
+			}
 		}
+	}
 
-		if (round_in_progress() && !m_players.empty()) {
-			// Update the status of the gates
-			if (get_gate('A').update()) {
-				report_gate_status('A', 0, 0);
-			}
-			if (get_gate('B').update()) {
-				report_gate_status('B', 0, 0);
-			}
+	shutdown();
+}
 
-			m_game_mode->check_state();
+void	Server::update()
+{
+	timeout_players();
+	m_network.resend_acks();
+	m_network.send_pending_acks();
 
-			if (get_gate('A').is_open()) {
-				m_game_mode->gate_open('A');
-			} else if (get_gate('B').is_open()) {
-				m_game_mode->gate_open('B');
-			}
+	if (m_register_with_metaserver && get_ticks() - m_last_metaserver_contact_time >= m_metaserver_contact_frequency) {
+		register_with_metaserver();
+	}
 
-			if (m_params.game_timeout && time_since_spawn() > m_params.game_timeout) {
-				m_game_mode->game_timeout();
-			}
-			
-			// Spawn any players who joined after the game started and are now ready to join:
-			spawn_waiting_players();
-
-		} else if (waiting_to_spawn()) {
-			if (time_until_spawn() == 0) {
-				frozen_players.clear();
-				start_game();
-			}
+	if (round_in_progress() && !m_players.empty()) {
+		// Update the status of the gates
+		if (get_gate('A').update()) {
+			report_gate_status('A', 0, 0);
 		}
-		
-		uint64_t diff = get_ticks() - last_logic_update;
-		
-		float curr_logic_update = 0;
-		
-		if (diff > 10) {
-			curr_logic_update = get_ticks();
-			if (m_game_logic != NULL) {
-				uint64_t extratime = m_game_logic->steps(diff);
-				
-				// Keep track of the extra time between updates.
-				curr_logic_update -= extratime;
-				
-				// Check for newly-dead players or players engaging gates:
-				for (PlayerMap::iterator it(m_players.begin()); it != m_players.end(); ++it) {
-					ServerPlayer& player = it->second;
-					
-					// Check for gates
-					char team = get_other_team(player. get_team());
-					bool is_engaged = m_game_logic->is_engaging_gate(player.get_id(), team);
-					if (get_gate(team).set_engagement(is_engaged, player.get_id())) {
-						report_gate_status(team, is_engaged ? 1 : -1, player.get_id());
-					}
-				
-					// Check for frozen
-					if (frozen_players.find(player.get_id()) != frozen_players.end()) {
-						if (!player.is_frozen()) {
-							frozen_players.erase(player.get_id());
-						}
-					} else {
-						if (player.is_frozen()) {
-							frozen_players.insert(player.get_id());
-							if (player.get_freeze_source() != NULL) {
-								broadcast_player_died(&player);
-							}
-						}
-					}
-					
-					
-				}
-			}
+		if (get_gate('B').update()) {
+			report_gate_status('B', 0, 0);
 		}
-		
-		// Check if we need to re-send player updates.
-		float curr_time = get_ticks();
-		if (last_player_update <= curr_time - PLAYER_UPDATE_RATE) {
-			last_player_update = curr_time;
-			
-			for (PlayerMap::iterator it(m_players.begin()); it != m_players.end(); ++it) {
-				ServerPlayer& player = it->second;
-				send_player_update(&player);
-			}
+
+		m_game_mode->check_state();
+
+		if (get_gate('A').is_open()) {
+			m_game_mode->gate_open('A');
+		} else if (get_gate('B').is_open()) {
+			m_game_mode->gate_open('B');
 		}
-		
-		m_network.receive_packets(0); // old version: server_sleep_time()
-		
-		if (curr_logic_update != 0) {
-			last_logic_update = curr_logic_update;
+
+		if (m_params.game_timeout && time_since_spawn() > m_params.game_timeout) {
+			m_game_mode->game_timeout();
 		}
 		
-		float totaltime = get_ticks() - last_logic_update;
+		// Spawn any players who joined after the game started and are now ready to join:
+		spawn_waiting_players();
+
+	} else if (waiting_to_spawn()) {
+		if (time_until_spawn() == 0) {
+			m_frozen_players.clear();
+			start_game();
+		}
+	}
+	
+	uint64_t	now = get_ticks_usec();
+	
+	if (m_game_logic != NULL && now >= m_logic_clock.get_next_tick_time()) {
+		run_logic_ticks(now);
+	}
+	
+	// Check if we need to re-send player updates.
+	if (now >= m_next_player_update) {
+		m_next_player_update += m_player_update_rate * 1000ULL;
+		if (m_next_player_update <= now) {
+			// We've missed at least one whole update - don't try to make up for it
+			m_next_player_update = now + m_player_update_rate * 1000ULL;
+		}
 		
-		if (totaltime < 17) {
-			msleep(17 - totaltime);
+		uint64_t	nbr_allocations = get_nbr_heap_allocations();
+		send_world_snapshots();
+		// Players with older clients are still sent a PLAYER_UPDATE for every player
+		for (PlayerMap::iterator it(m_players.begin()); it != m_players.end(); ++it) {
+			if (!it->second.receives_snapshots()) {
+				for (PlayerMap::iterator player_it(m_players.begin()); player_it != m_players.end(); ++player_it) {
+					send_player_update(&player_it->second);
+				}
+				break;
+			}
 		}
+		m_update_allocations.record(get_nbr_heap_allocations() - nbr_allocations);
 	}
+}
+
+void	Server::receive_packets(const UDPPacket* packets, size_t count)
+{
+	m_network.receive_packets(packets, count);
+}
+
+bool	Server::is_connected(const IPAddress& address) const
+{
+	return m_network.is_connected(address);
+}
+
+void	Server::shutdown()
+{
+	std::cerr << "Logic tick lateness (usec): " << m_tick_lateness << ", ticks dropped: " << m_logic_clock.get_nbr_dropped() << std::endl;
+	std::cerr << "Main loop wake lateness (usec): " << m_wake_lateness << std::endl;
+	std::cerr << "Heap allocations per player update round: " << m_update_allocations << std::endl;
+	std::cerr << "Heap allocations per logic step: " << m_step_allocations << std::endl;
+	std::cerr << "World snapshot size (bytes): " << m_snapshot_sizes << std::endl;
 
 	// Kick any players still in the game!
 	// XXX: do we still want to send a SHUTDOWN packet?  Maybe SHUTDOWN is not necessary...
@@ -916,6 +1109,44 @@ void	Server::run()
 
 void	Server::stop() {
 	m_is_running = false;
+	m_network.wake();
+}
+
+void	Server::run_logic_ticks(uint64_t now) {
+	// If we've fallen too far behind to catch up, the clock drops the ticks we can't make up
+	// (Any ticks the clock drops are the oldest ones due, so the ticks to run are the latest)
+	for (unsigned int nbr_ticks = m_logic_clock.advance(now); nbr_ticks > 0; --nbr_ticks) {
+		uint64_t	nbr_allocations = get_nbr_heap_allocations();
+		m_game_logic->step(m_logic_clock.get_tick() - nbr_ticks + 1);
+		m_step_allocations.record(get_nbr_heap_allocations() - nbr_allocations);
+	}
+	m_tick_lateness.record(m_logic_clock.get_lateness());
+
+	// Check for newly-dead players or players engaging gates:
+	for (PlayerMap::iterator it(m_players.begin()); it != m_players.end(); ++it) {
+		ServerPlayer& player = it->second;
+		
+		// Check for gates
+		char team = get_other_team(player. get_team());
+		bool is_engaged = m_game_logic->is_engaging_gate(player.get_id(), team);
+		if (get_gate(team).set_engagement(is_engaged, player.get_id())) {
+			report_gate_status(team, is_engaged ? 1 : -1, player.get_id());
+		}
+	
+		// Check for frozen
+		if (m_frozen_players.find(player.get_id()) != m_frozen_players.end()) {
+			if (!player.is_frozen()) {
+				m_frozen_players.erase(player.get_id());
+			}
+		} else {
+			if (player.is_frozen()) {
+				m_frozen_players.insert(player.get_id());
+				if (player.get_freeze_source() != NULL) {
+					broadcast_player_died(&player);
+				}
+			}
+		}
+	}
 }
 
 void	Server::restart() { // TODO
@@ -1011,8 +1242,10 @@ void	Server::start_game() {
 
 	delete_game_logic();
 	m_game_logic = new GameLogic(&m_current_map);
+	m_game_logic->set_records_history(m_validate_hits);
+	m_logic_clock.reset(get_ticks_usec());
 
-	const std::list<WeaponReader>&	const_weapons(m_weapon_set.get_weapons());
+	const std::list<WeaponReader>&	const_weapons(m_weapon_set->get_weapons());
 	std::list<WeaponReader> weapons(const_weapons);
 	size_t index = 0;
 
@@ -1093,17 +1326,9 @@ void	Server::gate_update(const IPAddress& address, PacketReader& packet) {
 	}
 }
 
-uint32_t	Server::server_sleep_time() const {
-	/*
-	 * Intentionally cap the server sleep time at the largest unsigned 32-bit integer,
-	 * because this function is returning a uint32_t, since all network timeouts use
-	 * uint32_t's.  This is because some OS's (*cough*, Mac OS X, *cough*) have undefined
-	 * maximums for timeouts being passed to select().  Keeping everything 32-bit means we
-	 * shouldn't exceed this undefined max.  It's OK if the server has to wake up every 49
-	 * days.
-	 * ("A wait of 49 days should be sufficient to keep it from busywaiting" -- Jeffrey)
-	 */
-	uint64_t	sleep_time = std::numeric_limits<uint32_t>::max();
+uint64_t	Server::server_sleep_time() const {
+	// All of the deadlines below except for the main loop's own are in milliseconds
+	uint64_t	sleep_time = numeric_limits<uint64_t>::max() / 1000;
 
 	if (m_register_with_metaserver) {
 		uint64_t	time_since_contact = get_ticks() - m_last_metaserver_contact_time;
@@ -1128,6 +1353,26 @@ uint32_t	Server::server_sleep_time() const {
 		sleep_time = std::min(sleep_time, m_network.time_until_ack_resend());
 	}
 
+	if (m_network.has_pending_acks()) {
+		sleep_time = std::min(sleep_time, m_network.time_until_acks_due());
+	}
+
+	if (sleep_time == numeric_limits<uint64_t>::max() / 1000) {
+		sleep_time = EventPoller::NO_TIMEOUT;
+	} else {
+		sleep_time *= 1000;
+	}
+
+	// Take into account logic ticks and player updates, which are scheduled in microseconds
+	uint64_t	now = get_ticks_usec();
+	if (m_game_logic != NULL) {
+		uint64_t	next_logic_tick = m_logic_clock.get_next_tick_time();
+		sleep_time = std::min(sleep_time, next_logic_tick > now ? next_logic_tick - now : 0);
+	}
+	if (!m_players.empty()) {
+		sleep_time = std::min(sleep_time, m_next_player_update > now ? m_next_player_update - now : 0);
+	}
+
 	return sleep_time;
 }
 
@@ -1237,15 +1482,15 @@ void	Server::reject_join(const IPAddress& addr, const char* why) {
 }
 
 bool	Server::load_map(const char* map_name) {
-	string		map_filename(map_name);
-	map_filename += ".map";
+	const string*	map_file = m_resources.get_map_file(map_name);
+	if (map_file == NULL) {
+		return false;
+	}
 
-	ifstream file(m_path_manager.data_path(map_filename.c_str(), "maps"));
+	istringstream	file(*map_file);
 	if (!m_current_map.load(file)) {
-		file.close();
 		return false;
 	}
-	file.close();
 
 	// 1. Reset the game parameters to their hard-coded internal defaults
 	m_params.reset();
@@ -1256,8 +1501,10 @@ bool	Server::load_map(const char* map_name) {
 	// 3. Set game parameters that are specified in the server-wide config
 	m_params.init_from_config(m_config);
 
-	// 4. Initialize the weapon set
-	m_weapon_set.load_file(m_params.weapon_set.c_str(), m_path_manager.data_path(m_params.weapon_set.c_str(), "weapons"));
+	// 4. Initialize the weapon set (keeping the current one if the new one can't be loaded)
+	if (const WeaponFile* weapon_set = m_resources.get_weapon_set(m_params.weapon_set)) {
+		m_weapon_set = weapon_set;
+	}
 
 	// 5. Initialize the game mode for this map
 	init_game_mode();
@@ -1582,7 +1829,7 @@ void	Server::broadcast_player_died(const ServerPlayer* dead_player, const Server
 }
 
 void	Server::broadcast_weapons(const ServerPlayer* player) {
-	const std::list<WeaponReader>&	weapons(m_weapon_set.get_weapons());
+	const std::list<WeaponReader>&	weapons(m_weapon_set->get_weapons());
 	size_t				index = 0;
 
 	for (std::list<WeaponReader>::const_iterator it(weapons.begin()); it != weapons.end(); ++it) {
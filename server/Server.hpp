@@ -33,6 +33,10 @@
 #include "common/GameParameters.hpp"
 #include "common/team.hpp"
 #include "common/WeaponFile.hpp"
+#include "common/TimingStats.hpp"
+#include "common/TickClock.hpp"
+#include "common/Packet.hpp"
+#include "common/Snapshot.hpp"
 #include <stdint.h>
 #include <math.h>
 #include <map>
@@ -44,10 +48,14 @@
 
 namespace LM {
 	class PacketReader;
-	class PathManager;
+	class ServerResources;
+	class UDPPacket;
+	class UDPSocket;
 	class IPAddress;
 	class ServerConfig;
 	class GameLogic;
+	class RayCast;
+	class Weapon;
 	
 	class Server {
 	public:
@@ -56,11 +64,16 @@ namespace LM {
 		// Internal time constants - should not be set by user
 		// in milliseconds
 		enum {
-			PLAYER_UPDATE_RATE = 34,
 			GATE_UPDATE_FREQUENCY = 100,		// When a gate is down, update players at least once every 100 ms
 			PLAYER_TIMEOUT = 10000			// Kick players who have not updated for 10 seconds
 		};
 
+		// Main loop scheduling constants
+		// in microseconds (unless noted)
+		enum {
+			MAX_CATCHUP_TICKS = 5			// Most logic ticks to run back-to-back before giving up on catching up (in ticks)
+		};
+
 	private:
 		typedef std::map<uint32_t, ServerPlayer> PlayerMap;	// A std::map from player_id to the player object
 	
@@ -73,7 +86,7 @@ namespace LM {
 		// Game State
 		//
 		ServerConfig&		m_config;
-		PathManager&		m_path_manager;
+		ServerResources&	m_resources;
 		GameParameters		m_params;
 		bool			m_is_running;		// When this is false, run() stops its main loop
 		IPAddress		m_listen_address;	// The address the server's listening on
@@ -83,7 +96,7 @@ namespace LM {
 		uint32_t		m_next_player_id;	// Used to allocate next player ID
 		PlayerMap		m_players;
 		ServerMap		m_current_map;
-		WeaponFile		m_weapon_set;
+		const WeaponFile*	m_weapon_set;		// Shared through m_resources
 		std::auto_ptr<GameModeHelper>	m_game_mode;
 		std::vector<GateStatus>	m_gates;		// [0] = Team A's gate  [1] = Team B's gate
 		uint64_t		m_game_start_time;	// Time at which the game started
@@ -93,6 +106,35 @@ namespace LM {
 		int			m_team_score[2];	// [0] = team A's score  [1] = team B's score
 		
 		GameLogic*		m_game_logic;
+
+		//
+		// Main loop scheduling (times are in microseconds, as returned by get_ticks_usec())
+		//
+		TickClock		m_logic_clock;		// Schedules GameLogic steps
+		uint64_t		m_next_player_update;	// Time at which player updates are next due
+		std::set<uint32_t>	m_frozen_players;	// Players known to be frozen (so newly-frozen players can be detected)
+		TimingStats		m_tick_lateness;	// How late each batch of logic ticks ran, relative to when the latest was due
+		TimingStats		m_wake_lateness;	// How late the main loop woke up, relative to the deadline it slept until
+
+		Packet			m_player_update_packet;	// Re-used for every player update, so sending updates doesn't allocate memory
+		Snapshot		m_world_snapshot;	// The latest snapshot of all players (each player is sent a filtered copy)
+		uint32_t		m_last_snapshot_id;
+
+		// Interest management (see ServerConfig)
+		bool			m_relevance_filter;
+		float			m_relevance_view_width;
+		float			m_relevance_view_height;
+		uint32_t		m_relevance_update_interval;
+
+		uint64_t		m_player_update_rate;	// How often players are sent WORLD_SNAPSHOTs (in milliseconds; see ServerConfig)
+
+		// Lag compensation (see ServerConfig)
+		bool			m_validate_hits;
+		float			m_hit_tolerance;
+		uint64_t		m_max_rewind;
+		TimingStats		m_snapshot_sizes;	// Size of each WORLD_SNAPSHOT packet (in bytes)
+		TimingStats		m_update_allocations;	// Heap allocations made by each round of player updates (should be 0 once warmed up)
+		TimingStats		m_step_allocations;	// Heap allocations made by each logic step (likewise)
 	
 		//
 		// Meta server stuff
@@ -121,6 +163,8 @@ namespace LM {
 		// Game logic stuff:
 		bool			round_in_progress() const;
 		void			delete_game_logic();
+		// Check a hit reported by the shooter against where the players were when the shooter fired
+		bool			is_valid_hit(const Weapon& weapon, const ServerPlayer& shooter, const ServerPlayer& shot_player, const Packet::PlayerHit& hitdata) const;
 	
 		//
 		// Network Helpers
@@ -143,7 +187,17 @@ namespace LM {
 		void			send_new_round_packets(const ServerPlayer* player =NULL); // Also broadcasts game and weapon info
 		void			send_round_start_packet(const ServerPlayer* player =NULL);
 		void			broadcast_player_died(const ServerPlayer* dead_player, const ServerPlayer* except = NULL);
-		void			send_player_update(Player* player);
+		void			send_player_update(Player* player);	// Only to players who aren't sent WORLD_SNAPSHOTs
+
+		// Take a snapshot of all the players, and send each player who receives WORLD_SNAPSHOTs the snapshot,
+		// delta-encoded against the latest snapshot the player has acknowledged.
+		void			send_world_snapshots();
+		void			send_player_updates_to(const ServerPlayer& recipient);	// For when a WORLD_SNAPSHOT doesn't fit in a packet
+
+		// Should the recipient be sent the other player's current state in the given snapshot?
+		// Always true for players within the recipient's view and not hidden by an obstacle.  Otherwise, only true
+		// for every m_relevance_update_interval'th snapshot.
+		bool			is_update_due(const ServerPlayer& recipient, const ServerPlayer& other, uint32_t snapshot_id, RayCast& ray_cast) const;
 
 		// Send all the relevant game parameters to the client (should be called at the beginning of each new game)
 		// If player is NULL, broadcast to all players, otherwise only to specific player
@@ -251,11 +305,11 @@ namespace LM {
 		// Main Loop Helpers
 		//
 	
-		// What's the maximum amount of time the server should sleep for between requests? (in milliseconds)
-		uint32_t		server_sleep_time() const;
+		// Run all the GameLogic steps which are due, and check for newly-dead players or players engaging gates
+		void			run_logic_ticks(uint64_t now);
 	
 	public:
-		Server (ServerConfig& config, PathManager& path_manager);
+		Server (ServerConfig& config, ServerResources& resources);
 	
 		// Get information about gate times
 		uint64_t get_gate_open_time(size_t nbr_players) const {
@@ -281,13 +335,27 @@ namespace LM {
 		void		player_died(const IPAddress& address, PacketReader& packet);
 		void		player_jumped(const IPAddress& address, PacketReader& packet);
 		void		player_to_server_update(const IPAddress& address, PacketReader& packet);
+		void		snapshot_ack(const IPAddress& address, PacketReader& packet);
 
 		void		excessive_packet_drop(const IPAddress& address);
 	
-		void		start();
+		// If shared_socket isn't NULL, the server sends from it instead of binding its own socket,
+		// and whoever reads from it must pass this server's packets to receive_packets().
+		void		start(const UDPSocket* shared_socket =NULL);
+		// run() repeatedly calls update() and waits for packets, until stop() is called, and then calls shutdown()
 		void		run();
 		void		stop();
 		void		restart();
+
+		// For running the server from someone else's main loop (e.g. an ArenaHost's)
+		void		update();				// Do everything that's due
+		void		receive_packets(const UDPPacket* packets, size_t count);
+		uint64_t	server_sleep_time() const;		// How long until update() has something to do (in microseconds)
+		void		shutdown();				// Kick all the players, and print statistics
+
+		bool		is_running() const { return m_is_running; }
+		bool		is_connected(const IPAddress& address) const;
+		size_t		get_nbr_players() const { return m_players.size(); }
 	};
 }
 
@@ -34,5 +34,30 @@ void ServerConfig::reset() {
 	set("map", "alpha1");
 	set("portno", uint16_t(DEFAULT_PORTNO));
 	set("register_server", true);
+
+	// Independent games to host on the one port (see ArenaHost), and threads to run them on (0 = one per processor)
+	set("arenas", 1);
+	set("arena_threads", 0);
+
+	// Threads to receive and re-order packets on, away from the game (0 = receive on the game's thread)
+	set("network_threads", 0);
+
+	// How often players' states are sent to clients (in milliseconds).  Clients interpolate between states,
+	// so this can be raised to save bandwidth, as long as it stays below the clients' interpolation delay
+	set("player_update_rate", 34);
+
+	// Interest management: players outside a client's view (in game units, centered on the client's player),
+	// or hidden from it by obstacles, are only included in every Nth WORLD_SNAPSHOT sent to that client
+	set("relevance_filter", false);
+	set("relevance_view_width", 2048);
+	set("relevance_view_height", 1536);
+	set("relevance_update_interval", 4);
+
+	// Lag compensation: hits reported by clients are checked against where the players were when the shooter fired,
+	// rewinding by the shooter's round trip time plus its interpolation delay (at most max_rewind milliseconds),
+	// with players' boxes grown by hit_tolerance game units
+	set("validate_hits", true);
+	set("hit_tolerance", 12);
+	set("max_rewind", 500);
 }
 
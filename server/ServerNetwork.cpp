@@ -24,28 +24,62 @@
 
 #include "ServerNetwork.hpp"
 #include "Server.hpp"
+#include "ReceiveThread.hpp"
 #include "common/Exception.hpp"
 #include "common/network.hpp"
 #include "common/PacketWriter.hpp"
 #include "common/PacketReader.hpp"
 #include "common/UDPPacket.hpp"
 #include "common/IPAddress.hpp"
+#include "common/BinaryWriter.hpp"
+#include "common/Snapshot.hpp"
 #include <stdio.h>
 #include <stdlib.h>
-#ifndef __WIN32
-#include <signal.h>
-#endif
 
 using namespace LM;
 using namespace std;
 
-bool	ServerNetwork::start(const IPAddress& bind_address) {
+ServerNetwork::~ServerNetwork() {
+	for (size_t i = 0; i < m_receive_threads.size(); ++i) {
+		delete m_receive_threads[i];
+	}
+}
+
+bool	ServerNetwork::start(const IPAddress& bind_address, size_t nbr_receive_threads) {
 	// TODO: check to make sure server isn't listening already
 
 	m_ack_manager.clear();
 	m_peers.clear();
 
-	return m_socket.bind(bind_address);
+	if (nbr_receive_threads > 1 && !m_socket.set_reuse_port()) {
+		// Packets can't be shared out between several sockets here
+		nbr_receive_threads = 1;
+	}
+
+	if (!m_socket.bind(bind_address)) {
+		return false;
+	}
+
+	if (nbr_receive_threads == 0) {
+		return m_poller.add(m_socket.get_fd());
+	}
+
+	// The first thread reads from our own socket (which we still send from), and the others bind sockets of their own.
+	// Receive threads only wake our poller once they've handed packets over.
+	for (size_t i = 0; i < nbr_receive_threads; ++i) {
+		m_receive_threads.push_back(new ReceiveThread(m_poller));
+		if (!(i == 0 ? m_receive_threads.back()->start(m_socket) : m_receive_threads.back()->start(bind_address))) {
+			return false;
+		}
+	}
+	return true;
+}
+
+void	ServerNetwork::start(const UDPSocket& shared_socket) {
+	m_ack_manager.clear();
+	m_peers.clear();
+
+	m_socket.share(shared_socket);
 }
 
 void	ServerNetwork::send_reliable_packet(const IPAddress& address, const PacketWriter& packet) {
@@ -55,116 +89,228 @@ void	ServerNetwork::send_reliable_packet(const IPAddress& address, const PacketW
 		return;
 	}
 
+	PacketBody	body(packet.get_data(), packet.get_length());
 	PacketHeader	header(packet.packet_type(), peer->next_sequence_no++, peer->connection_id);
-	send_packet(address, header, packet.packet_data());
-	m_ack_manager.add_packet(address, header, packet.packet_data());
+	send_packet(address, header, body);
+	m_ack_manager.add_packet(address, header, body);
 }
 
+// The broadcast functions marshal the packet body once, and then share it between all of the peers' datagrams
+// (and the AckManager) - only the header is written separately for each peer.
+
 void	ServerNetwork::broadcast_packet(const PacketWriter& packet, const IPAddress* exclude_peer) {
+	SendBatch	batch(*this);
+	PacketBody	body(packet.get_data(), packet.get_length());
+
 	for (std::map<IPAddress, Peer>::iterator it(m_peers.begin()); it != m_peers.end(); ++it) {
 		if (exclude_peer && *exclude_peer == it->first) {
 			continue;
 		}
 
-		send_packet(it->first, packet);
+		send_packet(it->first, packet.get_header(), body);
 	}
 }
 
-void	ServerNetwork::broadcast_reliable_packet(const PacketWriter& packet, const IPAddress* exclude_peer) {
-	AckManager::PacketHandle	ack_handle(m_ack_manager.add_broadcast_packet(packet.packet_data()));
+void	ServerNetwork::broadcast_packet(Packet* packet, const IPAddress* exclude_peer, bool exclude_snapshot_peers) {
+	SendBatch	batch(*this);
+
+	packet->header = PacketHeader(packet->type, 0, 0);
+
+	// The binary encoding is complete, header and all, since it's the same for every peer
+	PacketBody	binary_packet;
+	if (packet->marshal_binary()) {
+		binary_packet = PacketBody(packet->raw.get_data(), packet->raw.get_length());
+	}
+
+	// The text encoding is only marshalled if any peers need it
+	PacketWriter	text_packet(packet->type);
+	PacketBody	text_body;
+	bool		is_marshalled = false;
 
 	for (std::map<IPAddress, Peer>::iterator it(m_peers.begin()); it != m_peers.end(); ++it) {
-		if (exclude_peer && *exclude_peer == it->first) {
+		if ((exclude_peer && *exclude_peer == it->first) || (exclude_snapshot_peers && it->second.world_snapshots)) {
 			continue;
 		}
 
-		PacketHeader	header(packet.packet_type(), it->second.next_sequence_no++, it->second.connection_id);
-		send_packet(it->first, header, packet.packet_data());
-		m_ack_manager.add_broadcast_recipient(ack_handle, it->first, header);
+		if (it->second.binary_packets && !binary_packet.is_empty()) {
+			send_raw_packet(it->first, binary_packet);
+		} else {
+			if (!is_marshalled) {
+				packet->marshal(text_packet);
+				text_body = PacketBody(text_packet.get_data(), text_packet.get_length());
+				is_marshalled = true;
+			}
+			send_packet(it->first, packet->header, text_body);
+		}
 	}
 }
 
-void	ServerNetwork::broadcast_reliable_packet(Packet* packet, const IPAddress* exclude_peer) {
-	AckManager::PacketHandle	ack_handle(m_ack_manager.add_broadcast_packet(*packet));
+void	ServerNetwork::broadcast_reliable_packet(const PacketWriter& packet, const IPAddress* exclude_peer) {
+	SendBatch			batch(*this);
+	PacketBody			body(packet.get_data(), packet.get_length());
+	AckManager::PacketHandle	ack_handle(m_ack_manager.add_broadcast_packet(body));
 
 	for (std::map<IPAddress, Peer>::iterator it(m_peers.begin()); it != m_peers.end(); ++it) {
 		if (exclude_peer && *exclude_peer == it->first) {
 			continue;
 		}
 
-		PacketHeader header = PacketHeader(packet->type, it->second.next_sequence_no++, it->second.connection_id);
-		send_packet_to(it->first, packet);
+		PacketHeader	header(packet.packet_type(), it->second.next_sequence_no++, it->second.connection_id);
+		send_packet(it->first, header, body);
 		m_ack_manager.add_broadcast_recipient(ack_handle, it->first, header);
 	}
 }
 
-bool	ServerNetwork::receive_packets(uint32_t timeout) {
-#ifndef __WIN32
-	// Now is an ideal time to handle signals, so unblock all signals
-	sigset_t		old_sigset;
-	sigset_t		new_sigset;
-	sigemptyset(&new_sigset);
-	sigprocmask(SIG_SETMASK, &new_sigset, &old_sigset);
-#endif
+void	ServerNetwork::broadcast_reliable_packet(Packet* packet, const IPAddress* exclude_peer) {
+	PacketWriter	text_packet(packet->type);
+	packet->marshal(text_packet);
+	broadcast_reliable_packet(text_packet, exclude_peer);
+}
 
-	// Block until packets are received, timeout has elapsed, or a signal has been received.
-	bool		has_packets = true;
-	if (timeout != 0) {
-		has_packets = m_socket.has_packets(timeout);
+size_t	ServerNetwork::send_world_snapshot(const IPAddress& dest, const Snapshot& snapshot, const Snapshot* baseline, uint64_t send_time, uint32_t input_sequence, uint64_t input_age) {
+	PacketHeader	header(WORLD_SNAPSHOT_PACKET, 0, 0);
+	add_acks(dest, header);
+	BinaryWriter	w(m_snapshot_packet);
+	w.put_header(header);
+	w.put_varint(snapshot.get_id());
+	w.put_varint(baseline ? baseline->get_id() : 0);
+	if (Peer* peer = get_peer(dest)) {
+		if (peer->input_acks) {
+			w.put_varint(input_sequence);
+			w.put_varint(input_age);
+		}
+		if (peer->timed_snapshots) {
+			w.put_varint(send_time);
+		}
 	}
+	snapshot.write(w, baseline);
 
-#ifndef __WIN32
-	// Restore the old signal mask
-	sigprocmask(SIG_SETMASK, &old_sigset, NULL);
-#endif
+	if (w.has_overflowed()) {
+		return 0;
+	}
+
+	m_snapshot_packet.set_address(dest);
+	send_raw_packet(m_snapshot_packet);
+	return m_snapshot_packet.get_length();
+}
 
-	if (!has_packets) {
+bool	ServerNetwork::receive_packets(uint64_t timeout_usec) {
+	if (!m_receive_threads.empty()) {
+		bool	has_received = false;
+		for (size_t i = 0; i < m_receive_threads.size(); ++i) {
+			has_received |= m_receive_threads[i]->has_received();
+		}
+		if (!has_received) {
+			// Our poller is only woken once there's something to process (or by wake())
+			m_poller.wait(timeout_usec);
+		}
+
+		SendBatch	batch(*this);
+		bool		processed = false;
+		for (size_t i = 0; i < m_receive_threads.size(); ++i) {
+			processed |= process_received(*m_receive_threads[i]);
+		}
+		return processed;
+	}
+
+	// Block until packets are received, timeout has elapsed, or a signal has been received.
+	// Signals are unblocked only for the duration of the wait, which is an ideal time to handle them.
+	if (m_poller.wait(timeout_usec) != EventPoller::READABLE) {
 		// Socket does not have packets to receive - timeout must have elapsed, or a signal was received
 		return false;
 	}
 
-	UDPPacket	raw_packet(MAX_PACKET_LENGTH);
+	// ACKs and any other packets sent while processing are sent together, after each batch
+	SendBatch	batch(*this);
+	size_t		nbr_received;
 
 	// Receive all the packets we can.
-	while (receive_raw_packet(raw_packet)) {
-		PacketReader	packet(raw_packet);
-
-		if (packet.sequence_no()) {
-			try {
-				// High reliability packet
-				// Immediately send an ACK
-				send_ack(raw_packet.get_address(), packet);
-
-				if (Peer* peer = get_peer(raw_packet.get_address())) {
-					if (packet.connection_id() == peer->connection_id && peer->packet_queue.push_r(packet)) {
-						// Ready to be processed now.
-						process_packet(raw_packet.get_address(), packet);
-
-						// Process any other packets that might be waiting in the queue from this peer.
-						while (peer->packet_queue.has_packet_r()) {
-							process_packet(raw_packet.get_address(), peer->packet_queue.peek_r());
-							peer->packet_queue.pop_r();
-						}
-					} else if (packet.connection_id() > peer->connection_id) {
-						// From a newer connection than is currently registered
-						// Process the packet, but we can't attempt any re-ordering.
-						// What should happen (on a JOIN) is the Server class detects the duplicate connection,
-						// un-registers the current peer, and re-registers it with the new connection ID
-						process_packet(raw_packet.get_address(), packet);
+	do {
+		nbr_received = m_socket.recv_batch(m_recv_batch);
+		for (size_t i = 0; i < nbr_received; ++i) {
+			receive_packet(m_recv_batch[i]);
+		}
+		flush_send_batch();
+	} while (nbr_received == m_recv_batch.get_capacity());
+
+	return true;
+}
+
+void	ServerNetwork::receive_packets(const UDPPacket* packets, size_t count) {
+	SendBatch	batch(*this);
+	for (size_t i = 0; i < count; ++i) {
+		receive_packet(packets[i]);
+	}
+}
+
+void	ServerNetwork::receive_packet(const UDPPacket& raw_packet) {
+	PacketReader	packet(raw_packet);
+
+	// Any packet may carry acknowledgements of our reliable packets
+	process_acks(raw_packet.get_address(), packet.get_header());
+
+	if (packet.sequence_no()) {
+		try {
+			// High reliability packet
+			acknowledge(raw_packet.get_address(), packet.get_header());
+
+			if (Peer* peer = get_peer(raw_packet.get_address())) {
+				if (packet.connection_id() == peer->connection_id && peer->packet_queue.push(raw_packet, packet.sequence_no())) {
+					// Ready to be processed now.
+					process_packet(raw_packet.get_address(), packet);
+
+					// Process any other packets that might be waiting in the queue from this peer.
+					while (peer->packet_queue.has_packet()) {
+						peer->packet_queue.pop(m_queued_packet);
+						PacketReader	queued_packet(m_queued_packet);
+						process_packet(raw_packet.get_address(), queued_packet);
 					}
-				} else {
-					// From an unbound peer, so we can't attempt to re-order it, but we can process it anyways
+				} else if (packet.connection_id() > peer->connection_id) {
+					// From a newer connection than is currently registered
+					// Process the packet, but we can't attempt any re-ordering.
+					// What should happen (on a JOIN) is the Server class detects the duplicate connection,
+					// un-registers the current peer, and re-registers it with the new connection ID
 					process_packet(raw_packet.get_address(), packet);
 				}
-			} catch (PacketQueue::FullQueueException) {
-				m_server.excessive_packet_drop(raw_packet.get_address());
+			} else {
+				// From an unbound peer, so we can't attempt to re-order it, but we can process it anyways
+				process_packet(raw_packet.get_address(), packet);
 			}
-		} else {
-			// Low reliability packet - we don't care if, when, or how often it arrives
-			process_packet(raw_packet.get_address(), packet);
+		} catch (PacketQueue::FullQueueException) {
+			m_server.excessive_packet_drop(raw_packet.get_address());
 		}
+	} else {
+		// Low reliability packet - we don't care if, when, or how often it arrives
+		process_packet(raw_packet.get_address(), packet);
 	}
-	return true;
+}
+
+// The receive thread has already done the re-ordering that receive_packet() does
+bool	ServerNetwork::process_received(ReceiveThread& receive_thread) {
+	// Only process what's already there, so a steady stream of packets can't keep us from returning
+	size_t	nbr_received = receive_thread.get_nbr_received();
+	for (size_t i = 0; i < nbr_received; ++i) {
+		const ReceiveThread::Received*	received = receive_thread.get_front();
+		const IPAddress&	address(received->packet.get_address());
+
+		if (received->actions & ReceiveThread::Received::ARRIVED) {
+			// Any packet may carry acknowledgements of our reliable packets
+			process_acks(address, received->header);
+			if (received->header.sequence_no) {
+				acknowledge(address, received->header);
+			}
+		}
+		if (received->actions & ReceiveThread::Received::PROCESS) {
+			PacketReader	packet(received->packet);
+			process_packet(address, packet);
+		}
+		if (received->actions & ReceiveThread::Received::EXCESSIVE_DROP) {
+			m_server.excessive_packet_drop(address);
+		}
+
+		receive_thread.pop();
+	}
+	return nbr_received != 0;
 }
 
 void	ServerNetwork::process_packet(const IPAddress& address, PacketReader& reader) {
@@ -236,6 +382,10 @@ void	ServerNetwork::process_packet(const IPAddress& address, PacketReader& reade
 	case PLAYER_TO_SERVER_UPDATE_PACKET:
 		m_server.player_to_server_update(address, reader);
 		break;
+
+	case SNAPSHOT_ACK_PACKET:
+		m_server.snapshot_ack(address, reader);
+		break;
 	}
 }
 
@@ -244,13 +394,44 @@ CommonNetwork::Peer*	ServerNetwork::get_peer(const IPAddress& addr) {
 	return it != m_peers.end() ? &it->second : NULL;
 }
 
-void	ServerNetwork::register_peer(const IPAddress& address, uint32_t connection_id, uint64_t next_send_sequence_no, uint64_t next_receive_sequence_no) {
+void	ServerNetwork::send_due_acks(uint64_t now) {
+	for (map<IPAddress, Peer>::iterator it(m_peers.begin()); it != m_peers.end(); ++it) {
+		send_pending_ack(it->first, it->second, now);
+	}
+}
+
+const PacketQueue*	ServerNetwork::get_packet_queue(const IPAddress& address) const {
+	if (!m_receive_threads.empty()) {
+		// The receive threads keep the real queues to themselves
+		return NULL;
+	}
+	map<IPAddress, Peer>::const_iterator	it(m_peers.find(address));
+	return it != m_peers.end() ? &it->second.packet_queue : NULL;
+}
+
+void	ServerNetwork::register_peer(const IPAddress& address, uint32_t connection_id, uint64_t next_send_sequence_no, uint64_t next_receive_sequence_no, int protocol_version) {
 	m_ack_manager.clear_peer(address);
-	m_peers[address].init(connection_id, next_send_sequence_no, next_receive_sequence_no);
+	Peer&	peer(m_peers[address]);
+	peer.init(connection_id, next_send_sequence_no, next_receive_sequence_no);
+	peer.binary_packets = protocol_version >= BINARY_PROTOCOL_VERSION;
+	peer.world_snapshots = protocol_version >= SNAPSHOT_PROTOCOL_VERSION;
+	peer.piggyback_acks = protocol_version > SNAPSHOT_PROTOCOL_VERSION;
+	peer.input_acks = protocol_version > PIGGYBACK_PROTOCOL_VERSION;
+	peer.timed_snapshots = protocol_version > INPUT_ACK_PROTOCOL_VERSION;
+
+	for (size_t i = 0; i < m_receive_threads.size(); ++i) {
+		m_receive_threads[i]->register_peer(address, connection_id, next_receive_sequence_no);
+	}
 }
 
 void	ServerNetwork::unregister_peer(const IPAddress& address) {
+	// Packets already sent to the peer (e.g. its LEAVE) are still resent until they're ACKed or given up on
+	m_ack_manager.release_peer(address);
 	m_peers.erase(address);
+
+	for (size_t i = 0; i < m_receive_threads.size(); ++i) {
+		m_receive_threads[i]->unregister_peer(address);
+	}
 }
 
 void	ServerNetwork::excessive_packet_drop(const IPAddress& peer) {
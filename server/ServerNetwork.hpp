@@ -27,24 +27,52 @@
 
 #include "common/CommonNetwork.hpp"
 #include "common/PacketWriter.hpp"
+#include "common/EventPoller.hpp"
+#include "common/network.hpp"
 #include <stdint.h>
 #include <string>
 #include <map>
+#include <vector>
 
 namespace LM {
 	class Server;
 	class PacketWriter;
 	class UDPPacket;
 	class IPAddress;
+	class Snapshot;
+	class ReceiveThread;
 	
 	class ServerNetwork : public CommonNetwork {
 	private:
 		// A reference to our owning Server object
 		Server&		m_server;
 
+		// Waits for the socket to become readable (or for a timeout, signal, or wake())
+		EventPoller	m_poller;
+
+		// Incoming packets are received into here, a batch at a time
+		UDPPacketBatch	m_recv_batch;
+
+		// Re-used for every WORLD_SNAPSHOT sent
+		UDPPacket	m_snapshot_packet;
+
+		// Packets taken from a peer's PacketQueue are copied into here to be processed
+		UDPPacket	m_queued_packet;
+
+		// If not empty, these receive the packets, and receive_packets() processes what they hand over
+		std::vector<ReceiveThread*>	m_receive_threads;
+
 		// Map of addresses to their NetworkPeer objects
 		std::map<IPAddress, Peer>	m_peers;
-		Peer*	get_peer(const IPAddress&); // Convenience function to lookup in m_peers map
+		virtual Peer*	get_peer(const IPAddress&); // Convenience function to lookup in m_peers map
+
+		virtual void	send_due_acks(uint64_t now);
+
+		// Send an ACK for (if necessary), re-order, and process an individual raw packet which has been received
+		void		receive_packet(const UDPPacket& raw_packet);
+
+		// Process everything a receive thread has handed over.  Returns true if there was anything.
+		bool		process_received(ReceiveThread& receive_thread);
 
 		// Process an individual packet which has been received
 		void		process_packet(const IPAddress& peer_address, PacketReader& packet);
@@ -53,10 +81,16 @@ namespace LM {
 	
 	public:
 		explicit ServerNetwork(Server& s) : m_server(s) { }
+		~ServerNetwork();
 
 		// "Listen" on given address
+		// If nbr_receive_threads is non-zero, packets are received and re-ordered by that many threads
+		// (each with its own socket, where supported - otherwise just one thread).
 		//  Returns true if successfully listened, false otherwise
-		bool		start(const IPAddress& address);
+		bool		start(const IPAddress& address, size_t nbr_receive_threads =0);
+		// Send from a socket which someone else reads from (and which must outlive us):
+		// they pass the packets to receive_packets(packets, count) instead
+		void		start(const UDPSocket& shared_socket);
 	
 		// TODO: bring back stop() and is_running() functions
 
@@ -64,8 +98,12 @@ namespace LM {
 		/*
 		 * Peer functions
 		 */
-		void		register_peer(const IPAddress&, uint32_t connection_id, uint64_t next_send_sequence_no, uint64_t next_receive_sequence_no);
+		// The peer's protocol version determines whether it is sent binary-encoded packets, and WORLD_SNAPSHOTs
+		void		register_peer(const IPAddress&, uint32_t connection_id, uint64_t next_send_sequence_no, uint64_t next_receive_sequence_no, int protocol_version =TEXT_PROTOCOL_VERSION);
 		void		unregister_peer(const IPAddress&);
+		// For the peer's reordering statistics (NULL if the peer isn't registered, or receive threads are used)
+		const PacketQueue*	get_packet_queue(const IPAddress&) const;
+		bool		is_connected(const IPAddress& address) const { return m_peers.count(address) != 0; }
 
 
 		/*
@@ -73,9 +111,14 @@ namespace LM {
 		 */
 	
 		// Process all packets and notify the server of their receipt
-		// Wait up to the given timeout (in ms) for packets
-		// Returns: true if packets were received, false if timeout or signal happened first
-		bool		receive_packets(uint32_t timeout);
+		// Wait up to the given timeout (in microseconds) for packets
+		// Returns: true if packets were received, false if timeout, signal, or wake() happened first
+		bool		receive_packets(uint64_t timeout_usec);
+		// Process packets which were received by someone else (see start(shared_socket))
+		void		receive_packets(const UDPPacket* packets, size_t count);
+
+		// Interrupt a concurrent (or the next) call to receive_packets() - safe to call from a signal handler
+		void		wake() { m_poller.wake(); }
 
 
 		/*
@@ -91,8 +134,20 @@ namespace LM {
 		void		broadcast_reliable_packet(const PacketWriter& packet, const IPAddress* exclude_peer =NULL);
 		void		broadcast_reliable_packet(Packet* packet, const IPAddress* exclude_peer=NULL);
 		void		broadcast_packet(const PacketWriter& packet, const IPAddress* exclude_peer =NULL);
+		// Each peer is sent the packet binary-encoded if it understands binary packets, otherwise as text
+		// If exclude_snapshot_peers is true, peers which are sent WORLD_SNAPSHOTs are skipped.
+		void		broadcast_packet(Packet* packet, const IPAddress* exclude_peer =NULL, bool exclude_snapshot_peers =false);
 		
 		void		send_packet_to(const IPAddress& dest, Packet* packet) { CommonNetwork::send_packet(dest, packet); }
+
+		// Send a WORLD_SNAPSHOT to the given address, delta-encoded against the given baseline (if not NULL)
+		// Peers which number their inputs are also told the last input applied, and how many milliseconds ago,
+		// and newer peers are told the send_time (from get_ticks()), so they can time the snapshot by our clock.
+		// Returns the size of the packet sent, or 0 (and sends nothing) if the snapshot doesn't fit in a packet.
+		size_t		send_world_snapshot(const IPAddress& dest, const Snapshot& snapshot, const Snapshot* baseline, uint64_t send_time, uint32_t input_sequence =0, uint64_t input_age =0);
+
+		// While one of these exists, sent packets are collected up and sent all at once
+		using CommonNetwork::SendBatch;
 	};
 }
 
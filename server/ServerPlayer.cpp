@@ -35,6 +35,10 @@ ServerPlayer::ServerPlayer() {
 	m_is_op = false;
 	m_spawnpoint = NULL;
 	m_join_time = m_last_seen_time = m_team_change_time = 0;
+	m_acked_snapshot_id = 0;
+	m_last_input_sequence = 0;
+	m_last_input_time = 0;
+	m_interpolation_delay = 0;
 }
 
 ServerPlayer& ServerPlayer::init(uint32_t player_id, const IPAddress& address, int client_version, const char* name, char team, ServerPlayer::Queue& timeout_queue) {
@@ -44,6 +48,11 @@ ServerPlayer& ServerPlayer::init(uint32_t player_id, const IPAddress& address, i
 
 	m_address = address;
 	m_client_version = client_version;
+	m_acked_snapshot_id = 0;
+	m_sent_snapshots.clear();
+	m_last_input_sequence = 0;
+	m_last_input_time = 0;
+	m_interpolation_delay = 0;
 
 	m_join_time = m_last_seen_time = get_ticks();
 
@@ -53,6 +62,13 @@ ServerPlayer& ServerPlayer::init(uint32_t player_id, const IPAddress& address, i
 	return *this;
 }
 
+void ServerPlayer::applied_input(uint32_t sequence) {
+	if (sequence > m_last_input_sequence) {
+		m_last_input_sequence = sequence;
+		m_last_input_time = get_ticks();
+	}
+}
+
 void ServerPlayer::reset_join_time() {
 	m_join_time = get_ticks();
 }
@@ -27,6 +27,8 @@
 
 #include "common/Player.hpp"
 #include "common/IPAddress.hpp"
+#include "common/network.hpp"
+#include "common/Snapshot.hpp"
 #include <stdint.h>
 #include <list>
 
@@ -48,6 +50,12 @@ namespace LM {
 		uint64_t	m_join_time;		// The tick time at which the player joined the game
 		uint64_t	m_last_seen_time;	// The tick time at which this player was last seen (i.e. last had a packet from)
 		uint64_t	m_team_change_time;	// The tick time at which this player last changed teams
+
+		uint32_t	m_acked_snapshot_id;	// The latest WORLD_SNAPSHOT the player has acknowledged (0 if none)
+		SnapshotHistory	m_sent_snapshots;	// The WORLD_SNAPSHOTs most recently sent to this player (as filtered for this player)
+		uint32_t	m_last_input_sequence;	// The latest numbered input from the player that has been applied (0 if none)
+		uint64_t	m_last_input_time;	// The tick time at which it was applied
+		uint64_t	m_interpolation_delay;	// How far behind the server the player's client shows other players (in milliseconds)
 	
 		// Iterator into a list which keeps track of when players were last seen:
 		Queue::iterator	m_timeout_queue_position;
@@ -58,6 +66,7 @@ namespace LM {
 		// Standard getters
 		const IPAddress& get_address() const { return m_address; }
 		int		get_client_version() const { return m_client_version; }
+		bool		receives_snapshots() const { return m_client_version >= SNAPSHOT_PROTOCOL_VERSION; }
 	
 		bool		is_op() const { return m_is_op; }
 		void		set_is_op(bool isop) { m_is_op = isop; }
@@ -76,6 +85,21 @@ namespace LM {
 		void		set_team_change_time();		// Set the time to now
 		uint64_t	get_team_change_time() const { return m_team_change_time; }
 	
+		// For delta-encoding WORLD_SNAPSHOTs against the latest snapshot the player has
+		uint32_t	get_acked_snapshot_id() const { return m_acked_snapshot_id; }
+		SnapshotHistory& get_sent_snapshots() { return m_sent_snapshots; }
+		const SnapshotHistory& get_sent_snapshots() const { return m_sent_snapshots; }
+		void		ack_snapshot(uint32_t id) { if (id > m_acked_snapshot_id) { m_acked_snapshot_id = id; } }	// Ignores out-of-order acks
+
+		// For client-side prediction: the latest of the player's numbered inputs that has been applied (0 if none), and when
+		uint32_t	get_last_input_sequence() const { return m_last_input_sequence; }
+		uint64_t	get_last_input_time() const { return m_last_input_time; }
+		void		applied_input(uint32_t sequence);	// Ignores unnumbered (0) and out-of-order inputs
+
+		// For checking hits against where the player saw the other players
+		uint64_t	get_interpolation_delay() const { return m_interpolation_delay; }
+		void		set_interpolation_delay(uint64_t delay) { m_interpolation_delay = delay; }
+
 		// For time out handling
 		void		seen(Queue& timeout_queue);	// Update last seen time
 		bool		has_timed_out() const;		// True if this player has timed out
@@ -0,0 +1,71 @@
+/*
+ * server/ServerResources.cpp
+ *
+ * This file is part of Leges Motus, a networked, 2D shooter set in zero gravity.
+ * 
+ * Copyright 2009-2011 Andrew Ayer, Nathan Partlan, Jeffrey Pfau
+ * 
+ * Leges Motus is free and open source software.  You may redistribute it and/or
+ * modify it under the terms of version 2, or (at your option) version 3, of the
+ * GNU General Public License (GPL), as published by the Free Software Foundation.
+ * 
+ * Leges Motus is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.  See the full text of the GNU General Public License for
+ * further detail.
+ * 
+ * For a full copy of the GNU General Public License, please see the COPYING file
+ * in the root of the source code tree.  You may also retrieve a copy from
+ * <http://www.gnu.org/licenses/gpl-2.0.txt>, or request a copy by writing to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ * 02111-1307  USA
+ * 
+ */
+
+#include "ServerResources.hpp"
+#include "common/PathManager.hpp"
+#include "common/misc.hpp"
+#include <fstream>
+#include <iterator>
+
+using namespace LM;
+using namespace std;
+
+ServerResources::ServerResources(PathManager& path_manager) : m_path_manager(path_manager) {
+}
+
+const string*	ServerResources::get_map_file(const string& map_name) {
+	Mutex::Lock		lock(m_mutex);
+
+	MapFiles::iterator	it(m_map_files.find(map_name));
+	if (it == m_map_files.end()) {
+		ifstream	file(m_path_manager.data_path((map_name + ".map").c_str(), "maps"));
+		if (!file) {
+			return NULL;
+		}
+		string		contents((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+		it = m_map_files.insert(make_pair(map_name, contents)).first;
+	}
+
+	return &it->second;
+}
+
+const WeaponFile*	ServerResources::get_weapon_set(const string& name) {
+	Mutex::Lock		lock(m_mutex);
+
+	WeaponSets::iterator	it(m_weapon_sets.find(name));
+	if (it == m_weapon_sets.end()) {
+		WeaponFile	weapon_set;
+		if (!weapon_set.load_file(name.c_str(), m_path_manager.data_path(name.c_str(), "weapons"))) {
+			return NULL;
+		}
+		it = m_weapon_sets.insert(make_pair(name, weapon_set)).first;
+	}
+
+	return &it->second;
+}
+
+void	ServerResources::list_map_files(list<string>& filenames) {
+	Mutex::Lock		lock(m_mutex);
+	scan_directory(filenames, m_path_manager.data_path("", "maps"));
+}
@@ -0,0 +1,72 @@
+/*
+ * server/ServerResources.hpp
+ *
+ * This file is part of Leges Motus, a networked, 2D shooter set in zero gravity.
+ * 
+ * Copyright 2009-2011 Andrew Ayer, Nathan Partlan, Jeffrey Pfau
+ * 
+ * Leges Motus is free and open source software.  You may redistribute it and/or
+ * modify it under the terms of version 2, or (at your option) version 3, of the
+ * GNU General Public License (GPL), as published by the Free Software Foundation.
+ * 
+ * Leges Motus is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.  See the full text of the GNU General Public License for
+ * further detail.
+ * 
+ * For a full copy of the GNU General Public License, please see the COPYING file
+ * in the root of the source code tree.  You may also retrieve a copy from
+ * <http://www.gnu.org/licenses/gpl-2.0.txt>, or request a copy by writing to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ * 02111-1307  USA
+ * 
+ */
+
+#ifndef LM_SERVER_SERVERRESOURCES_HPP
+#define LM_SERVER_SERVERRESOURCES_HPP
+
+#include "common/WeaponFile.hpp"
+#include "common/Thread.hpp"
+#include <string>
+#include <list>
+#include <map>
+
+namespace LM {
+	class PathManager;
+
+	/*
+	 * The game files a Server loads, which never change once they're loaded: map files and weapon sets.
+	 *
+	 * Servers which share one of these (e.g. the arenas run by an ArenaHost) share a single copy
+	 * of each file.  It's thread-safe, and nothing is unloaded until it's destroyed, so the pointers
+	 * it returns stay valid for as long as it exists.
+	 */
+	class ServerResources {
+	private:
+		typedef std::map<std::string, std::string> MapFiles;	// The contents of each map file, by map name
+		typedef std::map<std::string, WeaponFile> WeaponSets;	// Each weapon set, by name
+
+		PathManager&	m_path_manager;
+		Mutex		m_mutex;	// Guards everything here (PathManager returns paths in a shared buffer)
+		MapFiles	m_map_files;
+		WeaponSets	m_weapon_sets;
+
+		// Not copyable
+		ServerResources(const ServerResources&);
+		ServerResources& operator=(const ServerResources&);
+
+	public:
+		explicit ServerResources(PathManager& path_manager);
+
+		// The contents of the named map's file, or NULL if it can't be read
+		const std::string*	get_map_file(const std::string& map_name);
+
+		// The named weapon set, or NULL if it can't be loaded
+		const WeaponFile*	get_weapon_set(const std::string& name);
+
+		// Fill the list with the names of the files in the maps directory
+		void			list_map_files(std::list<std::string>& filenames);
+	};
+}
+
+#endif
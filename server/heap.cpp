@@ -0,0 +1,73 @@
+/*
+ * server/heap.cpp
+ *
+ * This file is part of Leges Motus, a networked, 2D shooter set in zero gravity.
+ * 
+ * Copyright 2009-2011 Andrew Ayer, Nathan Partlan, Jeffrey Pfau
+ * 
+ * Leges Motus is free and open source software.  You may redistribute it and/or
+ * modify it under the terms of version 2, or (at your option) version 3, of the
+ * GNU General Public License (GPL), as published by the Free Software Foundation.
+ * 
+ * Leges Motus is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.  See the full text of the GNU General Public License for
+ * further detail.
+ * 
+ * For a full copy of the GNU General Public License, please see the COPYING file
+ * in the root of the source code tree.  You may also retrieve a copy from
+ * <http://www.gnu.org/licenses/gpl-2.0.txt>, or request a copy by writing to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ * 02111-1307  USA
+ * 
+ */
+
+#include "heap.hpp"
+#include <new>
+#include <cstdlib>
+
+// operator new must be declared with an exception specification before C++11, and without one after
+#if __cplusplus >= 201103L
+#define LM_THROWS_BAD_ALLOC
+#define LM_THROWS_NOTHING noexcept
+#else
+#define LM_THROWS_BAD_ALLOC throw (std::bad_alloc)
+#define LM_THROWS_NOTHING throw ()
+#endif
+
+using namespace LM;
+using namespace std;
+
+namespace {
+	// Per thread, so that arenas running side by side on the ThreadPool don't count each other's
+	// allocations (and so that allocating doesn't contend on one shared counter)
+	__thread uint64_t	nbr_heap_allocations = 0;
+
+	void*	counted_malloc(size_t size) {
+		++nbr_heap_allocations;
+		if (void* ptr = malloc(size ? size : 1)) {
+			return ptr;
+		}
+		throw bad_alloc();
+	}
+}
+
+uint64_t	LM::get_nbr_heap_allocations() {
+	return nbr_heap_allocations;
+}
+
+void*	operator new(size_t size) LM_THROWS_BAD_ALLOC {
+	return counted_malloc(size);
+}
+
+void*	operator new[](size_t size) LM_THROWS_BAD_ALLOC {
+	return counted_malloc(size);
+}
+
+void	operator delete(void* ptr) LM_THROWS_NOTHING {
+	free(ptr);
+}
+
+void	operator delete[](void* ptr) LM_THROWS_NOTHING {
+	free(ptr);
+}
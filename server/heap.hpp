@@ -0,0 +1,37 @@
+/*
+ * server/heap.hpp
+ *
+ * This file is part of Leges Motus, a networked, 2D shooter set in zero gravity.
+ * 
+ * Copyright 2009-2011 Andrew Ayer, Nathan Partlan, Jeffrey Pfau
+ * 
+ * Leges Motus is free and open source software.  You may redistribute it and/or
+ * modify it under the terms of version 2, or (at your option) version 3, of the
+ * GNU General Public License (GPL), as published by the Free Software Foundation.
+ * 
+ * Leges Motus is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.  See the full text of the GNU General Public License for
+ * further detail.
+ * 
+ * For a full copy of the GNU General Public License, please see the COPYING file
+ * in the root of the source code tree.  You may also retrieve a copy from
+ * <http://www.gnu.org/licenses/gpl-2.0.txt>, or request a copy by writing to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ * 02111-1307  USA
+ * 
+ */
+
+#ifndef LM_SERVER_HEAP_HPP
+#define LM_SERVER_HEAP_HPP
+
+#include <stdint.h>
+
+namespace LM {
+	// The number of times the global operator new has been called by the calling thread.
+	// heap.cpp replaces operator new to keep count, so that the main loop can check that its
+	// steady-state work doesn't allocate memory.  Only compare counts taken on the same thread.
+	uint64_t	get_nbr_heap_allocations();
+}
+
+#endif
@@ -24,6 +24,8 @@
 
 #include "Server.hpp"
 #include "ServerConfig.hpp"
+#include "ServerResources.hpp"
+#include "ArenaHost.hpp"
 #include "common/Exception.hpp"
 #include "common/network.hpp"
 #include "common/PathManager.hpp"
@@ -41,6 +43,7 @@ using namespace std;
 
 namespace {
 	auto_ptr<Server>		server;
+	auto_ptr<ArenaHost>		arena_host;	// Used instead of server if there's more than one arena
 
 	void display_usage(const char* progname) {
 		cout << "Usage: " << progname << " [OPTION]" << endl;
@@ -70,12 +73,18 @@ namespace {
 
 	void	graceful_termination_handler (int)
 	{
-		server->stop();
+		if (arena_host.get()) {
+			arena_host->stop();
+		} else {
+			server->stop();
+		}
 	}
 
 	void	restart_server_handler (int)
 	{
-		server->restart();
+		if (server.get()) {
+			server->restart();
+		}
 	}
 
 	void	init_signals () {
@@ -112,7 +121,9 @@ namespace {
 }
 
 extern "C" void clean_exit() {
-	if (server.get()) {
+	if (arena_host.get()) {
+		arena_host->stop();
+	} else if (server.get()) {
 		server->stop();
 	}
 }
@@ -179,10 +190,15 @@ extern "C" int main(int argc, char* argv[]) try {
 	}
 
 	PathManager		path_manager(argv[0]);
-
-	server.reset(new Server(config, path_manager));
-
-	server->start();
+	ServerResources		resources(path_manager);
+
+	if (config.get<int>("arenas") > 1) {
+		arena_host.reset(new ArenaHost(config, resources, config.get<int>("arenas"), config.get<int>("arena_threads")));
+		arena_host->start();
+	} else {
+		server.reset(new Server(config, resources));
+		server->start();
+	}
 
 	if (username || groupname) {
 		drop_privileges(username, groupname);
@@ -194,7 +210,11 @@ extern "C" int main(int argc, char* argv[]) try {
 
 	init_signals();
 
-	server->run();
+	if (arena_host.get()) {
+		arena_host->run();
+	} else {
+		server->run();
+	}
 
 	return 0;
 
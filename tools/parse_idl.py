@@ -35,6 +35,38 @@ class ParseError(Exception):
     def __str__(self):
         return self._msg
 
+# How each field type is written to a BinaryWriter and read from a BinaryReader.
+# Definitions with fields of any other type have no binary encoding, and are always sent as text.
+binaryPut = {
+    'uint32_t': 'w.put_varint({0});',
+    'uint64_t': 'w.put_varint({0});',
+    'size_t': 'w.put_varint({0});',
+    'int': 'w.put_signed_varint({0});',
+    'float': 'w.put_float({0});',
+    'bool': 'w.put_bool({0});',
+    'char': 'w.put_char({0});',
+    'string': 'w.put_string(*{0});',
+    'Point': 'w.put_point(*{0});',
+}
+
+binaryGet = {
+    'uint32_t': '{0} = r.get_varint();',
+    'uint64_t': '{0} = r.get_varint();',
+    'size_t': '{0} = r.get_varint();',
+    'int': '{0} = r.get_signed_varint();',
+    'float': '{0} = r.get_float();',
+    'bool': '{0} = r.get_bool();',
+    'char': '{0} = r.get_char();',
+    'string': '{0} = r.get_string();',
+    'Point': '{0} = r.get_point();',
+}
+
+def hasBinary(definition):
+    for field in definition.fields:
+        if field.type not in binaryPut:
+            return False
+    return True
+
 def CamelCase(string):
     string = string.lower()
     while string.find('_') >= 0:
@@ -192,7 +224,13 @@ def outputHpp(interface):
     code.append('\t\tvoid clear();')
     code.append('\t\tvoid free();')
     code.append('\t\tvoid marshal();')
+    code.append('\t\t// Write just the fields (not the header) as text')
+    code.append('\t\tvoid marshal(PacketWriter& w);')
+    code.append('\t\t// Returns false (leaving raw in an unspecified state) if this type of packet has no binary encoding')
+    code.append('\t\tbool marshal_binary();')
+    code.append('\t\t// Handles both text and binary packets')
     code.append('\t\tvoid unmarshal();')
+    code.append('\t\tvoid unmarshal_binary();')
     code.append('\t\tvoid dispatch({0}Receiver* r);'.format(interface.name, interface.name.lower()))
     for item in interface.definitions:
         code.append('\t\tstruct {0} {{'.format(CamelCase(item.name)))
@@ -226,6 +264,8 @@ def outputHpp(interface):
 def outputCpp(interface):
     code = ['// Auto-generated by parse_idl.py\n',
             '#include "{0}.hpp"'.format(interface.name),
+            '#include "BinaryWriter.hpp"',
+            '#include "BinaryReader.hpp"',
             '#include <cstring>\n',
             'using namespace LM;',
             'using namespace std;\n']
@@ -241,6 +281,17 @@ def outputCpp(interface):
             code.append('\tr >> p->{0}.{1};'.format(item.name.lower(), field.name))
         code.append('}\n')
 
+        if hasBinary(item):
+            code.append('static void marshal_binary_{1}(BinaryWriter& w, {0}* p) {{'.format(interface.name, item.name))
+            for field in item.fields:
+                code.append('\t' + binaryPut[field.type].format('p->{0}.{1}'.format(item.name.lower(), field.name)))
+            code.append('}\n')
+
+            code.append('static void unmarshal_binary_{1}(BinaryReader& r, {0}* p) {{'.format(interface.name, item.name))
+            for field in item.fields:
+                code.append('\t' + binaryGet[field.type].format('p->{0}.{1}'.format(item.name.lower(), field.name)))
+            code.append('}\n')
+
     code.append('{0}::{0}() {{'.format(interface.name))
     code.append('\tclear();');
     code.append('\ttype = ({0}Enum) 0;'.format(interface.name));
@@ -292,6 +343,11 @@ def outputCpp(interface):
 
     code.append('void {0}::marshal() {{'.format(interface.name))
     code.append('\tPacketWriter w(type, header);')
+    code.append('\tmarshal(w);')
+    code.append('\tw.fill_packet(raw);');
+    code.append('}\n')
+
+    code.append('void {0}::marshal(PacketWriter& w) {{'.format(interface.name))
     code.append('\tswitch(type) {')
     for item in interface.definitions:
         code.append('\tcase {1}_{0}:'.format(interface.name.upper(), item.name))
@@ -299,12 +355,29 @@ def outputCpp(interface):
         code.append('\t\tbreak;\n')
     code.append('\tdefault:');
     code.append('\t\tbreak;');
+    code.append('\t}')
+    code.append('}\n')
+
+    code.append('bool {0}::marshal_binary() {{'.format(interface.name))
+    code.append('\tBinaryWriter w(raw);')
+    code.append('\tw.put_header(PacketHeader(type, header.sequence_no, header.connection_id));')
+    code.append('\tswitch(type) {')
+    for item in interface.definitions:
+        if hasBinary(item):
+            code.append('\tcase {1}_{0}:'.format(interface.name.upper(), item.name))
+            code.append('\t\tmarshal_binary_{0}(w, this);'.format(item.name))
+            code.append('\t\tbreak;\n')
+    code.append('\tdefault:');
+    code.append('\t\treturn false;');
     code.append('\t}\n')
-    code.append('\traw.fill(w.get_header().make_string());');
-    code.append('\traw.append(w.packet_data());');
+    code.append('\treturn !w.has_overflowed();');
     code.append('}\n')
 
     code.append('void {0}::unmarshal() {{'.format(interface.name))
+    code.append('\tif (BinaryReader::is_binary(raw)) {')
+    code.append('\t\tunmarshal_binary();')
+    code.append('\t\treturn;')
+    code.append('\t}\n')
     code.append('\tPacketReader r(raw);')
     code.append('\ttype = ({0}Enum) r.packet_type();'.format(interface.name))
     code.append('\theader = r.get_header();')
@@ -318,6 +391,21 @@ def outputCpp(interface):
     code.append('\t}')
     code.append('}')
 
+    code.append('void {0}::unmarshal_binary() {{'.format(interface.name))
+    code.append('\tBinaryReader r(raw);')
+    code.append('\tr.get_header(header);')
+    code.append('\ttype = ({0}Enum) header.packet_type;'.format(interface.name))
+    code.append('\tswitch(type) {')
+    for item in interface.definitions:
+        if hasBinary(item):
+            code.append('\tcase {1}_{0}:'.format(interface.name.upper(), item.name))
+            code.append('\t\tunmarshal_binary_{0}(r, this);'.format(item.name))
+            code.append('\t\tbreak;\n')
+    code.append('\tdefault:');
+    code.append('\t\tbreak;');
+    code.append('\t}')
+    code.append('}')
+
     code.append('void {0}::dispatch({0}Receiver* r) {{'.format(interface.name))
     code.append('\tswitch(type) {')
     for item in interface.definitions: